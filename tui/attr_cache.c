@@ -0,0 +1,273 @@
+/**
+ * @file attr_cache.c
+ * @brief Functions for reading sysfs attributes using persistent file
+ * descriptors (an LRU bounded table of open attribute handles).
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <cdk.h>
+#include <sys/resource.h>
+
+#include "prototypes.h"
+#include "system.h"
+
+
+/* An open attribute handle; the handles are linked in LRU order (most
+ * recently used at the head) and chained in the hash buckets */
+typedef struct {
+    int fd;
+    unsigned long hash;
+    int lru_prev;
+    int lru_next;
+    int hash_next;
+    char path[MAX_SYSFS_PATH_SIZE];
+} attr_handle_t;
+
+/* The attribute handle table; only the collector (or batch mode) uses it for
+ * the per-tick counters, but it's per thread so a handle is never closed out
+ * from under a read in another thread */
+typedef struct {
+    int capacity;
+    int used;
+    int bucket_cnt;
+    int lru_head;
+    int lru_tail;
+    int free_list;
+    int *buckets;
+    attr_handle_t *handles;
+} attr_cache_t;
+__thread attr_cache_t g_attr_cache;
+
+
+/**
+ * @brief Setup the attribute handle table; it's sized so a number of
+ * descriptors (under the current soft limit for open files) are always left
+ * for everything else. The limit isn't raised, since the programs we run
+ * would inherit it. Return FALSE if we couldn't allocate the table.
+ */
+boolean initAttrCache() {
+    struct rlimit fd_limit = {0};
+    int i = 0, capacity = ATTR_CACHE_MAX_FDS;
+
+    if (g_attr_cache.handles != NULL)
+        return TRUE;
+
+    /* Figure out how many descriptors we can keep open */
+    if ((getrlimit(RLIMIT_NOFILE, &fd_limit) == 0) &&
+            (fd_limit.rlim_cur != RLIM_INFINITY) &&
+            (fd_limit.rlim_cur < (rlim_t) (capacity + ATTR_CACHE_FD_RESERVE)))
+        capacity = (int) fd_limit.rlim_cur - ATTR_CACHE_FD_RESERVE;
+    if (capacity < ATTR_CACHE_MIN_FDS)
+        capacity = ATTR_CACHE_MIN_FDS;
+
+    /* Power of two bucket count, at least twice the capacity */
+    g_attr_cache.bucket_cnt = 1;
+    while (g_attr_cache.bucket_cnt < (capacity * 2))
+        g_attr_cache.bucket_cnt <<= 1;
+
+    g_attr_cache.handles = calloc(capacity, sizeof (attr_handle_t));
+    g_attr_cache.buckets = calloc(g_attr_cache.bucket_cnt, sizeof (int));
+    if ((g_attr_cache.handles == NULL) || (g_attr_cache.buckets == NULL)) {
+        DEBUG_LOG("calloc(): %s", strerror(errno));
+        FREE_NULL(g_attr_cache.handles);
+        FREE_NULL(g_attr_cache.buckets);
+        return FALSE;
+    }
+    for (i = 0; i < g_attr_cache.bucket_cnt; i++)
+        g_attr_cache.buckets[i] = -1;
+    for (i = 0; i < capacity; i++) {
+        g_attr_cache.handles[i].fd = -1;
+        g_attr_cache.handles[i].hash_next = -1;
+        g_attr_cache.handles[i].lru_prev = -1;
+        g_attr_cache.handles[i].lru_next = ((i + 1) < capacity) ? (i + 1) : -1;
+    }
+    g_attr_cache.free_list = 0;
+    g_attr_cache.lru_head = -1;
+    g_attr_cache.lru_tail = -1;
+    g_attr_cache.capacity = capacity;
+    g_attr_cache.used = 0;
+    return TRUE;
+}
+
+
+/**
+ * @brief Unlink a handle from the LRU list.
+ */
+void lruUnlinkAttr(int handle) {
+    attr_handle_t *entry = &g_attr_cache.handles[handle];
+
+    if (entry->lru_prev != -1)
+        g_attr_cache.handles[entry->lru_prev].lru_next = entry->lru_next;
+    else
+        g_attr_cache.lru_head = entry->lru_next;
+    if (entry->lru_next != -1)
+        g_attr_cache.handles[entry->lru_next].lru_prev = entry->lru_prev;
+    else
+        g_attr_cache.lru_tail = entry->lru_prev;
+    entry->lru_prev = -1;
+    entry->lru_next = -1;
+}
+
+
+/**
+ * @brief Put a handle at the head (most recently used) of the LRU list.
+ */
+void lruPushAttr(int handle) {
+    attr_handle_t *entry = &g_attr_cache.handles[handle];
+
+    entry->lru_prev = -1;
+    entry->lru_next = g_attr_cache.lru_head;
+    if (g_attr_cache.lru_head != -1)
+        g_attr_cache.handles[g_attr_cache.lru_head].lru_prev = handle;
+    g_attr_cache.lru_head = handle;
+    if (g_attr_cache.lru_tail == -1)
+        g_attr_cache.lru_tail = handle;
+}
+
+
+/**
+ * @brief Close an attribute handle and put it back on the free list.
+ */
+void dropAttrHandle(int handle) {
+    attr_handle_t *entry = &g_attr_cache.handles[handle];
+    int *link = NULL;
+
+    /* Remove it from the hash chain */
+    link = &g_attr_cache.buckets[entry->hash &
+            (g_attr_cache.bucket_cnt - 1)];
+    while (*link != -1) {
+        if (*link == handle) {
+            *link = entry->hash_next;
+            break;
+        }
+        link = &g_attr_cache.handles[*link].hash_next;
+    }
+
+    /* Close it and move it to the free list */
+    lruUnlinkAttr(handle);
+    if (entry->fd != -1)
+        close(entry->fd);
+    entry->fd = -1;
+    entry->path[0] = '\0';
+    entry->hash_next = -1;
+    entry->lru_next = g_attr_cache.free_list;
+    g_attr_cache.free_list = handle;
+    g_attr_cache.used--;
+}
+
+
+/**
+ * @brief Close all of the cached attribute handles (for the calling thread).
+ */
+void closeAttrHandles() {
+    if (g_attr_cache.handles == NULL)
+        return;
+    while (g_attr_cache.lru_head != -1)
+        dropAttrHandle(g_attr_cache.lru_head);
+}
+
+
+/**
+ * @brief Return the handle for the given sysfs attribute path, opening it
+ * (and evicting the least recently used handle if the table is full) if it's
+ * not already open. Return -1 and set errno if the attribute can't be opened.
+ */
+int getAttrHandle(char sysfs_attr[]) {
+    unsigned long hash = 0;
+    int handle = 0, attr_fd = 0, bucket = 0;
+    attr_handle_t *entry = NULL;
+
+    if (!initAttrCache()) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    /* Look for an existing handle */
+    hash = hashRateKey(sysfs_attr);
+    bucket = hash & (g_attr_cache.bucket_cnt - 1);
+    for (handle = g_attr_cache.buckets[bucket]; handle != -1;
+            handle = g_attr_cache.handles[handle].hash_next) {
+        entry = &g_attr_cache.handles[handle];
+        if ((entry->hash == hash) && (strcmp(entry->path, sysfs_attr) == 0)) {
+            if (g_attr_cache.lru_head != handle) {
+                lruUnlinkAttr(handle);
+                lruPushAttr(handle);
+            }
+            return handle;
+        }
+    }
+
+    /* Not open yet */
+    if ((attr_fd = open(sysfs_attr, O_RDONLY | O_CLOEXEC)) == -1)
+        return -1;
+    if (g_attr_cache.free_list == -1)
+        dropAttrHandle(g_attr_cache.lru_tail);
+    handle = g_attr_cache.free_list;
+    entry = &g_attr_cache.handles[handle];
+    g_attr_cache.free_list = entry->lru_next;
+    entry->fd = attr_fd;
+    entry->hash = hash;
+    snprintf(entry->path, MAX_SYSFS_PATH_SIZE, "%s", sysfs_attr);
+    entry->hash_next = g_attr_cache.buckets[bucket];
+    g_attr_cache.buckets[bucket] = handle;
+    lruPushAttr(handle);
+    g_attr_cache.used++;
+    return handle;
+}
+
+
+/**
+ * @brief Read a sysfs attribute value using a persistent (cached) descriptor;
+ * the value is re-read with pread() at offset zero so sysfs generates it again.
+ * If the handle went stale (eg, the session logged out) we drop it and try
+ * opening the attribute once more. Like readAttribute(), only the first line
+ * is returned, the character array is filled with the error on failure, and
+ * the errno value is returned (zero on success).
+ */
+int readAttrCached(char sysfs_attr[], char attr_value[]) {
+    int handle = 0, tries = 0, ret_val = 0;
+    ssize_t read_size = 0;
+    char *remove_me = NULL;
+
+    for (tries = 0; tries < 2; tries++) {
+        if ((handle = getAttrHandle(sysfs_attr)) == -1) {
+            ret_val = errno;
+            snprintf(attr_value, MAX_SYSFS_ATTR_SIZE,
+                    "open(): %s", strerror(ret_val));
+            return ret_val;
+        }
+        read_size = pread(g_attr_cache.handles[handle].fd, attr_value,
+                (MAX_SYSFS_ATTR_SIZE - 1), 0);
+        if (read_size != -1)
+            break;
+        ret_val = errno;
+        dropAttrHandle(handle);
+        if ((ret_val != ENODEV) && (ret_val != ENOENT) &&
+                (ret_val != ESTALE) && (ret_val != EBADF))
+            break;
+    }
+    if (read_size == -1) {
+        snprintf(attr_value, MAX_SYSFS_ATTR_SIZE,
+                "pread(): %s", strerror(ret_val));
+        return ret_val;
+    }
+    attr_value[read_size] = '\0';
+
+    /* Only the first line (same as fgets) */
+    remove_me = strchr(attr_value, '\n');
+    if (remove_me) {
+        *remove_me = '\0';
+    }
+
+    /* Done */
+    return 0;
+}
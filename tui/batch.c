@@ -0,0 +1,237 @@
+/**
+ * @file batch.c
+ * @brief Headless (batch/stream) mode; the SCST target and session
+ * information is collected the same way as for the main screen, but is
+ * written to standard output as JSON or CSV records instead.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include <time.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "topology.h"
+#include "strings.h"
+
+
+/**
+ * @brief Write a string to the given stream as a JSON string (quoted, with
+ * the special/control characters escaped).
+ */
+void writeJSONStr(FILE *stream, const char *string) {
+    const unsigned char *curr_char = NULL;
+
+    fputc('"', stream);
+    for (curr_char = (const unsigned char *) string; *curr_char != '\0';
+            curr_char++) {
+        if ((*curr_char == '"') || (*curr_char == '\\')) {
+            fputc('\\', stream);
+            fputc(*curr_char, stream);
+        } else if (*curr_char < 0x20) {
+            fprintf(stream, "\\u%04x", *curr_char);
+        } else {
+            fputc(*curr_char, stream);
+        }
+    }
+    fputc('"', stream);
+}
+
+
+/**
+ * @brief Write a string to the given stream as a CSV field (only quoted if
+ * it needs to be, with any quotes doubled).
+ */
+void writeCSVStr(FILE *stream, const char *string) {
+    const char *curr_char = NULL;
+
+    if (strpbrk(string, ",\"\r\n") == NULL) {
+        fputs(string, stream);
+        return;
+    }
+    fputc('"', stream);
+    for (curr_char = string; *curr_char != '\0'; curr_char++) {
+        if (*curr_char == '"')
+            fputc('"', stream);
+        fputc(*curr_char, stream);
+    }
+    fputc('"', stream);
+}
+
+
+/**
+ * @brief Write one JSON record (a single line) for the given topology.
+ */
+void writeBatchJSON(FILE *stream, scst_topo_t *topo, time_t sample_time) {
+    scst_tgt_tbl_t *tgts = &topo->tgts;
+    scst_sess_tbl_t *sess = &topo->sess;
+    int i = 0, tgt = 0;
+
+    fprintf(stream, "{\"time\":%lld,\"scst_loaded\":%s,\"error\":",
+            (long long) sample_time, (topo->scst_loaded ? "true" : "false"));
+    if (topo->error_msg[0] != '\0')
+        writeJSONStr(stream, topo->error_msg);
+    else
+        fputs("null", stream);
+
+    /* Targets */
+    fputs(",\"targets\":[", stream);
+    for (i = 0; i < tgts->cnt; i++) {
+        fprintf(stream, "%s{\"driver\":", ((i != 0) ? "," : ""));
+        writeJSONStr(stream, poolStr(&topo->strings, tgts->driver[i]));
+        fputs(",\"name\":", stream);
+        writeJSONStr(stream, poolStr(&topo->strings, tgts->name[i]));
+        fprintf(stream, ",\"enabled\":%s,\"link_speed\":",
+                (tgts->enabled[i] ? "true" : "false"));
+        if (tgts->adapter[i] != -1)
+            writeJSONStr(stream, topo->adapters[tgts->adapter[i]].speed);
+        else
+            fputs("null", stream);
+        fputc('}', stream);
+    }
+
+    /* Sessions; the rates are null until we have two samples */
+    fputs("],\"sessions\":[", stream);
+    for (i = 0; i < sess->cnt; i++) {
+        tgt = sess->target[i];
+        fprintf(stream, "%s{\"driver\":", ((i != 0) ? "," : ""));
+        writeJSONStr(stream, poolStr(&topo->strings, tgts->driver[tgt]));
+        fputs(",\"target\":", stream);
+        writeJSONStr(stream, poolStr(&topo->strings, tgts->name[tgt]));
+        fputs(",\"session\":", stream);
+        writeJSONStr(stream, poolStr(&topo->strings, sess->name[i]));
+        fputs(",\"initiator\":", stream);
+        writeJSONStr(stream, poolStr(&topo->strings, sess->initiator[i]));
+        fprintf(stream, ",\"luns\":%d", sess->lun_cnt[i]);
+        fprintf(stream, ",\"active_cmds\":%d,\"read_io_kb\":%llu,"
+                "\"write_io_kb\":%llu", sess->active_cmds[i],
+                sess->read_io_kb[i], sess->write_io_kb[i]);
+        /* Not every SCST build has the command counts */
+        if (sess->has_cmd_cnts[i])
+            fprintf(stream, ",\"read_cmds\":%llu,\"write_cmds\":%llu",
+                    sess->read_cmds[i], sess->write_cmds[i]);
+        else
+            fputs(",\"read_cmds\":null,\"write_cmds\":null", stream);
+        if (sess->have_rate[i])
+            fprintf(stream, ",\"read_kbps\":%.1f,\"write_kbps\":%.1f,"
+                    "\"iops\":%.1f", sess->read_kbps[i], sess->write_kbps[i],
+                    sess->iops[i]);
+        else
+            fputs(",\"read_kbps\":null,\"write_kbps\":null,\"iops\":null",
+                    stream);
+        fputc('}', stream);
+    }
+    fputs("]}\n", stream);
+}
+
+
+/**
+ * @brief Write the CSV rows for the given topology; targets and sessions
+ * share one set of columns (the "type" column tells them apart) and the
+ * fields that don't apply to a row are left empty.
+ */
+void writeBatchCSV(FILE *stream, scst_topo_t *topo, time_t sample_time) {
+    scst_tgt_tbl_t *tgts = &topo->tgts;
+    scst_sess_tbl_t *sess = &topo->sess;
+    int i = 0, tgt = 0;
+
+    /* An error (or SCST not loaded) row, so the interval isn't just missing */
+    if (!topo->scst_loaded || topo->error_msg[0] != '\0') {
+        fprintf(stream, "%lld,error,,,,,", (long long) sample_time);
+        writeCSVStr(stream, (topo->scst_loaded ? topo->error_msg :
+                BATCH_NO_SCST_MSG));
+        fputs(",,,,,,,,,,\n", stream);
+    }
+
+    for (i = 0; i < tgts->cnt; i++) {
+        fprintf(stream, "%lld,target,", (long long) sample_time);
+        writeCSVStr(stream, poolStr(&topo->strings, tgts->driver[i]));
+        fputc(',', stream);
+        writeCSVStr(stream, poolStr(&topo->strings, tgts->name[i]));
+        fprintf(stream, ",,,%s,", (tgts->enabled[i] ? "Enabled" : "Disabled"));
+        if (tgts->adapter[i] != -1)
+            writeCSVStr(stream, topo->adapters[tgts->adapter[i]].speed);
+        fputs(",,,,,,,,,\n", stream);
+    }
+
+    for (i = 0; i < sess->cnt; i++) {
+        tgt = sess->target[i];
+        fprintf(stream, "%lld,session,", (long long) sample_time);
+        writeCSVStr(stream, poolStr(&topo->strings, tgts->driver[tgt]));
+        fputc(',', stream);
+        writeCSVStr(stream, poolStr(&topo->strings, tgts->name[tgt]));
+        fputc(',', stream);
+        writeCSVStr(stream, poolStr(&topo->strings, sess->name[i]));
+        fputc(',', stream);
+        writeCSVStr(stream, poolStr(&topo->strings, sess->initiator[i]));
+        fprintf(stream, ",,,%d,", sess->lun_cnt[i]);
+        fprintf(stream, "%d,%llu,%llu,", sess->active_cmds[i],
+                sess->read_io_kb[i], sess->write_io_kb[i]);
+        if (sess->has_cmd_cnts[i])
+            fprintf(stream, "%llu,%llu,", sess->read_cmds[i],
+                    sess->write_cmds[i]);
+        else
+            fputs(",,", stream);
+        if (sess->have_rate[i])
+            fprintf(stream, "%.1f,%.1f,%.1f\n", sess->read_kbps[i],
+                    sess->write_kbps[i], sess->iops[i]);
+        else
+            fputs(",,\n", stream);
+    }
+}
+
+
+/**
+ * @brief Run in batch mode; update the SCST topology every 'interval' seconds
+ * and write a record for each update to standard output (flushed, so it can
+ * be piped). The first record is written after one interval so the session
+ * rates are available. Stop after 'count' records (zero means run until we
+ * are killed) or when standard output goes away. Return the exit status.
+ */
+int batchMode(int interval, batch_fmt_t format, int count) {
+    struct timespec next_time = {0};
+    int records = 0;
+
+    /* The collection is the same as for the main screen */
+    updateSCSTTopology(&g_scst_topo);
+
+    if (format == BATCH_CSV) {
+        fputs(BATCH_CSV_HEADER "\n", stdout);
+        fflush(stdout);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &next_time);
+    while ((count == 0) || (records < count)) {
+        /* Sleep until the next interval (absolute, so we don't drift) */
+        next_time.tv_sec += interval;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                &next_time, NULL) == EINTR)
+            ;
+
+        /* Errors end up in the topology error message */
+        updateSCSTTopology(&g_scst_topo);
+
+        if (format == BATCH_JSON)
+            writeBatchJSON(stdout, &g_scst_topo, time(NULL));
+        else
+            writeBatchCSV(stdout, &g_scst_topo, time(NULL));
+        if ((fflush(stdout) == EOF) || ferror(stdout)) {
+            DEBUG_LOG("fflush(): %s", strerror(errno));
+            closeAttrHandles();
+            return EXIT_FAILURE;
+        }
+        records++;
+    }
+
+    /* Done */
+    closeAttrHandles();
+    return EXIT_SUCCESS;
+}
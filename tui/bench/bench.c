@@ -0,0 +1,314 @@
+/**
+ * @file bench.c
+ * @brief Time the TUI data layer (the SCST topology collection, main screen
+ * information labels, LUN layout walk and usable block device list) against
+ * a synthetic sysfs/procfs tree (see mktree.c), and compare the results with
+ * a saved baseline. The heap allocations are counted too; the steady-state
+ * refresh phases must not allocate at all.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "dialogs.h"
+#include "topology.h"
+#include "strings.h"
+
+#define BENCH_USAGE_MSG "Usage: %s -r ROOT [-n ITERATIONS] [-b BASELINE] " \
+        "[-t THRESHOLD_PCT] [-u]\n"
+#define MAX_BENCH_ITERS     101
+/* Differences smaller than this are timer/scheduler noise */
+#define BENCH_NOISE_MSEC    0.5
+
+/* These normally come from main.c and menu_common.c (the benchmark only
+ * links the data layer) */
+ThemeNum g_curr_theme = 0;
+chtype g_color_main_text[MAX_TUI_THEMES] = {0};
+chtype g_color_main_box[MAX_TUI_THEMES] = {0};
+int g_color_info_header[MAX_TUI_THEMES] = {0};
+
+/* The benchmark phases */
+typedef enum {
+    PHASE_REBUILD, PHASE_COUNTERS, PHASE_SNAPSHOT, PHASE_INFO_LABELS,
+    PHASE_LUN_LAYOUT, PHASE_BLOCK_DEVS, MAX_BENCH_PHASES
+} bench_phase_t;
+char *g_phase_names[] = {"topo_rebuild", "topo_counters", "topo_snapshot",
+    "info_labels", "lun_layout", "block_devs"};
+
+/* The phases that must not allocate once they are warmed up (the LUN layout
+ * walk opens directory streams, and those are allocated by the C library) */
+boolean g_phase_alloc_free[] = {FALSE, TRUE, TRUE, TRUE, FALSE, FALSE};
+
+scst_topo_t g_bench_snapshot;
+row_arena_t g_tgt_label_rows, g_sess_label_rows, g_layout_rows;
+char g_blk_dev_name[MAX_BLOCK_DEVS][MISC_STRING_LEN],
+        g_blk_dev_info[MAX_BLOCK_DEVS][MISC_STRING_LEN],
+        g_blk_dev_size[MAX_BLOCK_DEVS][MISC_STRING_LEN];
+
+
+/* Count the heap allocations; glibc allows replacing these functions (its
+ * own allocations come through here too), and the benchmark is single
+ * threaded */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+unsigned long g_alloc_cnt = 0;
+
+void *malloc(size_t size) {
+    g_alloc_cnt++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    g_alloc_cnt++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    g_alloc_cnt++;
+    return __libc_realloc(ptr, size);
+}
+
+
+/**
+ * @brief There is no screen; just print the error.
+ */
+void errorDialog(CDKSCREEN *screen, char *msg_line_1, char *msg_line_2) {
+    (void) screen;
+    fprintf(stderr, "Error: %s %s\n", (msg_line_1 ? msg_line_1 : ""),
+            (msg_line_2 ? msg_line_2 : ""));
+}
+
+
+/**
+ * @brief Run one iteration of the given phase; return FALSE if it failed.
+ */
+boolean runPhase(bench_phase_t phase) {
+    switch (phase) {
+        case PHASE_REBUILD:
+            /* The whole tree is walked again */
+            g_scst_topo.stale = TRUE;
+            g_scst_topo.devs_stale = TRUE;
+            return updateSCSTTopology(&g_scst_topo);
+        case PHASE_COUNTERS:
+            /* Nothing changed, so only the counters are read */
+            return updateSCSTTopology(&g_scst_topo);
+        case PHASE_SNAPSHOT:
+            return copySCSTTopology(&g_bench_snapshot, &g_scst_topo);
+        case PHASE_INFO_LABELS:
+            g_bench_snapshot.collected = TRUE;
+            clock_gettime(CLOCK_MONOTONIC, &g_bench_snapshot.published);
+            readTargetData(&g_bench_snapshot, &g_tgt_label_rows);
+            readSessionData(&g_bench_snapshot, &g_sess_label_rows);
+            readDeviceData(&g_bench_snapshot, &g_sess_label_rows);
+            return TRUE;
+        case PHASE_LUN_LAYOUT:
+            resetRowArena(&g_layout_rows);
+            return (readLUNLayout(&g_layout_rows) != -1);
+        case PHASE_BLOCK_DEVS:
+            return (getUsableBlockDevs(NULL, g_blk_dev_name, g_blk_dev_info,
+                    g_blk_dev_size) != -1);
+        default:
+            return FALSE;
+    }
+}
+
+
+/**
+ * @brief Compare two doubles (for qsort()).
+ */
+int compareMsec(const void *a, const void *b) {
+    double msec_a = *(const double *) a, msec_b = *(const double *) b;
+    return (msec_a > msec_b) - (msec_a < msec_b);
+}
+
+
+/**
+ * @brief Time the given phase; one (untimed) warm-up iteration, then the
+ * median of the timed iterations (in milliseconds) is returned, or -1 if
+ * the phase failed. The most allocations made by a timed iteration are
+ * returned by reference.
+ */
+double timePhase(bench_phase_t phase, int iterations,
+        unsigned long *allocs) {
+    double msec[MAX_BENCH_ITERS] = {0};
+    struct timespec start = {0}, end = {0};
+    unsigned long start_allocs = 0;
+    int i = 0;
+
+    *allocs = 0;
+    if (!runPhase(phase))
+        return -1;
+    for (i = 0; i < iterations; i++) {
+        start_allocs = g_alloc_cnt;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (!runPhase(phase))
+            return -1;
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if ((g_alloc_cnt - start_allocs) > *allocs)
+            *allocs = g_alloc_cnt - start_allocs;
+        msec[i] = ((end.tv_sec - start.tv_sec) * 1000.0) +
+                ((end.tv_nsec - start.tv_nsec) / 1000000.0);
+    }
+    qsort(msec, iterations, sizeof (double), compareMsec);
+    return msec[iterations / 2];
+}
+
+
+/**
+ * @brief Read the baseline file ("<phase> <msec>" lines); phases that are
+ * missing are left at -1. Return FALSE if the file couldn't be opened.
+ */
+boolean readBaseline(char file_name[], double baseline[]) {
+    FILE *baseline_file = NULL;
+    char phase_name[MISC_STRING_LEN] = {0};
+    double msec = 0;
+    int i = 0;
+
+    for (i = 0; i < MAX_BENCH_PHASES; i++)
+        baseline[i] = -1;
+    if ((baseline_file = fopen(file_name, "r")) == NULL)
+        return FALSE;
+    while (fscanf(baseline_file, "%63s %lf", phase_name, &msec) == 2) {
+        for (i = 0; i < MAX_BENCH_PHASES; i++) {
+            if (strcmp(phase_name, g_phase_names[i]) == 0)
+                baseline[i] = msec;
+        }
+    }
+    fclose(baseline_file);
+    return TRUE;
+}
+
+
+/**
+ * @brief Write the results as the new baseline file. Return FALSE on error.
+ */
+boolean writeBaseline(char file_name[], double result[]) {
+    FILE *baseline_file = NULL;
+    int i = 0;
+
+    if ((baseline_file = fopen(file_name, "w")) == NULL) {
+        fprintf(stderr, "fopen(%s): %s\n", file_name, strerror(errno));
+        return FALSE;
+    }
+    for (i = 0; i < MAX_BENCH_PHASES; i++)
+        fprintf(baseline_file, "%s %.3f\n", g_phase_names[i], result[i]);
+    if (fclose(baseline_file) == EOF) {
+        fprintf(stderr, "fclose(%s): %s\n", file_name, strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+/**
+ * @brief Run the benchmark; the exit status is non-zero if a phase failed
+ * or is slower than the baseline (by more than the threshold).
+ */
+int main(int argc, char **argv) {
+    char *root_dir = NULL, *baseline_file = NULL;
+    double result[MAX_BENCH_PHASES] = {0}, baseline[MAX_BENCH_PHASES] = {0};
+    double limit = 0, threshold = 20;
+    unsigned long allocs = 0;
+    int iterations = 9, c = 0, i = 0, exit_status = EXIT_SUCCESS;
+    boolean have_baseline = FALSE, update_baseline = FALSE;
+
+    while ((c = getopt(argc, argv, "r:n:b:t:uh")) != -1) {
+        switch (c) {
+            case 'r':
+                root_dir = optarg;
+                break;
+            case 'n':
+                iterations = atoi(optarg);
+                break;
+            case 'b':
+                baseline_file = optarg;
+                break;
+            case 't':
+                threshold = atof(optarg);
+                break;
+            case 'u':
+                update_baseline = TRUE;
+                break;
+            default:
+                fprintf(stderr, BENCH_USAGE_MSG, argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((root_dir == NULL) || (iterations < 1) ||
+            (iterations > MAX_BENCH_ITERS) || (threshold < 0)) {
+        fprintf(stderr, BENCH_USAGE_MSG, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Everything is read from the synthetic tree */
+    if (!setSysRoot(root_dir) || !isSCSTLoaded()) {
+        fprintf(stderr, "Error: No SCST sysfs tree under '%s'.\n", root_dir);
+        return EXIT_FAILURE;
+    }
+    if ((baseline_file != NULL) && !update_baseline)
+        have_baseline = readBaseline(baseline_file, baseline);
+
+    /* The same row buffers are used every iteration (like the main screen) */
+    if (!initRowArena(&g_tgt_label_rows, MAX_INFO_LABEL_ROWS,
+            INFO_LABEL_ROW_SIZE) || !initRowArena(&g_sess_label_rows,
+            MAX_INFO_LABEL_ROWS, INFO_LABEL_ROW_SIZE) ||
+            !initRowArena(&g_layout_rows, MAX_LUN_LAYOUT_LINES,
+            LUN_LAYOUT_ROW_SIZE)) {
+        fprintf(stderr, "Error: %s\n", ROW_ARENA_ERR_MSG);
+        return EXIT_FAILURE;
+    }
+
+    printf("%-16s %12s %12s %9s %8s\n", "phase", "median_ms", "baseline_ms",
+            "change", "allocs");
+    for (i = 0; i < MAX_BENCH_PHASES; i++) {
+        if ((result[i] = timePhase(i, iterations, &allocs)) < 0) {
+            fprintf(stderr, "Error: The '%s' phase failed (%s).\n",
+                    g_phase_names[i], g_scst_topo.error_msg);
+            return EXIT_FAILURE;
+        }
+        if (!have_baseline || (baseline[i] < 0)) {
+            printf("%-16s %12.3f %12s %9s %8lu", g_phase_names[i], result[i],
+                    "-", "-", allocs);
+        } else {
+            limit = (baseline[i] * (1 + (threshold / 100))) +
+                    BENCH_NOISE_MSEC;
+            printf("%-16s %12.3f %12.3f %+8.1f%% %8lu", g_phase_names[i],
+                    result[i], baseline[i], ((baseline[i] > 0) ?
+                    (((result[i] - baseline[i]) / baseline[i]) * 100) : 0),
+                    allocs);
+            if (result[i] > limit) {
+                printf("  REGRESSION");
+                exit_status = EXIT_FAILURE;
+            }
+        }
+        if (g_phase_alloc_free[i] && (allocs != 0)) {
+            printf("  ALLOCATES");
+            exit_status = EXIT_FAILURE;
+        }
+        printf("\n");
+    }
+
+    /* No baseline yet (or we were asked to replace it) */
+    if ((baseline_file != NULL) && (!have_baseline || update_baseline)) {
+        if (!writeBaseline(baseline_file, result))
+            return EXIT_FAILURE;
+        printf("Baseline written to '%s'.\n", baseline_file);
+    }
+    if (exit_status != EXIT_SUCCESS)
+        printf("Failed; a phase is slower than the baseline by more than "
+                "%.1f%%, or a steady-state phase allocates.\n", threshold);
+    return exit_status;
+}
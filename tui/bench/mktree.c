@@ -0,0 +1,487 @@
+/**
+ * @file mktree.c
+ * @brief Build a synthetic sysfs/procfs tree (SCST targets, sessions, LUNs
+ * and devices, FC and IB adapters, block and SCSI devices, mounts) of a
+ * given size for benchmarking the TUI data layer (see "esos_tui --sysroot"
+ * and bench.c).
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define MKTREE_USAGE_MSG "Usage: %s [-d DRIVERS] [-t TARGETS] " \
+        "[-s SESSIONS] [-l LUNS] [-b BLOCK_DEVS] [-f FC_HOSTS] " \
+        "[-i IB_HCAS] ROOT\n"
+#define MAX_ROOT_SIZE   512
+#define MAX_REL_SIZE    1024
+
+/* The first target drivers get real names (the adapters are matched to
+ * those targets), the rest are generic */
+#define FC_DRIVER_IDX   1
+#define IB_DRIVER_IDX   2
+char *g_real_drivers[] = {"iscsi", "qla2x00t", "ib_srpt"};
+
+char g_root[MAX_ROOT_SIZE] = {0};
+
+
+/**
+ * @brief Make the given directory (relative to the root) and any parents
+ * that are missing. Return 0 on success, -1 on failure.
+ */
+int makeDir(const char *format, ...) {
+    char path[PATH_MAX] = {0};
+    char *slash = NULL;
+    int root_len = 0;
+    va_list args;
+
+    root_len = snprintf(path, PATH_MAX, "%s/", g_root);
+    va_start(args, format);
+    vsnprintf((path + root_len), (PATH_MAX - root_len), format, args);
+    va_end(args);
+
+    for (slash = strchr((path + 1), '/'); slash != NULL;
+            slash = strchr((slash + 1), '/')) {
+        *slash = '\0';
+        if ((mkdir(path, 0755) == -1) && (errno != EEXIST)) {
+            fprintf(stderr, "mkdir(%s): %s\n", path, strerror(errno));
+            return -1;
+        }
+        *slash = '/';
+    }
+    if ((mkdir(path, 0755) == -1) && (errno != EEXIST)) {
+        fprintf(stderr, "mkdir(%s): %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Write an attribute file (relative to the root) with the given value
+ * and a trailing new line, like sysfs. Return 0 on success, -1 on failure.
+ */
+int writeAttr(const char *rel_path, const char *format, ...) {
+    char path[PATH_MAX] = {0};
+    FILE *attr_file = NULL;
+    va_list args;
+
+    snprintf(path, PATH_MAX, "%s/%s", g_root, rel_path);
+    if ((attr_file = fopen(path, "w")) == NULL) {
+        fprintf(stderr, "fopen(%s): %s\n", path, strerror(errno));
+        return -1;
+    }
+    va_start(args, format);
+    vfprintf(attr_file, format, args);
+    va_end(args);
+    fputc('\n', attr_file);
+    if (fclose(attr_file) == EOF) {
+        fprintf(stderr, "fclose(%s): %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Create a symbolic link (relative to the root) pointing at the given
+ * (relative) target. Return 0 on success, -1 on failure.
+ */
+int makeLink(const char *link_target, const char *rel_path) {
+    char path[PATH_MAX] = {0};
+
+    snprintf(path, PATH_MAX, "%s/%s", g_root, rel_path);
+    if ((symlink(link_target, path) == -1) && (errno != EEXIST)) {
+        fprintf(stderr, "symlink(%s): %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Fill in a "sd" style disk name for the given index (sda .. sdz,
+ * sdaa .. sdzz, etc.).
+ */
+void diskName(int index, char disk_name[], size_t name_size) {
+    char suffix[16] = {0};
+    int pos = sizeof (suffix) - 1;
+
+    index++;
+    while ((index > 0) && (pos > 0)) {
+        index--;
+        suffix[--pos] = 'a' + (index % 26);
+        index = index / 26;
+    }
+    snprintf(disk_name, name_size, "sd%s", (suffix + pos));
+}
+
+
+/**
+ * @brief Fill in the name of a target for the given driver; the FC and IB
+ * target names match the adapter port names / node GUIDs.
+ */
+void targetName(int driver, int index, char tgt_name[], size_t name_size) {
+    if (driver == 0)
+        snprintf(tgt_name, name_size, "iqn.2012-01.org.esos:bench.tgt%05d",
+                index);
+    else if (driver == FC_DRIVER_IDX)
+        snprintf(tgt_name, name_size, "21:00:00:24:ff:%02x:%02x:%02x",
+                ((index >> 16) & 0xff), ((index >> 8) & 0xff),
+                (index & 0xff));
+    else if (driver == IB_DRIVER_IDX)
+        snprintf(tgt_name, name_size, "0002:c903:%04x:%04x",
+                ((index >> 16) & 0xffff), (index & 0xffff));
+    else
+        snprintf(tgt_name, name_size, "bench_drv%02d_tgt%05d", driver, index);
+}
+
+
+/**
+ * @brief Build the block devices (each with one partition and a SCSI
+ * device); every 8th disk has a mounted partition, every 16th is held by
+ * another device. Return 0 on success, -1 on failure.
+ */
+int makeBlockDevs(int blk_dev_cnt) {
+    char disk[32] = {0}, hctl[32] = {0}, rel_path[MAX_REL_SIZE] = {0},
+            link_target[MAX_REL_SIZE] = {0}, mounts_path[PATH_MAX] = {0};
+    FILE *mounts = NULL;
+    int i = 0, dev_minor = 0;
+
+    if ((makeDir("sys/block") == -1) || (makeDir("sys/dev/block") == -1) ||
+            (makeDir("sys/class/scsi_device") == -1) ||
+            (makeDir("sys/class/scsi_disk") == -1) ||
+            (makeDir("proc/self") == -1))
+        return -1;
+
+    snprintf(mounts_path, PATH_MAX, "%s/proc/self/mountinfo", g_root);
+    if ((mounts = fopen(mounts_path, "w")) == NULL) {
+        fprintf(stderr, "fopen(%s): %s\n", mounts_path, strerror(errno));
+        return -1;
+    }
+    fprintf(mounts, "1 0 0:1 / / rw,relatime - rootfs rootfs rw\n");
+
+    for (i = 0; i < blk_dev_cnt; i++) {
+        diskName(i, disk, sizeof (disk));
+        snprintf(hctl, sizeof (hctl), "%d:0:%d:0", (i / 256), (i % 256));
+        dev_minor = i * 16;
+
+        /* The SCSI device */
+        if ((makeDir("sys/devices/virtual/scsi/%s/block/%s", hctl,
+                disk) == -1) ||
+                (makeDir("sys/devices/virtual/scsi/%s/scsi_device",
+                hctl) == -1))
+            return -1;
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/scsi/%s/type", hctl);
+        writeAttr(rel_path, "0");
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/scsi/%s/vendor",
+                hctl);
+        writeAttr(rel_path, "ESOS    ");
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/scsi/%s/model",
+                hctl);
+        writeAttr(rel_path, "BENCH DISK %-5d ", i);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/scsi/%s/rev", hctl);
+        writeAttr(rel_path, "1.0 ");
+        snprintf(rel_path, MAX_REL_SIZE,
+                "sys/devices/virtual/scsi/%s/scsi_device/device", hctl);
+        makeLink("..", rel_path);
+        snprintf(link_target, MAX_REL_SIZE,
+                "../../devices/virtual/scsi/%s/scsi_device", hctl);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/class/scsi_device/%s", hctl);
+        makeLink(link_target, rel_path);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/class/scsi_disk/%s", hctl);
+        makeLink(link_target, rel_path);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/scsi/%s/block/%s/dev",
+                hctl, disk);
+        writeAttr(rel_path, "8:%d", dev_minor);
+
+        /* The disk and its partition */
+        if ((makeDir("sys/devices/virtual/block/%s/holders", disk) == -1) ||
+                (makeDir("sys/devices/virtual/block/%s/slaves", disk) == -1) ||
+                (makeDir("sys/devices/virtual/block/%s/queue", disk) == -1) ||
+                (makeDir("sys/devices/virtual/block/%s/%s1/holders", disk,
+                disk) == -1))
+            return -1;
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/block/%s/dev", disk);
+        writeAttr(rel_path, "8:%d", dev_minor);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/block/%s/size", disk);
+        writeAttr(rel_path, "%llu", (1953525168ULL + i));
+        snprintf(rel_path, MAX_REL_SIZE,
+                "sys/devices/virtual/block/%s/queue/logical_block_size", disk);
+        writeAttr(rel_path, "512");
+        snprintf(link_target, MAX_REL_SIZE, "../../scsi/%s", hctl);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/block/%s/device",
+                disk);
+        makeLink(link_target, rel_path);
+        snprintf(rel_path, MAX_REL_SIZE,
+                "sys/devices/virtual/block/%s/%s1/partition", disk, disk);
+        writeAttr(rel_path, "1");
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/block/%s/%s1/dev",
+                disk, disk);
+        writeAttr(rel_path, "8:%d", (dev_minor + 1));
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/block/%s/%s1/size",
+                disk, disk);
+        writeAttr(rel_path, "%llu", (1953523120ULL + i));
+        if ((i % 16) == 15) {
+            snprintf(rel_path, MAX_REL_SIZE,
+                    "sys/devices/virtual/block/%s/holders/dm-%d", disk, i);
+            makeLink("../../dm-0", rel_path);
+        }
+        snprintf(link_target, MAX_REL_SIZE, "../devices/virtual/block/%s", disk);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/block/%s", disk);
+        makeLink(link_target, rel_path);
+        snprintf(link_target, MAX_REL_SIZE, "../../devices/virtual/block/%s",
+                disk);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/dev/block/8:%d", dev_minor);
+        makeLink(link_target, rel_path);
+        snprintf(link_target, MAX_REL_SIZE, "../../devices/virtual/block/%s/%s1",
+                disk, disk);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/dev/block/8:%d", (dev_minor + 1));
+        makeLink(link_target, rel_path);
+
+        if ((i % 8) == 7)
+            fprintf(mounts, "%d 1 8:%d / /mnt/vdisks/%s1 rw,noatime - xfs "
+                    "/dev/%s1 rw\n", (i + 100), (dev_minor + 1), disk, disk);
+    }
+    fclose(mounts);
+
+    return writeAttr("proc/swaps", "Filename\t\t\t\tType\t\tSize\tUsed\t"
+            "Priority");
+}
+
+
+/**
+ * @brief Build the FC hosts and IB HCAs; their port names / node GUIDs match
+ * the first targets of the "qla2x00t" and "ib_srpt" drivers. Return 0 on
+ * success, -1 on failure.
+ */
+int makeAdapters(int fc_host_cnt, int ib_hca_cnt) {
+    char rel_path[MAX_REL_SIZE] = {0}, link_target[MAX_REL_SIZE] = {0};
+    int i = 0;
+
+    if ((makeDir("sys/class/fc_host") == -1) ||
+            (makeDir("sys/class/infiniband") == -1))
+        return -1;
+
+    for (i = 0; i < fc_host_cnt; i++) {
+        if (makeDir("sys/devices/virtual/fc_host/host%d", i) == -1)
+            return -1;
+        snprintf(rel_path, MAX_REL_SIZE,
+                "sys/devices/virtual/fc_host/host%d/port_name", i);
+        writeAttr(rel_path, "0x21000024ff%06x", i);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/devices/virtual/fc_host/host%d/speed",
+                i);
+        writeAttr(rel_path, "8 Gbit");
+        snprintf(link_target, MAX_REL_SIZE, "../../devices/virtual/fc_host/host%d",
+                i);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/class/fc_host/host%d", i);
+        makeLink(link_target, rel_path);
+    }
+
+    for (i = 0; i < ib_hca_cnt; i++) {
+        if (makeDir("sys/devices/virtual/infiniband/mlx4_%d/ports/1",
+                i) == -1)
+            return -1;
+        snprintf(rel_path, MAX_REL_SIZE,
+                "sys/devices/virtual/infiniband/mlx4_%d/node_guid", i);
+        writeAttr(rel_path, "0002:c903:%04x:%04x", ((i >> 16) & 0xffff),
+                (i & 0xffff));
+        snprintf(rel_path, MAX_REL_SIZE,
+                "sys/devices/virtual/infiniband/mlx4_%d/ports/1/rate", i);
+        writeAttr(rel_path, "40 Gb/sec (4X QDR)");
+        snprintf(link_target, MAX_REL_SIZE,
+                "../../devices/virtual/infiniband/mlx4_%d", i);
+        snprintf(rel_path, MAX_REL_SIZE, "sys/class/infiniband/mlx4_%d", i);
+        makeLink(link_target, rel_path);
+    }
+
+    return 0;
+}
+
+
+/**
+ * @brief Build the SCST tree: the targets are spread over the drivers, the
+ * sessions over the targets, and the LUNs over the targets (each target has
+ * one group, and each LUN is its own vdisk_blockio device backed by one of
+ * the block devices). Return 0 on success, -1 on failure.
+ */
+int makeSCSTTree(int driver_cnt, int tgt_cnt, int sess_cnt, int lun_cnt,
+        int blk_dev_cnt) {
+    char scst_dir[] = "sys/kernel/scst_tgt";
+    char driver[64] = {0}, tgt_name[64] = {0}, init_name[64] = {0},
+            disk[32] = {0}, rel_path[MAX_REL_SIZE] = {0},
+            link_target[MAX_REL_SIZE] = {0}, tgt_dir[MAX_ROOT_SIZE] = {0};
+    int tgt = 0, sess = 0, lun = 0, drv = 0, dev_idx = 0, tgt_sess = 0,
+            tgt_luns = 0, *drv_tgt_cnt = NULL;
+
+    if ((makeDir("%s/targets/copy_manager/copy_manager_tgt", scst_dir) == -1) ||
+            (makeDir("%s/devices", scst_dir) == -1) ||
+            (makeDir("%s/handlers/vdisk_blockio", scst_dir) == -1) ||
+            (makeDir("%s/handlers/vdisk_fileio", scst_dir) == -1))
+        return -1;
+
+    if ((drv_tgt_cnt = calloc(driver_cnt, sizeof (int))) == NULL) {
+        fprintf(stderr, "calloc(): %s\n", strerror(errno));
+        return -1;
+    }
+
+    for (tgt = 0; tgt < tgt_cnt; tgt++) {
+        drv = tgt % driver_cnt;
+        if (drv < (int) (sizeof (g_real_drivers) / sizeof (char *)))
+            snprintf(driver, sizeof (driver), "%s", g_real_drivers[drv]);
+        else
+            snprintf(driver, sizeof (driver), "bench_drv%02d", drv);
+        targetName(drv, drv_tgt_cnt[drv], tgt_name, sizeof (tgt_name));
+        drv_tgt_cnt[drv]++;
+        snprintf(tgt_dir, MAX_ROOT_SIZE, "%s/targets/%s/%s", scst_dir, driver,
+                tgt_name);
+        if ((makeDir("%s/sessions", tgt_dir) == -1) ||
+                (makeDir("%s/ini_groups/bench_group/initiators",
+                tgt_dir) == -1) ||
+                (makeDir("%s/ini_groups/bench_group/luns", tgt_dir) == -1))
+            return -1;
+        snprintf(rel_path, MAX_REL_SIZE, "%s/enabled", tgt_dir);
+        writeAttr(rel_path, "1");
+        snprintf(rel_path, MAX_REL_SIZE, "%s/ini_groups/bench_group/initiators/mgmt",
+                tgt_dir);
+        writeAttr(rel_path, "");
+        snprintf(rel_path, MAX_REL_SIZE, "%s/ini_groups/bench_group/luns/mgmt",
+                tgt_dir);
+        writeAttr(rel_path, "");
+
+        /* This target's share of the LUNs (and devices) */
+        tgt_luns = (lun_cnt / tgt_cnt) + ((tgt < (lun_cnt % tgt_cnt)) ? 1 : 0);
+        for (lun = 0; lun < tgt_luns; lun++) {
+            snprintf(rel_path, MAX_REL_SIZE, "%s/devices/bench_dev%06d/filename",
+                    scst_dir, dev_idx);
+            if (makeDir("%s/devices/bench_dev%06d", scst_dir, dev_idx) == -1)
+                return -1;
+            diskName((blk_dev_cnt > 0) ? (dev_idx % blk_dev_cnt) : 0, disk,
+                    sizeof (disk));
+            writeAttr(rel_path, "/dev/%s", disk);
+            snprintf(rel_path, MAX_REL_SIZE,
+                    "%s/handlers/vdisk_blockio/bench_dev%06d", scst_dir,
+                    dev_idx);
+            snprintf(link_target, MAX_REL_SIZE, "../../devices/bench_dev%06d",
+                    dev_idx);
+            makeLink(link_target, rel_path);
+            if (makeDir("%s/ini_groups/bench_group/luns/%d", tgt_dir,
+                    lun) == -1)
+                return -1;
+            snprintf(rel_path, MAX_REL_SIZE,
+                    "%s/ini_groups/bench_group/luns/%d/device", tgt_dir, lun);
+            snprintf(link_target, MAX_REL_SIZE,
+                    "../../../../../../../devices/bench_dev%06d", dev_idx);
+            makeLink(link_target, rel_path);
+            dev_idx++;
+        }
+
+        /* This target's share of the sessions; each sees all of the LUNs */
+        tgt_sess = (sess_cnt / tgt_cnt) + ((tgt < (sess_cnt % tgt_cnt)) ? 1 : 0);
+        for (; tgt_sess > 0; tgt_sess--, sess++) {
+            snprintf(init_name, sizeof (init_name),
+                    "iqn.1994-05.com.example:bench.ini%05d", sess);
+            snprintf(rel_path, MAX_REL_SIZE,
+                    "%s/ini_groups/bench_group/initiators/%s", tgt_dir,
+                    init_name);
+            writeAttr(rel_path, "");
+            for (lun = 0; lun < tgt_luns; lun++) {
+                if (makeDir("%s/sessions/%s/luns/%d", tgt_dir, init_name,
+                        lun) == -1)
+                    return -1;
+            }
+            if ((tgt_luns == 0) && makeDir("%s/sessions/%s/luns", tgt_dir,
+                    init_name) == -1)
+                return -1;
+            snprintf(rel_path, MAX_REL_SIZE, "%s/sessions/%s/initiator_name",
+                    tgt_dir, init_name);
+            writeAttr(rel_path, "%s", init_name);
+            snprintf(rel_path, MAX_REL_SIZE, "%s/sessions/%s/active_commands",
+                    tgt_dir, init_name);
+            writeAttr(rel_path, "%d", (sess % 32));
+            snprintf(rel_path, MAX_REL_SIZE, "%s/sessions/%s/read_io_count_kb",
+                    tgt_dir, init_name);
+            writeAttr(rel_path, "%llu", (1048576ULL * (sess + 1)));
+            snprintf(rel_path, MAX_REL_SIZE, "%s/sessions/%s/write_io_count_kb",
+                    tgt_dir, init_name);
+            writeAttr(rel_path, "%llu", (524288ULL * (sess + 1)));
+            snprintf(rel_path, MAX_REL_SIZE, "%s/sessions/%s/read_cmd_count",
+                    tgt_dir, init_name);
+            writeAttr(rel_path, "%llu", (262144ULL * (sess + 1)));
+            snprintf(rel_path, MAX_REL_SIZE, "%s/sessions/%s/write_cmd_count",
+                    tgt_dir, init_name);
+            writeAttr(rel_path, "%llu", (131072ULL * (sess + 1)));
+        }
+    }
+
+    free(drv_tgt_cnt);
+    return 0;
+}
+
+
+/**
+ * @brief Parse the options and build the tree.
+ */
+int main(int argc, char **argv) {
+    int driver_cnt = 16, tgt_cnt = 1024, sess_cnt = 4096, lun_cnt = 16384,
+            blk_dev_cnt = 256, fc_host_cnt = 8, ib_hca_cnt = 4, c = 0;
+
+    while ((c = getopt(argc, argv, "d:t:s:l:b:f:i:h")) != -1) {
+        switch (c) {
+            case 'd':
+                driver_cnt = atoi(optarg);
+                break;
+            case 't':
+                tgt_cnt = atoi(optarg);
+                break;
+            case 's':
+                sess_cnt = atoi(optarg);
+                break;
+            case 'l':
+                lun_cnt = atoi(optarg);
+                break;
+            case 'b':
+                blk_dev_cnt = atoi(optarg);
+                break;
+            case 'f':
+                fc_host_cnt = atoi(optarg);
+                break;
+            case 'i':
+                ib_hca_cnt = atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, MKTREE_USAGE_MSG, argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if ((optind != (argc - 1)) || (driver_cnt < 1) || (tgt_cnt < 1) ||
+            (sess_cnt < 0) || (lun_cnt < 0) || (blk_dev_cnt < 0) ||
+            (fc_host_cnt < 0) || (ib_hca_cnt < 0)) {
+        fprintf(stderr, MKTREE_USAGE_MSG, argv[0]);
+        return EXIT_FAILURE;
+    }
+    snprintf(g_root, MAX_ROOT_SIZE, "%s", argv[optind]);
+
+    if ((makeBlockDevs(blk_dev_cnt) == -1) ||
+            (makeAdapters(fc_host_cnt, ib_hca_cnt) == -1) ||
+            (makeSCSTTree(driver_cnt, tgt_cnt, sess_cnt, lun_cnt,
+            blk_dev_cnt) == -1))
+        return EXIT_FAILURE;
+
+    printf("%s: %d drivers, %d targets, %d sessions, %d LUNs, "
+            "%d block devices, %d FC hosts, %d IB HCAs\n", g_root, driver_cnt,
+            tgt_cnt, sess_cnt, lun_cnt, blk_dev_cnt, fc_host_cnt, ib_hca_cnt);
+    return EXIT_SUCCESS;
+}
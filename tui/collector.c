@@ -0,0 +1,152 @@
+/**
+ * @file collector.c
+ * @brief Background thread that collects the SCST topology/counters and
+ * publishes snapshots for the main screen information labels.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "topology.h"
+
+
+/* The collector thread works on g_scst_topo (and the session rate table)
+ * privately, and then copies it into the published snapshot; the lock is
+ * only ever held for that copy, never across a sysfs read (the snapshot
+ * tables are re-used, so a copy normally doesn't allocate anything) */
+scst_topo_t g_topo_snapshot;
+unsigned long g_topo_snapshot_seq = 0;
+pthread_mutex_t g_collector_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_collector_cond = PTHREAD_COND_INITIALIZER;
+pthread_t g_collector_thread;
+boolean g_collector_running = FALSE;
+boolean g_collector_stop = FALSE;
+
+
+/**
+ * @brief The collector thread; update the topology, publish it, then sleep
+ * for the collection interval (or until we're told to stop).
+ */
+void *collectorThread(void *arg) {
+    struct timespec wake_time = {0}, prof_start = {0};
+
+    (void) arg;
+
+    blockThreadSignals(NULL);
+
+    for (;;) {
+        /* Errors end up in the topology error message */
+        startProfile(&prof_start);
+        updateSCSTTopology(&g_scst_topo);
+        endProfile("sysfs walk: SCST topology", &prof_start);
+
+        /* Publish the new snapshot */
+        pthread_mutex_lock(&g_collector_mutex);
+        g_scst_topo.collected = TRUE;
+        clock_gettime(CLOCK_MONOTONIC, &g_scst_topo.published);
+        copySCSTTopology(&g_topo_snapshot, &g_scst_topo);
+        g_topo_snapshot_seq++;
+
+        /* Wait for the next interval */
+        clock_gettime(CLOCK_REALTIME, &wake_time);
+        wake_time.tv_sec += COLLECT_INTERVAL_MSEC / 1000;
+        wake_time.tv_nsec += (COLLECT_INTERVAL_MSEC % 1000) * 1000000L;
+        if (wake_time.tv_nsec >= 1000000000L) {
+            wake_time.tv_sec++;
+            wake_time.tv_nsec -= 1000000000L;
+        }
+        while (!g_collector_stop) {
+            if (pthread_cond_timedwait(&g_collector_cond, &g_collector_mutex,
+                    &wake_time) == ETIMEDOUT)
+                break;
+        }
+        if (g_collector_stop) {
+            pthread_mutex_unlock(&g_collector_mutex);
+            break;
+        }
+        pthread_mutex_unlock(&g_collector_mutex);
+    }
+
+    closeAttrHandles();
+    return NULL;
+}
+
+
+/**
+ * @brief Start the collector thread (if it isn't already running). Return
+ * FALSE if the thread couldn't be created.
+ */
+boolean startCollector() {
+    int ret_val = 0;
+
+    if (g_collector_running)
+        return TRUE;
+    g_collector_stop = FALSE;
+    if ((ret_val = pthread_create(&g_collector_thread, NULL,
+            collectorThread, NULL)) != 0) {
+        DEBUG_LOG("pthread_create(): %s", strerror(ret_val));
+        return FALSE;
+    }
+    g_collector_running = TRUE;
+    return TRUE;
+}
+
+
+/**
+ * @brief Tell the collector thread to stop. We don't wait (join) for it since
+ * it may be stuck in a sysfs read; we're normally on our way out anyway.
+ */
+void stopCollector() {
+    if (!g_collector_running)
+        return;
+    pthread_mutex_lock(&g_collector_mutex);
+    g_collector_stop = TRUE;
+    pthread_cond_signal(&g_collector_cond);
+    pthread_mutex_unlock(&g_collector_mutex);
+    pthread_detach(g_collector_thread);
+    g_collector_running = FALSE;
+}
+
+
+/**
+ * @brief Copy the latest published snapshot into the given topology if it is
+ * newer than the one identified by 'last_seq' (which is then updated). Return
+ * TRUE if a new snapshot was copied.
+ */
+boolean getTopoSnapshot(scst_topo_t *topo, unsigned long *last_seq) {
+    boolean copied = FALSE;
+
+    pthread_mutex_lock(&g_collector_mutex);
+    if (g_topo_snapshot_seq != *last_seq) {
+        copySCSTTopology(topo, &g_topo_snapshot);
+        *last_seq = g_topo_snapshot_seq;
+        copied = TRUE;
+    }
+    pthread_mutex_unlock(&g_collector_mutex);
+    return copied;
+}
+
+
+/**
+ * @brief Return how many seconds old the given snapshot is.
+ */
+int topoSnapshotAge(scst_topo_t *topo) {
+    struct timespec now = {0};
+
+    if (!topo->collected)
+        return 0;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int) (now.tv_sec - topo->published.tv_sec);
+}
@@ -0,0 +1,609 @@
+/**
+ * @file dev_table.c
+ * @brief The live device table; the block and SCSI devices are read once
+ * when we start, and then a background thread keeps the table current from
+ * a libudev monitor, so the device pickers don't have to rescan sysfs.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <libudev.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "dev_table.h"
+
+
+/* The table is only changed with the lock held (by the monitor thread, or
+ * by the UI thread when there is no monitor); the sysfs reads for an update
+ * are always done before taking the lock */
+dev_table_t g_dev_table;
+pthread_mutex_t g_dev_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_dev_table_cond = PTHREAD_COND_INITIALIZER;
+pthread_t g_dev_table_thread;
+boolean g_dev_table_running = FALSE;
+boolean g_dev_table_stop = FALSE;
+
+
+/**
+ * @brief Make sure the block device part of the table has room for at least
+ * 'rows' rows (doubling). Return FALSE if we couldn't allocate it.
+ */
+boolean growBlkDevTable(dev_table_t *tbl, int rows) {
+    int new_alloc = 0;
+    boolean success = TRUE;
+
+    if (rows <= tbl->blk_alloc)
+        return TRUE;
+    new_alloc = (tbl->blk_alloc > 0) ? tbl->blk_alloc : SCST_TBL_INIT_ROWS;
+    while (new_alloc < rows)
+        new_alloc *= 2;
+    tbl->blk_devs = growColumn(tbl->blk_devs, sizeof (blk_dev_ent_t),
+            new_alloc, &success);
+    if (!success)
+        return FALSE;
+    tbl->blk_alloc = new_alloc;
+    return TRUE;
+}
+
+
+/**
+ * @brief Make sure the SCSI device part of the table has room for at least
+ * 'rows' rows (doubling). Return FALSE if we couldn't allocate it.
+ */
+boolean growSCSIDevTable(dev_table_t *tbl, int rows) {
+    int new_alloc = 0;
+    boolean success = TRUE;
+
+    if (rows <= tbl->scsi_alloc)
+        return TRUE;
+    new_alloc = (tbl->scsi_alloc > 0) ? tbl->scsi_alloc : SCST_TBL_INIT_ROWS;
+    while (new_alloc < rows)
+        new_alloc *= 2;
+    tbl->scsi_devs = growColumn(tbl->scsi_devs, sizeof (scsi_dev_ent_t),
+            new_alloc, &success);
+    if (!success)
+        return FALSE;
+    tbl->scsi_alloc = new_alloc;
+    return TRUE;
+}
+
+
+/**
+ * @brief Return the row of the named block device, or -1 if it isn't in the
+ * table.
+ */
+int findBlkDevEntry(dev_table_t *tbl, const char *dev_name) {
+    int i = 0;
+
+    for (i = 0; i < tbl->blk_cnt; i++) {
+        if (strcmp(tbl->blk_devs[i].name, dev_name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Read a block device's attributes from sysfs (relative to the open
+ * /sys/block directory). The extra information depends on the device type,
+ * and only the types we know about are "listable". Return FALSE if the
+ * device directory couldn't be opened (eg, it just went away).
+ */
+boolean readBlkDevEntry(int block_fd, const char *dev_name,
+        blk_dev_ent_t *entry) {
+    char attr_val[MAX_SYSFS_ATTR_SIZE] = {0};
+    unsigned int dev_major = 0, dev_minor = 0;
+    int dev_fd = -1;
+
+    memset(entry, 0, sizeof (blk_dev_ent_t));
+    snprintf(entry->name, MISC_STRING_LEN, "%s", dev_name);
+    if ((dev_fd = openDirAt(block_fd, dev_name)) == -1)
+        return FALSE;
+    if ((readAttributeAt(dev_fd, "dev", attr_val) == 0) &&
+            (sscanf(attr_val, "%u:%u", &dev_major, &dev_minor) == 2))
+        entry->dev_num = makedev(dev_major, dev_minor);
+    if (readAttributeAt(dev_fd, "size", attr_val) == 0)
+        entry->size = strtoull(attr_val, NULL, 10);
+    if (readAttributeAt(dev_fd, "device/model", attr_val) == 0)
+        snprintf(entry->model, MISC_STRING_LEN, "%s", strStrip(attr_val));
+
+    entry->listable = TRUE;
+    if (strncmp(dev_name, "drbd", 4) == 0) {
+        /* Nothing extra for DRBD... yet */
+        snprintf(entry->info, MISC_STRING_LEN, "DRBD Device");
+    } else if (strncmp(dev_name, "md", 2) == 0) {
+        readAttributeAt(dev_fd, "md/level", attr_val);
+        snprintf(entry->info, MISC_STRING_LEN, "Level: %s", attr_val);
+    } else if (strncmp(dev_name, "sd", 2) == 0) {
+        snprintf(entry->info, MISC_STRING_LEN, "Model: %s", entry->model);
+    } else if (strncmp(dev_name, "dm-", 3) == 0) {
+        readAttributeAt(dev_fd, "dm/name", attr_val);
+        snprintf(entry->info, MISC_STRING_LEN, "Name: %s", attr_val);
+    } else if (strncmp(dev_name, "cciss", 5) == 0) {
+        readAttributeAt(dev_fd, "device/raid_level", attr_val);
+        snprintf(entry->info, MISC_STRING_LEN, "RAID Level: %s", attr_val);
+    } else if ((strncmp(dev_name, "zd", 2) == 0) ||
+            (strncmp(dev_name, "rbd", 3) == 0) ||
+            (strncmp(dev_name, "nvme", 4) == 0)) {
+        readAttributeAt(dev_fd, "queue/logical_block_size", attr_val);
+        snprintf(entry->info, MISC_STRING_LEN, "Block Size: %s", attr_val);
+    } else {
+        // TODO: Still more controller block devices (ida, rd)
+        // need to be added but we need hardware so we can
+        // confirm sysfs attributes.
+        entry->listable = FALSE;
+    }
+    close(dev_fd);
+    return TRUE;
+}
+
+
+/**
+ * @brief Set the block device link from the udev device links; the first
+ * /dev/disk/by-id link is preferred, otherwise the first link (eg, a ZFS
+ * /dev/zvol link). The udev list is sorted, so this is stable.
+ */
+void setBlkDevLinks(struct udev_device *udev_dev, blk_dev_ent_t *entry) {
+    struct udev_list_entry *link_entry = NULL;
+    const char *link_name = NULL;
+
+    entry->by_id[0] = '\0';
+    udev_list_entry_foreach(link_entry,
+            udev_device_get_devlinks_list_entry(udev_dev)) {
+        link_name = udev_list_entry_get_name(link_entry);
+        if (strncmp(link_name, DEV_DISK_BY_ID "/",
+                strlen(DEV_DISK_BY_ID "/")) == 0) {
+            snprintf(entry->by_id, MAX_SYSFS_PATH_SIZE, "%s", link_name);
+            break;
+        } else if (entry->by_id[0] == '\0') {
+            snprintf(entry->by_id, MAX_SYSFS_PATH_SIZE, "%s", link_name);
+        }
+    }
+}
+
+
+/**
+ * @brief Fill in the missing block device links from the /dev/disk/by-id
+ * directory (matched by device number); this is used when udev can't tell
+ * us (no libudev context or no udev database). The lowest sorting link
+ * wins, same as with udev.
+ */
+void readByIdLinks(dev_table_t *tbl) {
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    struct stat link_stat = {0};
+    char link_path[MAX_SYSFS_PATH_SIZE] = {0};
+    blk_dev_ent_t *entry = NULL;
+    int i = 0;
+
+    if ((dir_stream = opendir(DEV_DISK_BY_ID)) == NULL)
+        return;
+    while ((dir_entry = readdir(dir_stream)) != NULL) {
+        if ((dir_entry->d_type != DT_LNK) || (fstatat(dirfd(dir_stream),
+                dir_entry->d_name, &link_stat, 0) == -1) ||
+                !S_ISBLK(link_stat.st_mode))
+            continue;
+        snprintf(link_path, MAX_SYSFS_PATH_SIZE, "%s/%s", DEV_DISK_BY_ID,
+                dir_entry->d_name);
+        for (i = 0; i < tbl->blk_cnt; i++) {
+            entry = &tbl->blk_devs[i];
+            if ((entry->dev_num == link_stat.st_rdev) &&
+                    ((entry->by_id[0] == '\0') ||
+                    (strcmp(link_path, entry->by_id) < 0)))
+                snprintf(entry->by_id, MAX_SYSFS_PATH_SIZE, "%s", link_path);
+        }
+    }
+    closedir(dir_stream);
+}
+
+
+/**
+ * @brief Read a SCSI device's attributes from sysfs (relative to the open
+ * /sys/class/scsi_device directory). Return FALSE if the device went away.
+ */
+boolean readSCSIDevEntry(int scsi_fd, const char *hctl,
+        scsi_dev_ent_t *entry) {
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    char attr_val[MAX_SYSFS_ATTR_SIZE] = {0},
+            attr_path[MAX_SYSFS_PATH_SIZE] = {0};
+    int dev_fd = -1;
+
+    memset(entry, 0, sizeof (scsi_dev_ent_t));
+    snprintf(entry->hctl, MISC_STRING_LEN, "%s", hctl);
+    snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/device", hctl);
+    if ((dev_fd = openDirAt(scsi_fd, attr_path)) == -1)
+        return FALSE;
+    if (readAttributeAt(dev_fd, "type", attr_val) == 0)
+        entry->type = atoi(attr_val);
+    else
+        entry->type = -1;
+    if (readAttributeAt(dev_fd, "vendor", attr_val) == 0)
+        snprintf(entry->vendor, MISC_STRING_LEN, "%s", strStrip(attr_val));
+    if (readAttributeAt(dev_fd, "model", attr_val) == 0)
+        snprintf(entry->model, MISC_STRING_LEN, "%s", strStrip(attr_val));
+    if (readAttributeAt(dev_fd, "rev", attr_val) == 0)
+        snprintf(entry->rev, MISC_STRING_LEN, "%s", strStrip(attr_val));
+
+    /* The first directory is the block device node name */
+    if ((dir_stream = openDirStreamAt(dev_fd, "block")) != NULL) {
+        while ((dir_entry = readdir(dir_stream)) != NULL) {
+            if ((dir_entry->d_type == DT_DIR) &&
+                    (dir_entry->d_name[0] != '.')) {
+                snprintf(entry->block_name, MISC_STRING_LEN, "%s",
+                        dir_entry->d_name);
+                break;
+            }
+        }
+        closedir(dir_stream);
+    }
+    close(dev_fd);
+
+    snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s", SYSFS_SCSI_DISK, hctl);
+    entry->scsi_disk = (faccessat(AT_FDCWD, attr_path, F_OK, 0) == 0);
+    return TRUE;
+}
+
+
+/**
+ * @brief Read all of the block devices into the given (private) table. The
+ * udev context may be NULL. Return FALSE if we couldn't allocate memory.
+ */
+boolean scanBlkDevs(dev_table_t *tbl, struct udev *udev) {
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    struct udev_device *udev_dev = NULL;
+    blk_dev_ent_t *entry = NULL;
+    boolean success = TRUE;
+
+    tbl->blk_cnt = 0;
+    if ((dir_stream = opendir(SYSFS_BLOCK)) == NULL) {
+        DEBUG_LOG("opendir(): %s", strerror(errno));
+        return TRUE;
+    }
+    while ((dir_entry = readdir(dir_stream)) != NULL) {
+        if (dir_entry->d_type != DT_LNK)
+            continue;
+        if (!growBlkDevTable(tbl, (tbl->blk_cnt + 1))) {
+            success = FALSE;
+            break;
+        }
+        entry = &tbl->blk_devs[tbl->blk_cnt];
+        if (!readBlkDevEntry(dirfd(dir_stream), dir_entry->d_name, entry))
+            continue;
+        if ((udev != NULL) && ((udev_dev = udev_device_new_from_subsystem_sysname(
+                udev, "block", dir_entry->d_name)) != NULL)) {
+            setBlkDevLinks(udev_dev, entry);
+            udev_device_unref(udev_dev);
+        }
+        tbl->blk_cnt++;
+    }
+    closedir(dir_stream);
+    readByIdLinks(tbl);
+    return success;
+}
+
+
+/**
+ * @brief Read all of the SCSI devices into the given (private) table.
+ * Return FALSE if we couldn't allocate memory.
+ */
+boolean scanSCSIDevs(dev_table_t *tbl) {
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    boolean success = TRUE;
+
+    tbl->scsi_cnt = 0;
+    if ((dir_stream = opendir(SYSFS_SCSI_DEVICE)) == NULL) {
+        DEBUG_LOG("opendir(): %s", strerror(errno));
+        return TRUE;
+    }
+    while ((dir_entry = readdir(dir_stream)) != NULL) {
+        if (dir_entry->d_type != DT_LNK)
+            continue;
+        if (!growSCSIDevTable(tbl, (tbl->scsi_cnt + 1))) {
+            success = FALSE;
+            break;
+        }
+        if (readSCSIDevEntry(dirfd(dir_stream), dir_entry->d_name,
+                &tbl->scsi_devs[tbl->scsi_cnt]))
+            tbl->scsi_cnt++;
+    }
+    closedir(dir_stream);
+    return success;
+}
+
+
+/**
+ * @brief Swap the block and/or SCSI devices of a private table into the
+ * shared table (with the lock held); the private table gets the old rows so
+ * they can be freed or re-used.
+ */
+void swapDevTable(dev_table_t *tbl, boolean blk_devs, boolean scsi_devs) {
+    dev_table_t old_tbl;
+
+    pthread_mutex_lock(&g_dev_table_mutex);
+    old_tbl = g_dev_table;
+    if (blk_devs) {
+        g_dev_table.blk_cnt = tbl->blk_cnt;
+        g_dev_table.blk_alloc = tbl->blk_alloc;
+        g_dev_table.blk_devs = tbl->blk_devs;
+        tbl->blk_cnt = old_tbl.blk_cnt;
+        tbl->blk_alloc = old_tbl.blk_alloc;
+        tbl->blk_devs = old_tbl.blk_devs;
+    }
+    if (scsi_devs) {
+        g_dev_table.scsi_cnt = tbl->scsi_cnt;
+        g_dev_table.scsi_alloc = tbl->scsi_alloc;
+        g_dev_table.scsi_devs = tbl->scsi_devs;
+        tbl->scsi_cnt = old_tbl.scsi_cnt;
+        tbl->scsi_alloc = old_tbl.scsi_alloc;
+        tbl->scsi_devs = old_tbl.scsi_devs;
+    }
+    /* Swapping in both halves means we have a complete read */
+    if (blk_devs && scsi_devs)
+        g_dev_table.scan_failed = FALSE;
+    g_dev_table.populated = TRUE;
+    pthread_cond_broadcast(&g_dev_table_cond);
+    pthread_mutex_unlock(&g_dev_table_mutex);
+}
+
+
+/**
+ * @brief Re-read the whole device table (the udev context may be NULL).
+ * Return FALSE if we couldn't allocate memory (the table isn't changed).
+ */
+boolean rescanDevTable(struct udev *udev) {
+    dev_table_t new_tbl = {0};
+    boolean success = FALSE;
+    struct timespec prof_start = {0};
+
+    startProfile(&prof_start);
+    if (scanBlkDevs(&new_tbl, udev) && scanSCSIDevs(&new_tbl)) {
+        swapDevTable(&new_tbl, TRUE, TRUE);
+        success = TRUE;
+    }
+    endProfile("sysfs walk: device table", &prof_start);
+    FREE_NULL(new_tbl.blk_devs);
+    FREE_NULL(new_tbl.scsi_devs);
+    return success;
+}
+
+
+/**
+ * @brief Apply one udev event to the device table. Block disk events update
+ * (or remove) just that row; partitions are ignored. The SCSI devices are
+ * few, so for those (and for SCSI disk events, which change a SCSI device's
+ * block node) we simply re-read them all.
+ */
+void handleDevEvent(struct udev_device *udev_dev, int block_fd,
+        dev_table_t *scratch) {
+    const char *subsystem = NULL, *dev_type = NULL, *action = NULL,
+            *sys_name = NULL;
+    blk_dev_ent_t entry;
+    boolean have_entry = FALSE;
+    int row = 0;
+
+    if (((subsystem = udev_device_get_subsystem(udev_dev)) == NULL) ||
+            ((sys_name = udev_device_get_sysname(udev_dev)) == NULL))
+        return;
+    action = udev_device_get_action(udev_dev);
+
+    if (strcmp(subsystem, "block") == 0) {
+        dev_type = udev_device_get_devtype(udev_dev);
+        if ((dev_type != NULL) && (strcmp(dev_type, "disk") != 0))
+            return;
+        if ((action == NULL) || (strcmp(action, "remove") != 0)) {
+            if ((have_entry = readBlkDevEntry(block_fd, sys_name, &entry)))
+                setBlkDevLinks(udev_dev, &entry);
+        }
+
+        pthread_mutex_lock(&g_dev_table_mutex);
+        row = findBlkDevEntry(&g_dev_table, sys_name);
+        if (!have_entry) {
+            if (row != -1) {
+                memmove(&g_dev_table.blk_devs[row],
+                        &g_dev_table.blk_devs[row + 1],
+                        (sizeof (blk_dev_ent_t) *
+                        (g_dev_table.blk_cnt - row - 1)));
+                g_dev_table.blk_cnt--;
+            }
+        } else if (row != -1) {
+            entry.in_use = g_dev_table.blk_devs[row].in_use;
+            g_dev_table.blk_devs[row] = entry;
+        } else if (growBlkDevTable(&g_dev_table,
+                (g_dev_table.blk_cnt + 1))) {
+            g_dev_table.blk_devs[g_dev_table.blk_cnt++] = entry;
+        }
+        pthread_mutex_unlock(&g_dev_table_mutex);
+
+        if (strncmp(sys_name, "sd", 2) != 0)
+            return;
+    }
+
+    /* The SCSI devices */
+    if (scanSCSIDevs(scratch))
+        swapDevTable(scratch, FALSE, TRUE);
+}
+
+
+/**
+ * @brief The device table thread; start listening for udev events, read the
+ * table, then apply the events as they come in (until we're told to stop).
+ * Without a udev monitor the table is read once and the thread exits; the
+ * pickers then re-read it each time they're used.
+ */
+void *devTableThread(void *arg) {
+    struct udev *udev = NULL;
+    struct udev_monitor *monitor = NULL;
+    struct udev_device *udev_dev = NULL;
+    struct pollfd poll_fd = {0};
+    dev_table_t scratch = {0};
+    int block_fd = -1;
+
+    (void) arg;
+
+    blockThreadSignals(NULL);
+
+    /* Listen before the first read, so we don't miss anything in between;
+     * the "udev" source means the links have been created already */
+    if ((udev = udev_new()) == NULL) {
+        DEBUG_LOG("udev_new() failed");
+    } else if ((monitor = udev_monitor_new_from_netlink(udev,
+            "udev")) == NULL) {
+        DEBUG_LOG("udev_monitor_new_from_netlink() failed");
+    } else if ((udev_monitor_filter_add_match_subsystem_devtype(monitor,
+            "block", NULL) < 0) ||
+            (udev_monitor_filter_add_match_subsystem_devtype(monitor,
+            "scsi", "scsi_device") < 0) ||
+            (udev_monitor_enable_receiving(monitor) < 0) ||
+            ((block_fd = openDirAt(AT_FDCWD, SYSFS_BLOCK)) == -1)) {
+        DEBUG_LOG("Couldn't set up the udev monitor.");
+        udev_monitor_unref(monitor);
+        monitor = NULL;
+    }
+
+    pthread_mutex_lock(&g_dev_table_mutex);
+    g_dev_table.monitored = (monitor != NULL);
+    pthread_mutex_unlock(&g_dev_table_mutex);
+    if (!rescanDevTable(udev)) {
+        DEBUG_LOG("Couldn't allocate memory for the device table.");
+        /* Don't leave the pickers waiting for a table that isn't coming */
+        pthread_mutex_lock(&g_dev_table_mutex);
+        g_dev_table.scan_failed = TRUE;
+        pthread_cond_broadcast(&g_dev_table_cond);
+        pthread_mutex_unlock(&g_dev_table_mutex);
+    }
+
+    if (monitor != NULL) {
+        poll_fd.fd = udev_monitor_get_fd(monitor);
+        poll_fd.events = POLLIN;
+        while (!g_dev_table_stop) {
+            if (poll(&poll_fd, 1, DEV_TABLE_POLL_MSEC) <= 0)
+                continue;
+            while ((udev_dev =
+                    udev_monitor_receive_device(monitor)) != NULL) {
+                handleDevEvent(udev_dev, block_fd, &scratch);
+                udev_device_unref(udev_dev);
+            }
+        }
+        udev_monitor_unref(monitor);
+        close(block_fd);
+    }
+
+    /* Done */
+    FREE_NULL(scratch.scsi_devs);
+    udev_unref(udev);
+    return NULL;
+}
+
+
+/**
+ * @brief Start the device table thread (if it isn't already running). Return
+ * FALSE if the thread couldn't be created (the pickers still work, they just
+ * read the devices each time).
+ */
+boolean startDevTable() {
+    int ret_val = 0;
+
+    if (g_dev_table_running)
+        return TRUE;
+    g_dev_table_stop = FALSE;
+    if ((ret_val = pthread_create(&g_dev_table_thread, NULL,
+            devTableThread, NULL)) != 0) {
+        DEBUG_LOG("pthread_create(): %s", strerror(ret_val));
+        return FALSE;
+    }
+    g_dev_table_running = TRUE;
+    return TRUE;
+}
+
+
+/**
+ * @brief Tell the device table thread to stop; like the collector, we don't
+ * wait for it.
+ */
+void stopDevTable() {
+    if (!g_dev_table_running)
+        return;
+    g_dev_table_stop = TRUE;
+    pthread_detach(g_dev_table_thread);
+    g_dev_table_running = FALSE;
+}
+
+
+/**
+ * @brief Make sure the device table can be read: wait for the first read if
+ * the thread is still doing it, and if there is no udev monitor keeping the
+ * table current (or the thread's read failed), read it again now.
+ */
+void readyDevTable() {
+    boolean monitored = FALSE, scan_failed = FALSE;
+
+    pthread_mutex_lock(&g_dev_table_mutex);
+    while (g_dev_table_running && !g_dev_table.populated &&
+            !g_dev_table.scan_failed)
+        pthread_cond_wait(&g_dev_table_cond, &g_dev_table_mutex);
+    monitored = g_dev_table.monitored;
+    scan_failed = g_dev_table.scan_failed;
+    pthread_mutex_unlock(&g_dev_table_mutex);
+
+    if ((!monitored || scan_failed) && !rescanDevTable(NULL))
+        DEBUG_LOG("Couldn't allocate memory for the device table.");
+}
+
+
+/**
+ * @brief Update the in-use status of the block devices. Mounts, swap and
+ * the SCST configuration don't generate udev events, so this is done (it's
+ * cheap, no device is opened) whenever a picker is about to be shown.
+ * Return FALSE if we couldn't allocate memory.
+ */
+boolean refreshDevTableInUse() {
+    str_pool_t in_use = {0};
+    int i = 0;
+
+    if (!findBlockDevsInUse(&in_use)) {
+        freeStrPool(&in_use);
+        return FALSE;
+    }
+    pthread_mutex_lock(&g_dev_table_mutex);
+    for (i = 0; i < g_dev_table.blk_cnt; i++)
+        g_dev_table.blk_devs[i].in_use = (lookupStr(&in_use,
+                g_dev_table.blk_devs[i].name) != -1);
+    pthread_mutex_unlock(&g_dev_table_mutex);
+    freeStrPool(&in_use);
+    return TRUE;
+}
+
+
+/**
+ * @brief Get the stable (/dev/disk/by-id, etc.) link for the named block
+ * device from the device table. Return FALSE if it doesn't have one.
+ */
+boolean getDevTableLink(const char *dev_name, char dev_link[]) {
+    int row = 0;
+
+    dev_link[0] = '\0';
+    pthread_mutex_lock(&g_dev_table_mutex);
+    if ((row = findBlkDevEntry(&g_dev_table, dev_name)) != -1)
+        snprintf(dev_link, MAX_SYSFS_PATH_SIZE, "%s",
+                g_dev_table.blk_devs[row].by_id);
+    pthread_mutex_unlock(&g_dev_table_mutex);
+    return (dev_link[0] != '\0');
+}
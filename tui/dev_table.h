@@ -0,0 +1,74 @@
+/**
+ * @file dev_table.h
+ * @brief Data structures for the live (udev monitored) device table.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _DEV_TABLE_H
+#define	_DEV_TABLE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <sys/types.h>
+#include <pthread.h>
+
+#include "system.h"
+
+/* From libudev.h (only used by pointer outside of dev_table.c) */
+struct udev;
+struct udev_device;
+
+/* A block device (an entry in /sys/block) */
+typedef struct {
+    char name[MISC_STRING_LEN];
+    dev_t dev_num;
+    unsigned long long size;
+    char model[MISC_STRING_LEN];
+    char info[MISC_STRING_LEN];
+    /* The first /dev/disk/by-id link (or another udev link if it doesn't
+     * have one); empty if udev didn't create any */
+    char by_id[MAX_SYSFS_PATH_SIZE];
+    /* A device type we offer in the block device list */
+    boolean listable;
+    /* Mounted, has holders, used by SCST, etc. (see refreshDevTableInUse()) */
+    boolean in_use;
+} blk_dev_ent_t;
+
+/* A SCSI device (an entry in /sys/class/scsi_device) */
+typedef struct {
+    char hctl[MISC_STRING_LEN];
+    int type;
+    char vendor[MISC_STRING_LEN];
+    char model[MISC_STRING_LEN];
+    char rev[MISC_STRING_LEN];
+    /* The block device node name (empty if it doesn't have one) */
+    char block_name[MISC_STRING_LEN];
+    /* Bound to the SCSI disk driver (in /sys/class/scsi_disk) */
+    boolean scsi_disk;
+} scsi_dev_ent_t;
+
+/* The device table; the monitor thread updates it (with the lock held) and
+ * the device pickers read it */
+typedef struct {
+    boolean populated;
+    /* The thread's first (full) read failed; the pickers read it themselves
+     * until one succeeds */
+    boolean scan_failed;
+    boolean monitored;
+    int blk_cnt;
+    int blk_alloc;
+    blk_dev_ent_t *blk_devs;
+    int scsi_cnt;
+    int scsi_alloc;
+    scsi_dev_ent_t *scsi_devs;
+} dev_table_t;
+extern dev_table_t g_dev_table;
+extern pthread_mutex_t g_dev_table_mutex;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _DEV_TABLE_H */
@@ -85,6 +85,7 @@ extern int g_color_dialog_title[MAX_TUI_THEMES];
 #define LUN_LAYOUT_ROWS                 12
 #define LUN_LAYOUT_COLS                 62
 #define MAX_LUN_LAYOUT_LINES            128
+#define LUN_LAYOUT_ROW_SIZE             384
 #define CRM_INFO_ROWS                   12
 #define CRM_INFO_COLS                   68
 #define MAX_CRM_INFO_LINES              512
@@ -94,6 +95,20 @@ extern int g_color_dialog_title[MAX_TUI_THEMES];
 #define ALUA_LAYOUT_ROWS                12
 #define ALUA_LAYOUT_COLS                72
 #define MAX_ALUA_LAYOUT_LINES           128
+#define MGMT_RESULT_ROWS                12
+#define MGMT_RESULT_COLS                70
+#define MAX_MGMT_RESULT_LINES           512
+#define MGMT_RESULT_ROW_SIZE            384
+#define PROFILE_INFO_ROWS               14
+#define PROFILE_INFO_COLS               74
+#define PROFILE_ROW_SIZE                128
+#define JOBS_INFO_ROWS                  14
+#define JOBS_INFO_COLS                  74
+#define JOBS_ROW_SIZE                   160
+#define BENCH_INFO_ROWS                 16
+#define BENCH_INFO_COLS                 70
+#define MAX_BENCH_INFO_LINES            32
+#define BENCH_ROW_SIZE                  128
 #define ESOS_LICENSE_ROWS               10
 #define ESOS_LICENSE_COLS               76
 #define MAX_ESOS_LICENSE_LINES          768
@@ -104,6 +119,10 @@ extern int g_color_dialog_title[MAX_TUI_THEMES];
 #define NEW_LD_INFO_LINES               3
 #define NEW_ARRAY_INFO_LINES            3
 #define ADD_VDISK_INFO_LINES            4
+#define CLONE_VDISK_INFO_LINES          4
+#define RECLAIM_VDISK_INFO_LINES        4
+#define STRIPE_GEOM_INFO_LINES          4
+#define BENCH_SETUP_INFO_LINES          4
 #define NEW_LV_INFO_LINES               4
 #define CONFIRM_DIAG_MSG_SIZE           6
 #define ERROR_DIAG_MSG_SIZE             6
@@ -136,6 +155,8 @@ extern int g_color_dialog_title[MAX_TUI_THEMES];
 #define MAX_VDISK_NAME_LEN      32
 #define MAX_ARRAY_NAME_LEN      32
 #define MAX_LV_NAME_LEN         32
+#define MAX_MOUNT_OPTS_LEN      256
+#define MAX_MOUNT_PROFILES      16
 
 /* Misc. limits */
 #define MAX_FILE_SYSTEMS                128
@@ -145,6 +166,11 @@ extern int g_color_dialog_title[MAX_TUI_THEMES];
 #define MAX_ZONEINFO_PATH               64
 #define MAX_TZ_FILES                    1024
 #define MAX_PD_INFO_LINE_BUFF           4096
+/* File system stripe alignment; the unit is in KiB (a multiple of the 4 KiB
+ * file system block) and the width is the number of data disks */
+#define FS_STRIPE_BLOCK_SIZE            4096
+#define MAX_FS_STRIPE_UNIT_KB           1048576
+#define MAX_FS_STRIPE_WIDTH             256
 #define MAX_DEV_INFO_LINE_BUFF          4096
 #define MAX_SLAVES_LIST_BUFF            512
 #define MAX_BR_MEMBERS_LIST_BUFF        512
@@ -187,6 +213,31 @@ typedef enum {
     NO_BONDING, MASTER, SLAVE
 } bonding_t;
 
+/* A set of fixed-size line buffers for the rows of a label or scroll window;
+ * the rows are formatted in place and the buffers are re-used every refresh.
+ * The line pointers (handed to the widgets) are NULL for unused rows */
+typedef struct {
+    int rows;
+    int cols;
+    int used;
+    char *buffer;
+    char **lines;
+} row_arena_t;
+
+/* A named set of mount options (from the ESOS config. file, or built-in);
+ * the options can be limited to a file system type, eg, "xfs:inode64" */
+typedef struct {
+    char name[MISC_STRING_LEN];
+    char options[MAX_MOUNT_OPTS_LEN];
+} mount_profile_t;
+
+/* What a main screen information label (widget) is showing; only the rows
+ * that changed are redrawn (the rows are compared as markup strings) */
+typedef struct {
+    CDKLABEL *label;
+    row_arena_t shown;
+} info_label_t;
+
 /* This would normally be set via the ESOS build */
 #ifndef BUILD_OPTS
 #define BUILD_OPTS "N/A"
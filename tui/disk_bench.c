@@ -0,0 +1,530 @@
+/**
+ * @file disk_bench.c
+ * @brief Functions for benchmarking a block device or file with direct,
+ * asynchronous I/O; these don't touch the screen, the dialog starts a run
+ * and polls it.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <syslog.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <libaio.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "disk_bench.h"
+
+
+/**
+ * @brief Return the time as nanoseconds.
+ */
+long long timespecNsec(const struct timespec *time) {
+    return ((time->tv_sec * 1000000000LL) + time->tv_nsec);
+}
+
+
+/**
+ * @brief Return the histogram bucket for a value.
+ */
+int histBucket(uint64_t value) {
+    int shift = 0, bucket = 0;
+
+    if (value < (1ULL << BENCH_HIST_SUB_BITS))
+        return (int) value;
+    /* Keep the top SUB_BITS bits; the shift says which power of two */
+    shift = (63 - __builtin_clzll(value)) - BENCH_HIST_SUB_BITS + 1;
+    bucket = (shift << (BENCH_HIST_SUB_BITS - 1)) + (int) (value >> shift);
+    return MIN(bucket, (BENCH_HIST_BUCKETS - 1));
+}
+
+
+/**
+ * @brief Return the value a histogram bucket stands for (the middle of its
+ * range).
+ */
+uint64_t histBucketValue(int bucket) {
+    int shift = 0;
+
+    if (bucket < (1 << BENCH_HIST_SUB_BITS))
+        return (uint64_t) bucket;
+    shift = (bucket >> (BENCH_HIST_SUB_BITS - 1)) - 1;
+    return (((uint64_t) (bucket - (shift << (BENCH_HIST_SUB_BITS - 1))) <<
+            shift) + (((1ULL << shift) - 1) / 2));
+}
+
+
+/**
+ * @brief Add a value to a histogram.
+ */
+void histAdd(bench_hist_t *hist, uint64_t value) {
+    hist->counts[histBucket(value)]++;
+    if ((hist->total == 0) || (value < hist->min))
+        hist->min = value;
+    if (value > hist->max)
+        hist->max = value;
+    hist->sum += value;
+    hist->total++;
+}
+
+
+/**
+ * @brief Add all of the values in one histogram to another.
+ */
+void histMerge(bench_hist_t *dest, const bench_hist_t *src) {
+    int i = 0;
+
+    if (src->total == 0)
+        return;
+    for (i = 0; i < BENCH_HIST_BUCKETS; i++)
+        dest->counts[i] += src->counts[i];
+    if ((dest->total == 0) || (src->min < dest->min))
+        dest->min = src->min;
+    if (src->max > dest->max)
+        dest->max = src->max;
+    dest->sum += src->sum;
+    dest->total += src->total;
+}
+
+
+/**
+ * @brief Return the value (eg, 99.9) percent of the histogram values are at
+ * or below; zero if it's empty.
+ */
+uint64_t histPercentile(const bench_hist_t *hist, double percent) {
+    uint64_t wanted = 0, seen = 0, value = 0;
+    int i = 0;
+
+    if (hist->total == 0)
+        return 0;
+    wanted = (uint64_t) ((hist->total * percent) / 100.0);
+    if (wanted < 1)
+        wanted = 1;
+    for (i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= wanted)
+            break;
+    }
+    value = histBucketValue(MIN(i, (BENCH_HIST_BUCKETS - 1)));
+    /* The extremes are known exactly */
+    return MAX(MIN(value, hist->max), hist->min);
+}
+
+
+/**
+ * @brief Return the next number from a job's (xorshift64*) random number
+ * generator; it only picks the offsets, so it doesn't need to be any good.
+ */
+uint64_t benchRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return (*state * 2685821657736338717ULL);
+}
+
+
+/**
+ * @brief One benchmark job; it keeps its queue full of block sized I/O
+ * until the run time is up (or it's stopped), timing each one. Random tests
+ * pick any block on the target; for sequential tests each job has its own
+ * part of the target and goes around it. The counts are added to the run's
+ * totals every so often, the latency histogram at the end.
+ */
+void *benchThread(void *arg) {
+    bench_job_t *job = (bench_job_t *) arg;
+    bench_t *bench = job->bench;
+    io_context_t aio_ctx = 0;
+    struct iocb *iocbs = NULL, **free_cbs = NULL, **submit_cbs = NULL,
+            *curr_cb = NULL;
+    struct io_event *events = NULL;
+    struct timespec now = {0};
+    long long *submitted = NULL;
+    bench_hist_t *hist = NULL;
+    void *buffer = NULL;
+    long long blocks = 0, region_start = 0, region_blocks = 0, next_block = 0,
+            seq_block = 0, ios = 0, bytes = 0, added_ios = 0, added_bytes = 0,
+            now_nsec = 0, deadline = 0, last_added = 0;
+    long result = 0;
+    uint64_t rand_state = 0;
+    int free_cnt = 0, in_flight = 0, submit_cnt = 0, got = 0, ret_val = 0,
+            i = 0, io_errno = 0;
+    unsigned char *fill = NULL;
+    const char *error_func = NULL;
+    boolean write_test = FALSE, rand_test = FALSE, stop = FALSE;
+
+    /* Started from the UI thread, so it doesn't inherit a blocked mask */
+    blockThreadSignals(NULL);
+
+    write_test = ((bench->test == BENCH_SEQ_WRITE) ||
+            (bench->test == BENCH_RAND_WRITE));
+    rand_test = ((bench->test == BENCH_RAND_READ) ||
+            (bench->test == BENCH_RAND_WRITE));
+    blocks = bench->size / bench->block_size;
+    region_blocks = blocks / bench->jobs;
+    region_start = job->index * region_blocks;
+    rand_state = ((uint64_t) timespecNsec(&bench->started) ^
+            (0x9E3779B97F4A7C15ULL * (job->index + 1)));
+    if (rand_state == 0)
+        rand_state = 1;
+    deadline = timespecNsec(&bench->started) +
+            (bench->run_time * 1000000000LL);
+    last_added = timespecNsec(&bench->started);
+
+    while (1) {
+        /* Every I/O uses the same buffer; the data isn't looked at, but
+         * what's written isn't zeros (thin storage would skip them) */
+        if ((ret_val = posix_memalign(&buffer, BENCH_ALIGN,
+                bench->block_size)) != 0) {
+            buffer = NULL;
+            io_errno = ret_val;
+            error_func = "posix_memalign()";
+            break;
+        }
+        fill = (unsigned char *) buffer;
+        for (i = 0; i < bench->block_size; i++)
+            fill[i] = (unsigned char) benchRandom(&rand_state);
+        if (((iocbs = calloc(bench->queue_depth,
+                sizeof (struct iocb))) == NULL) ||
+                ((free_cbs = calloc(bench->queue_depth,
+                sizeof (struct iocb *))) == NULL) ||
+                ((submit_cbs = calloc(bench->queue_depth,
+                sizeof (struct iocb *))) == NULL) ||
+                ((submitted = calloc(bench->queue_depth,
+                sizeof (long long))) == NULL) ||
+                ((events = calloc(bench->queue_depth,
+                sizeof (struct io_event))) == NULL) ||
+                ((hist = calloc(1, sizeof (bench_hist_t))) == NULL)) {
+            io_errno = errno;
+            error_func = "calloc()";
+            break;
+        }
+        for (i = 0; i < bench->queue_depth; i++)
+            free_cbs[free_cnt++] = &iocbs[i];
+        if ((ret_val = io_setup(bench->queue_depth, &aio_ctx)) != 0) {
+            aio_ctx = 0;
+            io_errno = -ret_val;
+            error_func = "io_setup()";
+            break;
+        }
+
+        while (1) {
+            /* Fill the queue back up (in one call) */
+            if (!stop) {
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                now_nsec = timespecNsec(&now);
+                submit_cnt = 0;
+                while (free_cnt > 0) {
+                    curr_cb = free_cbs[--free_cnt];
+                    if (rand_test) {
+                        next_block = (long long) (benchRandom(&rand_state) %
+                                (uint64_t) blocks);
+                    } else {
+                        next_block = region_start + seq_block;
+                        seq_block = ((seq_block + 1) % region_blocks);
+                    }
+                    if (write_test)
+                        io_prep_pwrite(curr_cb, bench->fd, buffer,
+                                bench->block_size,
+                                (next_block * bench->block_size));
+                    else
+                        io_prep_pread(curr_cb, bench->fd, buffer,
+                                bench->block_size,
+                                (next_block * bench->block_size));
+                    submitted[curr_cb - iocbs] = now_nsec;
+                    submit_cbs[submit_cnt++] = curr_cb;
+                }
+                if (submit_cnt > 0) {
+                    ret_val = io_submit(aio_ctx, submit_cnt, submit_cbs);
+                    /* With some in flight, the device is just busy */
+                    if ((ret_val < 0) && ((ret_val != -EAGAIN) ||
+                            (in_flight == 0))) {
+                        io_errno = -ret_val;
+                        error_func = "io_submit()";
+                        stop = TRUE;
+                    }
+                    if (ret_val < 0)
+                        ret_val = 0;
+                    for (i = ret_val; i < submit_cnt; i++)
+                        free_cbs[free_cnt++] = submit_cbs[i];
+                    in_flight += ret_val;
+                }
+            }
+            if (in_flight == 0)
+                break;
+
+            /* Reap whatever has finished; they're all timed as of now */
+            if ((got = io_getevents(aio_ctx, 1, in_flight, events,
+                    NULL)) < 0) {
+                if (got == -EINTR)
+                    continue;
+                if (io_errno == 0) {
+                    io_errno = -got;
+                    error_func = "io_getevents()";
+                }
+                break;
+            }
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            now_nsec = timespecNsec(&now);
+            for (i = 0; i < got; i++) {
+                curr_cb = events[i].obj;
+                result = (long) events[i].res;
+                if ((result < 0) || ((unsigned long) result !=
+                        curr_cb->u.c.nbytes)) {
+                    if (io_errno == 0) {
+                        io_errno = ((result < 0) ? -result : EIO);
+                        error_func = (write_test ? "Asynchronous write" :
+                                "Asynchronous read");
+                    }
+                    stop = TRUE;
+                } else {
+                    histAdd(hist, (uint64_t) (now_nsec -
+                            submitted[curr_cb - iocbs]));
+                    ios++;
+                    bytes += result;
+                }
+                free_cbs[free_cnt++] = curr_cb;
+                in_flight--;
+            }
+
+            /* Add our counts to the totals, and see if we should stop */
+            if (!stop && ((now_nsec - last_added) >= BENCH_PUBLISH_NSEC)) {
+                pthread_mutex_lock(&bench->mutex);
+                bench->ios += (ios - added_ios);
+                bench->bytes += (bytes - added_bytes);
+                stop = bench->stop;
+                pthread_mutex_unlock(&bench->mutex);
+                added_ios = ios;
+                added_bytes = bytes;
+                last_added = now_nsec;
+            }
+            if (now_nsec >= deadline)
+                stop = TRUE;
+        }
+        break;
+    }
+
+    /* Done; the last one out notes the time */
+    if (aio_ctx != 0)
+        io_destroy(aio_ctx);
+    pthread_mutex_lock(&bench->mutex);
+    bench->ios += (ios - added_ios);
+    bench->bytes += (bytes - added_bytes);
+    if (hist != NULL)
+        histMerge(&bench->hist, hist);
+    if ((io_errno != 0) && (bench->error == 0)) {
+        bench->error = io_errno;
+        snprintf(bench->error_func, MISC_STRING_LEN, "%s", error_func);
+        /* No point in the others carrying on */
+        bench->stop = TRUE;
+    }
+    if (--bench->running == 0)
+        clock_gettime(CLOCK_MONOTONIC, &bench->finished);
+    pthread_mutex_unlock(&bench->mutex);
+    FREE_NULL(hist);
+    FREE_NULL(events);
+    FREE_NULL(submitted);
+    FREE_NULL(submit_cbs);
+    FREE_NULL(free_cbs);
+    FREE_NULL(iocbs);
+    free(buffer);
+    return NULL;
+}
+
+
+/**
+ * @brief Start a benchmark run (the setup in the structure is filled in by
+ * the caller) against a block device or a regular file: the target is
+ * opened for direct I/O (a block device is opened exclusively for a write
+ * test, so one that's mounted, etc. is refused) and the job threads are
+ * started. Files are only tested up to their current size, they're never
+ * extended. On failure, the error message is filled and FALSE is returned;
+ * otherwise it must be finished with finishBenchmark().
+ */
+boolean startBenchmark(bench_t *bench, char error_msg[]) {
+    struct stat target_stat = {0};
+    unsigned long long dev_size = 0;
+    int open_flags = O_DIRECT, sector_size = 0, ret_val = 0;
+    boolean write_test = FALSE;
+
+    write_test = ((bench->test == BENCH_SEQ_WRITE) ||
+            (bench->test == BENCH_RAND_WRITE));
+    if ((bench->block_size < BENCH_ALIGN) ||
+            ((bench->block_size % BENCH_ALIGN) != 0)) {
+        snprintf(error_msg, MISC_STRING_LEN, "The block size must be a "
+                "multiple of %d bytes.", BENCH_ALIGN);
+        return FALSE;
+    }
+    if (bench->queue_depth < 1)
+        bench->queue_depth = 1;
+    if (bench->queue_depth > MAX_BENCH_QUEUE_DEPTH)
+        bench->queue_depth = MAX_BENCH_QUEUE_DEPTH;
+    if (bench->jobs < 1)
+        bench->jobs = 1;
+    if (bench->jobs > MAX_BENCH_JOBS)
+        bench->jobs = MAX_BENCH_JOBS;
+
+    if (stat(bench->path, &target_stat) == -1) {
+        snprintf(error_msg, MISC_STRING_LEN, "stat(): %s", strerror(errno));
+        return FALSE;
+    }
+    if (S_ISBLK(target_stat.st_mode)) {
+        open_flags |= (write_test ? (O_WRONLY | O_EXCL) : O_RDONLY);
+    } else if (S_ISREG(target_stat.st_mode)) {
+        open_flags |= (write_test ? O_WRONLY : O_RDONLY);
+    } else {
+        snprintf(error_msg, MISC_STRING_LEN, "%s is not a block device or "
+                "a regular file!", bench->path);
+        return FALSE;
+    }
+    if ((bench->fd = open(bench->path, open_flags)) == -1) {
+        if (errno == EINVAL)
+            snprintf(error_msg, MISC_STRING_LEN, "Direct I/O (O_DIRECT) "
+                    "isn't supported for %s.", bench->path);
+        else if (errno == EBUSY)
+            snprintf(error_msg, MISC_STRING_LEN, "%s is in use!",
+                    bench->path);
+        else
+            snprintf(error_msg, MISC_STRING_LEN, "open(): %s",
+                    strerror(errno));
+        return FALSE;
+    }
+
+    while (1) {
+        if (S_ISBLK(target_stat.st_mode)) {
+            if (ioctl(bench->fd, BLKGETSIZE64, &dev_size) == -1) {
+                snprintf(error_msg, MISC_STRING_LEN,
+                        "ioctl(BLKGETSIZE64): %s", strerror(errno));
+                break;
+            }
+            bench->size = (long long) dev_size;
+            if ((ioctl(bench->fd, BLKSSZGET, &sector_size) == 0) &&
+                    (sector_size > 0) &&
+                    ((bench->block_size % sector_size) != 0)) {
+                snprintf(error_msg, MISC_STRING_LEN, "The block size must "
+                        "be a multiple of the %d byte sectors.",
+                        sector_size);
+                break;
+            }
+        } else {
+            bench->size = target_stat.st_size;
+        }
+        if ((bench->size / bench->block_size) < bench->jobs) {
+            snprintf(error_msg, MISC_STRING_LEN, "%s is too small for %d "
+                    "job(s) with this block size.", bench->path, bench->jobs);
+            break;
+        }
+
+        bench->stop = FALSE;
+        bench->ios = 0;
+        bench->bytes = 0;
+        bench->error = 0;
+        bench->error_func[0] = '\0';
+        memset(&bench->hist, 0, sizeof (bench_hist_t));
+        pthread_mutex_init(&bench->mutex, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &bench->started);
+        bench->finished = bench->started;
+
+        /* Fewer jobs is fine, as long as there is one */
+        pthread_mutex_lock(&bench->mutex);
+        for (bench->thread_cnt = 0; bench->thread_cnt < bench->jobs;
+                bench->thread_cnt++) {
+            bench->job_args[bench->thread_cnt].bench = bench;
+            bench->job_args[bench->thread_cnt].index = bench->thread_cnt;
+            if ((ret_val = pthread_create(&bench->threads[bench->thread_cnt],
+                    NULL, benchThread,
+                    &bench->job_args[bench->thread_cnt])) != 0)
+                break;
+        }
+        bench->running = bench->thread_cnt;
+        pthread_mutex_unlock(&bench->mutex);
+        if (bench->thread_cnt == 0) {
+            snprintf(error_msg, MISC_STRING_LEN, "pthread_create(): %s",
+                    strerror(ret_val));
+            pthread_mutex_destroy(&bench->mutex);
+            break;
+        }
+        DEBUG_LOG("Benchmark of %s started with %d job(s).", bench->path,
+                bench->thread_cnt);
+        return TRUE;
+    }
+
+    close(bench->fd);
+    bench->fd = -1;
+    return FALSE;
+}
+
+
+/**
+ * @brief Ask the jobs of a benchmark run to stop early; the I/O they have
+ * in flight is finished first.
+ */
+void stopBenchmark(bench_t *bench) {
+    pthread_mutex_lock(&bench->mutex);
+    bench->stop = TRUE;
+    pthread_mutex_unlock(&bench->mutex);
+}
+
+
+/**
+ * @brief Get the totals so far for a benchmark run (and the nanoseconds it
+ * has been running). Return TRUE while any of its jobs are still running.
+ */
+boolean benchProgress(bench_t *bench, long long *ios, long long *bytes,
+        long long *elapsed) {
+    struct timespec now = {0};
+    boolean running = FALSE;
+
+    pthread_mutex_lock(&bench->mutex);
+    *ios = bench->ios;
+    *bytes = bench->bytes;
+    running = (bench->running > 0);
+    if (running)
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    else
+        now = bench->finished;
+    pthread_mutex_unlock(&bench->mutex);
+    *elapsed = timespecNsec(&now) - timespecNsec(&bench->started);
+    return running;
+}
+
+
+/**
+ * @brief Wait for the jobs of a benchmark run and close the target; the
+ * results are in the structure. If any I/O failed, the error message is
+ * filled and FALSE is returned (the results are still there).
+ */
+boolean finishBenchmark(bench_t *bench, char error_msg[]) {
+    int i = 0;
+
+    for (i = 0; i < bench->thread_cnt; i++)
+        pthread_join(bench->threads[i], NULL);
+    bench->thread_cnt = 0;
+    pthread_mutex_destroy(&bench->mutex);
+    if (bench->fd != -1) {
+        close(bench->fd);
+        bench->fd = -1;
+    }
+    DEBUG_LOG("Benchmark of %s finished: %lld I/O, %lld bytes.",
+            bench->path, bench->ios, bench->bytes);
+    if (bench->error != 0) {
+        snprintf(error_msg, MISC_STRING_LEN, "%s: %s", bench->error_func,
+                strerror(bench->error));
+        return FALSE;
+    }
+    return TRUE;
+}
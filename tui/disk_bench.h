@@ -0,0 +1,97 @@
+/**
+ * @file disk_bench.h
+ * @brief Data structures and settings for the block device/file I/O
+ * benchmark.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _DISK_BENCH_H
+#define	_DISK_BENCH_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "system.h"
+#include "dialogs.h"
+
+/* The benchmark I/O is O_DIRECT using Linux AIO; the block size (KiB in the
+ * dialog) is a multiple of the buffer alignment */
+#define BENCH_ALIGN             4096
+#define BENCH_DEF_BLOCK_KB      4
+#define MAX_BENCH_BLOCK_KB      4096
+#define BENCH_DEF_QUEUE_DEPTH   32
+#define MAX_BENCH_QUEUE_DEPTH   256
+#define BENCH_DEF_JOBS          1
+#define MAX_BENCH_JOBS          16
+#define BENCH_DEF_RUN_TIME      30
+#define MAX_BENCH_RUN_TIME      3600
+/* How often (nanoseconds) each job adds its counts to the totals */
+#define BENCH_PUBLISH_NSEC      100000000LL
+
+/* The latency histogram (nanoseconds), HDR style: values below
+ * 2^SUB_BITS each have a bucket, then every power of two is split into
+ * 2^(SUB_BITS - 1) buckets, so any value (and percentile) is within 1% from
+ * 1 ns up to 2^MAX_BITS ns (about 18 minutes); longer ones are counted in
+ * the last bucket */
+#define BENCH_HIST_SUB_BITS     8
+#define BENCH_HIST_MAX_BITS     40
+#define BENCH_HIST_BUCKETS      ((BENCH_HIST_MAX_BITS - \
+        BENCH_HIST_SUB_BITS + 2) << (BENCH_HIST_SUB_BITS - 1))
+
+/* The benchmark tests; the order matches the radio widget options */
+typedef enum {
+    BENCH_SEQ_READ, BENCH_SEQ_WRITE, BENCH_RAND_READ, BENCH_RAND_WRITE
+} bench_test_t;
+
+typedef struct {
+    uint64_t counts[BENCH_HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum;
+} bench_hist_t;
+
+struct bench;
+
+/* One job thread; each has its own AIO context and queue */
+typedef struct {
+    struct bench *bench;
+    int index;
+} bench_job_t;
+
+/* A benchmark run; the setup is filled by the caller, the rest is shared
+ * with the job threads (with the lock held) while it's running */
+typedef struct bench {
+    char path[MAX_VDISK_PATH_LEN];
+    bench_test_t test;
+    int block_size;
+    int queue_depth;
+    int jobs;
+    int run_time;
+    int fd;
+    long long size;
+    struct timespec started;
+    struct timespec finished;
+    pthread_t threads[MAX_BENCH_JOBS];
+    bench_job_t job_args[MAX_BENCH_JOBS];
+    int thread_cnt;
+    pthread_mutex_t mutex;
+    boolean stop;
+    int running;
+    long long ios;
+    long long bytes;
+    int error;
+    char error_func[MISC_STRING_LEN];
+    bench_hist_t hist;
+} bench_t;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _DISK_BENCH_H */
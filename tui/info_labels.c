@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <syslog.h>
 #include <errno.h>
 #include <cdk.h>
 #include <sys/param.h>
@@ -21,27 +22,66 @@
 #include "strings.h"
 
 
+/* The UI thread's copy of the latest collector snapshot, and the session
+ * display order (grows with the session table, re-used every refresh) */
+scst_topo_t g_ui_topo;
+unsigned long g_ui_topo_seq = 0;
+int *g_sess_order = NULL;
+int g_sess_order_size = 0;
+
+/* How the sessions label is sorted/limited (changed from the main screen);
+ * a top-N limit of zero means show them all */
+sess_sort_t g_sess_sort_key = SORT_READ_RATE;
+int g_sess_top_n_opts[] = {0, 10, 25, 50, 100};
+int g_sess_top_n = 0;
+
+/* The sessions label can show the SCST devices instead ('v' key); they are
+ * ordered busiest first (the order array grows like the session one) */
+boolean g_show_devices = FALSE;
+int *g_dev_order = NULL;
+int g_dev_order_size = 0;
+
+/* What each information label widget is currently showing */
+info_label_t g_tgt_label_state, g_sess_label_state;
+
+/* What qsort_r() compares the session indexes with */
+typedef struct {
+    scst_topo_t *topo;
+    sess_sort_t key;
+} sess_sort_ctx_t;
+
+
 /**
  * @brief This function is responsible for moving, resizing, and updating the
  * message lines in the main screen information labels. It will read the screen
  * size and message data for each label then act based on this data. It should
  * be called when the terminal is re-sized and frequently to update the display.
+ * The label widgets are created large enough for the screen and are then moved
+ * and resized in place; only rows that changed are redrawn, and the terminal
+ * is updated once (wnoutrefresh/doupdate) so we send as little as possible.
  */
 boolean updateInfoLabels(CDKSCREEN *cdk_screen,
         CDKLABEL **tgt_info, CDKLABEL **sess_info,
-        char *tgt_info_msg[],  char *sess_info_msg[],
+        row_arena_t *tgt_label_rows, row_arena_t *sess_label_rows,
         int *last_scr_y, int *last_scr_x,
         int *last_tgt_rows, int *last_sess_rows) {
     int window_x = 0, window_y = 0, usable_height = 0, half_height = 0,
             tgt_want_rows = 0, sess_want_rows = 0, tgt_lbl_rows = 0,
             sess_lbl_rows = 0, tgt_lbl_height = 0, sess_lbl_height = 0,
-            tgt_y_start = 0, sess_y_start = 0,
+            tgt_y_start = 0, sess_y_start = 0, lbl_capacity = 0,
             smallest_val = 0, largest_val = 0;
-    boolean success = TRUE;
+    boolean success = TRUE, moved = FALSE;
+
+    /* Swap in the latest snapshot from the collector thread (if any); we
+     * never read sysfs here, so a stalled read can't hang the UI */
+    getTopoSnapshot(&g_ui_topo, &g_ui_topo_seq);
 
     /* Fill the label messages and get sizes */
-    tgt_want_rows = readTargetData(tgt_info_msg);
-    sess_want_rows = readSessionData(sess_info_msg);
+    tgt_want_rows = readTargetData(&g_ui_topo, tgt_label_rows);
+    if (g_show_devices)
+        sess_want_rows = readDeviceData(&g_ui_topo, sess_label_rows);
+    else
+        sess_want_rows = readSessionData(&g_ui_topo, sess_label_rows);
 
     /* Figure out how much real estate we have */
     getmaxyx(cdk_screen->window, window_y, window_x);
@@ -90,31 +130,32 @@ boolean updateInfoLabels(CDKSCREEN *cdk_screen,
     tgt_y_start = 3;
     sess_y_start = tgt_y_start + tgt_lbl_height;
 
-    /* If the screen size has changed, or either label row count has changed
-     * then we need to delete the labels and start fresh */
-    if ((window_y != *last_scr_y) || (window_x != *last_scr_x) ||
-            (tgt_lbl_rows != *last_tgt_rows) ||
-            (sess_lbl_rows != *last_sess_rows)) {
-        if (*tgt_info != NULL) {
+    /* The label widgets are created with enough rows for the biggest either
+     * can be on this screen (the other label always gets at least 2 rows) */
+    lbl_capacity = MAX((usable_height - 6), MAX(tgt_lbl_rows, sess_lbl_rows));
+
+    /* If the screen size has changed, everything gets redrawn once */
+    if ((window_y != *last_scr_y) || (window_x != *last_scr_x)) {
+        resetInfoLabel(&g_tgt_label_state, g_tgt_label_state.label);
+        resetInfoLabel(&g_sess_label_state, g_sess_label_state.label);
+        moved = TRUE;
+    }
+    /* Set these here for next time around */
+    *last_scr_y = window_y;
+    *last_scr_x = window_x;
+    *last_tgt_rows = tgt_lbl_rows;
+    *last_sess_rows = sess_lbl_rows;
+
+    /* Create the information/status labels (if they don't exist, or if they
+     * are too small for the screen now) */
+    while (1) {
+        if ((*tgt_info != NULL) && (tgt_lbl_rows > (*tgt_info)->rows)) {
             destroyCDKLabel(*tgt_info);
             *tgt_info = NULL;
         }
-        if (*sess_info != NULL) {
-            destroyCDKLabel(*sess_info);
-            *sess_info = NULL;
-        }
-        /* Set these here for next time around */
-        *last_scr_y = window_y;
-        *last_scr_x = window_x;
-        *last_tgt_rows = tgt_lbl_rows;
-        *last_sess_rows = sess_lbl_rows;
-    }
-
-    /* Create the information/status labels (if they don't exist) */
-    while (1) {
         if (*tgt_info == NULL) {
             *tgt_info = newCDKLabel(cdk_screen, 1, tgt_y_start,
-                    tgt_info_msg, tgt_lbl_rows, TRUE, FALSE);
+                    tgt_label_rows->lines, lbl_capacity, TRUE, FALSE);
             if (!*tgt_info) {
                 errorDialog(cdk_screen, LABEL_ERR_MSG, NULL);
                 success = FALSE;
@@ -123,10 +164,15 @@ boolean updateInfoLabels(CDKSCREEN *cdk_screen,
             setCDKLabelBoxAttribute(*tgt_info, g_color_main_box[g_curr_theme]);
             setCDKLabelBackgroundAttrib(*tgt_info,
                     g_color_main_text[g_curr_theme]);
+            resetInfoLabel(&g_tgt_label_state, *tgt_info);
+        }
+        if ((*sess_info != NULL) && (sess_lbl_rows > (*sess_info)->rows)) {
+            destroyCDKLabel(*sess_info);
+            *sess_info = NULL;
         }
         if (*sess_info == NULL) {
-            *sess_info = newCDKLabel(cdk_screen, 1, sess_y_start,
-                    sess_info_msg, sess_lbl_rows, TRUE, FALSE);
+            *sess_info = newCDKLabel(cdk_screen, 1, tgt_y_start,
+                    sess_label_rows->lines, lbl_capacity, TRUE, FALSE);
             if (!*sess_info) {
                 errorDialog(cdk_screen, LABEL_ERR_MSG, NULL);
                 success = FALSE;
@@ -135,14 +181,27 @@ boolean updateInfoLabels(CDKSCREEN *cdk_screen,
             setCDKLabelBoxAttribute(*sess_info, g_color_main_box[g_curr_theme]);
             setCDKLabelBackgroundAttrib(*sess_info,
                     g_color_main_text[g_curr_theme]);
+            resetInfoLabel(&g_sess_label_state, *sess_info);
         }
         break;
     }
 
-    /* Refresh information label messages */
+    /* Move/resize the labels in place, and redraw the rows that changed */
     if (success) {
-        setCDKLabelMessage(*tgt_info, tgt_info_msg, tgt_lbl_rows);
-        setCDKLabelMessage(*sess_info, sess_info_msg, sess_lbl_rows);
+        if (placeInfoLabel(&g_tgt_label_state, tgt_y_start, tgt_lbl_rows))
+            moved = TRUE;
+        if (placeInfoLabel(&g_sess_label_state, sess_y_start, sess_lbl_rows))
+            moved = TRUE;
+        if (moved) {
+            /* Clean up anything a label left behind */
+            touchwin(cdk_screen->window);
+            wnoutrefresh(cdk_screen->window);
+        }
+        drawInfoLabelRows(&g_tgt_label_state, tgt_label_rows->lines,
+                tgt_want_rows, moved);
+        drawInfoLabelRows(&g_sess_label_state, sess_label_rows->lines,
+                sess_want_rows, moved);
+        doupdate();
     }
 
     /* Done */
@@ -150,39 +209,113 @@ boolean updateInfoLabels(CDKSCREEN *cdk_screen,
 }
 
 
+/**
+ * @brief Forget what an information label is showing (so every row is drawn
+ * next time) and set the label widget it tracks. The shown rows are kept in
+ * a row arena; if we can't allocate it, every row is simply always drawn.
+ */
+void resetInfoLabel(info_label_t *lbl_state, CDKLABEL *label) {
+    if (!initRowArena(&lbl_state->shown, MAX_INFO_LABEL_ROWS,
+            INFO_LABEL_ROW_SIZE))
+        DEBUG_LOG("Couldn't allocate the shown label rows.");
+    resetRowArena(&lbl_state->shown);
+    lbl_state->label = label;
+}
+
+
+/**
+ * @brief Move and resize an information label widget (in place) so it shows
+ * the given number of rows at the given position. The widget must have been
+ * created with at least that many rows. Return TRUE if it moved or changed
+ * size (the label is then cleared and every row will be redrawn).
+ */
+boolean placeInfoLabel(info_label_t *lbl_state, int y_pos, int rows) {
+    CDKLABEL *label = lbl_state->label;
+    int height = rows + (2 * BorderOf(label));
+
+    if ((getbegy(label->win) == y_pos) && (getmaxy(label->win) == height))
+        return FALSE;
+
+    /* Shrink before moving, and grow after, so it always fits the screen */
+    if (height < getmaxy(label->win)) {
+        wresize(label->win, height, label->boxWidth);
+        mvwin(label->win, y_pos, getbegx(label->win));
+    } else {
+        mvwin(label->win, y_pos, getbegx(label->win));
+        wresize(label->win, height, label->boxWidth);
+    }
+    label->boxHeight = height;
+    label->ypos = y_pos;
+
+    /* Start clean */
+    werase(label->win);
+    if (ObjOf(label)->box)
+        drawObjBox(label->win, ObjOf(label));
+    resetInfoLabel(lbl_state, label);
+    return TRUE;
+}
+
+
+/**
+ * @brief Redraw the rows of an information label that differ from what it is
+ * showing; the label window is only queued for output (wnoutrefresh), so the
+ * caller needs to call doupdate(). The label widget rows are kept in sync, so
+ * the CDK screen can still redraw it (eg, after a dialog).
+ */
+void drawInfoLabelRows(info_label_t *lbl_state, char *label_msg[],
+        int msg_rows, boolean force_refresh) {
+    CDKLABEL *label = lbl_state->label;
+    int i = 0, shown_rows = 0, border = BorderOf(label);
+    char *new_row = NULL;
+    boolean dirty = force_refresh;
+
+    shown_rows = MIN((getmaxy(label->win) - (2 * border)), label->rows);
+    for (i = 0; i < shown_rows; i++) {
+        /* A blank row is a single space (so the widget row isn't empty) */
+        new_row = ((i < msg_rows) && (label_msg[i] != NULL)) ?
+                label_msg[i] : " ";
+        if ((i < lbl_state->shown.used) &&
+                (lbl_state->shown.lines[i] != NULL) &&
+                (strcmp(lbl_state->shown.lines[i], new_row) == 0))
+            continue;
+
+        /* Update the widget row and draw it */
+        freeChtype(label->info[i]);
+        label->info[i] = char2Chtype(new_row, &label->infoLen[i],
+                &label->infoPos[i]);
+        label->infoPos[i] = justifyString((label->boxWidth - (2 * border)),
+                label->infoLen[i], label->infoPos[i]);
+        mvwhline(label->win, (i + border), border, ' ',
+                (label->boxWidth - (2 * border)));
+        writeChtype(label->win, (label->infoPos[i] + border), (i + border),
+                label->info[i], HORIZONTAL, 0, label->infoLen[i]);
+        setArenaRow(&lbl_state->shown, i, "%s", new_row);
+        dirty = TRUE;
+    }
+
+    if (dirty)
+        wnoutrefresh(label->win);
+}
+
+
 /**
  * @brief This function will fill an array of char pointers for the "targets"
- * information label (main screen). The return value is the number of rows
- * that should be displayed in the label. If an error occurs, we simply
- * print the error message in the label row data and return.
+ * information label (main screen) using the cached SCST topology. The return
+ * value is the number of rows that should be displayed in the label. If an
+ * error occurs, we simply print the error message in the label row data and
+ * return.
  */
-int readTargetData(char *label_msg[]) {
-    DIR *dir_stream = NULL;
-    struct dirent *dir_entry = NULL;
-    int row_cnt = 0, i = 0, j = 0, driver_cnt = 0, temp_int = 0,
-            fc_adp_cnt = 0, ib_adp_cnt = 0, port_name_size = 0, tgt_cnt = 0;
-    char line_buffer[TARGETS_LABEL_COLS],
-            dir_name[MAX_SYSFS_PATH_SIZE] = {0},
-            attr_path[MAX_SYSFS_PATH_SIZE] = {0},
-            attr_val[MAX_SYSFS_ATTR_SIZE] = {0};
-    char tgt_drivers[MAX_SCST_DRIVERS][MISC_STRING_LEN] = {{0}, {0}},
-            driver_name[MAX_SCST_SESSNS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}},
-            tgt_name[MAX_SCST_SESSNS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}},
-            tgt_state[MAX_SCST_SESSNS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}},
-            fc_port_name[MAX_FC_ADAPTERS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}},
-            fc_speed[MAX_FC_ADAPTERS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}},
-            ib_node_guid[MAX_IB_ADAPTERS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}},
-            ib_port_speed[MAX_IB_ADAPTERS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}},
-            tgt_speed_str[MAX_SCST_SESSNS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}};
-    char *temp_pstr = NULL;
-
-    /* Clear the label message */
-    for (i = 0; i < MAX_INFO_LABEL_ROWS; i++)
-        FREE_NULL(label_msg[i]);
+int readTargetData(scst_topo_t *topo, row_arena_t *label_rows) {
+    scst_tgt_tbl_t *tgts = &topo->tgts;
+    int row_cnt = 0, i = 0;
+    char line_buffer[TARGETS_LABEL_COLS], tgt_name[MISC_STRING_LEN] = {0};
+
+    /* Empty the label rows (the line buffers are re-used) */
+    resetRowArena(label_rows);
 
     /* Set the initial label messages; the number of characters
      * controls the label width (using white space as padding for width) */
-    SAFE_ASPRINTF(&label_msg[0],
+    setArenaRow(label_rows, 0,
             "</%d/B/U>Target<!%d><!B><!U>                            "
             "</%d/B/U>Driver<!%d><!B><!U>     "
             "</%d/B/U>State<!%d><!B><!U>      "
@@ -199,174 +332,207 @@ int readTargetData(char *label_msg[]) {
     /* We start our row 1 down (skip title) */
     row_cnt = 1;
 
+    /* Nothing to show until the collector publishes its first snapshot */
+    if (!topo->collected) {
+        snprintf(line_buffer, TARGETS_LABEL_COLS, COLLECT_WAIT_MSG);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
+        return row_cnt;
+    }
+
+    /* Let the user know if the data isn't being updated */
+    if (topoSnapshotAge(topo) >= COLLECT_STALL_SECS) {
+        snprintf(line_buffer, TARGETS_LABEL_COLS, COLLECT_STALL_MSG,
+                topoSnapshotAge(topo));
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
+    }
+
     /* Print a nice message if SCST isn't loaded and return */
-    if (!isSCSTLoaded()) {
+    if (!topo->scst_loaded) {
         snprintf(line_buffer, TARGETS_LABEL_COLS, NO_SCST_MSG);
-        SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
         row_cnt++;
         return row_cnt;
     }
 
-    /* Fill the array with current SCST target drivers */
-    if (!listSCSTTgtDrivers(tgt_drivers, &driver_cnt)) {
-        snprintf(line_buffer, TARGETS_LABEL_COLS, TGT_DRIVERS_ERR);
-        SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
+    /* Print the error (if any) from updating the topology and return */
+    if (topo->error_msg[0] != '\0') {
+        snprintf(line_buffer, TARGETS_LABEL_COLS, "%s", topo->error_msg);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
         row_cnt++;
         return row_cnt;
     }
 
-    for (i = 0; i < driver_cnt; i++) {
-        /* Open the directory for targets */
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                "%s/targets/%s", SYSFS_SCST_TGT, tgt_drivers[i]);
-        if ((dir_stream = opendir(dir_name)) == NULL) {
-            if (row_cnt < MAX_INFO_LABEL_ROWS) {
-                snprintf(line_buffer, SESSIONS_LABEL_COLS, "opendir(): %s",
-                        strerror(errno));
-                SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
-                row_cnt++;
-            }
-            return row_cnt;
-        }
-        while ((dir_entry = readdir(dir_stream)) != NULL) {
-            /* The target names are directories */
-            if ((dir_entry->d_type == DT_DIR) &&
-                    (strcmp(dir_entry->d_name, ".") != 0) &&
-                    (strcmp(dir_entry->d_name, "..") != 0)) {
-                /* Store the driver name for this target */
-                snprintf(driver_name[j], MAX_SYSFS_ATTR_SIZE, tgt_drivers[i]);
-                /* Store the target name */
-                snprintf(tgt_name[j], MAX_SYSFS_ATTR_SIZE, dir_entry->d_name);
-                /* Get the target enabled/disabled attribute */
-                snprintf(attr_path, MAX_SYSFS_PATH_SIZE,
-                        "%s/targets/%s/%s/enabled", SYSFS_SCST_TGT,
-                        tgt_drivers[i], dir_entry->d_name);
-                readAttribute(attr_path, attr_val);
-                temp_int = atoi(attr_val);
-                if (temp_int == 1)
-                    snprintf(tgt_state[j], MAX_SYSFS_ATTR_SIZE, "Enabled");
-                else
-                    snprintf(tgt_state[j], MAX_SYSFS_ATTR_SIZE, "Disabled");
-                j++;
-            }
-        }
-        /* Close the target directory stream */
-        closedir(dir_stream);
+    /* Fill the label lines */
+    for (i = 0; (i < tgts->cnt) && (row_cnt < MAX_INFO_LABEL_ROWS); i++) {
+        /* Put it all together */
+        snprintf(line_buffer, TARGETS_LABEL_COLS,
+                "%-33.33s %-10.10s %-10.10s %-20.20s",
+                prettyShrinkStrBuf(33, poolStr(&topo->strings, tgts->name[i]),
+                tgt_name, MISC_STRING_LEN),
+                poolStr(&topo->strings, tgts->driver[i]),
+                (tgts->enabled[i] ? "Enabled" : "Disabled"),
+                ((tgts->adapter[i] != -1) ?
+                topo->adapters[tgts->adapter[i]].speed : "N/A"));
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
     }
 
-    /* Fibre Channel / FCoE adapter information */
-    if ((dir_stream = opendir(SYSFS_FC_HOST)) == NULL) {
-        if (row_cnt < MAX_INFO_LABEL_ROWS) {
-            snprintf(line_buffer, TARGETS_LABEL_COLS, "opendir(): %s",
-                    strerror(errno));
-            SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
-        }
+    /* Done */
+    if (row_cnt == 1) {
+        /* Add a blank line if there are no rows of data */
+        setArenaRow(label_rows, row_cnt, " ");
+        row_cnt++;
+    }
+    return row_cnt;
+}
+
+
+/**
+ * @brief This function will fill an array of char pointers for the "sessions"
+ * information label (main screen) using the cached SCST topology. The return
+ * value is the number of rows that should be displayed in the label. If an
+ * error occurs, we simply print the error message in the label row data and
+ * return.
+ */
+int readSessionData(scst_topo_t *topo, row_arena_t *label_rows) {
+    scst_sess_tbl_t *sess = &topo->sess;
+    sess_sort_ctx_t sort_ctx = {0};
+    int i = 0, row_cnt = 0, row = 0, show_cnt = 0;
+    int *new_order = NULL;
+    char line_buffer[SESSIONS_LABEL_COLS], iops_str[MISC_STRING_LEN] = {0},
+            read_rate[MISC_STRING_LEN] = {0}, write_rate[MISC_STRING_LEN] = {0},
+            peak_rate[MISC_STRING_LEN] = {0}, init_name[MISC_STRING_LEN] = {0};
+
+    /* Empty the label rows (the line buffers are re-used) */
+    resetRowArena(label_rows);
+
+    /* Set the initial label messages; the number of characters
+     * controls the label width (using white space as padding for width) */
+    setArenaRow(label_rows, 0,
+            "</%d/B/U>Session<!%d><!B><!U>                "
+            "</%d/B/U>LUNs<!%d><!B><!U>  "
+            "</%d/B/U>Cmds<!%d><!B><!U>     "
+            "</%d/B/U>Read/s<!%d><!B><!U>    "
+            "</%d/B/U>Write/s<!%d><!B><!U>     "
+            "</%d/B/U>IOPS<!%d><!B><!U>     "
+            "</%d/B/U>Peak/s<!%d><!B><!U>",
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme]);
+
+    /* We start our row 1 down (skip title) */
+    row_cnt = 1;
+
+    /* Nothing to show until the collector publishes its first snapshot */
+    if (!topo->collected) {
+        snprintf(line_buffer, SESSIONS_LABEL_COLS, COLLECT_WAIT_MSG);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
         return row_cnt;
     }
-    while ((dir_entry = readdir(dir_stream)) != NULL) {
-        /* The hostX directory names are links */
-        if (dir_entry->d_type == DT_LNK) {
-            /* Get the port name */
-            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/port_name",
-                    SYSFS_FC_HOST, dir_entry->d_name);
-            readAttribute(attr_path, attr_val);
-            /* Make the port name match a SCST target name */
-            temp_pstr = strchr(attr_val, 'x');
-            if (temp_pstr != NULL) {
-                temp_pstr++;
-                while ((temp_int = strlen(temp_pstr)) != 0) {
-                    if (!((temp_int - 2) < 0)) {
-                        if (port_name_size >= MAX_SYSFS_ATTR_SIZE) {
-                            break;
-                        } else {
-                            strncat(fc_port_name[fc_adp_cnt], temp_pstr, 2);
-                            port_name_size = port_name_size + 2;
-                            if ((temp_int - 2) != 0) {
-                                strncat(fc_port_name[fc_adp_cnt], ":", 1);
-                                port_name_size++;
-                            }
-                            temp_pstr = temp_pstr + 2;
-                        }
-                    } else {
-                        break;
-                    }
-                }
-            }
-            /* Get speed string */
-            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/speed",
-                    SYSFS_FC_HOST, dir_entry->d_name);
-            readAttribute(attr_path, attr_val);
-            snprintf(fc_speed[fc_adp_cnt], MAX_SYSFS_ATTR_SIZE, "%s", attr_val);
-        }
-        fc_adp_cnt++;
+
+    /* Print a nice message if SCST isn't loaded and return */
+    if (!topo->scst_loaded) {
+        snprintf(line_buffer, SESSIONS_LABEL_COLS, NO_SCST_MSG);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
+        return row_cnt;
     }
-    closedir(dir_stream);
 
-    /* InfiniBand HCA information */
-    if ((dir_stream = opendir(SYSFS_INFINIBAND)) == NULL) {
-        if (row_cnt < MAX_INFO_LABEL_ROWS) {
-            snprintf(line_buffer, TARGETS_LABEL_COLS, "opendir(): %s",
-                    strerror(errno));
-            SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
-        }
+    /* Print the error (if any) from updating the topology and return */
+    if (topo->error_msg[0] != '\0') {
+        snprintf(line_buffer, SESSIONS_LABEL_COLS, "%s", topo->error_msg);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
         return row_cnt;
     }
-    while ((dir_entry = readdir(dir_stream)) != NULL) {
-        /* The IB directory names are links */
-        if (dir_entry->d_type == DT_LNK) {
-            /* Get the HCA node GUID (this matches what SCST has) */
-            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/node_guid",
-                    SYSFS_INFINIBAND, dir_entry->d_name);
-            readAttribute(attr_path, attr_val);
-            snprintf(ib_node_guid[ib_adp_cnt], MAX_SYSFS_ATTR_SIZE, attr_val);
-
-            /* Get the port rate/speed */
-            // TODO: It may be incorrect to assume there is only 1 port!
-            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/ports/1/rate",
-                    SYSFS_INFINIBAND, dir_entry->d_name);
-            readAttribute(attr_path, attr_val);
-            snprintf(ib_port_speed[ib_adp_cnt], MAX_SYSFS_ATTR_SIZE, attr_val);
+
+    /* The order array only grows (with the session table) */
+    if (sess->cnt > g_sess_order_size) {
+        if ((new_order = realloc(g_sess_order,
+                (sizeof (int) * sess->alloc))) == NULL) {
+            snprintf(line_buffer, SESSIONS_LABEL_COLS, "realloc(): %s",
+                    strerror(errno));
+            setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+            row_cnt++;
+            return row_cnt;
         }
-        ib_adp_cnt++;
+        g_sess_order = new_order;
+        g_sess_order_size = sess->alloc;
     }
-    closedir(dir_stream);
 
-    /* Fill the label lines */
-    tgt_cnt = j;
-    for (i = 0; i < tgt_cnt; i++) {
-        for (j = 0; j < fc_adp_cnt; j++) {
-            if (strcmp(tgt_name[i], fc_port_name[j]) == 0) {
-                /* Add speed/rate if its a matching FC adapter */
-                snprintf(tgt_speed_str[i], MAX_SYSFS_ATTR_SIZE,
-                        "%s", fc_speed[j]);
-                break;
-            }
-        }
-        for (j = 0; j < ib_adp_cnt; j++) {
-            if (strcmp(tgt_name[i], ib_node_guid[j]) == 0) {
-                /* Add speed/rate if its a matching IB adapter */
-                snprintf(tgt_speed_str[i], MAX_SYSFS_ATTR_SIZE,
-                        "%s", ib_port_speed[j]);
-                break;
-            }
-        }
-        if (tgt_speed_str[i][0] == '\0')
-            snprintf(tgt_speed_str[i], MAX_SYSFS_ATTR_SIZE, "N/A");
-        /* Put it all together */
-        if (row_cnt < MAX_INFO_LABEL_ROWS) {
-            snprintf(line_buffer, TARGETS_LABEL_COLS,
-                    "%-33.33s %-10.10s %-10.10s %-20.20s",
-                    prettyShrinkStr(33, tgt_name[i]), driver_name[i],
-                    tgt_state[i], tgt_speed_str[i]);
-            SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
-            row_cnt++;
+    /* Sort the session indexes using the chosen key (the cached topology is
+     * left alone, and no strings are copied) */
+    for (i = 0; i < sess->cnt; i++)
+        g_sess_order[i] = i;
+    sort_ctx.topo = topo;
+    sort_ctx.key = g_sess_sort_key;
+    qsort_r(g_sess_order, sess->cnt, sizeof (int), compareSessions,
+            &sort_ctx);
+
+    /* Top-N limit (if any), and leave a row for the sort/limit line */
+    show_cnt = sess->cnt;
+    if ((g_sess_top_n_opts[g_sess_top_n] != 0) &&
+            (show_cnt > g_sess_top_n_opts[g_sess_top_n]))
+        show_cnt = g_sess_top_n_opts[g_sess_top_n];
+    if (show_cnt > (MAX_INFO_LABEL_ROWS - 2))
+        show_cnt = MAX_INFO_LABEL_ROWS - 2;
+
+    /* Finally, fill the label array with our sorted data */
+    for (i = 0; i < show_cnt; i++) {
+        row = g_sess_order[i];
+        if (sess->have_rate[row]) {
+            prettyFormatBytesBuf((uint64_t) (sess->read_kbps[row] * 1024),
+                    read_rate, MISC_STRING_LEN);
+            prettyFormatBytesBuf((uint64_t) (sess->write_kbps[row] * 1024),
+                    write_rate, MISC_STRING_LEN);
+            prettyFormatBytesBuf((uint64_t) (sess->peak_kbps[row] * 1024),
+                    peak_rate, MISC_STRING_LEN);
+        } else {
+            snprintf(read_rate, MISC_STRING_LEN, "-");
+            snprintf(write_rate, MISC_STRING_LEN, "-");
+            snprintf(peak_rate, MISC_STRING_LEN, "-");
         }
+        if (sess->has_cmd_cnts[row] && sess->have_rate[row])
+            snprintf(iops_str, MISC_STRING_LEN, "%.0f", sess->iops[row]);
+        else
+            snprintf(iops_str, MISC_STRING_LEN, "-");
+        snprintf(line_buffer, SESSIONS_LABEL_COLS,
+                "%-22.22s %4d %5d %10.10s %10.10s %8.8s %10.10s",
+                prettyShrinkStrBuf(22, poolStr(&topo->strings,
+                sess->initiator[row]), init_name, MISC_STRING_LEN),
+                sess->lun_cnt[row],
+                sess->active_cmds[row], read_rate, write_rate, iops_str,
+                peak_rate);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
+    }
+
+    /* How it's sorted, and how many we're showing */
+    if (sess->cnt > 0) {
+        snprintf(line_buffer, SESSIONS_LABEL_COLS, SESS_SORT_MSG,
+                g_sess_sort_keys[g_sess_sort_key], show_cnt, sess->cnt);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
     }
 
     /* Done */
     if (row_cnt == 1) {
         /* Add a blank line if there are no rows of data */
-        SAFE_ASPRINTF(&label_msg[row_cnt], " ");
+        setArenaRow(label_rows, row_cnt, " ");
         row_cnt++;
     }
     return row_cnt;
@@ -374,41 +540,83 @@ int readTargetData(char *label_msg[]) {
 
 
 /**
- * @brief This function will fill an array of char pointers for the "sessions"
- * information label (main screen). The return value is the number of rows
- * that should be displayed in the label. If an error occurs, we simply
- * print the error message in the label row data and return.
+ * @brief Compare two sessions (by index) for qsort_r(); the rates and counts
+ * sort highest first, the initiator name alphabetically. Ties are broken with
+ * the initiator name, and then the index so the order is stable.
  */
-int readSessionData(char *label_msg[]) {
-    DIR *tgt_dir_stream = NULL, *sess_dir_stream = NULL;
-    struct dirent *tgt_dir_entry = NULL, *sess_dir_entry = NULL;
-    int i = 0, j = 0, row_cnt = 0, driver_cnt = 0, num_sessions = 0,
-            max_index = 0, tmp_act_cmds = 0, tmp_lun_cnt = 0;
-    int active_cmds[MAX_SCST_SESSNS] = {0}, lun_count[MAX_SCST_SESSNS] = {0};
-    unsigned long long read_io_kb[MAX_SCST_SESSNS] = {0},
-            write_io_kb[MAX_SCST_SESSNS] = {0};
-    unsigned long long tmp_read_io = 0, tmp_write_io = 0;
-    char line_buffer[SESSIONS_LABEL_COLS],
-            tgt_dir_name[MAX_SYSFS_PATH_SIZE] = {0},
-            sess_dir_name[MAX_SYSFS_PATH_SIZE] = {0},
-            attr_path[MAX_SYSFS_PATH_SIZE] = {0},
-            attr_val[MAX_SYSFS_ATTR_SIZE] = {0},
-            tmp_init_name[MAX_SYSFS_ATTR_SIZE] = {0};
-    char tgt_drivers[MAX_SCST_DRIVERS][MISC_STRING_LEN] = {{0}, {0}},
-            init_names[MAX_SCST_SESSNS][MAX_SYSFS_ATTR_SIZE] = {{0}, {0}};
-
-    /* Clear the label message */
-    for (i = 0; i < MAX_INFO_LABEL_ROWS; i++)
-        FREE_NULL(label_msg[i]);
+int compareSessions(const void *a, const void *b, void *arg) {
+    sess_sort_ctx_t *sort_ctx = (sess_sort_ctx_t *) arg;
+    scst_sess_tbl_t *sess = &sort_ctx->topo->sess;
+    int sess_a = *(const int *) a, sess_b = *(const int *) b, result = 0;
+    double diff = 0;
+
+    switch (sort_ctx->key) {
+        case SORT_READ_RATE:
+            diff = sess->read_kbps[sess_b] - sess->read_kbps[sess_a];
+            break;
+        case SORT_WRITE_RATE:
+            diff = sess->write_kbps[sess_b] - sess->write_kbps[sess_a];
+            break;
+        case SORT_ACTIVE_CMDS:
+            diff = sess->active_cmds[sess_b] - sess->active_cmds[sess_a];
+            break;
+        case SORT_LUN_CNT:
+            diff = sess->lun_cnt[sess_b] - sess->lun_cnt[sess_a];
+            break;
+        default:
+            break;
+    }
+    if (diff != 0)
+        return (diff > 0) ? 1 : -1;
+    if (sess->initiator[sess_a] != sess->initiator[sess_b])
+        result = strcmp(poolStr(&sort_ctx->topo->strings,
+                sess->initiator[sess_a]), poolStr(&sort_ctx->topo->strings,
+                sess->initiator[sess_b]));
+    if (result != 0)
+        return result;
+    return sess_a - sess_b;
+}
+
+
+/**
+ * @brief This function will fill an array of char pointers for the "devices"
+ * view of the sessions information label (main screen): each SCST device with
+ * its backing block device and that device's I/O rates, busiest first. The
+ * return value is the number of rows that should be displayed in the label.
+ * If an error occurs, we simply print the error message in the label row data
+ * and return.
+ */
+int readDeviceData(scst_topo_t *topo, row_arena_t *label_rows) {
+    scst_dev_tbl_t *devs = &topo->devs;
+    int i = 0, row_cnt = 0, row = 0, show_cnt = 0;
+    int *new_order = NULL;
+    char line_buffer[SESSIONS_LABEL_COLS], r_iops[MISC_STRING_LEN] = {0},
+            w_iops[MISC_STRING_LEN] = {0}, r_mbps[MISC_STRING_LEN] = {0},
+            w_mbps[MISC_STRING_LEN] = {0}, svc_time[MISC_STRING_LEN] = {0},
+            backing_str[MISC_STRING_LEN] = {0},
+            dev_name[MISC_STRING_LEN] = {0};
+    char *backing = NULL;
+
+    /* Empty the label rows (the line buffers are re-used) */
+    resetRowArena(label_rows);
 
     /* Set the initial label messages; the number of characters
      * controls the label width (using white space as padding for width) */
-    SAFE_ASPRINTF(&label_msg[0],
-            "</%d/B/U>Session<!%d><!B><!U>                  "
-            "  </%d/B/U>LUNs<!%d><!B><!U>"
-            "  </%d/B/U>Cmds<!%d><!B><!U>"
-            "       </%d/B/U>Read IO (KB)<!%d><!B><!U>"
-            "      </%d/B/U>Write IO (KB)<!%d><!B><!U> ",
+    setArenaRow(label_rows, 0,
+            "</%d/B/U>Device<!%d><!B><!U>           "
+            "</%d/B/U>Backing<!%d><!B><!U>       "
+            "</%d/B/U>R IOPS<!%d><!B><!U>  "
+            "</%d/B/U>W IOPS<!%d><!B><!U>  "
+            "</%d/B/U>R MB/s<!%d><!B><!U>  "
+            "</%d/B/U>W MB/s<!%d><!B><!U> "
+            "</%d/B/U>Svc ms<!%d><!B><!U> "
+            "</%d/B/U>InFlt<!%d><!B><!U>",
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
+            g_color_info_header[g_curr_theme],
             g_color_info_header[g_curr_theme],
             g_color_info_header[g_curr_theme],
             g_color_info_header[g_curr_theme],
@@ -423,178 +631,147 @@ int readSessionData(char *label_msg[]) {
     /* We start our row 1 down (skip title) */
     row_cnt = 1;
 
+    /* Nothing to show until the collector publishes its first snapshot */
+    if (!topo->collected) {
+        snprintf(line_buffer, SESSIONS_LABEL_COLS, COLLECT_WAIT_MSG);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
+        return row_cnt;
+    }
+
     /* Print a nice message if SCST isn't loaded and return */
-    if (!isSCSTLoaded()) {
+    if (!topo->scst_loaded) {
         snprintf(line_buffer, SESSIONS_LABEL_COLS, NO_SCST_MSG);
-        SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
         row_cnt++;
         return row_cnt;
     }
 
-    /* Fill the array with current SCST target drivers */
-    if (!listSCSTTgtDrivers(tgt_drivers, &driver_cnt)) {
-        snprintf(line_buffer, SESSIONS_LABEL_COLS, TGT_DRIVERS_ERR);
-        SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
+    /* Print the error (if any) from updating the topology and return */
+    if (topo->error_msg[0] != '\0') {
+        snprintf(line_buffer, SESSIONS_LABEL_COLS, "%s", topo->error_msg);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
         row_cnt++;
         return row_cnt;
     }
 
-    for (i = 0; i < driver_cnt; i++) {
-        /* Open the directory for targets */
-        snprintf(tgt_dir_name, MAX_SYSFS_PATH_SIZE,
-                "%s/targets/%s", SYSFS_SCST_TGT, tgt_drivers[i]);
-        if ((tgt_dir_stream = opendir(tgt_dir_name)) == NULL) {
-            if (row_cnt < MAX_INFO_LABEL_ROWS) {
-                snprintf(line_buffer, SESSIONS_LABEL_COLS, "opendir(): %s",
-                        strerror(errno));
-                SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
-                row_cnt++;
-            }
+    /* The order array only grows (with the device table) */
+    if (devs->cnt > g_dev_order_size) {
+        if ((new_order = realloc(g_dev_order,
+                (sizeof (int) * devs->alloc))) == NULL) {
+            snprintf(line_buffer, SESSIONS_LABEL_COLS, "realloc(): %s",
+                    strerror(errno));
+            setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+            row_cnt++;
             return row_cnt;
         }
-        while ((tgt_dir_entry = readdir(tgt_dir_stream)) != NULL) {
-            /* The target names are directories */
-            if ((tgt_dir_entry->d_type == DT_DIR) &&
-                    (strcmp(tgt_dir_entry->d_name, ".") != 0) &&
-                    (strcmp(tgt_dir_entry->d_name, "..") != 0)) {
-                /* Open the directory for sessions */
-                snprintf(sess_dir_name, MAX_SYSFS_PATH_SIZE,
-                        "%s/targets/%s/%s/sessions",
-                        SYSFS_SCST_TGT, tgt_drivers[i],
-                        tgt_dir_entry->d_name);
-                if ((sess_dir_stream = opendir(sess_dir_name)) == NULL) {
-                    closedir(tgt_dir_stream);
-                    if (row_cnt < MAX_INFO_LABEL_ROWS) {
-                        snprintf(line_buffer, SESSIONS_LABEL_COLS,
-                                "opendir(): %s", strerror(errno));
-                        SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
-                        row_cnt++;
-                    }
-                    return row_cnt;
-                }
-                while ((sess_dir_entry = readdir(sess_dir_stream)) != NULL) {
-                    /* The session names are directories */
-                    if ((sess_dir_entry->d_type == DT_DIR) &&
-                            (strcmp(sess_dir_entry->d_name, ".") != 0) &&
-                            (strcmp(sess_dir_entry->d_name, "..") != 0)) {
-                        /* Get the initiator name attribute */
-                        snprintf(attr_path, MAX_SYSFS_PATH_SIZE,
-                                "%s/targets/%s/%s/sessions/%s/initiator_name",
-                                SYSFS_SCST_TGT, tgt_drivers[i],
-                                tgt_dir_entry->d_name,
-                                sess_dir_entry->d_name);
-                        readAttribute(attr_path, attr_val);
-                        snprintf(init_names[j], MAX_SYSFS_ATTR_SIZE,
-                                "%s", attr_val);
-                        /* Get the number of LUNs for this session */
-                        lun_count[j] = countSCSTSessLUNs(tgt_dir_entry->d_name,
-                                tgt_drivers[i], sess_dir_entry->d_name);
-                        /* Get the active commands attribute */
-                        snprintf(attr_path, MAX_SYSFS_PATH_SIZE,
-                                "%s/targets/%s/%s/sessions/%s/active_commands",
-                                SYSFS_SCST_TGT, tgt_drivers[i],
-                                tgt_dir_entry->d_name,
-                                sess_dir_entry->d_name);
-                        readAttribute(attr_path, attr_val);
-                        active_cmds[j] = atoi(attr_val);
-                        /* Get the read IO (in KB) attribute */
-                        snprintf(attr_path, MAX_SYSFS_PATH_SIZE,
-                                "%s/targets/%s/%s/sessions/%s/read_io_count_kb",
-                                SYSFS_SCST_TGT, tgt_drivers[i],
-                                tgt_dir_entry->d_name,
-                                sess_dir_entry->d_name);
-                        readAttribute(attr_path, attr_val);
-                        errno = 0;
-                        read_io_kb[j] = strtoull(attr_val, NULL, 10);
-                        if (errno != 0) {
-                            closedir(sess_dir_stream);
-                            closedir(tgt_dir_stream);
-                            if (row_cnt < MAX_INFO_LABEL_ROWS) {
-                                snprintf(line_buffer, SESSIONS_LABEL_COLS,
-                                        "strtoull(): %s", strerror(errno));
-                                SAFE_ASPRINTF(&label_msg[row_cnt], "%s",
-                                        line_buffer);
-                                row_cnt++;
-                            }
-                            return row_cnt;
-                        }
-                        /* Get the write IO (in KB) attribute */
-                        snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/targets/"
-                                "%s/%s/sessions/%s/write_io_count_kb",
-                                SYSFS_SCST_TGT, tgt_drivers[i],
-                                tgt_dir_entry->d_name,
-                                sess_dir_entry->d_name);
-                        readAttribute(attr_path, attr_val);
-                        errno = 0;
-                        write_io_kb[j] = strtoull(attr_val, NULL, 10);
-                        if (errno != 0) {
-                            closedir(sess_dir_stream);
-                            closedir(tgt_dir_stream);
-                            if (row_cnt < MAX_INFO_LABEL_ROWS) {
-                                snprintf(line_buffer, SESSIONS_LABEL_COLS,
-                                        "strtoull(): %s", strerror(errno));
-                                SAFE_ASPRINTF(&label_msg[row_cnt], "%s",
-                                        line_buffer);
-                                row_cnt++;
-                            }
-                            return row_cnt;
-                        }
-                        j++;
-                    }
-                }
-                /* Close the session directory stream */
-                closedir(sess_dir_stream);
-            }
-        }
-        /* Close the target directory stream */
-        closedir(tgt_dir_stream);
+        g_dev_order = new_order;
+        g_dev_order_size = devs->alloc;
     }
 
-    /* Sort the data so the busiest session (most read IO in KB) is higher */
-    num_sessions = j;
-    for (i = 0; i < num_sessions; i++) {
-        max_index = i;
-        for (j = i; j < num_sessions; j++) {
-            if (read_io_kb[max_index] < read_io_kb[j])
-                max_index = j;
+    /* Busiest devices first */
+    for (i = 0; i < devs->cnt; i++)
+        g_dev_order[i] = i;
+    qsort_r(g_dev_order, devs->cnt, sizeof (int), compareDevices, topo);
+
+    /* Same top-N limit as the sessions, and a row for the footer */
+    show_cnt = devs->cnt;
+    if ((g_sess_top_n_opts[g_sess_top_n] != 0) &&
+            (show_cnt > g_sess_top_n_opts[g_sess_top_n]))
+        show_cnt = g_sess_top_n_opts[g_sess_top_n];
+    if (show_cnt > (MAX_INFO_LABEL_ROWS - 2))
+        show_cnt = MAX_INFO_LABEL_ROWS - 2;
+
+    for (i = 0; i < show_cnt; i++) {
+        row = g_dev_order[i];
+        backing = poolStr(&topo->dev_strings, devs->backing[row]);
+        if (devs->have_rate[row]) {
+            snprintf(r_iops, MISC_STRING_LEN, "%.0f", devs->read_iops[row]);
+            snprintf(w_iops, MISC_STRING_LEN, "%.0f", devs->write_iops[row]);
+            snprintf(r_mbps, MISC_STRING_LEN, "%.1f", devs->read_mbps[row]);
+            snprintf(w_mbps, MISC_STRING_LEN, "%.1f", devs->write_mbps[row]);
+            snprintf(svc_time, MISC_STRING_LEN, "%.1f", devs->svc_msec[row]);
+        } else {
+            snprintf(r_iops, MISC_STRING_LEN, "-");
+            snprintf(w_iops, MISC_STRING_LEN, "-");
+            snprintf(r_mbps, MISC_STRING_LEN, "-");
+            snprintf(w_mbps, MISC_STRING_LEN, "-");
+            snprintf(svc_time, MISC_STRING_LEN, "-");
         }
-        /* Set temporary variable */
-        strncpy(tmp_init_name, init_names[i], MAX_SYSFS_ATTR_SIZE);
-        tmp_lun_cnt = lun_count[i];
-        tmp_act_cmds = active_cmds[i];
-        tmp_read_io = read_io_kb[i];
-        tmp_write_io = write_io_kb[i];
-        /* Set current position variable with new maximum */
-        strncpy(init_names[i], init_names[max_index], MAX_SYSFS_ATTR_SIZE);
-        lun_count[i] = lun_count[max_index];
-        active_cmds[i] = active_cmds[max_index];
-        read_io_kb[i] = read_io_kb[max_index];
-        write_io_kb[i] = write_io_kb[max_index];
-        /* Move variable to old location */
-        strncpy(init_names[max_index], tmp_init_name, MAX_SYSFS_ATTR_SIZE);
-        lun_count[max_index] = tmp_lun_cnt;
-        active_cmds[max_index] = tmp_act_cmds;
-        read_io_kb[max_index] = tmp_read_io;
-        write_io_kb[max_index] = tmp_write_io;
+        if (backing[0] != '\0')
+            prettyShrinkStrBuf(12, backing, backing_str, MISC_STRING_LEN);
+        else
+            snprintf(backing_str, MISC_STRING_LEN, "N/A");
+        snprintf(line_buffer, SESSIONS_LABEL_COLS,
+                "%-16.16s %-12.12s %7.7s %7.7s %7.7s %7.7s %6.6s %5llu",
+                prettyShrinkStrBuf(16, poolStr(&topo->dev_strings,
+                devs->name[row]), dev_name, MISC_STRING_LEN), backing_str,
+                r_iops, w_iops, r_mbps, w_mbps, svc_time,
+                devs->in_flight[row]);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
     }
 
-    /* Finally, fill the label array with our sorted data */
-    for (i = 0; i < num_sessions; i++) {
-        if (row_cnt < MAX_INFO_LABEL_ROWS) {
-            snprintf(line_buffer, SESSIONS_LABEL_COLS,
-                    "%-25.25s %5d %5d %18llu %18llu",
-                    prettyShrinkStr(25, init_names[i]), lun_count[i],
-                    active_cmds[i], read_io_kb[i], write_io_kb[i]);
-            SAFE_ASPRINTF(&label_msg[row_cnt], "%s", line_buffer);
-            row_cnt++;
-        }
+    /* How many we're showing */
+    if (devs->cnt > 0) {
+        snprintf(line_buffer, SESSIONS_LABEL_COLS, DEV_PANEL_MSG,
+                show_cnt, devs->cnt);
+        setArenaRow(label_rows, row_cnt, "%s", line_buffer);
+        row_cnt++;
     }
 
     /* Done */
     if (row_cnt == 1) {
         /* Add a blank line if there are no rows of data */
-        SAFE_ASPRINTF(&label_msg[row_cnt], " ");
+        setArenaRow(label_rows, row_cnt, " ");
         row_cnt++;
     }
     return row_cnt;
 }
+
+
+/**
+ * @brief Compare two SCST devices (by index) for qsort_r(); the busiest
+ * (MB/s, then IOPS) sort first, ties are broken with the device name.
+ */
+int compareDevices(const void *a, const void *b, void *arg) {
+    scst_topo_t *topo = (scst_topo_t *) arg;
+    scst_dev_tbl_t *devs = &topo->devs;
+    int dev_a = *(const int *) a, dev_b = *(const int *) b;
+    double diff = 0;
+
+    diff = (devs->read_mbps[dev_b] + devs->write_mbps[dev_b]) -
+            (devs->read_mbps[dev_a] + devs->write_mbps[dev_a]);
+    if (diff == 0)
+        diff = (devs->read_iops[dev_b] + devs->write_iops[dev_b]) -
+                (devs->read_iops[dev_a] + devs->write_iops[dev_a]);
+    if (diff != 0)
+        return (diff > 0) ? 1 : -1;
+    return strcmp(poolStr(&topo->dev_strings, devs->name[dev_a]),
+            poolStr(&topo->dev_strings, devs->name[dev_b]));
+}
+
+
+/**
+ * @brief Switch the sessions label between the sessions and SCST devices.
+ */
+void toggleDevicePanel() {
+    g_show_devices = !g_show_devices;
+}
+
+
+/**
+ * @brief Use the next sort key for the sessions label (main screen).
+ */
+void nextSessSortKey() {
+    g_sess_sort_key = (g_sess_sort_key + 1) % MAX_SESS_SORT_KEYS;
+}
+
+
+/**
+ * @brief Use the next top-N limit for the sessions label (main screen).
+ */
+void nextSessTopN() {
+    g_sess_top_n = (g_sess_top_n + 1) %
+            (int) ((sizeof g_sess_top_n_opts) / (sizeof g_sess_top_n_opts[0]));
+}
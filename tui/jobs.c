@@ -0,0 +1,510 @@
+/**
+ * @file jobs.c
+ * @brief The background job engine; long running work (writing out vdisk
+ * files, making file systems, creating arrays, etc.) is queued as a job and
+ * each one runs in its own thread, a few at a time, so the dialogs return
+ * right away. The UI thread shows the progress (Jobs panel) and picks up
+ * the results from the main loop.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <iniparser.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "dialogs.h"
+#include "strings.h"
+#include "jobs.h"
+
+
+/* The job table (and everything in it) is protected by the lock; a job's
+ * thread only uses its own entry, which isn't re-used until it's finished
+ * and the UI thread has reported it */
+pthread_mutex_t g_jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_jobs_cond = PTHREAD_COND_INITIALIZER;
+job_t g_jobs[MAX_JOBS];
+int g_job_limit = JOB_DEF_LIMIT;
+int g_jobs_running = 0;
+int g_next_job_id = 1;
+
+
+/**
+ * @brief Read the concurrency limit (how many jobs run at once) from the
+ * ESOS configuration file; the default is used if it's not set.
+ */
+void startJobs() {
+    dictionary *ini_dict = NULL;
+    int limit = JOB_DEF_LIMIT;
+
+    if ((ini_dict = iniparser_load(ESOS_CONF)) != NULL) {
+        limit = iniparser_getint(ini_dict, "tui:max_jobs", JOB_DEF_LIMIT);
+        iniparser_freedict(ini_dict);
+    }
+    if (limit < 1)
+        limit = 1;
+    if (limit > MAX_JOB_LIMIT)
+        limit = MAX_JOB_LIMIT;
+
+    pthread_mutex_lock(&g_jobs_mutex);
+    g_job_limit = limit;
+    pthread_mutex_unlock(&g_jobs_mutex);
+}
+
+
+/**
+ * @brief Return how many jobs run at the same time.
+ */
+int getJobLimit() {
+    int limit = 0;
+
+    pthread_mutex_lock(&g_jobs_mutex);
+    limit = g_job_limit;
+    pthread_mutex_unlock(&g_jobs_mutex);
+    return limit;
+}
+
+
+/**
+ * @brief A job's thread; run the work, record how it went, then start the
+ * next queued job (if any) in its place.
+ */
+void *jobThread(void *arg) {
+    job_t *job = (job_t *) arg;
+    boolean success = FALSE;
+
+    blockThreadSignals(NULL);
+
+    success = job->run(job, job->arg);
+    if (!success && (job->error_msg[0] == '\0'))
+        snprintf(job->error_msg, MISC_STRING_LEN, "The job failed.");
+
+    pthread_mutex_lock(&g_jobs_mutex);
+    clock_gettime(CLOCK_MONOTONIC, &job->finished);
+    job->state = (success ? JOB_DONE : JOB_FAILED);
+    job->child_pid = 0;
+    FREE_NULL(job->arg);
+    g_jobs_running--;
+    startQueuedJobs();
+    pthread_cond_broadcast(&g_jobs_cond);
+    pthread_mutex_unlock(&g_jobs_mutex);
+    return NULL;
+}
+
+
+/**
+ * @brief Start queued jobs (in the order they were submitted) until the
+ * concurrency limit is reached; the lock must be held.
+ */
+void startQueuedJobs() {
+    pthread_t job_thread;
+    job_t *next_job = NULL;
+    int i = 0, ret_val = 0;
+
+    while (g_jobs_running < g_job_limit) {
+        next_job = NULL;
+        for (i = 0; i < MAX_JOBS; i++) {
+            if ((g_jobs[i].state == JOB_QUEUED) && ((next_job == NULL) ||
+                    (g_jobs[i].id < next_job->id)))
+                next_job = &g_jobs[i];
+        }
+        if (next_job == NULL)
+            break;
+
+        clock_gettime(CLOCK_MONOTONIC, &next_job->started);
+        next_job->state = JOB_RUNNING;
+        if ((ret_val = pthread_create(&job_thread, NULL, jobThread,
+                next_job)) != 0) {
+            snprintf(next_job->error_msg, MISC_STRING_LEN,
+                    "pthread_create(): %s", strerror(ret_val));
+            next_job->finished = next_job->started;
+            next_job->state = JOB_FAILED;
+            FREE_NULL(next_job->arg);
+            continue;
+        }
+        pthread_detach(job_thread);
+        g_jobs_running++;
+    }
+}
+
+
+/**
+ * @brief Queue a new job; it starts right away if fewer than the limit are
+ * running. The argument must be allocated with malloc() and belongs to the
+ * job engine from now on (it's freed when the job ends, or now if the job
+ * can't be queued). Set 'bytes' if the job's progress is in bytes. Return
+ * the job ID, or -1 if the job table is full.
+ */
+int submitJob(const char *name, job_fn run, void *arg, boolean bytes) {
+    job_t *job = NULL;
+    int i = 0, job_id = -1;
+
+    pthread_mutex_lock(&g_jobs_mutex);
+    /* Use a free entry, otherwise the oldest reported one */
+    for (i = 0; i < MAX_JOBS; i++) {
+        if (g_jobs[i].state == JOB_FREE) {
+            job = &g_jobs[i];
+            break;
+        }
+        if (((g_jobs[i].state == JOB_DONE) ||
+                (g_jobs[i].state == JOB_FAILED)) && g_jobs[i].reported &&
+                ((job == NULL) || (g_jobs[i].id < job->id)))
+            job = &g_jobs[i];
+    }
+
+    if (job != NULL) {
+        memset(job, 0, sizeof (job_t));
+        job->id = g_next_job_id++;
+        snprintf(job->name, JOB_NAME_SIZE, "%s", name);
+        job->run = run;
+        job->arg = arg;
+        job->bytes = bytes;
+        clock_gettime(CLOCK_MONOTONIC, &job->queued);
+        job->state = JOB_QUEUED;
+        job_id = job->id;
+        DEBUG_LOG("Queued background job %d: %s", job_id, name);
+        startQueuedJobs();
+    } else {
+        free(arg);
+    }
+    pthread_mutex_unlock(&g_jobs_mutex);
+    return job_id;
+}
+
+
+/**
+ * @brief Update a job's progress (from its own thread).
+ */
+void setJobProgress(job_t *job, long long done, long long total) {
+    pthread_mutex_lock(&g_jobs_mutex);
+    job->done = done;
+    job->total = total;
+    pthread_mutex_unlock(&g_jobs_mutex);
+}
+
+
+/**
+ * @brief A progress callback (for the vdisk file functions) that updates the
+ * job given as the argument; return FALSE if the job has been cancelled.
+ */
+boolean jobProgressCB(void *arg, long long done, long long total) {
+    job_t *job = (job_t *) arg;
+    boolean cancel = FALSE;
+
+    pthread_mutex_lock(&g_jobs_mutex);
+    job->done = done;
+    job->total = total;
+    cancel = job->cancel;
+    pthread_mutex_unlock(&g_jobs_mutex);
+    return !cancel;
+}
+
+
+/**
+ * @brief Record the file a job is writing (from its own thread), so it can
+ * be removed if the TUI quits before the job is done.
+ */
+void setJobDestPath(job_t *job, const char *dst_path) {
+    pthread_mutex_lock(&g_jobs_mutex);
+    snprintf(job->dst_path, MAX_VDISK_PATH_LEN, "%s", dst_path);
+    pthread_mutex_unlock(&g_jobs_mutex);
+}
+
+
+/**
+ * @brief Run a shell command from a job's thread and wait for it; the child
+ * is recorded in the job (if one is given) so it can be stopped if the TUI
+ * quits. The tool name is used in the error message if the command exits
+ * with a non-zero status. Return FALSE (and fill the error message) if the
+ * command couldn't be run or failed.
+ */
+boolean runJobCmd(job_t *job, const char *tool, const char *command,
+        char error_msg[]) {
+    pid_t child_pid = 0;
+    sigset_t signal_set;
+    int child_status = 0;
+
+    if ((child_pid = fork()) < 0) {
+        snprintf(error_msg, MISC_STRING_LEN, "fork(): %s", strerror(errno));
+        return FALSE;
+    } else if (child_pid == 0) {
+        /* The signal mask is inherited (and kept by exec); the UI's
+         * handlers must not run in here before the exec */
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGHUP, SIG_DFL);
+        sigemptyset(&signal_set);
+        sigprocmask(SIG_SETMASK, &signal_set, NULL);
+        execl("/bin/sh", "sh", "-c", command, (char *) NULL);
+        _exit(127);
+    }
+
+    if (job != NULL) {
+        pthread_mutex_lock(&g_jobs_mutex);
+        job->child_pid = child_pid;
+        pthread_mutex_unlock(&g_jobs_mutex);
+    }
+    while (waitpid(child_pid, &child_status, 0) == -1) {
+        if (errno != EINTR) {
+            snprintf(error_msg, MISC_STRING_LEN, "waitpid(): %s",
+                    strerror(errno));
+            child_pid = -1;
+            break;
+        }
+    }
+    if (job != NULL) {
+        pthread_mutex_lock(&g_jobs_mutex);
+        job->child_pid = 0;
+        pthread_mutex_unlock(&g_jobs_mutex);
+    }
+
+    if (child_pid == -1)
+        return FALSE;
+    if (WIFSIGNALED(child_status)) {
+        snprintf(error_msg, MISC_STRING_LEN, "Running %s failed; killed by "
+                "signal %d.", tool, WTERMSIG(child_status));
+        return FALSE;
+    }
+    if (WEXITSTATUS(child_status) != 0) {
+        snprintf(error_msg, MISC_STRING_LEN, CMD_FAILED_ERR, tool,
+                WEXITSTATUS(child_status));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+/**
+ * @brief The work for a single command job.
+ */
+boolean cmdJob(job_t *job, void *arg) {
+    cmd_job_t *cmd_job = (cmd_job_t *) arg;
+    boolean success = FALSE;
+
+    setJobProgress(job, 0, 1);
+    success = runJobCmd(job, cmd_job->tool, cmd_job->command, job->error_msg);
+    if (success)
+        setJobProgress(job, 1, 1);
+    return success;
+}
+
+
+/**
+ * @brief Queue a job that runs one shell command; the tool name is used in
+ * the error message. Return the job ID, or -1 if it couldn't be queued.
+ */
+int submitCmdJob(const char *name, const char *tool, const char *command) {
+    cmd_job_t *cmd_job = NULL;
+
+    if ((cmd_job = calloc(1, sizeof (cmd_job_t))) == NULL)
+        return -1;
+    snprintf(cmd_job->tool, MAX_SHELL_CMD_LEN, "%s", tool);
+    snprintf(cmd_job->command, MAX_SHELL_CMD_LEN, "%s", command);
+    return submitJob(name, cmdJob, cmd_job, FALSE);
+}
+
+
+/**
+ * @brief Return the number of jobs that are queued or running.
+ */
+int activeJobCount() {
+    int i = 0, active = 0;
+
+    pthread_mutex_lock(&g_jobs_mutex);
+    for (i = 0; i < MAX_JOBS; i++) {
+        if ((g_jobs[i].state == JOB_QUEUED) ||
+                (g_jobs[i].state == JOB_RUNNING))
+            active++;
+    }
+    pthread_mutex_unlock(&g_jobs_mutex);
+    return active;
+}
+
+
+/**
+ * @brief Stop the jobs when the TUI quits; queued jobs never start, any
+ * commands that are running are sent SIGTERM, and jobs working in our own
+ * threads are cancelled (a new file they were writing is removed). We wait
+ * a while for them to stop; if one still hasn't, the file it's writing is
+ * removed here so a partial file isn't left looking complete.
+ */
+void stopJobs() {
+    struct timespec deadline = {0};
+    int i = 0;
+
+    pthread_mutex_lock(&g_jobs_mutex);
+    g_job_limit = 0;
+    for (i = 0; i < MAX_JOBS; i++) {
+        if (g_jobs[i].state == JOB_RUNNING) {
+            DEBUG_LOG("Background job %d (%s) was still running.",
+                    g_jobs[i].id, g_jobs[i].name);
+            g_jobs[i].cancel = TRUE;
+            if (g_jobs[i].child_pid > 0)
+                kill(g_jobs[i].child_pid, SIGTERM);
+        }
+    }
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += JOB_STOP_WAIT_SEC;
+    while (g_jobs_running > 0) {
+        if (pthread_cond_timedwait(&g_jobs_cond, &g_jobs_mutex,
+                &deadline) == ETIMEDOUT)
+            break;
+    }
+    for (i = 0; i < MAX_JOBS; i++) {
+        if ((g_jobs[i].state == JOB_RUNNING) &&
+                (g_jobs[i].dst_path[0] != '\0')) {
+            DEBUG_LOG("Background job %d (%s) didn't stop; removing '%s'.",
+                    g_jobs[i].id, g_jobs[i].name, g_jobs[i].dst_path);
+            unlink(g_jobs[i].dst_path);
+            g_jobs[i].dst_path[0] = '\0';
+        }
+    }
+    pthread_mutex_unlock(&g_jobs_mutex);
+}
+
+
+/**
+ * @brief Format a number of seconds as "H:MM:SS" into the buffer.
+ */
+void formatJobTime(double secs, char time_str[]) {
+    long whole = (long) secs;
+
+    if (whole < 0)
+        whole = 0;
+    snprintf(time_str, MISC_STRING_LEN, "%ld:%02ld:%02ld", (whole / 3600),
+            ((whole / 60) % 60), (whole % 60));
+}
+
+
+/**
+ * @brief Check for a job that has finished (and hasn't been reported yet);
+ * return TRUE only the first time each one is seen, with a message about it,
+ * its result message (if it worked and left one) and the error message
+ * (empty if it worked) for the UI thread to show.
+ */
+boolean getFinishedJob(char job_msg[], char result_msg[], char error_msg[]) {
+    job_t *job = NULL;
+    char time_str[MISC_STRING_LEN] = {0};
+    int i = 0;
+
+    pthread_mutex_lock(&g_jobs_mutex);
+    for (i = 0; i < MAX_JOBS; i++) {
+        if (((g_jobs[i].state == JOB_DONE) ||
+                (g_jobs[i].state == JOB_FAILED)) && !g_jobs[i].reported &&
+                ((job == NULL) || (g_jobs[i].id < job->id)))
+            job = &g_jobs[i];
+    }
+    if (job != NULL) {
+        formatJobTime((profileDiffMsec(&job->started,
+                &job->finished) / 1000.0), time_str);
+        if (job->state == JOB_DONE) {
+            snprintf(job_msg, MISC_STRING_LEN, JOB_DONE_MSG, job->id,
+                    job->name, time_str);
+            snprintf(result_msg, MISC_STRING_LEN, "%s", job->result_msg);
+            error_msg[0] = '\0';
+        } else {
+            snprintf(job_msg, MISC_STRING_LEN, JOB_FAILED_MSG, job->id,
+                    job->name);
+            result_msg[0] = '\0';
+            snprintf(error_msg, MISC_STRING_LEN, "%s", job->error_msg);
+        }
+        job->reported = TRUE;
+    }
+    pthread_mutex_unlock(&g_jobs_mutex);
+    return (job != NULL);
+}
+
+
+/**
+ * @brief Format the job table (plain text, a header row then the jobs in
+ * the order they were submitted, with the error under any that failed) into
+ * the row arena. Return FALSE if the arena filled up.
+ */
+boolean formatJobRows(row_arena_t *rows) {
+    struct timespec now = {0};
+    job_t *job = NULL;
+    char percent_str[MISC_STRING_LEN] = {0}, rate_str[MISC_STRING_LEN] = {0},
+            eta_str[MISC_STRING_LEN] = {0}, elapsed_str[MISC_STRING_LEN] = {0};
+    const char *state_str = NULL;
+    double secs = 0;
+    int i = 0, last_id = 0, next_idx = 0;
+    boolean all_fit = TRUE;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&g_jobs_mutex);
+    if (!addArenaRow(rows, "%4s %-24.24s %-7s %5s %8s %8s %8s", "ID", "Name",
+            "State", "Done", "MiB/s", "ETA", "Elapsed"))
+        all_fit = FALSE;
+
+    /* The table isn't in order (entries are re-used), so find each next
+     * job by ID */
+    while (all_fit) {
+        next_idx = -1;
+        for (i = 0; i < MAX_JOBS; i++) {
+            if ((g_jobs[i].state != JOB_FREE) && (g_jobs[i].id > last_id) &&
+                    ((next_idx == -1) || (g_jobs[i].id < g_jobs[next_idx].id)))
+                next_idx = i;
+        }
+        if (next_idx == -1)
+            break;
+        job = &g_jobs[next_idx];
+        last_id = job->id;
+
+        /* How long it has run (or did) */
+        if (job->state == JOB_QUEUED)
+            secs = 0;
+        else if (job->state == JOB_RUNNING)
+            secs = profileDiffMsec(&job->started, &now) / 1000.0;
+        else
+            secs = profileDiffMsec(&job->started, &job->finished) / 1000.0;
+        formatJobTime(secs, elapsed_str);
+
+        snprintf(percent_str, MISC_STRING_LEN, "-");
+        snprintf(rate_str, MISC_STRING_LEN, "-");
+        snprintf(eta_str, MISC_STRING_LEN, "-");
+        if (job->state == JOB_DONE)
+            snprintf(percent_str, MISC_STRING_LEN, "100%%");
+        else if (job->total > 0)
+            snprintf(percent_str, MISC_STRING_LEN, "%lld%%",
+                    ((job->done * 100) / job->total));
+        if (job->bytes && (secs > 0) && (job->done > 0))
+            snprintf(rate_str, MISC_STRING_LEN, "%.1f",
+                    ((job->done / (double) MEBIBYTE_SIZE) / secs));
+        /* The time left assumes the rate so far stays the same */
+        if ((job->state == JOB_RUNNING) && (job->done > 0) &&
+                (job->total > job->done))
+            formatJobTime((secs * (job->total - job->done) / job->done),
+                    eta_str);
+
+        if (job->state == JOB_QUEUED)
+            state_str = "Queued";
+        else if (job->state == JOB_RUNNING)
+            state_str = "Running";
+        else if (job->state == JOB_DONE)
+            state_str = "Done";
+        else
+            state_str = "Failed";
+
+        if (!addArenaRow(rows, "%4d %-24.24s %-7s %5s %8s %8s %8s", job->id,
+                job->name, state_str, percent_str, rate_str, eta_str,
+                elapsed_str))
+            all_fit = FALSE;
+        if (all_fit && (job->state == JOB_FAILED) &&
+                !addArenaRow(rows, "%4s %s", "", job->error_msg))
+            all_fit = FALSE;
+    }
+    pthread_mutex_unlock(&g_jobs_mutex);
+    return all_fit;
+}
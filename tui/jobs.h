@@ -0,0 +1,112 @@
+/**
+ * @file jobs.h
+ * @brief Data structures for the background job engine (long running work
+ * like writing vdisk files or making file systems).
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _JOBS_H
+#define	_JOBS_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <time.h>
+#include <sys/types.h>
+
+#include "system.h"
+#include "dialogs.h"
+#include "vdisk_io.h"
+
+/* The job table holds queued, running and finished jobs; finished jobs that
+ * have been reported are re-used (oldest first) when it fills up */
+#define MAX_JOBS                32
+#define JOB_NAME_SIZE           48
+/* How many jobs run at the same time (tui:max_jobs in the ESOS config) */
+#define JOB_DEF_LIMIT           2
+#define MAX_JOB_LIMIT           8
+/* How long (seconds) quitting waits for the running jobs to stop */
+#define JOB_STOP_WAIT_SEC       10
+
+typedef enum {
+    JOB_FREE, JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_FAILED
+} job_state_t;
+
+struct job;
+
+/* The work for a job; it runs in the job's own thread so it must not touch
+ * the screen. On failure, fill the job error message and return FALSE; on
+ * success, a result message (shown with the "finished" message) is optional. */
+typedef boolean (*job_fn)(struct job *job, void *arg);
+
+/* One job; the progress is in bytes (a rate is shown) or steps */
+typedef struct job {
+    int id;
+    char name[JOB_NAME_SIZE];
+    job_state_t state;
+    job_fn run;
+    void *arg;
+    long long done;
+    long long total;
+    boolean bytes;
+    struct timespec queued;
+    struct timespec started;
+    struct timespec finished;
+    pid_t child_pid;
+    /* Set when the TUI quits; the work stops at its next progress update */
+    boolean cancel;
+    /* The file the job is writing (if any); it's removed if the job is
+     * still running when we give up waiting for it */
+    char dst_path[MAX_VDISK_PATH_LEN];
+    boolean reported;
+    char error_msg[MISC_STRING_LEN];
+    char result_msg[MISC_STRING_LEN];
+} job_t;
+
+/* The argument for a job that runs one shell command */
+typedef struct {
+    char tool[MAX_SHELL_CMD_LEN];
+    char command[MAX_SHELL_CMD_LEN];
+} cmd_job_t;
+
+/* The argument for a job that makes a file system on a device (the new
+ * partition, if any, is setup by the dialog first); a stripe unit (bytes)
+ * of zero means the file system isn't aligned to any RAID stripes */
+typedef struct {
+    char blk_dev_node[MAX_FS_ATTR_LEN];
+    char fs_type[MAX_FS_ATTR_LEN];
+    char fs_label[MAX_FS_LABEL];
+    unsigned long stripe_unit;
+    int stripe_width;
+    char mount_opts[MAX_MOUNT_OPTS_LEN];
+    boolean mount;
+} mkfs_job_t;
+
+/* The argument for a job that writes out a new virtual disk file */
+typedef struct {
+    char path[MAX_VDISK_PATH_LEN];
+    long long size;
+    vdisk_prov_t mode;
+    int queue_depth;
+} vdisk_job_t;
+
+/* The argument for a job that clones a virtual disk file */
+typedef struct {
+    char src_path[MAX_VDISK_PATH_LEN];
+    char dst_path[MAX_VDISK_PATH_LEN];
+    int threads;
+} clone_job_t;
+
+/* The argument for a job that reclaims the zeroed space in a virtual disk
+ * file (the read rate limit is in MiB/s) */
+typedef struct {
+    char path[MAX_VDISK_PATH_LEN];
+    int rate_limit;
+} reclaim_job_t;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _JOBS_H */
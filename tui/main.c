@@ -16,9 +16,11 @@
 #include <fcntl.h>
 #include <iniparser.h>
 #include <uuid/uuid.h>
-#include <curl/curl.h>
 #include <assert.h>
 #include <locale.h>
+#include <getopt.h>
+#include <time.h>
+#include <curl/curl.h>
 
 #include "prototypes.h"
 #include "system.h"
@@ -53,8 +55,7 @@ int main(int argc, char** argv) {
     CDKLABEL *targets_label = 0, *sessions_label = 0;
     char *menu_list_1[MAX_MENU_ITEMS][MAX_SUB_ITEMS] = {{NULL}, {NULL}},
             *menu_list_2[MAX_MENU_ITEMS][MAX_SUB_ITEMS] = {{NULL}, {NULL}};
-    char *tgt_label_msg[MAX_INFO_LABEL_ROWS] = {NULL},
-            *sess_label_msg[MAX_INFO_LABEL_ROWS] = {NULL};
+    row_arena_t tgt_label_rows = {0}, sess_label_rows = {0};
     char *error_msg = NULL;
     int selection = 0, key_pressed = 0, menu_choice = 0, submenu_choice = 0,
             screen_x = 0, screen_y = 0, latest_scr_y = 0, latest_scr_x = 0,
@@ -68,7 +69,24 @@ int main(int argc, char** argv) {
             menu_loc_2[CDK_MENU_MAX_SIZE] = {0};
     pid_t child_pid = 0;
     uid_t saved_uid = 0;
-    boolean inet_works = FALSE;
+    boolean inet_works = FALSE, batch_mode = FALSE, first_frame = TRUE,
+            profile_mode = FALSE, inet_done = FALSE, confirm_quit = TRUE,
+            usage_posted = FALSE;
+    struct timespec start_time = {0}, frame_time = {0}, phase_start = {0};
+    char startup_err[MISC_STRING_LEN] = {0}, job_msg[MISC_STRING_LEN] = {0},
+            job_result[MISC_STRING_LEN] = {0}, job_err[MISC_STRING_LEN] = {0};
+    int batch_interval = BATCH_DEFAULT_INTERVAL, batch_count = 0, option = 0;
+    batch_fmt_t batch_format = BATCH_JSON;
+    static struct option long_options[] = {
+        {"batch", no_argument, NULL, 'b'},
+        {"interval", required_argument, NULL, 'i'},
+        {"format", required_argument, NULL, 'f'},
+        {"count", required_argument, NULL, 'c'},
+        {"sysroot", required_argument, NULL, 'r'},
+        {"profile", no_argument, NULL, 'p'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
 
     /* The "blue" TUI theme */
     g_color_main_text[BLUE_TUI]         = COLOR_PAIR(5);
@@ -118,15 +136,87 @@ int main(int argc, char** argv) {
     /* Setup logging for debug messages */
     openlog(TUI_LOG_PREFIX, TUI_LOG_OPTIONS, TUI_LOG_FACILITY);
     DEBUG_LOG("TUI start-up...");
+    initProfile();
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    /* Parse the command line options */
+    while ((option = getopt_long(argc, argv, "bi:f:c:r:ph",
+            long_options, NULL)) != -1) {
+        switch (option) {
+            case 'b':
+                batch_mode = TRUE;
+                break;
+            case 'i':
+                batch_interval = atoi(optarg);
+                if (batch_interval < 1) {
+                    fprintf(stderr, BATCH_USAGE_MSG, argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'f':
+                if (strcasecmp(optarg, "json") == 0) {
+                    batch_format = BATCH_JSON;
+                } else if (strcasecmp(optarg, "csv") == 0) {
+                    batch_format = BATCH_CSV;
+                } else {
+                    fprintf(stderr, BATCH_USAGE_MSG, argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'c':
+                batch_count = atoi(optarg);
+                if (batch_count < 0) {
+                    fprintf(stderr, BATCH_USAGE_MSG, argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'r':
+                if (!setSysRoot(optarg))
+                    exit(EXIT_FAILURE);
+                break;
+            case 'p':
+                profile_mode = TRUE;
+                break;
+            case 'h':
+                fprintf(stdout, BATCH_USAGE_MSG, argv[0]);
+                exit(EXIT_SUCCESS);
+            default:
+                fprintf(stderr, BATCH_USAGE_MSG, argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+    if (optind < argc) {
+        fprintf(stderr, BATCH_USAGE_MSG, argv[0]);
+        exit(EXIT_FAILURE);
+    }
 
-    /* Check if there is Internet access */
-    inet_works = checkInetAccess();
+    /* Headless mode; no curses, just the SCST information on stdout */
+    if (batch_mode) {
+        DEBUG_LOG("Running in batch mode...");
+        exit(batchMode(batch_interval, batch_format, batch_count));
+    }
+
+    /* The cURL global setup isn't thread-safe, so it's done before any of
+     * our threads are started (and never cleaned up, they may still be
+     * running when we exit) */
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    /* Check if there is Internet access (and maybe report usage) in the
+     * background; the results are picked up in the main loop */
+    if (!startStartupThread())
+        DEBUG_LOG("Couldn't start the start-up thread; no usage report.");
+
+    /* Long running work from the dialogs is queued as background jobs */
+    startJobs();
 
     /* Set the TUI interface theme (colors) */
+    startProfile(&phase_start);
     setTheme();
+    endProfile(PROFILE_STARTUP_PREFIX "setTheme", &phase_start);
 
     /* Initialize screen and check size */
 start:
+    startProfile(&phase_start);
     setlocale(LC_ALL, "");
     main_window = initscr();
     curs_set(0);
@@ -143,6 +233,7 @@ start:
     wbkgd(sub_window, g_color_main_text[g_curr_theme]);
     cdk_screen = initCDKScreen(sub_window);
     initCDKColor();
+    endProfile(PROFILE_STARTUP_PREFIX "terminal init", &phase_start);
 
     /* Create the menu lists */
     SAFE_ASPRINTF(&menu_list_1[SYSTEM_MENU][0],
@@ -173,6 +264,8 @@ start:
             "</B>DRBD Status       <!B>";
     menu_list_1[SYSTEM_MENU][SYSTEM_DATE_TIME] = \
             "</B>Date/Time Settings<!B>";
+    menu_list_1[SYSTEM_MENU][SYSTEM_BENCHMARK] = \
+            "</B>I/O Benchmark     <!B>";
 
     SAFE_ASPRINTF(&menu_list_1[HW_RAID_MENU][0],
             "</B>H</%d/U>a<!%d><!U>rdware RAID  <!B>",
@@ -233,8 +326,14 @@ start:
             "</B>Add File System   <!B>";
     menu_list_1[FILE_SYS_MENU][FILE_SYS_REM_FS] = \
             "</B>Remove File System<!B>";
+    menu_list_1[FILE_SYS_MENU][FILE_SYS_MNT_OPTS] = \
+            "</B>Mount Options     <!B>";
     menu_list_1[FILE_SYS_MENU][FILE_SYS_ADD_VDISK] = \
             "</B>Add VDisk File    <!B>";
+    menu_list_1[FILE_SYS_MENU][FILE_SYS_CLONE_VDISK] = \
+            "</B>Clone VDisk File  <!B>";
+    menu_list_1[FILE_SYS_MENU][FILE_SYS_RECLAIM_VDISK] = \
+            "</B>Reclaim VDisk File<!B>";
     menu_list_1[FILE_SYS_MENU][FILE_SYS_REM_VDISK] = \
             "</B>Remove VDisk File <!B>";
 
@@ -322,11 +421,15 @@ start:
             "</B>Help          <!B>";
     menu_list_2[INTERFACE_MENU][INTERFACE_SUPPORT_PKG] = \
             "</B>Support Bundle<!B>";
+    menu_list_2[INTERFACE_MENU][INTERFACE_PROFILE] = \
+            "</B>Latency Stats <!B>";
+    menu_list_2[INTERFACE_MENU][INTERFACE_JOBS] = \
+            "</B>Jobs          <!B>";
     menu_list_2[INTERFACE_MENU][INTERFACE_ABOUT] = \
             "</B>About         <!B>";
 
     /* Set top menu sizes and locations */
-    submenu_size_1[SYSTEM_MENU]       = 13;
+    submenu_size_1[SYSTEM_MENU]       = 14;
     menu_loc_1[SYSTEM_MENU]           = LEFT;
     submenu_size_1[HW_RAID_MENU]      = 5;
     menu_loc_1[HW_RAID_MENU]          = LEFT;
@@ -334,7 +437,7 @@ start:
     menu_loc_1[SW_RAID_MENU]          = LEFT;
     submenu_size_1[LVM_MENU]          = 8;
     menu_loc_1[LVM_MENU]              = LEFT;
-    submenu_size_1[FILE_SYS_MENU]     = 6;
+    submenu_size_1[FILE_SYS_MENU]     = 9;
     menu_loc_1[FILE_SYS_MENU]         = LEFT;
 
     /* Set bottom menu sizes and locations */
@@ -346,7 +449,7 @@ start:
     menu_loc_2[TARGETS_MENU]          = LEFT;
     submenu_size_2[ALUA_MENU]         = 10;
     menu_loc_2[ALUA_MENU]             = LEFT;
-    submenu_size_2[INTERFACE_MENU]    = 7;
+    submenu_size_2[INTERFACE_MENU]    = 9;
     menu_loc_2[INTERFACE_MENU]        = RIGHT;
 
     /* Create the top menu */
@@ -384,6 +487,7 @@ start:
     refreshCDKScreen(cdk_screen);
 
     /* Check if license has been accepted */
+    startProfile(&phase_start);
     if (!acceptLicense(cdk_screen)) {
         errorDialog(cdk_screen,
                 "You must accept the Enterprise Storage OS (ESOS) license",
@@ -391,27 +495,104 @@ start:
         goto quit;
     }
 
-    /* Usage count (only if we have Internet) */
-    if (inet_works)
-        reportUsage(cdk_screen);
+    endProfile(PROFILE_STARTUP_PREFIX "acceptLicense", &phase_start);
 
     /* Check and see if SCST is loaded */
+    startProfile(&phase_start);
     if (!isSCSTLoaded()) {
         errorDialog(cdk_screen,
                 "It appears SCST is not loaded; a number of the TUI",
                 "functions will not work. Check the '/var/log/boot' file.");
     }
 
+    endProfile(PROFILE_STARTUP_PREFIX "isSCSTLoaded", &phase_start);
+
+    /* Start collecting the SCST information in the background */
+    if (!startCollector()) {
+        errorDialog(cdk_screen, COLLECTOR_ERR_MSG, NULL);
+        goto quit;
+    }
+
+    /* Keep the device table (for the device pickers) current in the
+     * background; if we can't, the pickers read the devices each time */
+    if (!startDevTable())
+        DEBUG_LOG("Couldn't start the device table thread.");
+
+    /* The label rows are formatted into buffers that are re-used on
+     * every refresh */
+    if (!initRowArena(&tgt_label_rows, MAX_INFO_LABEL_ROWS,
+            INFO_LABEL_ROW_SIZE) || !initRowArena(&sess_label_rows,
+            MAX_INFO_LABEL_ROWS, INFO_LABEL_ROW_SIZE)) {
+        errorDialog(cdk_screen, ROW_ARENA_ERR_MSG, NULL);
+        goto quit;
+    }
+
     /* Loop, refreshing the labels and waiting for input */
     halfdelay(REFRESH_DELAY);
     for (;;) {
         /* Update the information labels */
+        if (first_frame)
+            startProfile(&phase_start);
         if (!updateInfoLabels(cdk_screen, &targets_label, &sessions_label,
-                tgt_label_msg, sess_label_msg,
+                &tgt_label_rows, &sess_label_rows,
                 &labels_last_scr_y, &labels_last_scr_x,
                 &last_tgt_lbl_rows, &last_sess_lbl_rows))
             goto quit;
 
+        /* How long it took to get here the first time */
+        if (first_frame) {
+            endProfile(PROFILE_STARTUP_PREFIX "first updateInfoLabels",
+                    &phase_start);
+            clock_gettime(CLOCK_MONOTONIC, &frame_time);
+            recordProfile(PROFILE_STARTUP_PREFIX "first interactive frame",
+                    profileDiffMsec(&start_time, &frame_time));
+            DEBUG_LOG("First interactive frame after %.1f ms.",
+                    profileDiffMsec(&start_time, &frame_time));
+            first_frame = FALSE;
+        }
+
+        /* Usage count (only if we have Internet); the start-up thread
+         * transmits it, and we show any error once it's done; nothing is
+         * reported on a profiling run */
+        if (getInetResult(&inet_works)) {
+            if (inet_works && !profile_mode) {
+                /* The question dialog would time out with halfdelay() */
+                cbreak();
+                reportUsage(cdk_screen);
+                halfdelay(REFRESH_DELAY);
+            } else {
+                setUsageReport(NULL);
+            }
+            inet_done = TRUE;
+        }
+
+        /* A profiling run is done once the start-up work has finished; the
+         * breakdown is printed after the screen is cleaned up */
+        if (profile_mode && inet_done)
+            goto quit;
+        if (getStartupResult(startup_err, &usage_posted)) {
+            /* The ESOS config. file is only ever written by this thread */
+            if (usage_posted)
+                recordUsageVersion(startup_err);
+            if (startup_err[0] != '\0') {
+                cbreak();
+                errorDialog(cdk_screen, startup_err, NULL);
+                halfdelay(REFRESH_DELAY);
+            }
+        }
+
+        /* Let the user know when a background job finishes */
+        if (getFinishedJob(job_msg, job_result, job_err)) {
+            cbreak();
+            if (job_err[0] != '\0')
+                errorDialog(cdk_screen, job_msg, job_err);
+            else
+                informDialog(cdk_screen, job_msg, ((job_result[0] != '\0') ?
+                        job_result : NULL));
+            halfdelay(REFRESH_DELAY);
+            continue;
+        }
+
         /* Get user input */
         wrefresh(sub_window);
         keypad(sub_window, TRUE);
@@ -488,6 +669,28 @@ start:
                     g_color_menu_text[g_curr_theme]);
             selection = activateCDKMenu(menu_2, 0);
 
+        } else if (key_pressed == 'k' || key_pressed == 'K') {
+            /* Sort the sessions label by the next key */
+            nextSessSortKey();
+            continue;
+
+        } else if (key_pressed == 'n' || key_pressed == 'N') {
+            /* Show the next top-N number of sessions */
+            nextSessTopN();
+            continue;
+
+        } else if (key_pressed == 'v' || key_pressed == 'V') {
+            /* Switch between the sessions and SCST devices */
+            toggleDevicePanel();
+            continue;
+
+        } else if (key_pressed == 'j' || key_pressed == 'J') {
+            /* Show the background jobs */
+            jobsDialog(cdk_screen);
+            refreshCDKScreen(cdk_screen);
+            halfdelay(REFRESH_DELAY);
+            continue;
+
         } else if (key_pressed == KEY_RESIZE) {
             /* Screen re-size */
             screenResize(cdk_screen, main_window, sub_window,
@@ -511,7 +714,7 @@ start:
             if (menu_choice == SYSTEM_MENU &&
                     submenu_choice == SYSTEM_SYNC_CONF - 1) {
                 /* Sync. Configuration dialog */
-                syncConfig(cdk_screen);
+                syncConfig(cdk_screen, FALSE);
 
             } else if (menu_choice == SYSTEM_MENU &&
                     submenu_choice == SYSTEM_NETWORK - 1) {
@@ -568,6 +771,11 @@ start:
                 /* Date & Time Settings dialog */
                 dateTimeDialog(cdk_screen);
 
+            } else if (menu_choice == SYSTEM_MENU &&
+                    submenu_choice == SYSTEM_BENCHMARK - 1) {
+                /* I/O Benchmark dialog */
+                benchmarkDialog(cdk_screen);
+
             } else if (menu_choice == HW_RAID_MENU &&
                     submenu_choice == HW_RAID_ADD_VOL - 1) {
                 /* Add Volume dialog */
@@ -668,11 +876,26 @@ start:
                 /* Remove File System dialog */
                 removeFSDialog(cdk_screen);
 
+            } else if (menu_choice == FILE_SYS_MENU &&
+                    submenu_choice == FILE_SYS_MNT_OPTS - 1) {
+                /* Mount Options dialog */
+                mountOptsDialog(cdk_screen);
+
             } else if (menu_choice == FILE_SYS_MENU &&
                     submenu_choice == FILE_SYS_ADD_VDISK - 1) {
                 /* Add VDisk File dialog */
                 addVDiskFileDialog(cdk_screen);
 
+            } else if (menu_choice == FILE_SYS_MENU &&
+                    submenu_choice == FILE_SYS_CLONE_VDISK - 1) {
+                /* Clone VDisk File dialog */
+                cloneVDiskFileDialog(cdk_screen);
+
+            } else if (menu_choice == FILE_SYS_MENU &&
+                    submenu_choice == FILE_SYS_RECLAIM_VDISK - 1) {
+                /* Reclaim VDisk File dialog */
+                reclaimVDiskFileDialog(cdk_screen);
+
             } else if (menu_choice == FILE_SYS_MENU &&
                     submenu_choice == FILE_SYS_REM_VDISK - 1) {
                 /* Remove VDisk File dialog */
@@ -820,9 +1043,20 @@ start:
 
             } else if (menu_choice == INTERFACE_MENU &&
                     submenu_choice == INTERFACE_QUIT - 1) {
-                /* Synchronize the configuration and quit */
-                syncConfig(cdk_screen);
-                goto quit;
+                /* Synchronize the configuration and quit; check first
+                 * if any background jobs would be cut short */
+                if ((i = activeJobCount()) > 0) {
+                    SAFE_ASPRINTF(&error_msg, JOBS_ACTIVE_MSG, i);
+                    confirm_quit = confirmDialog(cdk_screen, error_msg,
+                            JOBS_QUIT_MSG);
+                    FREE_NULL(error_msg);
+                }
+                if (confirm_quit) {
+                    stopJobs();
+                    syncConfig(cdk_screen, TRUE);
+                    goto quit;
+                }
+                confirm_quit = TRUE;
 
             } else if (menu_choice == INTERFACE_MENU &&
                     submenu_choice == INTERFACE_SHELL - 1) {
@@ -854,8 +1088,10 @@ start:
                     }
                     exit(2);
                 } else {
-                    /* Parent; wait for the child to finish */
-                    while ((proc_status = wait(&child_status)) != child_pid) {
+                    /* Parent; wait for the child to finish (only ours; the
+                     * background jobs wait for their own) */
+                    while ((proc_status = waitpid(child_pid, &child_status,
+                            0)) != child_pid) {
                         if (proc_status < 0 && errno == ECHILD)
                             break;
                         errno = 0;
@@ -900,6 +1136,16 @@ start:
                 /* Support Bundle dialog */
                 supportArchDialog(cdk_screen);
 
+            } else if (menu_choice == INTERFACE_MENU &&
+                    submenu_choice == INTERFACE_PROFILE - 1) {
+                /* Latency Stats dialog */
+                profileDialog(cdk_screen);
+
+            } else if (menu_choice == INTERFACE_MENU &&
+                    submenu_choice == INTERFACE_JOBS - 1) {
+                /* Background Jobs dialog */
+                jobsDialog(cdk_screen);
+
             } else if (menu_choice == INTERFACE_MENU &&
                     submenu_choice == INTERFACE_ABOUT - 1) {
                 /* About dialog */
@@ -922,6 +1168,9 @@ start:
     /* All done -- clean up */
 quit:
     DEBUG_LOG("Quitting...");
+    stopJobs();
+    stopCollector();
+    stopDevTable();
     closelog();
     if (cdk_screen != NULL) {
         destroyCDKScreenObjects(cdk_screen);
@@ -934,11 +1183,11 @@ quit:
         FREE_NULL(menu_list_1[i][0]);
     for (i = 0; i < menu_2_cnt; i++)
         FREE_NULL(menu_list_2[i][0]);
-    for (i = 0; i < MAX_INFO_LABEL_ROWS; i++) {
-        FREE_NULL(tgt_label_msg[i]);
-        FREE_NULL(sess_label_msg[i]);
-    }
+    freeRowArena(&tgt_label_rows);
+    freeRowArena(&sess_label_rows);
     system(CLEAR_BIN);
+    if (profile_mode)
+        printStartupProfile(stdout);
     exit(EXIT_SUCCESS);
 }
 
@@ -1282,20 +1531,18 @@ boolean acceptLicense(CDKSCREEN *main_cdk_screen) {
 /**
  * @brief Read the ESOS configuration file and prompt the user to participate
  * in anonymous usage statistics; if user participates, whenever the ESOS
- * version changes (upgrade), an HTTP POST request is made.
+ * version changes (upgrade), an HTTP POST request is made (by the start-up
+ * thread, so we never wait on the network here).
  */
 void reportUsage(CDKSCREEN *main_cdk_screen) {
     boolean question = FALSE;
     dictionary *ini_dict = NULL;
     uuid_t install_id = {0};
-    CDKLABEL *transmit_msg = 0;
     char *error_msg = NULL, *conf_install_id = NULL, *conf_last_ver = NULL,
             *conf_participate = NULL;
     char install_id_str[UUID_STR_SIZE] = {0};
     FILE *ini_file = NULL;
-    CURL *curl = NULL;
-    CURLcode result = 0;
-    struct curl_httppost *form_post = NULL, *last_ptr = NULL;
+    boolean report_due = FALSE;
 
     while (1) {
         if (access(ESOS_CONF, F_OK) != 0) {
@@ -1389,73 +1636,11 @@ void reportUsage(CDKSCREEN *main_cdk_screen) {
                 fclose(ini_file);
             }
 
-            /* Last reported version doesn't match what we have, report it */
+            /* Last reported version doesn't match what we have, so the
+             * start-up thread reports it (and saves the version) */
             if (strcmp(conf_last_ver, ESOS_VERSION) != 0) {
-                /* Display a message while we transmit */
-                transmit_msg = newCDKLabel(main_cdk_screen, CENTER, CENTER,
-                        g_usage_label_msg, g_usage_label_msg_size(),
-                        TRUE, FALSE);
-                if (!transmit_msg) {
-                    errorDialog(main_cdk_screen, LABEL_ERR_MSG, NULL);
-                    break;
-                }
-                setCDKLabelBackgroundAttrib(transmit_msg,
-                        g_color_dialog_text[g_curr_theme]);
-                setCDKLabelBoxAttribute(transmit_msg,
-                        g_color_dialog_box[g_curr_theme]);
-                refreshCDKScreen(main_cdk_screen);
-
-                /* Initialize cURL */
-                curl_global_init(CURL_GLOBAL_ALL);
-                if ((curl = curl_easy_init()) != NULL) {
-                    /* Fill in our form fields */
-                    curl_formadd(&form_post, &last_ptr, CURLFORM_COPYNAME,
-                            "branch", CURLFORM_COPYCONTENTS,
-                            GIT_BRANCH, CURLFORM_END);
-                    curl_formadd(&form_post, &last_ptr, CURLFORM_COPYNAME,
-                            "ver_string", CURLFORM_COPYCONTENTS,
-                            ESOS_VERSION, CURLFORM_END);
-                    curl_formadd(&form_post, &last_ptr, CURLFORM_COPYNAME,
-                            "install_id", CURLFORM_COPYCONTENTS,
-                            conf_install_id, CURLFORM_END);
-
-                    /* Set cURL options for our HTTP POST */
-                    curl_easy_setopt(curl, CURLOPT_URL, USAGE_POST_URL);
-                    curl_easy_setopt(curl, CURLOPT_HTTPPOST, form_post);
-                    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
-                    curl_easy_setopt(curl, CURLOPT_USERAGENT, TUI_LOG_PREFIX);
-
-                    /* Perform the request */
-                    result = curl_easy_perform(curl);
-                    if (result != CURLE_OK) {
-                        SAFE_ASPRINTF(&error_msg, "curl_easy_perform(): %s",
-                                curl_easy_strerror(result));
-                        errorDialog(main_cdk_screen, error_msg, NULL);
-                        FREE_NULL(error_msg);
-                        break;
-                    }
-
-                    /* Cleanup */
-                    curl_easy_cleanup(curl);
-                    curl_formfree(form_post);
-                }
-
-                /* Success if we made it this far, set the last version */
-                if (iniparser_set(ini_dict, "usage:last_ver",
-                        ESOS_VERSION) == -1) {
-                    errorDialog(main_cdk_screen, SET_FILE_VAL_ERR, NULL);
-                    break;
-                }
-                /* Save the file */
-                if ((ini_file = fopen(ESOS_CONF, "w")) == NULL) {
-                    SAFE_ASPRINTF(&error_msg, ESOS_CONF_WRITE_ERR,
-                            strerror(errno));
-                    errorDialog(main_cdk_screen, error_msg, NULL);
-                    FREE_NULL(error_msg);
-                    break;
-                }
-                iniparser_dump_ini(ini_dict, ini_file);
-                fclose(ini_file);
+                setUsageReport(conf_install_id);
+                report_due = TRUE;
             }
         }
 
@@ -1464,9 +1649,10 @@ void reportUsage(CDKSCREEN *main_cdk_screen) {
     }
 
     /* Done */
+    if (!report_due)
+        setUsageReport(NULL);
     if (ini_dict != NULL)
         iniparser_freedict(ini_dict);
-    destroyCDKLabel(transmit_msg);
     refreshCDKScreen(main_cdk_screen);
     return;
 }
@@ -481,105 +481,38 @@ int getSCSTLUNChoice(CDKSCREEN *cdk_screen, char tgt_name[], char tgt_driver[],
  */
 char *getSCSIDiskChoice(CDKSCREEN *cdk_screen) {
     CDKSCROLL *scsi_dsk_list = 0;
-    int disk_choice = 0, i = 0, dev_cnt = 0, j = 0;
+    int disk_choice = 0, i = 0, dev_cnt = 0;
     char *scsi_dsk_dev[MAX_SCSI_DISKS] = {NULL},
-            *scsi_dsk_node[MAX_SCSI_DISKS] = {NULL},
-            *scsi_dsk_model[MAX_SCSI_DISKS] = {NULL},
-            *scsi_dsk_vendor[MAX_SCSI_DISKS] = {NULL},
             *scsi_dev_info[MAX_SCSI_DISKS] = {NULL};
-    char *error_msg = NULL, *boot_dev_node = NULL, *scroll_title = NULL;
+    char *scroll_title = NULL;
     static char ret_buff[MAX_SYSFS_ATTR_SIZE] = {0};
-    char dir_name[MAX_SYSFS_PATH_SIZE] = {0},
-            tmp_buff[MAX_SYSFS_ATTR_SIZE] = {0};
-    DIR *dir_stream = NULL;
-    struct dirent *dir_entry = NULL;
+    char boot_disk[MISC_STRING_LEN] = {0};
+    scsi_dev_ent_t *entry = NULL;
 
     /* Since ret_buff is re-used between calls, we reset the first character */
     ret_buff[0] = '\0';
 
     while (1) {
-        /* Get the ESOS boot device node */
-        if ((boot_dev_node = blkid_get_devname(NULL, "LABEL",
-                ESOS_ROOT_PART)) == NULL) {
-            /* The function above returns NULL if the device isn't found */
-            SAFE_ASPRINTF(&boot_dev_node, " ");
-        }
-
-        /* Open the directory to get SCSI disks */
-        if ((dir_stream = opendir(SYSFS_SCSI_DISK)) == NULL) {
-            SAFE_ASPRINTF(&error_msg, "opendir(): %s", strerror(errno));
-            errorDialog(cdk_screen, error_msg, NULL);
-            FREE_NULL(error_msg);
-            break;
-        }
-
-        /* Loop over each entry in the directory (SCSI disks) */
-        while ((dir_entry = readdir(dir_stream)) != NULL) {
-            if (dir_entry->d_type == DT_LNK && dev_cnt < MAX_SCSI_DISKS) {
-                SAFE_ASPRINTF(&scsi_dsk_dev[dev_cnt], "%s", dir_entry->d_name);
-                dev_cnt++;
-            }
-        }
-
-        /* Close the directory stream */
-        closedir(dir_stream);
-
-        /* Loop over our list of SCSI disks */
-        while ((i < dev_cnt) && (i < MAX_SCSI_DISKS)) {
-            /* Get the SCSI block device node */
-            snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/device/block",
-                    SYSFS_SCSI_DISK, scsi_dsk_dev[i]);
-            if ((dir_stream = opendir(dir_name)) == NULL) {
-                if (i < MAX_SCSI_DISKS)
-                    SAFE_ASPRINTF(&scsi_dsk_node[i], "opendir(): %s",
-                            strerror(errno));
-            } else {
-                while ((dir_entry = readdir(dir_stream)) != NULL) {
-                    /* We want to skip the '.' and '..' directories */
-                    if ((dir_entry->d_type == DT_DIR) &&
-                            (strcmp(dir_entry->d_name, ".") != 0) &&
-                            (strcmp(dir_entry->d_name, "..") != 0)) {
-                        /* The first directory is the node name we're using */
-                        if (i < MAX_SCSI_DISKS)
-                            SAFE_ASPRINTF(&scsi_dsk_node[i], "%s",
-                                    dir_entry->d_name);
-                        break;
-                    }
-                }
-                closedir(dir_stream);
-            }
-            /* Make sure this isn't the ESOS boot device (USB); if it is,
-             * clean-up anything allocated, shift the elements, and
-             * decrement device count */
-            if ((strstr(boot_dev_node, scsi_dsk_node[i])) != NULL) {
-                FREE_NULL(scsi_dsk_node[i]);
-                scsi_dsk_node[i] = NULL;
-                FREE_NULL(scsi_dsk_dev[i]);
-                scsi_dsk_dev[i] = NULL;
-                // TODO: This needs to be checked for safeness.
-                for (j = i; j < dev_cnt; j++)
-                    scsi_dsk_dev[j] = scsi_dsk_dev[j + 1];
-                dev_cnt--;
+        /* Get the ESOS boot device (disk) */
+        getBootDiskName(boot_disk);
+
+        /* Fill the list (pretty) for our CDK label with SCSI disks (from the
+         * device table); make sure it isn't the ESOS boot device (USB) */
+        readyDevTable();
+        pthread_mutex_lock(&g_dev_table_mutex);
+        for (i = 0; (i < g_dev_table.scsi_cnt) && (dev_cnt < MAX_SCSI_DISKS);
+                i++) {
+            entry = &g_dev_table.scsi_devs[i];
+            if (!entry->scsi_disk || ((boot_disk[0] != '\0') &&
+                    (strcmp(entry->block_name, boot_disk) == 0)))
                 continue;
-            }
-            /* Read SCSI disk attributes */
-            if (i < MAX_SCSI_DISKS) {
-                snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/device/model",
-                        SYSFS_SCSI_DISK, scsi_dsk_dev[i]);
-                readAttribute(dir_name, tmp_buff);
-                SAFE_ASPRINTF(&scsi_dsk_model[i], "%s", tmp_buff);
-                snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/device/vendor",
-                        SYSFS_SCSI_DISK, scsi_dsk_dev[i]);
-                readAttribute(dir_name, tmp_buff);
-                SAFE_ASPRINTF(&scsi_dsk_vendor[i], "%s", tmp_buff);
-                /* Fill the list (pretty) for our CDK label with SCSI disks */
-                SAFE_ASPRINTF(&scsi_dev_info[i], "<C>[%s] %s %s (/dev/%s)",
-                        scsi_dsk_dev[i], scsi_dsk_vendor[i],
-                        scsi_dsk_model[i], scsi_dsk_node[i]);
-                /* Next */
-                i++;
-            }
+            SAFE_ASPRINTF(&scsi_dsk_dev[dev_cnt], "%s", entry->hctl);
+            SAFE_ASPRINTF(&scsi_dev_info[dev_cnt], "<C>[%s] %s %s (/dev/%s)",
+                    entry->hctl, entry->vendor, entry->model,
+                    entry->block_name);
+            dev_cnt++;
         }
+        pthread_mutex_unlock(&g_dev_table_mutex);
 
         /* Make sure we actually have something to present */
         if (dev_cnt == 0) {
@@ -610,13 +543,9 @@ char *getSCSIDiskChoice(CDKSCREEN *cdk_screen) {
     /* Done */
     destroyCDKScroll(scsi_dsk_list);
     refreshCDKScreen(cdk_screen);
-    FREE_NULL(boot_dev_node);
     FREE_NULL(scroll_title);
     for (i = 0; i < MAX_SCSI_DISKS; i++) {
         FREE_NULL(scsi_dsk_dev[i]);
-        FREE_NULL(scsi_dsk_node[i]);
-        FREE_NULL(scsi_dsk_model[i]);
-        FREE_NULL(scsi_dsk_vendor[i]);
         FREE_NULL(scsi_dev_info[i]);
     }
     if (ret_buff[0] != '\0')
@@ -802,15 +731,70 @@ void getSCSTInitChoice(CDKSCREEN *cdk_screen, char tgt_name[],
 
 
 /**
- * @brief Synchronize the ESOS configuration files to the USB drive; this will
- * also dump the SCST configuration to a flat file (before sync'ing).
+ * @brief Tell the user a background job was queued (or that it couldn't
+ * be, if the job ID is -1).
  */
-void syncConfig(CDKSCREEN *main_cdk_screen) {
-    CDKLABEL *sync_msg = 0;
+void jobQueuedDialog(CDKSCREEN *main_cdk_screen, int job_id) {
+    char *queued_msg = NULL;
+
+    if (job_id == -1) {
+        errorDialog(main_cdk_screen, JOB_SUBMIT_ERR, NULL);
+        return;
+    }
+    SAFE_ASPRINTF(&queued_msg, JOB_QUEUED_MSG, job_id);
+    informDialog(main_cdk_screen, queued_msg, JOB_WATCH_MSG);
+    FREE_NULL(queued_msg);
+}
+
+
+/**
+ * @brief The work for synchronizing the ESOS configuration; dump the SCST
+ * configuration to a flat file (if its loaded), then sync the configuration
+ * files to the USB drive. Runs as a background job (or directly when
+ * quitting) so it must not touch the screen.
+ */
+boolean syncConfigJob(job_t *job, void *arg) {
     char scstadmin_cmd[MAX_SHELL_CMD_LEN] = {0},
             sync_conf_cmd[MAX_SHELL_CMD_LEN] = {0};
-    char *error_msg = NULL;
-    int ret_val = 0, exit_stat = 0;
+
+    (void) arg;
+
+    /* Dump the SCST configuration to a file, if its loaded */
+    setJobProgress(job, 0, 2);
+    if (isSCSTLoaded()) {
+        snprintf(scstadmin_cmd, MAX_SHELL_CMD_LEN,
+                "%s -force -nonkey -write_config %s > /dev/null 2>&1",
+                SCSTADMIN_TOOL, SCST_CONF);
+        if (!runJobCmd(job, SCSTADMIN_TOOL, scstadmin_cmd, job->error_msg))
+            return FALSE;
+    }
+
+    /* Synchronize the ESOS configuration */
+    setJobProgress(job, 1, 2);
+    snprintf(sync_conf_cmd, MAX_SHELL_CMD_LEN, "%s > /dev/null 2>&1",
+            SYNC_CONF_TOOL);
+    if (!runJobCmd(job, SYNC_CONF_TOOL, sync_conf_cmd, job->error_msg))
+        return FALSE;
+    setJobProgress(job, 2, 2);
+    return TRUE;
+}
+
+
+/**
+ * @brief Synchronize the ESOS configuration files to the USB drive; this will
+ * also dump the SCST configuration to a flat file (before sync'ing). This is
+ * queued as a background job, unless 'foreground' is set (when quitting).
+ */
+void syncConfig(CDKSCREEN *main_cdk_screen, boolean foreground) {
+    CDKLABEL *sync_msg = 0;
+    job_t sync_job = {0};
+    int job_id = 0;
+
+    if (!foreground) {
+        job_id = submitJob("Sync. configuration", syncConfigJob, NULL, FALSE);
+        jobQueuedDialog(main_cdk_screen, job_id);
+        return;
+    }
 
     /* Display a nice short label message while we sync */
     sync_msg = newCDKLabel(main_cdk_screen, CENTER, CENTER,
@@ -823,33 +807,9 @@ void syncConfig(CDKSCREEN *main_cdk_screen) {
     setCDKLabelBoxAttribute(sync_msg, g_color_dialog_box[g_curr_theme]);
     refreshCDKScreen(main_cdk_screen);
 
-    while (1) {
-        /* Dump the SCST configuration to a file, if its loaded */
-        if (isSCSTLoaded()) {
-            snprintf(scstadmin_cmd, MAX_SHELL_CMD_LEN,
-                    "%s -force -nonkey -write_config %s > /dev/null 2>&1",
-                    SCSTADMIN_TOOL, SCST_CONF);
-            ret_val = system(scstadmin_cmd);
-            if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
-                SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR, SCSTADMIN_TOOL, exit_stat);
-                errorDialog(main_cdk_screen, error_msg, NULL);
-                FREE_NULL(error_msg);
-                break;
-            }
-        }
-
-        /* Synchronize the ESOS configuration */
-        snprintf(sync_conf_cmd, MAX_SHELL_CMD_LEN, "%s > /dev/null 2>&1",
-                SYNC_CONF_TOOL);
-        ret_val = system(sync_conf_cmd);
-        if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
-            SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR, SYNC_CONF_TOOL, exit_stat);
-            errorDialog(main_cdk_screen, error_msg, NULL);
-            FREE_NULL(error_msg);
-            break;
-        }
-        break;
-    }
+    /* Do the job's work here (it isn't in the job table) */
+    if (!syncConfigJob(&sync_job, NULL))
+        errorDialog(main_cdk_screen, sync_job.error_msg, NULL);
 
     /* Done */
     destroyCDKLabel(sync_msg);
@@ -984,7 +944,8 @@ void getFSChoice(CDKSCREEN *cdk_screen, char fs_name[], char fs_path[],
             *fs_types[MAX_FILE_SYSTEMS] = {NULL},
             *scroll_list[MAX_FILE_SYSTEMS] = {NULL};
     char *error_msg = NULL, *scroll_title = NULL;
-    char mnt_line_buffer[MAX_MNT_LINE_BUFFER] = {0};
+    char mnt_line_buffer[MAX_MNT_LINE_BUFFER] = {0},
+            mount_opts[MAX_MOUNT_OPTS_LEN] = {0};
     int i = 0, fs_cnt = 0, user_choice = 0, mnt_line_size = 0, mnt_dir_size = 0;
     boolean fs_mounted[MAX_FILE_SYSTEMS] = {FALSE};
     FILE *fstab_file = NULL, *mtab_file = NULL;
@@ -1037,10 +998,15 @@ void getFSChoice(CDKSCREEN *cdk_screen, char fs_name[], char fs_path[],
                     fs_mounted[fs_cnt] = FALSE;
                 else
                     fs_mounted[fs_cnt] = TRUE;
+                /* Show the options the kernel is actually using */
+                if (!fs_mounted[fs_cnt] ||
+                        !getMountedOpts(fstab_entry->mnt_dir, mount_opts))
+                    snprintf(mount_opts, MAX_MOUNT_OPTS_LEN,
+                            "(not mounted)");
                 SAFE_ASPRINTF(&scroll_list[fs_cnt],
-                        "<C>%-25.25s %-20.20s %-5.5s (Mounted: %d)",
+                        "<C>%-20.20s %-17.17s %-5.5s %-22.22s",
                         fs_names[fs_cnt], fs_paths[fs_cnt],
-                        fs_types[fs_cnt], fs_mounted[fs_cnt]);
+                        fs_types[fs_cnt], mount_opts);
                 fs_cnt++;
             }
         }
@@ -1094,6 +1060,66 @@ void getFSChoice(CDKSCREEN *cdk_screen, char fs_name[], char fs_path[],
 }
 
 
+/**
+ * @brief Give the user the list of mount option profiles (with the options
+ * each gives for this file system type) and have them pick one. Return
+ * FALSE if they didn't, otherwise TRUE with the mount options filled in.
+ */
+boolean getMountProfileChoice(CDKSCREEN *cdk_screen, char fs_type[],
+        char mount_opts[]) {
+    CDKSCROLL *profile_scroll = 0;
+    mount_profile_t profiles[MAX_MOUNT_PROFILES];
+    char *scroll_list[MAX_MOUNT_PROFILES] = {NULL};
+    char *scroll_title = NULL;
+    char type_opts[MAX_MOUNT_OPTS_LEN] = {0};
+    int profile_cnt = 0, user_choice = 0, i = 0;
+    boolean chosen = FALSE;
+
+    profile_cnt = readMountProfiles(profiles);
+    for (i = 0; i < profile_cnt; i++) {
+        profileMountOpts(profiles[i].options, fs_type, type_opts);
+        SAFE_ASPRINTF(&scroll_list[i], "<C>%-22.22s %-42.42s",
+                profiles[i].name, type_opts);
+    }
+
+    while (1) {
+        /* Get the profile choice */
+        SAFE_ASPRINTF(&scroll_title, "<C></%d/B>Choose a Mount Option "
+                "Profile (%s)\n", g_color_dialog_title[g_curr_theme],
+                fs_type);
+        profile_scroll = newCDKScroll(cdk_screen, CENTER, CENTER, NONE,
+                15, 70, scroll_title, scroll_list,
+                profile_cnt, FALSE, g_color_dialog_select[g_curr_theme],
+                TRUE, FALSE);
+        if (!profile_scroll) {
+            errorDialog(cdk_screen, SCROLL_ERR_MSG, NULL);
+            break;
+        }
+        setCDKScrollBoxAttribute(profile_scroll,
+                g_color_dialog_box[g_curr_theme]);
+        setCDKScrollBackgroundAttrib(profile_scroll,
+                g_color_dialog_text[g_curr_theme]);
+        user_choice = activateCDKScroll(profile_scroll, 0);
+
+        /* Check exit from widget and write the data if normal */
+        if (profile_scroll->exitType == vNORMAL) {
+            profileMountOpts(profiles[user_choice].options, fs_type,
+                    mount_opts);
+            chosen = TRUE;
+        }
+        break;
+    }
+
+    /* Done */
+    destroyCDKScroll(profile_scroll);
+    refreshCDKScreen(cdk_screen);
+    FREE_NULL(scroll_title);
+    for (i = 0; i < profile_cnt; i++)
+        FREE_NULL(scroll_list[i]);
+    return chosen;
+}
+
+
 /**
  * @brief Give the user a list of block devices (SCSI, etc.) and have them
  * select one. We return a char array with the "/dev/X" path for the chosen
@@ -1101,18 +1127,16 @@ void getFSChoice(CDKSCREEN *cdk_screen, char fs_name[], char fs_path[],
  */
 char *getBlockDevChoice(CDKSCREEN *cdk_screen) {
     CDKSCROLL *block_dev_list = 0;
-    int blk_dev_choice = 0, i = 0, dev_cnt = 0, exit_stat = 0, ret_val = 0;
+    int blk_dev_choice = 0, i = 0, dev_cnt = 0;
     char *blk_dev_scroll_lines[MAX_BLOCK_DEVS] = {NULL};
-    char *error_msg = NULL, *dev_node_ptr = NULL, *cmd_str = NULL,
+    char *error_msg = NULL, *dev_node_ptr = NULL,
             *block_dev = NULL, *scroll_title = NULL;
     static char ret_buff[MAX_SYSFS_PATH_SIZE] = {0};
     char blk_dev_name[MAX_BLOCK_DEVS][MISC_STRING_LEN] = {0, 0},
             blk_dev_info[MAX_BLOCK_DEVS][MISC_STRING_LEN] = {0, 0},
             blk_dev_size[MAX_BLOCK_DEVS][MISC_STRING_LEN] = {0, 0},
             attr_path[MAX_SYSFS_PATH_SIZE] = {0},
-            attr_value[MAX_SYSFS_ATTR_SIZE] = {0},
-            sym_links[MAX_SYSFS_ATTR_SIZE] = {0};
-    FILE *udevadm_cmd = NULL;
+            attr_value[MAX_SYSFS_ATTR_SIZE] = {0};
 
     /* Since ret_buff is re-used between calls, we reset the first character */
     ret_buff[0] = '\0';
@@ -1161,33 +1185,15 @@ char *getBlockDevChoice(CDKSCREEN *cdk_screen) {
             if ((strstr(block_dev, "/dev/sd") != NULL) ||
                     (strstr(block_dev, "/dev/md") != NULL) ||
                     (strstr(block_dev, "/dev/zd") != NULL)) {
-                /* Get a unique symbolic link to the block device */
-                SAFE_ASPRINTF(&cmd_str,
-                        "%s info --root --query symlink --name %s 2>&1",
-                        UDEVADM_BIN, block_dev);
-                udevadm_cmd = popen(cmd_str, "r");
-                fgets(sym_links, sizeof (sym_links), udevadm_cmd);
-                if ((exit_stat = pclose(udevadm_cmd)) == -1) {
-                    ret_val = -1;
-                } else {
-                    if (WIFEXITED(exit_stat))
-                        ret_val = WEXITSTATUS(exit_stat);
-                    else
-                        ret_val = -1;
-                }
-                FREE_NULL(cmd_str);
-                if (ret_val != 0) {
-                    SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR,
-                            UDEVADM_BIN, ret_val);
+                /* Get a unique symbolic link to the block device (the
+                 * device table has the udev links) */
+                if (!getDevTableLink(blk_dev_name[blk_dev_choice],
+                        ret_buff)) {
+                    SAFE_ASPRINTF(&error_msg, NO_DEV_LINK_ERR, block_dev);
                     errorDialog(cdk_screen, error_msg, NULL);
                     FREE_NULL(error_msg);
                     break;
                 }
-                /* We only want the first sym link */
-                dev_node_ptr = strtok(sym_links, " ");
-                assert(dev_node_ptr != NULL);
-                snprintf(ret_buff, MAX_SYSFS_PATH_SIZE, "%s",
-                        strStrip(dev_node_ptr));
 
             } else if ((strstr(block_dev, "/dev/dm-")) != NULL) {
                 /* A /dev/dm-* device, we're assuming its
@@ -1231,70 +1237,30 @@ char *getSCSIDevChoice(CDKSCREEN *cdk_screen, int scsi_dev_type) {
     CDKSCROLL *scsi_dev_list = 0;
     int dev_choice = 0, i = 0, dev_cnt = 0;
     char *scsi_device[MAX_SCSI_DEVICES] = {NULL},
-            *scsi_dev_rev[MAX_SCSI_DEVICES] = {NULL},
-            *scsi_dev_model[MAX_SCSI_DEVICES] = {NULL},
-            *scsi_dev_vendor[MAX_SCSI_DEVICES] = {NULL},
             *scsi_dev_info[MAX_SCSI_DEVICES] = {NULL};
-    char *error_msg = NULL, *list_title = NULL;
+    char *list_title = NULL;
     static char ret_buff[MAX_SYSFS_ATTR_SIZE] = {0};
-    char dir_name[MAX_SYSFS_PATH_SIZE] = {0},
-            tmp_buff[MAX_SYSFS_ATTR_SIZE] = {0};
-    DIR *dir_stream = NULL;
-    struct dirent *dir_entry = NULL;
+    scsi_dev_ent_t *entry = NULL;
 
     /* Since ret_buff is re-used between calls, we reset the first character */
     ret_buff[0] = '\0';
 
     while (1) {
-        /* Open the directory to get SCSI devices */
-        if ((dir_stream = opendir(SYSFS_SCSI_DEVICE)) == NULL) {
-            SAFE_ASPRINTF(&error_msg, "opendir(): %s", strerror(errno));
-            errorDialog(cdk_screen, error_msg, NULL);
-            FREE_NULL(error_msg);
-            break;
-        }
-
-        /* Loop over each entry in the directory (SCSI devices) */
-        while ((dir_entry = readdir(dir_stream)) != NULL) {
-            if (dir_entry->d_type == DT_LNK && dev_cnt < MAX_SCSI_DEVICES) {
-                /* We only want devices that match the given type */
-                snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/device/type",
-                        SYSFS_SCSI_DEVICE, dir_entry->d_name);
-                readAttribute(dir_name, tmp_buff);
-                if ((atoi(tmp_buff)) == scsi_dev_type) {
-                    SAFE_ASPRINTF(&scsi_device[dev_cnt], "%s",
-                            dir_entry->d_name);
-                    dev_cnt++;
-                }
-            }
-        }
-
-        /* Close the directory stream */
-        closedir(dir_stream);
-
-        /* Loop over our list of SCSI devices and get some attributes */
-        while (i < dev_cnt) {
-            if (i < MAX_SCSI_DEVICES) {
-                snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/device/model",
-                        SYSFS_SCSI_DEVICE, scsi_device[i]);
-                readAttribute(dir_name, tmp_buff);
-                SAFE_ASPRINTF(&scsi_dev_model[i], "%s", tmp_buff);
-                snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/device/vendor",
-                        SYSFS_SCSI_DEVICE, scsi_device[i]);
-                readAttribute(dir_name, tmp_buff);
-                SAFE_ASPRINTF(&scsi_dev_vendor[i], "%s", tmp_buff);
-                snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/device/rev",
-                        SYSFS_SCSI_DEVICE, scsi_device[i]);
-                readAttribute(dir_name, tmp_buff);
-                SAFE_ASPRINTF(&scsi_dev_rev[i], "%s", tmp_buff);
-                /* Fill the list (pretty) for our CDK label with SCSI devices */
-                SAFE_ASPRINTF(&scsi_dev_info[i], "<C>[%s] %s %s %s",
-                        scsi_device[i], scsi_dev_vendor[i], scsi_dev_model[i],
-                        scsi_dev_rev[i]);
-                /* Next */
-                i++;
-            }
+        /* Fill the list (pretty) for our CDK label with the SCSI devices that
+         * match the given type (from the device table) */
+        readyDevTable();
+        pthread_mutex_lock(&g_dev_table_mutex);
+        for (i = 0; (i < g_dev_table.scsi_cnt) &&
+                (dev_cnt < MAX_SCSI_DEVICES); i++) {
+            entry = &g_dev_table.scsi_devs[i];
+            if (entry->type != scsi_dev_type)
+                continue;
+            SAFE_ASPRINTF(&scsi_device[dev_cnt], "%s", entry->hctl);
+            SAFE_ASPRINTF(&scsi_dev_info[dev_cnt], "<C>[%s] %s %s %s",
+                    entry->hctl, entry->vendor, entry->model, entry->rev);
+            dev_cnt++;
         }
+        pthread_mutex_unlock(&g_dev_table_mutex);
 
         /* Make sure we actually have something to present */
         if (dev_cnt == 0) {
@@ -1330,9 +1296,6 @@ char *getSCSIDevChoice(CDKSCREEN *cdk_screen, int scsi_dev_type) {
     FREE_NULL(list_title);
     for (i = 0; i < MAX_SCSI_DEVICES; i++) {
         FREE_NULL(scsi_device[i]);
-        FREE_NULL(scsi_dev_rev[i]);
-        FREE_NULL(scsi_dev_model[i]);
-        FREE_NULL(scsi_dev_vendor[i]);
         FREE_NULL(scsi_dev_info[i]);
     }
     if (ret_buff[0] != '\0')
@@ -2121,3 +2084,364 @@ int getBlockDevSelection(CDKSCREEN *cdk_screen,
     else
         return -1;
 }
+
+
+/**
+ * @brief Present the user with a list of SCST devices and let them select
+ * any number of them. We fill the char array with the selected device names
+ * and return how many were selected; return -1 if there was an error or
+ * escape (or nothing was selected).
+ */
+int getSCSTDevSelection(CDKSCREEN *cdk_screen,
+        char dev_list[MAX_SCST_DEVS][MISC_STRING_LEN]) {
+    CDKSELECTION *scst_dev_select = 0;
+    int i = 0, j = 0, chosen_dev_cnt = 0;
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    char *scst_dev_name[MAX_SCST_DEVS] = {NULL},
+            *selection_list[MAX_SCST_DEVS] = {NULL};
+    char *select_title = NULL, *error_msg = NULL;
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0};
+    boolean finished = FALSE, user_quit = FALSE;
+    struct timespec prof_start = {0};
+
+    while (1) {
+        /* Loop over each SCST handler type and grab any open device names */
+        startProfile(&prof_start);
+        for (i = 0; i < (int)g_scst_handlers_size(); i++) {
+            /* Open the directory */
+            snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s",
+                    SYSFS_SCST_TGT, g_scst_handlers[i]);
+            if ((dir_stream = opendir(dir_name)) == NULL) {
+                SAFE_ASPRINTF(&error_msg, "opendir(): %s", strerror(errno));
+                errorDialog(cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                finished = TRUE;
+                break;
+            }
+
+            /* Loop over each entry in the directory */
+            while ((dir_entry = readdir(dir_stream)) != NULL) {
+                if (dir_entry->d_type == DT_LNK) {
+                    if (j < MAX_SCST_DEVS) {
+                        SAFE_ASPRINTF(&scst_dev_name[j], "%s",
+                                dir_entry->d_name);
+                        SAFE_ASPRINTF(&selection_list[j],
+                                "<C>%-20.20s (Handler: %s)",
+                                dir_entry->d_name, g_scst_handlers[i]);
+                        j++;
+                    }
+                }
+            }
+
+            /* Close the directory stream */
+            closedir(dir_stream);
+        }
+        if (finished)
+            break;
+        endProfile("sysfs walk: SCST devices", &prof_start);
+
+        /* Make sure we actually have something to present */
+        if (j == 0) {
+            errorDialog(cdk_screen, "No devices found!", NULL);
+            break;
+        }
+
+        /* Selection widget for SCST devices */
+        SAFE_ASPRINTF(&select_title, "<C></%d/B>Select SCST Devices\n",
+                g_color_dialog_title[g_curr_theme]);
+        scst_dev_select = newCDKSelection(cdk_screen, CENTER, CENTER, NONE,
+                15, 60, select_title, selection_list, j,
+                g_choice_char, 2, g_color_dialog_select[g_curr_theme],
+                TRUE, FALSE);
+        if (!scst_dev_select) {
+            errorDialog(cdk_screen, SELECTION_ERR_MSG, NULL);
+            break;
+        }
+        setCDKSelectionBoxAttribute(scst_dev_select,
+                g_color_dialog_box[g_curr_theme]);
+        setCDKSelectionBackgroundAttrib(scst_dev_select,
+                g_color_dialog_text[g_curr_theme]);
+
+        /* Activate the widget */
+        activateCDKSelection(scst_dev_select, 0);
+
+        /* User hit escape, so we get out of this */
+        if (scst_dev_select->exitType == vESCAPE_HIT) {
+            user_quit = TRUE;
+            destroyCDKSelection(scst_dev_select);
+            refreshCDKScreen(cdk_screen);
+            break;
+
+        /* User hit return/tab so we can continue on
+         * and get what was selected */
+        } else if (scst_dev_select->exitType == vNORMAL) {
+            chosen_dev_cnt = 0;
+            for (i = 0; i < j; i++) {
+                if (scst_dev_select->selections[i] == 1) {
+                    snprintf(dev_list[chosen_dev_cnt], MISC_STRING_LEN,
+                            "%s", scst_dev_name[i]);
+                    chosen_dev_cnt++;
+                }
+            }
+            destroyCDKSelection(scst_dev_select);
+            refreshCDKScreen(cdk_screen);
+        }
+
+        /* Check and make sure some devices were actually selected */
+        if (chosen_dev_cnt == 0) {
+            errorDialog(cdk_screen, "No SCST devices selected!", NULL);
+            break;
+        }
+        break;
+    }
+
+    /* Done */
+    FREE_NULL(select_title);
+    for (i = 0; i < MAX_SCST_DEVS; i++) {
+        FREE_NULL(scst_dev_name[i]);
+        FREE_NULL(selection_list[i]);
+    }
+    if (!user_quit && chosen_dev_cnt > 0)
+        return chosen_dev_cnt;
+    else
+        return -1;
+}
+
+
+/**
+ * @brief Present the user with a list of LUN destinations (every target's
+ * default LUNs, and each of its groups) for all of the SCST targets, and let
+ * them select any number of them. We fill the char arrays with the "luns"
+ * directory and a description of each selected destination, and return how
+ * many were selected; return -1 if there was an error or escape (or nothing
+ * was selected).
+ */
+int getSCSTDestSelection(CDKSCREEN *cdk_screen,
+        char dest_luns[MAX_MAP_DESTS][MAX_SYSFS_PATH_SIZE],
+        char dest_desc[MAX_MAP_DESTS][MISC_STRING_LEN]) {
+    CDKSELECTION *dest_select = 0;
+    int i = 0, j = 0, driver_cnt = 0, chosen_dest_cnt = 0;
+    DIR *tgt_dir_stream = NULL, *group_dir_stream = NULL;
+    struct dirent *tgt_dir_entry = NULL, *group_dir_entry = NULL;
+    char *luns_list[MAX_MAP_DESTS] = {NULL}, *desc_list[MAX_MAP_DESTS] = {NULL},
+            *selection_list[MAX_MAP_DESTS] = {NULL};
+    char *select_title = NULL, *error_msg = NULL;
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0};
+    char drivers[MAX_SCST_DRIVERS][MISC_STRING_LEN] = {{0}, {0}};
+    boolean finished = FALSE, user_quit = FALSE;
+    struct timespec prof_start = {0};
+
+    while (1) {
+        /* Get a list of the target drivers */
+        startProfile(&prof_start);
+        if (!listSCSTTgtDrivers(drivers, &driver_cnt)) {
+            errorDialog(cdk_screen, TGT_DRIVERS_ERR, NULL);
+            break;
+        }
+
+        /* Loop over each SCST target driver and get targets */
+        for (i = 0; i < driver_cnt; i++) {
+            snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/targets/%s",
+                    SYSFS_SCST_TGT, drivers[i]);
+            if ((tgt_dir_stream = opendir(dir_name)) == NULL) {
+                SAFE_ASPRINTF(&error_msg, "opendir(): %s", strerror(errno));
+                errorDialog(cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                finished = TRUE;
+                break;
+            }
+            while ((tgt_dir_entry = readdir(tgt_dir_stream)) != NULL) {
+                /* The target names are directories; skip '.' and '..' */
+                if ((tgt_dir_entry->d_type != DT_DIR) ||
+                        (strcmp(tgt_dir_entry->d_name, ".") == 0) ||
+                        (strcmp(tgt_dir_entry->d_name, "..") == 0))
+                    continue;
+
+                /* The default LUNs for the target */
+                if (j < MAX_MAP_DESTS) {
+                    SAFE_ASPRINTF(&luns_list[j], "%s/targets/%s/%s/luns",
+                            SYSFS_SCST_TGT, drivers[i], tgt_dir_entry->d_name);
+                    SAFE_ASPRINTF(&desc_list[j], "%s (Default)",
+                            tgt_dir_entry->d_name);
+                    SAFE_ASPRINTF(&selection_list[j], "<C>%-36.36s %-8.8s %s",
+                            tgt_dir_entry->d_name, drivers[i], "(Default)");
+                    j++;
+                }
+
+                /* Each group for the target */
+                snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
+                        "%s/targets/%s/%s/ini_groups", SYSFS_SCST_TGT,
+                        drivers[i], tgt_dir_entry->d_name);
+                if ((group_dir_stream = opendir(dir_name)) == NULL)
+                    continue;
+                while ((group_dir_entry = readdir(group_dir_stream)) != NULL) {
+                    /* The group names are directories; skip '.' and '..' */
+                    if ((group_dir_entry->d_type == DT_DIR) &&
+                            (strcmp(group_dir_entry->d_name, ".") != 0) &&
+                            (strcmp(group_dir_entry->d_name, "..") != 0) &&
+                            (j < MAX_MAP_DESTS)) {
+                        SAFE_ASPRINTF(&luns_list[j],
+                                "%s/targets/%s/%s/ini_groups/%s/luns",
+                                SYSFS_SCST_TGT, drivers[i],
+                                tgt_dir_entry->d_name, group_dir_entry->d_name);
+                        SAFE_ASPRINTF(&desc_list[j], "%s (%s)",
+                                tgt_dir_entry->d_name, group_dir_entry->d_name);
+                        SAFE_ASPRINTF(&selection_list[j],
+                                "<C>%-36.36s %-8.8s %s", tgt_dir_entry->d_name,
+                                drivers[i], group_dir_entry->d_name);
+                        j++;
+                    }
+                }
+                closedir(group_dir_stream);
+            }
+            closedir(tgt_dir_stream);
+        }
+        if (finished)
+            break;
+        endProfile("sysfs walk: targets / groups", &prof_start);
+
+        /* Make sure we actually have something to present */
+        if (j == 0) {
+            errorDialog(cdk_screen, "No targets found!", NULL);
+            break;
+        }
+
+        /* Selection widget for the destinations */
+        SAFE_ASPRINTF(&select_title, "<C></%d/B>Select Targets / Groups\n",
+                g_color_dialog_title[g_curr_theme]);
+        dest_select = newCDKSelection(cdk_screen, CENTER, CENTER, NONE,
+                15, 72, select_title, selection_list, j,
+                g_choice_char, 2, g_color_dialog_select[g_curr_theme],
+                TRUE, FALSE);
+        if (!dest_select) {
+            errorDialog(cdk_screen, SELECTION_ERR_MSG, NULL);
+            break;
+        }
+        setCDKSelectionBoxAttribute(dest_select,
+                g_color_dialog_box[g_curr_theme]);
+        setCDKSelectionBackgroundAttrib(dest_select,
+                g_color_dialog_text[g_curr_theme]);
+
+        /* Activate the widget */
+        activateCDKSelection(dest_select, 0);
+
+        /* User hit escape, so we get out of this */
+        if (dest_select->exitType == vESCAPE_HIT) {
+            user_quit = TRUE;
+            destroyCDKSelection(dest_select);
+            refreshCDKScreen(cdk_screen);
+            break;
+
+        /* User hit return/tab so we can continue on
+         * and get what was selected */
+        } else if (dest_select->exitType == vNORMAL) {
+            chosen_dest_cnt = 0;
+            for (i = 0; i < j; i++) {
+                if (dest_select->selections[i] == 1) {
+                    snprintf(dest_luns[chosen_dest_cnt], MAX_SYSFS_PATH_SIZE,
+                            "%s", luns_list[i]);
+                    snprintf(dest_desc[chosen_dest_cnt], MISC_STRING_LEN,
+                            "%s", desc_list[i]);
+                    chosen_dest_cnt++;
+                }
+            }
+            destroyCDKSelection(dest_select);
+            refreshCDKScreen(cdk_screen);
+        }
+
+        /* Check and make sure something was actually selected */
+        if (chosen_dest_cnt == 0) {
+            errorDialog(cdk_screen, "No targets or groups selected!", NULL);
+            break;
+        }
+        break;
+    }
+
+    /* Done */
+    FREE_NULL(select_title);
+    for (i = 0; i < MAX_MAP_DESTS; i++) {
+        FREE_NULL(luns_list[i]);
+        FREE_NULL(desc_list[i]);
+        FREE_NULL(selection_list[i]);
+    }
+    if (!user_quit && chosen_dest_cnt > 0)
+        return chosen_dest_cnt;
+    else
+        return -1;
+}
+
+
+/**
+ * @brief Show the results of a (run) SCST management batch; if everything
+ * worked we just say so, otherwise each operation that failed (or was
+ * cancelled since something it depends on failed) is listed with its error.
+ */
+void mgmtBatchDialog(CDKSCREEN *screen, mgmt_batch_t *batch, char *title) {
+    CDKSWINDOW *result_info = 0;
+    char *swindow_title = NULL, *summary_msg = NULL;
+    row_arena_t result_rows = {0};
+    int i = 0;
+
+    /* Nothing failed, so keep it short */
+    if (batch->failed == 0) {
+        SAFE_ASPRINTF(&summary_msg, MGMT_BATCH_OK_MSG, batch->cnt);
+        informDialog(screen, summary_msg, NULL);
+        FREE_NULL(summary_msg);
+        return;
+    }
+
+    /* The failed operations are formatted into one set of buffers */
+    if (!initRowArena(&result_rows, MAX_MGMT_RESULT_LINES,
+            MGMT_RESULT_ROW_SIZE)) {
+        errorDialog(screen, ROW_ARENA_ERR_MSG, NULL);
+        return;
+    }
+    addArenaRow(&result_rows, MGMT_BATCH_FAIL_MSG, batch->failed,
+            batch->cnt);
+    addArenaRow(&result_rows, " ");
+    for (i = 0; i < batch->cnt; i++) {
+        /* Leave room for the closing message */
+        if (result_rows.used >= (MAX_MGMT_RESULT_LINES - 4))
+            break;
+        if (batch->ops[i].status == 0)
+            continue;
+        addArenaRow(&result_rows, "</B>%s<!B> (%s)", batch->ops[i].value,
+                batch->ops[i].path);
+        addArenaRow(&result_rows, "    %s", strerror(batch->ops[i].status));
+    }
+    addArenaRow(&result_rows, " ");
+    addArenaRow(&result_rows, "%s", CONTINUE_MSG);
+
+    /* Setup scrolling window widget */
+    SAFE_ASPRINTF(&swindow_title, "<C></%d/B>%s\n",
+            g_color_dialog_title[g_curr_theme], title);
+    result_info = newCDKSwindow(screen, CENTER, CENTER,
+            (MGMT_RESULT_ROWS + 2), (MGMT_RESULT_COLS + 2),
+            swindow_title, MAX_MGMT_RESULT_LINES, TRUE, FALSE);
+    if (!result_info) {
+        errorDialog(screen, SWINDOW_ERR_MSG, NULL);
+        FREE_NULL(swindow_title);
+        freeRowArena(&result_rows);
+        return;
+    }
+    setCDKSwindowBackgroundAttrib(result_info,
+            g_color_dialog_text[g_curr_theme]);
+    setCDKSwindowBoxAttribute(result_info, g_color_dialog_box[g_curr_theme]);
+
+    /* Set the scrolling window content */
+    setCDKSwindowContents(result_info, result_rows.lines, result_rows.used);
+
+    /* The 'g' makes the swindow widget scroll to the top, then activate */
+    injectCDKSwindow(result_info, 'g');
+    activateCDKSwindow(result_info, 0);
+
+    /* We fell through -- the user exited the widget, but we don't care how */
+    destroyCDKSwindow(result_info);
+    refreshCDKScreen(screen);
+
+    /* Done */
+    FREE_NULL(swindow_title);
+    freeRowArena(&result_rows);
+    return;
+}
@@ -13,6 +13,7 @@
 #include <cdk.h>
 #include <syslog.h>
 #include <assert.h>
+#include <fcntl.h>
 
 #include "prototypes.h"
 #include "system.h"
@@ -30,14 +31,24 @@ void devInfoDialog(CDKSCREEN *main_cdk_screen) {
             dir_name[MAX_SYSFS_PATH_SIZE] = {0},
             tmp_buff[MAX_SYSFS_ATTR_SIZE] = {0};
     char *swindow_info[MAX_DEV_INFO_LINES] = {NULL};
-    char *swindow_title = NULL;
-    int i = 0, line_cnt = 0;
+    char *swindow_title = NULL, *error_msg = NULL;
+    int i = 0, line_cnt = 0, dev_fd = -1;
 
     /* Have the user choose a SCST device */
     getSCSTDevChoice(main_cdk_screen, scst_dev, scst_hndlr);
     if (scst_dev[0] == '\0' || scst_hndlr[0] == '\0')
         return;
 
+    /* The attributes are all read relative to the device directory */
+    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s",
+            SYSFS_SCST_TGT, scst_hndlr, scst_dev);
+    if ((dev_fd = openDirAt(AT_FDCWD, dir_name)) == -1) {
+        SAFE_ASPRINTF(&error_msg, "openat(): %s", strerror(errno));
+        errorDialog(main_cdk_screen, error_msg, NULL);
+        FREE_NULL(error_msg);
+        return;
+    }
+
     /* Setup scrolling window widget */
     SAFE_ASPRINTF(&swindow_title, "<C></%d/B>SCST Device Information\n",
             g_color_dialog_title[g_curr_theme]);
@@ -46,6 +57,7 @@ void devInfoDialog(CDKSCREEN *main_cdk_screen) {
             MAX_DEV_INFO_LINES, TRUE, FALSE);
     if (!dev_info) {
         errorDialog(main_cdk_screen, SWINDOW_ERR_MSG, NULL);
+        close(dev_fd);
         return;
     }
     setCDKSwindowBackgroundAttrib(dev_info, g_color_dialog_text[g_curr_theme]);
@@ -55,115 +67,69 @@ void devInfoDialog(CDKSCREEN *main_cdk_screen) {
     SAFE_ASPRINTF(&swindow_info[0], "</B>Device Name:<!B>\t\t%s", scst_dev);
     SAFE_ASPRINTF(&swindow_info[1], "</B>Device Handler:<!B>\t\t%s",
             scst_hndlr);
-    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/threads_num",
-            SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-    readAttribute(dir_name, tmp_buff);
+    readAttributeAt(dev_fd, "threads_num", tmp_buff);
     SAFE_ASPRINTF(&swindow_info[2], "</B>Number of Threads:<!B>\t%s", tmp_buff);
-    snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-            "%s/handlers/%s/%s/threads_pool_type",
-            SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-    readAttribute(dir_name, tmp_buff);
+    readAttributeAt(dev_fd, "threads_pool_type", tmp_buff);
     SAFE_ASPRINTF(&swindow_info[3], "</B>Threads Pool Type:<!B>\t%s", tmp_buff);
-    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/type",
-            SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-    readAttribute(dir_name, tmp_buff);
+    readAttributeAt(dev_fd, "type", tmp_buff);
     SAFE_ASPRINTF(&swindow_info[4], "</B>SCSI Type:<!B>\t\t%s", tmp_buff);
     SAFE_ASPRINTF(&swindow_info[5], " ");
     line_cnt = 6;
 
     /* Some extra attributes for certain device handlers */
     if (strcmp(scst_hndlr, "vcdrom") == 0) {
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/filename",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "filename", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[6], "</B>Filename:<!B>\t%s", tmp_buff);
         line_cnt = 7;
 
     } else if (strcmp(scst_hndlr, "vdisk_blockio") == 0) {
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/filename",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "filename", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[6], "</B>Filename:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/blocksize",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "blocksize", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[7], "</B>Block Size:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/nv_cache",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "nv_cache", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[8], "</B>NV Cache:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/read_only",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "read_only", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[9], "</B>Read Only:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/removable",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "removable", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[10], "</B>Removable:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/rotational",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "rotational", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[11], "</B>Rotational:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                "%s/handlers/%s/%s/write_through",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "write_through", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[12], "</B>Write Through:<!B>\t%s",
                 tmp_buff);
         line_cnt = 13;
 
     } else if (strcmp(scst_hndlr, "vdisk_fileio") == 0) {
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/filename",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "filename", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[6], "</B>Filename:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/blocksize",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "blocksize", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[7], "</B>Block Size:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/nv_cache",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "nv_cache", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[8], "</B>NV Cache:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/read_only",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "read_only", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[9], "</B>Read Only:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/removable",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "removable", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[10], "</B>Removable:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/rotational",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "rotational", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[11], "</B>Rotational:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                "%s/handlers/%s/%s/write_through",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "write_through", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[12], "</B>Write Through:<!B>\t%s",
                 tmp_buff);
         line_cnt = 13;
 
     } else if (strcmp(scst_hndlr, "vdisk_nullio") == 0) {
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/blocksize",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "blocksize", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[6], "</B>Block Size:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/read_only",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "read_only", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[7], "</B>Read Only:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/removable",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "removable", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[8], "</B>Removable:<!B>\t%s", tmp_buff);
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s/%s/rotational",
-                SYSFS_SCST_TGT, scst_hndlr, scst_dev);
-        readAttribute(dir_name, tmp_buff);
+        readAttributeAt(dev_fd, "rotational", tmp_buff);
         SAFE_ASPRINTF(&swindow_info[9], "</B>Rotational:<!B>\t%s", tmp_buff);
         line_cnt = 10;
     }
+    close(dev_fd);
 
     /* Add a message to the bottom explaining how to close the dialog */
     if (line_cnt < MAX_DEV_INFO_LINES) {
@@ -1079,45 +1045,50 @@ void remDeviceDialog(CDKSCREEN *main_cdk_screen) {
 
 
 /**
- * @brief Run the "Map to Group" dialog.
+ * @brief Run the "Map to Group" dialog. Any number of SCST devices can be
+ * mapped to any number of targets/groups at once; the LUNs are assigned
+ * automatically and the writes are issued as one batch.
  */
 void mapDeviceDialog(CDKSCREEN *main_cdk_screen) {
     CDKSCREEN *map_screen = 0;
     CDKRADIO *read_only = 0;
-    CDKSCALE *lun = 0;
     CDKLABEL *map_info = 0;
     CDKBUTTON *ok_button = 0, *cancel_button = 0;
     tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
     WINDOW *map_window = 0;
-    char scst_dev[MAX_SYSFS_ATTR_SIZE] = {0},
-            scst_hndlr[MAX_SYSFS_ATTR_SIZE] = {0},
-            scst_tgt[MAX_SYSFS_ATTR_SIZE] = {0},
-            tgt_driver[MAX_SYSFS_ATTR_SIZE] = {0},
-            group_name[MAX_SYSFS_ATTR_SIZE] = {0},
-            attr_path[MAX_SYSFS_PATH_SIZE] = {0},
-            attr_value[MAX_SYSFS_ATTR_SIZE] = {0};
-    char *error_msg = NULL;
+    char scst_devs[MAX_SCST_DEVS][MISC_STRING_LEN] = {{0}, {0}},
+            dest_luns[MAX_MAP_DESTS][MAX_SYSFS_PATH_SIZE] = {{0}, {0}},
+            dest_desc[MAX_MAP_DESTS][MISC_STRING_LEN] = {{0}, {0}},
+            attr_path[MAX_SYSFS_PATH_SIZE] = {0};
     char *map_info_msg[MAP_DEV_INFO_LINES] = {NULL};
+    int luns[MAX_SCST_DEVS] = {0};
     int map_window_lines = 0, map_window_cols = 0, window_y = 0, window_x = 0,
-            temp_int = 0, i = 0, traverse_ret = 0;
+            i = 0, j = 0, traverse_ret = 0, dev_cnt = 0, dest_cnt = 0;
+    mgmt_batch_t map_batch;
+    boolean batch_ready = FALSE;
 
-    /* Have the user choose a SCST device to map */
-    getSCSTDevChoice(main_cdk_screen, scst_dev, scst_hndlr);
-    if (scst_dev[0] == '\0' || scst_hndlr[0] == '\0')
+    /* Have the user select the SCST devices to map */
+    if ((dev_cnt = getSCSTDevSelection(main_cdk_screen, scst_devs)) == -1)
         return;
 
-    /* Have the user choose a SCST target */
-    getSCSTTgtChoice(main_cdk_screen, scst_tgt, tgt_driver);
-    if (scst_tgt[0] == '\0' || tgt_driver[0] == '\0')
+    /* Have the user select the targets/groups to map them to */
+    if ((dest_cnt = getSCSTDestSelection(main_cdk_screen, dest_luns,
+            dest_desc)) == -1)
         return;
 
-    /* Get group choice from user (based on previously selected target) */
-    getSCSTGroupChoice(main_cdk_screen, scst_tgt, tgt_driver, group_name);
-    if (group_name[0] == '\0')
+    /* Each device gets the lowest LUN that is free in every destination */
+    if ((i = findFreeLUNs(dest_luns, dest_cnt, dev_cnt, luns)) == -1) {
+        errorDialog(main_cdk_screen, "Couldn't read the existing LUNs for "
+                "the selected targets/groups.", NULL);
         return;
+    } else if (i < dev_cnt) {
+        errorDialog(main_cdk_screen, "There aren't enough free LUNs for the "
+                "selected devices.", NULL);
+        return;
+    }
 
     /* New CDK screen */
-    map_window_lines = 18;
+    map_window_lines = 16;
     map_window_cols = 50;
     window_y = ((LINES / 2) - (map_window_lines / 2));
     window_x = ((COLS / 2) - (map_window_cols / 2));
@@ -1137,15 +1108,22 @@ void mapDeviceDialog(CDKSCREEN *main_cdk_screen) {
 
     while (1) {
         /* Information label */
-        SAFE_ASPRINTF(&map_info_msg[0], "</%d/B>Mapping SCST device...",
+        SAFE_ASPRINTF(&map_info_msg[0], "</%d/B>Mapping SCST devices...",
                 g_color_dialog_title[g_curr_theme]);
         SAFE_ASPRINTF(&map_info_msg[1], " ");
-        SAFE_ASPRINTF(&map_info_msg[2], "</B>Device:<!B>\t\t%s", scst_dev);
-        SAFE_ASPRINTF(&map_info_msg[3], "</B>Handler:<!B>\t%s", scst_hndlr);
+        SAFE_ASPRINTF(&map_info_msg[2], "</B>Devices:<!B>\t%d (%.20s%s)",
+                dev_cnt, scst_devs[0], ((dev_cnt > 1) ? ", ..." : ""));
+        SAFE_ASPRINTF(&map_info_msg[3], "</B>Targets:<!B>\t%d (%.20s%s)",
+                dest_cnt, dest_desc[0], ((dest_cnt > 1) ? ", ..." : ""));
         SAFE_ASPRINTF(&map_info_msg[4], " ");
-        SAFE_ASPRINTF(&map_info_msg[5], "</B>Target:<!B>\t%s", scst_tgt);
-        SAFE_ASPRINTF(&map_info_msg[6], "</B>Driver:<!B>\t%s", tgt_driver);
-        SAFE_ASPRINTF(&map_info_msg[7], "</B>Group:<!B>\t%s", group_name);
+        if (dev_cnt > 1)
+            SAFE_ASPRINTF(&map_info_msg[5], "</B>LUNs:<!B>\t\t%d to %d",
+                    luns[0], luns[dev_cnt - 1]);
+        else
+            SAFE_ASPRINTF(&map_info_msg[5], "</B>LUN:<!B>\t\t%d", luns[0]);
+        SAFE_ASPRINTF(&map_info_msg[6], "(Lowest LUNs free in all of the "
+                "targets/groups)");
+        SAFE_ASPRINTF(&map_info_msg[7], " ");
         map_info = newCDKLabel(map_screen, (window_x + 1), (window_y + 1),
                 map_info_msg, MAP_DEV_INFO_LINES, FALSE, FALSE);
         if (!map_info) {
@@ -1155,19 +1133,8 @@ void mapDeviceDialog(CDKSCREEN *main_cdk_screen) {
         setCDKLabelBackgroundAttrib(map_info,
                 g_color_dialog_text[g_curr_theme]);
 
-        /* LUN widget (scale) */
-        lun = newCDKScale(map_screen, (window_x + 1), (window_y + 10),
-                NULL, "</B>Logical Unit Number (LUN)",
-                g_color_dialog_select[g_curr_theme],
-                5, 0, MIN_SCST_LUN_VAL, MAX_SCST_LUN_VAL, 1, 10, FALSE, FALSE);
-        if (!lun) {
-            errorDialog(main_cdk_screen, SCALE_ERR_MSG, NULL);
-            break;
-        }
-        setCDKScaleBackgroundAttrib(lun, g_color_dialog_text[g_curr_theme]);
-
         /* Read only widget (radio) */
-        read_only = newCDKRadio(map_screen, (window_x + 1), (window_y + 12),
+        read_only = newCDKRadio(map_screen, (window_x + 1), (window_y + 10),
                 NONE, 3, 10, "</B>Read Only", g_no_yes_opts, 2,
                 '#' | g_color_dialog_select[g_curr_theme], 1,
                 g_color_dialog_select[g_curr_theme], FALSE, FALSE);
@@ -1180,7 +1147,7 @@ void mapDeviceDialog(CDKSCREEN *main_cdk_screen) {
         setCDKRadioCurrentItem(read_only, 0);
 
         /* Buttons */
-        ok_button = newCDKButton(map_screen, (window_x + 16), (window_y + 16),
+        ok_button = newCDKButton(map_screen, (window_x + 16), (window_y + 14),
                 g_ok_cancel_msg[0], ok_cb, FALSE, FALSE);
         if (!ok_button) {
             errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
@@ -1189,7 +1156,7 @@ void mapDeviceDialog(CDKSCREEN *main_cdk_screen) {
         setCDKButtonBackgroundAttrib(ok_button,
                 g_color_dialog_input[g_curr_theme]);
         cancel_button = newCDKButton(map_screen, (window_x + 26),
-                (window_y + 16), g_ok_cancel_msg[1], cancel_cb, FALSE, FALSE);
+                (window_y + 14), g_ok_cancel_msg[1], cancel_cb, FALSE, FALSE);
         if (!cancel_button) {
             errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
             break;
@@ -1206,24 +1173,38 @@ void mapDeviceDialog(CDKSCREEN *main_cdk_screen) {
             /* Turn the cursor off (pretty) */
             curs_set(0);
 
-            /* Add the new LUN (map device) */
-            snprintf(attr_path, MAX_SYSFS_PATH_SIZE,
-                    "%s/targets/%s/%s/ini_groups/%s/luns/mgmt",
-                    SYSFS_SCST_TGT, tgt_driver, scst_tgt, group_name);
-            snprintf(attr_value, MAX_SYSFS_ATTR_SIZE, "add %s %d read_only=%d",
-                    scst_dev, getCDKScaleValue(lun),
-                    getCDKRadioSelectedItem(read_only));
-            if ((temp_int = writeAttribute(attr_path, attr_value)) != 0) {
-                SAFE_ASPRINTF(&error_msg, "Couldn't map SCST device: %s",
-                        strerror(temp_int));
-                errorDialog(main_cdk_screen, error_msg, NULL);
-                FREE_NULL(error_msg);
+            /* Add the new LUNs (map the devices); it's all one batch */
+            if (!initMgmtBatch(&map_batch)) {
+                errorDialog(main_cdk_screen, MGMT_BATCH_ERR, NULL);
+                break;
+            }
+            batch_ready = TRUE;
+            for (i = 0; i < dest_cnt; i++) {
+                snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/mgmt",
+                        dest_luns[i]);
+                for (j = 0; j < dev_cnt; j++) {
+                    if (addMgmtOp(&map_batch, MGMT_OP_NO_DEP, attr_path,
+                            "add %s %d read_only=%d", scst_devs[j], luns[j],
+                            getCDKRadioSelectedItem(read_only)) == -1) {
+                        errorDialog(main_cdk_screen, MGMT_BATCH_ERR, NULL);
+                        break;
+                    }
+                }
+                if (j < dev_cnt)
+                    break;
             }
+            if (i < dest_cnt)
+                break;
+            runMgmtBatch(&map_batch);
+            mgmtBatchDialog(main_cdk_screen, &map_batch,
+                    "Map SCST Devices Results");
         }
         break;
     }
 
     /* All done */
+    if (batch_ready)
+        freeMgmtBatch(&map_batch);
     for (i = 0; i < MAP_DEV_INFO_LINES; i++)
         FREE_NULL(map_info_msg[i]);
     if (map_screen != NULL) {
@@ -1294,22 +1275,23 @@ void unmapDeviceDialog(CDKSCREEN *main_cdk_screen) {
 void lunLayoutDialog(CDKSCREEN *main_cdk_screen) {
     CDKSWINDOW *lun_info = 0;
     char *swindow_title = NULL;
-    char *swindow_info[MAX_LUN_LAYOUT_LINES] = {NULL};
-    int i = 0, line_pos = 0, dev_path_size = 0, driver_cnt = 0;
-    char dir_name[MAX_SYSFS_PATH_SIZE] = {0},
-            link_path[MAX_SYSFS_PATH_SIZE] = {0},
-            dev_path[MAX_SYSFS_PATH_SIZE] = {0};
-    char tgt_drivers[MAX_SCST_DRIVERS][MISC_STRING_LEN] = {{0}, {0}};
-    DIR *tgt_dir_stream = NULL, *group_dir_stream = NULL,
-            *init_dir_stream = NULL, *lun_dir_stream = NULL;
-    struct dirent *tgt_dir_entry = NULL, *group_dir_entry = NULL,
-            *init_dir_entry = NULL, *lun_dir_entry = NULL;
-
-    /* Fill the array with current SCST target drivers */
-    if (!listSCSTTgtDrivers(tgt_drivers, &driver_cnt)) {
+    row_arena_t lun_rows = {0};
+    struct timespec prof_start = {0};
+
+    /* The rows are formatted into one set of buffers */
+    if (!initRowArena(&lun_rows, MAX_LUN_LAYOUT_LINES, LUN_LAYOUT_ROW_SIZE)) {
+        errorDialog(main_cdk_screen, ROW_ARENA_ERR_MSG, NULL);
+        return;
+    }
+
+    /* Walk the SCST targets, groups, initiators and LUNs */
+    startProfile(&prof_start);
+    if (readLUNLayout(&lun_rows) == -1) {
         errorDialog(main_cdk_screen, TGT_DRIVERS_ERR, NULL);
+        freeRowArena(&lun_rows);
         return;
     }
+    endProfile("sysfs walk: LUN layout", &prof_start);
 
     /* Setup scrolling window widget */
     SAFE_ASPRINTF(&swindow_title, "<C></%d/B>SCST LUN/Group Layout\n",
@@ -1319,161 +1301,19 @@ void lunLayoutDialog(CDKSCREEN *main_cdk_screen) {
             swindow_title, MAX_LUN_LAYOUT_LINES, TRUE, FALSE);
     if (!lun_info) {
         errorDialog(main_cdk_screen, SWINDOW_ERR_MSG, NULL);
+        FREE_NULL(swindow_title);
+        freeRowArena(&lun_rows);
         return;
     }
     setCDKSwindowBackgroundAttrib(lun_info, g_color_dialog_text[g_curr_theme]);
     setCDKSwindowBoxAttribute(lun_info, g_color_dialog_box[g_curr_theme]);
 
-    /* Loop over each target driver type */
-    line_pos = 0;
-    for (i = 0; i < driver_cnt; i++) {
-        /* Loop over each target for current driver type */
-        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/targets/%s",
-                SYSFS_SCST_TGT, tgt_drivers[i]);
-        if ((tgt_dir_stream = opendir(dir_name)) == NULL) {
-            if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                SAFE_ASPRINTF(&swindow_info[line_pos], "opendir(): %s",
-                        strerror(errno));
-                line_pos++;
-            }
-            break;
-        }
-        while ((tgt_dir_entry = readdir(tgt_dir_stream)) != NULL) {
-            /* The target names are directories; skip '.' and '..' */
-            if ((tgt_dir_entry->d_type == DT_DIR) &&
-                    (strcmp(tgt_dir_entry->d_name, ".") != 0) &&
-                    (strcmp(tgt_dir_entry->d_name, "..") != 0)) {
-                if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                    SAFE_ASPRINTF(&swindow_info[line_pos],
-                            "</B>Target:<!B> %s (%s)",
-                            tgt_dir_entry->d_name, tgt_drivers[i]);
-                    line_pos++;
-                }
-                /* Loop over each security group for the current target */
-                snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                        "%s/targets/%s/%s/ini_groups", SYSFS_SCST_TGT,
-                        tgt_drivers[i], tgt_dir_entry->d_name);
-                if ((group_dir_stream = opendir(dir_name)) == NULL) {
-                    if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                        SAFE_ASPRINTF(&swindow_info[line_pos], "opendir(): %s",
-                                strerror(errno));
-                        line_pos++;
-                    }
-                    break;
-                }
-                while ((group_dir_entry = readdir(group_dir_stream)) != NULL) {
-                    /* The group names are directories; skip '.' and '..' */
-                    if ((group_dir_entry->d_type == DT_DIR) &&
-                            (strcmp(group_dir_entry->d_name, ".") != 0) &&
-                            (strcmp(group_dir_entry->d_name, "..") != 0)) {
-                        if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                            SAFE_ASPRINTF(&swindow_info[line_pos],
-                                    "\t</B>Group:<!B> %s",
-                                    group_dir_entry->d_name);
-                            line_pos++;
-                        }
-
-                        /* Loop over each initiator for the current group */
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                                "%s/targets/%s/%s/ini_groups/%s/initiators",
-                                SYSFS_SCST_TGT, tgt_drivers[i],
-                                tgt_dir_entry->d_name, group_dir_entry->d_name);
-                        if ((init_dir_stream = opendir(
-                                dir_name)) == NULL) {
-                            if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                                SAFE_ASPRINTF(&swindow_info[line_pos],
-                                        "opendir(): %s", strerror(errno));
-                                line_pos++;
-                            }
-                            break;
-                        }
-                        while ((init_dir_entry = readdir(init_dir_stream)) !=
-                                NULL) {
-                            /* The initiators are files; skip 'mgmt' */
-                            if ((init_dir_entry->d_type == DT_REG) &&
-                                    (strcmp(init_dir_entry->d_name,
-                                    "mgmt") != 0)) {
-                                if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                                    SAFE_ASPRINTF(&swindow_info[line_pos],
-                                            "\t\t</B>Initiator:<!B> %s",
-                                            init_dir_entry->d_name);
-                                    line_pos++;
-                                }
-                            }
-                        }
-                        closedir(init_dir_stream);
-
-                        /* Loop over each LUN for the current group */
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                                "%s/targets/%s/%s/ini_groups/%s/luns",
-                                SYSFS_SCST_TGT, tgt_drivers[i],
-                                tgt_dir_entry->d_name, group_dir_entry->d_name);
-                        if ((lun_dir_stream = opendir(
-                                dir_name)) == NULL) {
-                            if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                                SAFE_ASPRINTF(&swindow_info[line_pos],
-                                        "opendir(): %s", strerror(errno));
-                                line_pos++;
-                            }
-                            break;
-                        }
-                        while ((lun_dir_entry = readdir(lun_dir_stream)) !=
-                                NULL) {
-                            /* The LUNs are directories; skip '.' and '..' */
-                            if ((lun_dir_entry->d_type == DT_DIR) &&
-                                    (strcmp(lun_dir_entry->d_name,
-                                    ".") != 0) &&
-                                    (strcmp(lun_dir_entry->d_name,
-                                    "..") != 0)) {
-                                /* We need to get the device name (link) */
-                                snprintf(link_path, MAX_SYSFS_PATH_SIZE,
-                                        "%s/targets/%s/%s/ini_groups"
-                                        "/%s/luns/%s/device", SYSFS_SCST_TGT,
-                                        tgt_drivers[i], tgt_dir_entry->d_name,
-                                        group_dir_entry->d_name,
-                                        lun_dir_entry->d_name);
-                                /* Read the link to get device name
-                                 * (doesn't append null byte) */
-                                dev_path_size = readlink(link_path, dev_path,
-                                        MAX_SYSFS_PATH_SIZE);
-                                if (dev_path_size < MAX_SYSFS_PATH_SIZE)
-                                    *(dev_path + dev_path_size) = '\0';
-                                if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                                    SAFE_ASPRINTF(&swindow_info[line_pos],
-                                            "\t\t</B>LUN:<!B> %s (%s)",
-                                            lun_dir_entry->d_name,
-                                            (strrchr(dev_path, '/') + 1));
-                                    line_pos++;
-                                }
-                            }
-                        }
-                        closedir(lun_dir_stream);
-                    }
-                }
-                closedir(group_dir_stream);
-                /* Print a blank line to separate targets */
-                if (line_pos < MAX_LUN_LAYOUT_LINES) {
-                    SAFE_ASPRINTF(&swindow_info[line_pos], " ");
-                    line_pos++;
-                }
-            }
-        }
-        closedir(tgt_dir_stream);
-    }
-
-
     /* Add a message to the bottom explaining how to close the dialog */
-    if (line_pos < MAX_LUN_LAYOUT_LINES) {
-        SAFE_ASPRINTF(&swindow_info[line_pos], " ");
-        line_pos++;
-    }
-    if (line_pos < MAX_LUN_LAYOUT_LINES) {
-        SAFE_ASPRINTF(&swindow_info[line_pos], CONTINUE_MSG);
-        line_pos++;
-    }
+    addArenaRow(&lun_rows, " ");
+    addArenaRow(&lun_rows, "%s", CONTINUE_MSG);
 
     /* Set the scrolling window content */
-    setCDKSwindowContents(lun_info, swindow_info, line_pos);
+    setCDKSwindowContents(lun_info, lun_rows.lines, lun_rows.used);
 
     /* The 'g' makes the swindow widget scroll to the top, then activate */
     injectCDKSwindow(lun_info, 'g');
@@ -1484,7 +1324,6 @@ void lunLayoutDialog(CDKSCREEN *main_cdk_screen) {
 
     /* Done */
     FREE_NULL(swindow_title);
-    for (i = 0; i < MAX_LUN_LAYOUT_LINES; i++ )
-        FREE_NULL(swindow_info[i]);
+    freeRowArena(&lun_rows);
     return;
 }
@@ -19,6 +19,10 @@
 #include <limits.h>
 #include <blkid/blkid.h>
 #include <assert.h>
+#include <pthread.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <iniparser.h>
 
 #include "prototypes.h"
 #include "system.h"
@@ -26,6 +30,540 @@
 #include "strings.h"
 
 
+/* Jobs making file systems (and the dialogs) re-write the fstab file */
+pthread_mutex_t g_fstab_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * @brief The work for making a new file system; run mkfs on the device, add
+ * the fstab entry (by label), make the mount point and optionally mount it.
+ * Runs as a background job so it must not touch the screen.
+ */
+boolean makeFSJob(job_t *job, void *arg) {
+    mkfs_job_t *mkfs_job = (mkfs_job_t *) arg;
+    char mkfs_cmd[MAX_SHELL_CMD_LEN] = {0}, mount_cmd[MAX_SHELL_CMD_LEN] = {0},
+            new_mnt_point[MAX_FS_ATTR_LEN] = {0},
+            mkfs_tool[MISC_STRING_LEN] = {0},
+            stripe_opts[MISC_STRING_LEN] = {0};
+    FILE *fstab_file = NULL, *new_fstab_file = NULL;
+    struct mntent *fstab_entry = NULL, fstab_ent,
+            addtl_fstab_entry; /* Not a pointer */
+    char mnt_line_buffer[MAX_MNT_LINE_BUFFER] = {0};
+    boolean success = FALSE;
+
+    /* Align the file system to the RAID stripes (btrfs has no options) */
+    if ((mkfs_job->stripe_unit > 0) && (mkfs_job->stripe_width > 0)) {
+        if (strcmp(mkfs_job->fs_type, "xfs") == 0)
+            snprintf(stripe_opts, MISC_STRING_LEN, "-d su=%lu,sw=%d ",
+                    mkfs_job->stripe_unit, mkfs_job->stripe_width);
+        else if (strncmp(mkfs_job->fs_type, "ext", 3) == 0)
+            snprintf(stripe_opts, MISC_STRING_LEN,
+                    "-b %d -E stride=%lu,stripe-width=%lu ",
+                    FS_STRIPE_BLOCK_SIZE,
+                    (mkfs_job->stripe_unit / FS_STRIPE_BLOCK_SIZE),
+                    ((mkfs_job->stripe_unit / FS_STRIPE_BLOCK_SIZE) *
+                    mkfs_job->stripe_width));
+    }
+
+    /* Create the file system */
+    setJobProgress(job, 0, 4);
+    snprintf(mkfs_cmd, MAX_SHELL_CMD_LEN,
+            "mkfs.%s -L %s %s-%s %s > /dev/null 2>&1",
+            mkfs_job->fs_type, mkfs_job->fs_label, stripe_opts,
+            (((strcmp(mkfs_job->fs_type, "btrfs") == 0) ||
+            (strcmp(mkfs_job->fs_type, "xfs") == 0)) ? "f" : "F"),
+            mkfs_job->blk_dev_node);
+    snprintf(mkfs_tool, MISC_STRING_LEN, "mkfs.%s", mkfs_job->fs_type);
+    if (!runJobCmd(job, mkfs_tool, mkfs_cmd, job->error_msg))
+        return FALSE;
+
+    /* Add the new file system entry to the fstab file */
+    setJobProgress(job, 1, 4);
+    pthread_mutex_lock(&g_fstab_mutex);
+    while (1) {
+        /* Open the original file system tab file */
+        if ((fstab_file = setmntent(FSTAB, "r")) == NULL) {
+            snprintf(job->error_msg, MISC_STRING_LEN, "setmntent(): %s",
+                    strerror(errno));
+            break;
+        }
+        /* Open the new/temporary file system tab file */
+        if ((new_fstab_file = setmntent(FSTAB_TMP, "w+")) == NULL) {
+            snprintf(job->error_msg, MISC_STRING_LEN, "setmntent(): %s",
+                    strerror(errno));
+            endmntent(fstab_file);
+            break;
+        }
+        /* Loop over the original fstab file, and add
+         * each entry to the new file */
+        while ((fstab_entry = getmntent_r(fstab_file, &fstab_ent,
+                mnt_line_buffer, MAX_MNT_LINE_BUFFER)) != NULL) {
+            addmntent(new_fstab_file, fstab_entry);
+        }
+        /* New fstab entry */
+        SAFE_ASPRINTF(&addtl_fstab_entry.mnt_fsname, "LABEL=%s",
+                mkfs_job->fs_label);
+        SAFE_ASPRINTF(&addtl_fstab_entry.mnt_dir, "%s/%s",
+                VDISK_MNT_BASE, mkfs_job->fs_label);
+        SAFE_ASPRINTF(&addtl_fstab_entry.mnt_type, "%s", mkfs_job->fs_type);
+        SAFE_ASPRINTF(&addtl_fstab_entry.mnt_opts, "%s",
+                ((mkfs_job->mount_opts[0] != '\0') ?
+                mkfs_job->mount_opts : "defaults"));
+        addtl_fstab_entry.mnt_freq = 1;
+        addtl_fstab_entry.mnt_passno = 1;
+        addmntent(new_fstab_file, &addtl_fstab_entry);
+        fflush(new_fstab_file);
+        endmntent(new_fstab_file);
+        endmntent(fstab_file);
+        FREE_NULL(addtl_fstab_entry.mnt_fsname);
+        FREE_NULL(addtl_fstab_entry.mnt_dir);
+        FREE_NULL(addtl_fstab_entry.mnt_type);
+        FREE_NULL(addtl_fstab_entry.mnt_opts);
+        if ((rename(FSTAB_TMP, FSTAB)) == -1) {
+            snprintf(job->error_msg, MISC_STRING_LEN, "rename(): %s",
+                    strerror(errno));
+            break;
+        }
+        success = TRUE;
+        break;
+    }
+    pthread_mutex_unlock(&g_fstab_mutex);
+    if (!success)
+        return FALSE;
+
+    /* Make the mount point directory */
+    setJobProgress(job, 2, 4);
+    snprintf(new_mnt_point, MAX_FS_ATTR_LEN, "%s/%s",
+            VDISK_MNT_BASE, mkfs_job->fs_label);
+    if ((mkdir(new_mnt_point,
+            S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) == -1) {
+        snprintf(job->error_msg, MISC_STRING_LEN, "mkdir(): %s",
+                strerror(errno));
+        return FALSE;
+    }
+
+    /* Mount it (if the user wanted to) */
+    setJobProgress(job, 3, 4);
+    if (mkfs_job->mount) {
+        snprintf(mount_cmd, MAX_SHELL_CMD_LEN, "%s %s > /dev/null 2>&1",
+                MOUNT_BIN, new_mnt_point);
+        if (!runJobCmd(job, MOUNT_BIN, mount_cmd, job->error_msg))
+            return FALSE;
+    }
+    setJobProgress(job, 4, 4);
+    return TRUE;
+}
+
+
+/**
+ * @brief Fill the list of mount option profiles: "defaults" is always first,
+ * then the ones in the [mount_profiles] section of the ESOS config. file
+ * (the key is the name, underscores are shown as spaces), or the built-in
+ * ones if there are none. Profiles with characters that don't belong in
+ * mount options are skipped. Return how many there are.
+ */
+int readMountProfiles(mount_profile_t profiles[]) {
+    dictionary *ini_dict = NULL;
+    char **sec_keys = NULL;
+    char *conf_opts = NULL, *key_name = NULL;
+    int key_cnt = 0, profile_cnt = 0, i = 0, j = 0;
+
+    snprintf(profiles[0].name, MISC_STRING_LEN, "%s",
+            g_mount_profile_names[0]);
+    snprintf(profiles[0].options, MAX_MOUNT_OPTS_LEN, "%s",
+            g_mount_profile_opts[0]);
+    profile_cnt = 1;
+
+    if ((ini_dict = iniparser_load(ESOS_CONF)) != NULL) {
+        if (((key_cnt = iniparser_getsecnkeys(ini_dict,
+                "mount_profiles")) > 0) &&
+                ((sec_keys = iniparser_getseckeys(ini_dict,
+                "mount_profiles")) != NULL)) {
+            for (i = 0; (i < key_cnt) &&
+                    (profile_cnt < MAX_MOUNT_PROFILES); i++) {
+                /* The keys are "section:key" */
+                key_name = strchr(sec_keys[i], ':');
+                key_name = ((key_name != NULL) ? (key_name + 1) : sec_keys[i]);
+                conf_opts = iniparser_getstring(ini_dict, sec_keys[i], "");
+                if ((conf_opts[0] == '\0') ||
+                        (strcmp(key_name, g_mount_profile_names[0]) == 0))
+                    continue;
+                if (strspn(conf_opts, MOUNT_OPTS_CHARS) !=
+                        strlen(conf_opts)) {
+                    DEBUG_LOG("Skipping the '%s' mount profile (invalid "
+                            "characters).", key_name);
+                    continue;
+                }
+                snprintf(profiles[profile_cnt].name, MISC_STRING_LEN, "%s",
+                        key_name);
+                for (j = 0; profiles[profile_cnt].name[j] != '\0'; j++) {
+                    if (profiles[profile_cnt].name[j] == '_')
+                        profiles[profile_cnt].name[j] = ' ';
+                }
+                snprintf(profiles[profile_cnt].options, MAX_MOUNT_OPTS_LEN,
+                        "%s", conf_opts);
+                profile_cnt++;
+            }
+            free(sec_keys);
+        }
+        iniparser_freedict(ini_dict);
+    }
+
+    /* Nothing configured, so use the built-in profiles */
+    if (profile_cnt == 1) {
+        for (i = 1; (i < (int) g_mount_profile_names_size()) &&
+                (profile_cnt < MAX_MOUNT_PROFILES); i++) {
+            snprintf(profiles[profile_cnt].name, MISC_STRING_LEN, "%s",
+                    g_mount_profile_names[i]);
+            snprintf(profiles[profile_cnt].options, MAX_MOUNT_OPTS_LEN, "%s",
+                    g_mount_profile_opts[i]);
+            profile_cnt++;
+        }
+    }
+    return profile_cnt;
+}
+
+
+/**
+ * @brief Work out the mount options a profile gives for a file system type;
+ * options for another type ("xfs:inode64" on ext4) are left out, and the
+ * type is removed from the ones for this type. Nothing left is "defaults".
+ */
+void profileMountOpts(const char *options, const char *fs_type,
+        char mount_opts[]) {
+    char opts_copy[MAX_MOUNT_OPTS_LEN] = {0};
+    char *option = NULL, *save_ptr = NULL, *type_end = NULL;
+    int used = 0;
+
+    mount_opts[0] = '\0';
+    snprintf(opts_copy, MAX_MOUNT_OPTS_LEN, "%s", options);
+    for (option = strtok_r(opts_copy, ",", &save_ptr); option != NULL;
+            option = strtok_r(NULL, ",", &save_ptr)) {
+        if ((type_end = strchr(option, ':')) != NULL) {
+            *type_end = '\0';
+            if (strcmp(option, fs_type) != 0)
+                continue;
+            option = type_end + 1;
+        }
+        if ((option[0] == '\0') || (strcmp(option, "defaults") == 0))
+            continue;
+        used += snprintf((mount_opts + used), (MAX_MOUNT_OPTS_LEN - used),
+                "%s%s", ((used > 0) ? "," : ""), option);
+        if (used >= MAX_MOUNT_OPTS_LEN)
+            break;
+    }
+    if (mount_opts[0] == '\0')
+        snprintf(mount_opts, MAX_MOUNT_OPTS_LEN, "defaults");
+}
+
+
+/**
+ * @brief Get the options a file system is mounted with right now (what the
+ * kernel is using, from /proc/mounts). Return FALSE if it isn't mounted.
+ */
+boolean getMountedOpts(const char *mnt_dir, char mount_opts[]) {
+    FILE *mtab_file = NULL;
+    struct mntent mtab_entry;
+    char mnt_line_buffer[MAX_MNT_LINE_BUFFER] = {0};
+    boolean found = FALSE;
+
+    mount_opts[0] = '\0';
+    if ((mtab_file = setmntent(MTAB, "r")) == NULL)
+        return FALSE;
+    /* The re-entrant version; callers may be walking the fstab file */
+    while (getmntent_r(mtab_file, &mtab_entry, mnt_line_buffer,
+            MAX_MNT_LINE_BUFFER) != NULL) {
+        /* The last mount on a directory is the one in use */
+        if (strcmp(mtab_entry.mnt_dir, mnt_dir) == 0) {
+            snprintf(mount_opts, MAX_MOUNT_OPTS_LEN, "%s",
+                    mtab_entry.mnt_opts);
+            found = TRUE;
+        }
+    }
+    endmntent(mtab_file);
+    return found;
+}
+
+
+/**
+ * @brief Change the options of a file system's entry (by mount point) in the
+ * fstab file. On failure, the error message is filled and FALSE is returned.
+ */
+boolean setFstabMountOpts(const char *mnt_dir, const char *mount_opts,
+        char error_msg[]) {
+    FILE *fstab_file = NULL, *new_fstab_file = NULL;
+    struct mntent *fstab_entry = NULL, fstab_ent;
+    char mnt_line_buffer[MAX_MNT_LINE_BUFFER] = {0};
+    boolean success = FALSE;
+
+    /* A background job may be adding an entry */
+    pthread_mutex_lock(&g_fstab_mutex);
+    while (1) {
+        if ((fstab_file = setmntent(FSTAB, "r")) == NULL) {
+            snprintf(error_msg, MISC_STRING_LEN, "setmntent(): %s",
+                    strerror(errno));
+            break;
+        }
+        if ((new_fstab_file = setmntent(FSTAB_TMP, "w+")) == NULL) {
+            snprintf(error_msg, MISC_STRING_LEN, "setmntent(): %s",
+                    strerror(errno));
+            endmntent(fstab_file);
+            break;
+        }
+        while ((fstab_entry = getmntent_r(fstab_file, &fstab_ent,
+                mnt_line_buffer, MAX_MNT_LINE_BUFFER)) != NULL) {
+            if (strcmp(fstab_entry->mnt_dir, mnt_dir) == 0)
+                fstab_entry->mnt_opts = (char *) mount_opts;
+            addmntent(new_fstab_file, fstab_entry);
+        }
+        fflush(new_fstab_file);
+        endmntent(new_fstab_file);
+        endmntent(fstab_file);
+        if ((rename(FSTAB_TMP, FSTAB)) == -1) {
+            snprintf(error_msg, MISC_STRING_LEN, "rename(): %s",
+                    strerror(errno));
+            break;
+        }
+        success = TRUE;
+        break;
+    }
+    pthread_mutex_unlock(&g_fstab_mutex);
+    return success;
+}
+
+
+/**
+ * @brief Run the "Mount Options" dialog; the chosen profile's options are
+ * written to the file system's fstab entry and, if it's mounted, applied
+ * with a remount. The options the kernel ends up using are shown.
+ */
+void mountOptsDialog(CDKSCREEN *main_cdk_screen) {
+    char fs_name[MAX_FS_ATTR_LEN] = {0}, fs_path[MAX_FS_ATTR_LEN] = {0},
+            fs_type[MAX_FS_ATTR_LEN] = {0},
+            mount_opts[MAX_MOUNT_OPTS_LEN] = {0},
+            active_opts[MAX_MOUNT_OPTS_LEN] = {0},
+            mount_cmd[MAX_SHELL_CMD_LEN] = {0},
+            error_str[MISC_STRING_LEN] = {0};
+    char *confirm_msg = NULL, *error_msg = NULL;
+    boolean mounted = FALSE, confirm = FALSE;
+    int ret_val = 0, exit_stat = 0;
+
+    /* Have the user select a file system, and then the profile */
+    getFSChoice(main_cdk_screen, fs_name, fs_path, fs_type, &mounted);
+    if (fs_name[0] == '\0')
+        return;
+    if (!getMountProfileChoice(main_cdk_screen, fs_type, mount_opts))
+        return;
+
+    SAFE_ASPRINTF(&confirm_msg, "Use mount options '%.50s'", mount_opts);
+    confirm = confirmDialog(main_cdk_screen, confirm_msg, (mounted ?
+            "for this file system, and remount it now?" :
+            "for this file system?"));
+    FREE_NULL(confirm_msg);
+    if (!confirm)
+        return;
+
+    if (!setFstabMountOpts(fs_path, mount_opts, error_str)) {
+        errorDialog(main_cdk_screen, error_str, NULL);
+        return;
+    }
+
+    if (mounted) {
+        /* Apply them now; the profile characters were checked */
+        snprintf(mount_cmd, MAX_SHELL_CMD_LEN,
+                "%s -o remount,%s %s > /dev/null 2>&1",
+                MOUNT_BIN, mount_opts, fs_path);
+        ret_val = system(mount_cmd);
+        if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
+            SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR, MOUNT_BIN, exit_stat);
+            errorDialog(main_cdk_screen, error_msg, "The fstab entry was "
+                    "updated; they'll be used at the next mount.");
+            FREE_NULL(error_msg);
+            return;
+        }
+        /* Some options (eg, XFS log buffers) only change on a new mount */
+        getMountedOpts(fs_path, active_opts);
+        SAFE_ASPRINTF(&error_msg, "Now in use: %.60s", active_opts);
+        informDialog(main_cdk_screen, error_msg, "(Anything missing takes "
+                "effect the next time it's mounted.)");
+        FREE_NULL(error_msg);
+    } else {
+        informDialog(main_cdk_screen, "The new mount options will be used "
+                "the next time", "the file system is mounted.");
+    }
+    return;
+}
+
+
+/**
+ * @brief Show the RAID stripe geometry found under the block device (for
+ * aligning the new file system) and let the user confirm or change it; a
+ * stripe unit of zero means no alignment. Return FALSE if the user
+ * cancelled (or something failed), otherwise TRUE with the values set.
+ */
+boolean stripeGeomDialog(CDKSCREEN *main_cdk_screen, char blk_dev_node[],
+        char fs_type[], unsigned long *stripe_unit, int *stripe_width) {
+    WINDOW *geom_window = 0;
+    CDKSCREEN *geom_screen = 0;
+    CDKLABEL *geom_label = 0;
+    CDKBUTTON *ok_button = 0, *cancel_button = 0;
+    CDKENTRY *unit_entry = 0, *width_entry = 0;
+    tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
+    char source[MISC_STRING_LEN] = {0}, unit_str[MISC_STRING_LEN] = {0},
+            width_str[MISC_STRING_LEN] = {0};
+    char *error_msg = NULL;
+    char *geom_dialog_msg[STRIPE_GEOM_INFO_LINES] = {NULL};
+    int window_y = 0, window_x = 0, traverse_ret = 0, i = 0,
+            geom_window_lines = 0, geom_window_cols = 0, unit_kb = 0,
+            width_int = 0;
+    boolean accepted = FALSE;
+
+    findStripeGeometry(blk_dev_node, stripe_unit, stripe_width, source);
+
+    while (1) {
+        /* Setup a new small CDK screen for the stripe geometry */
+        geom_window_lines = 12;
+        geom_window_cols = 70;
+        window_y = ((LINES / 2) - (geom_window_lines / 2));
+        window_x = ((COLS / 2) - (geom_window_cols / 2));
+        geom_window = newwin(geom_window_lines, geom_window_cols,
+                window_y, window_x);
+        if (geom_window == NULL) {
+            errorDialog(main_cdk_screen, NEWWIN_ERR_MSG, NULL);
+            break;
+        }
+        geom_screen = initCDKScreen(geom_window);
+        if (geom_screen == NULL) {
+            errorDialog(main_cdk_screen, CDK_SCR_ERR_MSG, NULL);
+            break;
+        }
+        boxWindow(geom_window, g_color_dialog_box[g_curr_theme]);
+        wbkgd(geom_window, g_color_dialog_text[g_curr_theme]);
+        wrefresh(geom_window);
+
+        /* Fill the information label */
+        SAFE_ASPRINTF(&geom_dialog_msg[0],
+                "</%d/B>Aligning the new %s file system to RAID stripes...",
+                g_color_dialog_title[g_curr_theme], fs_type);
+        SAFE_ASPRINTF(&geom_dialog_msg[1], " ");
+        SAFE_ASPRINTF(&geom_dialog_msg[2], "</B>Device:<!B> %.58s",
+                blk_dev_node);
+        SAFE_ASPRINTF(&geom_dialog_msg[3], "</B>Found:<!B>  %.58s", source);
+        geom_label = newCDKLabel(geom_screen, (window_x + 1), (window_y + 1),
+                geom_dialog_msg, STRIPE_GEOM_INFO_LINES, FALSE, FALSE);
+        if (!geom_label) {
+            errorDialog(main_cdk_screen, LABEL_ERR_MSG, NULL);
+            break;
+        }
+        setCDKLabelBackgroundAttrib(geom_label,
+                g_color_dialog_text[g_curr_theme]);
+
+        /* Stripe unit (zero for none) */
+        unit_entry = newCDKEntry(geom_screen, (window_x + 1), (window_y + 6),
+                "</B>Stripe Unit (KiB, 0 = none)", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                8, 1, 7, FALSE, FALSE);
+        if (!unit_entry) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(unit_entry,
+                g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(unit_entry,
+                    g_color_dialog_text[g_curr_theme]);
+        snprintf(unit_str, MISC_STRING_LEN, "%lu", (*stripe_unit / 1024));
+        setCDKEntryValue(unit_entry, unit_str);
+
+        /* Stripe width (data disks) */
+        width_entry = newCDKEntry(geom_screen, (window_x + 34),
+                (window_y + 6), "</B>Stripe Width (Data Disks)", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                4, 1, 3, FALSE, FALSE);
+        if (!width_entry) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(width_entry,
+                g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(width_entry,
+                    g_color_dialog_text[g_curr_theme]);
+        snprintf(width_str, MISC_STRING_LEN, "%d", *stripe_width);
+        setCDKEntryValue(width_entry, width_str);
+
+        /* Buttons */
+        ok_button = newCDKButton(geom_screen, (window_x + 26),
+                (window_y + 10), g_ok_cancel_msg[0], ok_cb, FALSE, FALSE);
+        if (!ok_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(ok_button,
+                g_color_dialog_input[g_curr_theme]);
+        cancel_button = newCDKButton(geom_screen, (window_x + 36),
+                (window_y + 10), g_ok_cancel_msg[1], cancel_cb, FALSE, FALSE);
+        if (!cancel_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(cancel_button,
+                g_color_dialog_input[g_curr_theme]);
+
+        /* Allow user to traverse the screen */
+        refreshCDKScreen(geom_screen);
+        traverse_ret = traverseCDKScreen(geom_screen);
+
+        /* User hit 'OK' button */
+        if (traverse_ret == 1) {
+            /* Turn the cursor off (pretty) */
+            curs_set(0);
+
+            unit_kb = atoi(getCDKEntryValue(unit_entry));
+            width_int = atoi(getCDKEntryValue(width_entry));
+            if (unit_kb == 0) {
+                *stripe_unit = 0;
+                *stripe_width = 0;
+                accepted = TRUE;
+                break;
+            }
+            if ((unit_kb < 0) || (unit_kb > MAX_FS_STRIPE_UNIT_KB) ||
+                    (((unit_kb * 1024) % FS_STRIPE_BLOCK_SIZE) != 0)) {
+                SAFE_ASPRINTF(&error_msg, "The stripe unit must be a "
+                        "multiple of %d KiB (up to %d KiB).",
+                        (FS_STRIPE_BLOCK_SIZE / 1024), MAX_FS_STRIPE_UNIT_KB);
+                errorDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                break;
+            }
+            if ((width_int < 1) || (width_int > MAX_FS_STRIPE_WIDTH)) {
+                SAFE_ASPRINTF(&error_msg, "The stripe width must be "
+                        "between 1 and %d data disks.", MAX_FS_STRIPE_WIDTH);
+                errorDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                break;
+            }
+            *stripe_unit = (unsigned long) unit_kb * 1024;
+            *stripe_width = width_int;
+            accepted = TRUE;
+        }
+        break;
+    }
+
+    /* Done */
+    for (i = 0; i < STRIPE_GEOM_INFO_LINES; i++)
+        FREE_NULL(geom_dialog_msg[i]);
+    if (geom_screen != NULL) {
+        destroyCDKScreenObjects(geom_screen);
+        destroyCDKScreen(geom_screen);
+    }
+    if (geom_window != NULL)
+        delwin(geom_window);
+    refreshCDKScreen(main_cdk_screen);
+    return accepted;
+}
+
+
 /**
  * @brief Run the "Create File System" dialog.
  */
@@ -38,22 +576,20 @@ void createFSDialog(CDKSCREEN *main_cdk_screen) {
     CDKRADIO *fs_type = 0, *add_part = 0;
     CDKSWINDOW *make_fs_info = 0;
     tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
-    char fs_label_buff[MAX_FS_LABEL] = {0}, mkfs_cmd[MAX_SHELL_CMD_LEN] = {0},
-            mount_cmd[MAX_SHELL_CMD_LEN] = {0},
-            new_mnt_point[MAX_FS_ATTR_LEN] = {0},
+    char fs_label_buff[MAX_FS_LABEL] = {0},
             new_blk_dev_node[MAX_FS_ATTR_LEN] = {0},
-            real_blk_dev_node[MAX_SYSFS_PATH_SIZE] = {0};
+            real_blk_dev_node[MAX_SYSFS_PATH_SIZE] = {0},
+            mount_opts[MAX_MOUNT_OPTS_LEN] = {0},
+            job_name[JOB_NAME_SIZE] = {0};
     char *block_dev = NULL, *error_msg = NULL, *confirm_msg = NULL,
             *dev_node = NULL, *device_size = NULL, *tmp_str_ptr = NULL,
             *swindow_title = NULL;
     char *fs_dialog_msg[MAX_FS_DIALOG_INFO_LINES] = {NULL},
             *swindow_info[MAX_MAKE_FS_INFO_LINES] = {NULL};
-    FILE *fstab_file = NULL, *new_fstab_file = NULL;
-    struct mntent *fstab_entry = NULL,
-            addtl_fstab_entry; /* Not a pointer */
+    FILE *fstab_file = NULL;
+    struct mntent *fstab_entry = NULL;
     int temp_int = 0, window_y = 0, window_x = 0, info_line_cnt = 0,
-            traverse_ret = 0, i = 0, exit_stat = 0, ret_val = 0,
-            fs_window_lines = 0, fs_window_cols = 0;
+            traverse_ret = 0, i = 0, fs_window_lines = 0, fs_window_cols = 0;
     PedDevice *device = NULL;
     PedDiskType *disk_type = NULL;
     PedDisk *disk = NULL;
@@ -61,18 +597,20 @@ void createFSDialog(CDKSCREEN *main_cdk_screen) {
     PedFileSystemType *file_system_type = NULL;
     PedConstraint *start_constraint = NULL, *end_constraint = NULL,
              *final_constraint = NULL;
-    boolean confirm = FALSE, question = FALSE, finished = FALSE;
+    boolean confirm = FALSE, finished = FALSE;
+    unsigned long stripe_unit = 0;
+    int stripe_width = 0;
+    mkfs_job_t *mkfs_job = NULL;
 
     /* Get block device choice from user */
     if ((block_dev = getBlockDevChoice(main_cdk_screen)) == NULL)
         return;
 
     while (1) {
-        if (strstr(block_dev, "/dev/disk-by-id") != NULL) {
+        if (strstr(block_dev, DEV_DISK_BY_ID) != NULL) {
             /* If its a SCSI disk, we need the real block device node */
-            if (readlink(block_dev, real_blk_dev_node,
-                    MAX_SYSFS_PATH_SIZE) == -1) {
-                SAFE_ASPRINTF(&error_msg, "readlink(): %s", strerror(errno));
+            if (realpath(block_dev, real_blk_dev_node) == NULL) {
+                SAFE_ASPRINTF(&error_msg, "realpath(): %s", strerror(errno));
                 errorDialog(main_cdk_screen, error_msg, NULL);
                 FREE_NULL(error_msg);
                 break;
@@ -104,7 +642,7 @@ void createFSDialog(CDKSCREEN *main_cdk_screen) {
             } else if ((strstr(fstab_entry->mnt_fsname, "LABEL=") != NULL) ||
                     (strstr(fstab_entry->mnt_fsname, "UUID=") != NULL)) {
                 /* Find the device node for the given file system */
-                if ((dev_node = blkid_get_devname(NULL,
+                if ((dev_node = blkid_get_devname(getBlkidCache(),
                         fstab_entry->mnt_fsname, NULL)) != NULL) {
                     if ((strstr(dev_node, real_blk_dev_node) != NULL)) {
                         errorDialog(main_cdk_screen, "It appears the selected "
@@ -321,6 +859,18 @@ void createFSDialog(CDKSCREEN *main_cdk_screen) {
             /* Get FS type choice */
             temp_int = getCDKRadioSelectedItem(fs_type);
 
+            /* Confirm (or change) the stripe alignment; btrfs doesn't
+             * take any */
+            if ((strcmp(g_fs_type_opts[temp_int], "btrfs") != 0) &&
+                    !stripeGeomDialog(main_cdk_screen, real_blk_dev_node,
+                    g_fs_type_opts[temp_int], &stripe_unit, &stripe_width))
+                break;
+
+            /* How the new file system is mounted (the fstab entry) */
+            if (!getMountProfileChoice(main_cdk_screen,
+                    g_fs_type_opts[temp_int], mount_opts))
+                break;
+
             /* Get confirmation before applying block device changes */
             SAFE_ASPRINTF(&confirm_msg,
                     "You are about to write a new file system to '%s';",
@@ -428,123 +978,43 @@ void createFSDialog(CDKSCREEN *main_cdk_screen) {
                             real_blk_dev_node);
                 }
 
-                /* Create the file system */
-                if (i < MAX_MAKE_FS_INFO_LINES) {
-                    SAFE_ASPRINTF(&swindow_info[i],
-                            "<C>Creating new %s file system...",
-                            g_fs_type_opts[temp_int]);
-                    addCDKSwindow(make_fs_info, swindow_info[i], BOTTOM);
-                    i++;
-                }
-                snprintf(mkfs_cmd, MAX_SHELL_CMD_LEN,
-                        "mkfs.%s -L %s -%s %s > /dev/null 2>&1",
-                        g_fs_type_opts[temp_int], fs_label_buff,
-                        (((strcmp(g_fs_type_opts[temp_int], "btrfs") == 0) ||
-                        (strcmp(g_fs_type_opts[temp_int],
-                        "xfs") == 0)) ? "f" : "F"),
-                        new_blk_dev_node);
-                ret_val = system(mkfs_cmd);
-                if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
-                    SAFE_ASPRINTF(&error_msg,
-                            "Running '%s' failed; exited with %d.",
-                            mkfs_cmd, exit_stat);
-                    errorDialog(main_cdk_screen, error_msg, NULL);
-                    FREE_NULL(error_msg);
-                    break;
-                }
-
-                /* Add the new file system entry to the fstab file */
-                if (i < MAX_MAKE_FS_INFO_LINES) {
-                    SAFE_ASPRINTF(&swindow_info[i],
-                            "<C>Adding new entry to fstab file...");
-                    addCDKSwindow(make_fs_info, swindow_info[i], BOTTOM);
-                    i++;
-                }
-                /* Open the original file system tab file */
-                if ((fstab_file = setmntent(FSTAB, "r")) == NULL) {
-                    SAFE_ASPRINTF(&error_msg, "setmntent(): %s",
-                            strerror(errno));
-                    errorDialog(main_cdk_screen, error_msg, NULL);
-                    FREE_NULL(error_msg);
-                    break;
-                }
-                /* Open the new/temporary file system tab file */
-                if ((new_fstab_file = setmntent(FSTAB_TMP, "w+")) == NULL) {
-                    SAFE_ASPRINTF(&error_msg, "setmntent(): %s",
-                            strerror(errno));
-                    errorDialog(main_cdk_screen, error_msg, NULL);
-                    FREE_NULL(error_msg);
-                    break;
-                }
-                /* Loop over the original fstab file, and add
-                 * each entry to the new file */
-                while ((fstab_entry = getmntent(fstab_file)) != NULL) {
-                    addmntent(new_fstab_file, fstab_entry);
-                }
-                /* New fstab entry */
-                SAFE_ASPRINTF(&addtl_fstab_entry.mnt_fsname, "LABEL=%s",
-                        fs_label_buff);
-                SAFE_ASPRINTF(&addtl_fstab_entry.mnt_dir, "%s/%s",
-                        VDISK_MNT_BASE, fs_label_buff);
-                SAFE_ASPRINTF(&addtl_fstab_entry.mnt_type, "%s",
-                        g_fs_type_opts[temp_int]);
-                SAFE_ASPRINTF(&addtl_fstab_entry.mnt_opts, "defaults");
-                addtl_fstab_entry.mnt_freq = 1;
-                addtl_fstab_entry.mnt_passno = 1;
-                addmntent(new_fstab_file, &addtl_fstab_entry);
-                fflush(new_fstab_file);
-                endmntent(new_fstab_file);
-                endmntent(fstab_file);
-                FREE_NULL(addtl_fstab_entry.mnt_fsname);
-                FREE_NULL(addtl_fstab_entry.mnt_dir);
-                FREE_NULL(addtl_fstab_entry.mnt_type);
-                FREE_NULL(addtl_fstab_entry.mnt_opts);
-                if ((rename(FSTAB_TMP, FSTAB)) == -1) {
-                    SAFE_ASPRINTF(&error_msg, "rename(): %s", strerror(errno));
-                    errorDialog(main_cdk_screen, error_msg, NULL);
-                    FREE_NULL(error_msg);
-                    break;
-                }
-                /* Make the mount point directory */
-                snprintf(new_mnt_point, MAX_FS_ATTR_LEN, "%s/%s",
-                        VDISK_MNT_BASE, fs_label_buff);
-                if ((mkdir(new_mnt_point,
-                        S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH)) ==
-                        -1) {
-                    SAFE_ASPRINTF(&error_msg, "mkdir(): %s", strerror(errno));
-                    errorDialog(main_cdk_screen, error_msg, NULL);
-                    FREE_NULL(error_msg);
-                    break;
-                }
-
                 /* Clean up the screen */
                 destroyCDKSwindow(make_fs_info);
+                make_fs_info = NULL;
                 refreshCDKScreen(main_cdk_screen);
 
-                /* Ask if user would like to mount the new FS */
-                question = questionDialog(main_cdk_screen,
-                        "Would you like to mount the new file system now?",
-                        NULL);
-                if (question) {
-                    /* Run mount */
-                    snprintf(mount_cmd, MAX_SHELL_CMD_LEN,
-                            "%s %s > /dev/null 2>&1", MOUNT_BIN, new_mnt_point);
-                    ret_val = system(mount_cmd);
-                    if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
-                        SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR,
-                                MOUNT_BIN, exit_stat);
-                        errorDialog(main_cdk_screen, error_msg, NULL);
-                        FREE_NULL(error_msg);
-                        break;
-                    }
+                /* Making the file system (and the fstab entry, mount point,
+                 * etc.) runs in the background, so ask about mounting now */
+                if ((mkfs_job = calloc(1, sizeof (mkfs_job_t))) == NULL) {
+                    errorDialog(main_cdk_screen, "Calling calloc() failed.",
+                            NULL);
+                    break;
                 }
+                snprintf(mkfs_job->blk_dev_node, MAX_FS_ATTR_LEN, "%s",
+                        new_blk_dev_node);
+                snprintf(mkfs_job->fs_type, MAX_FS_ATTR_LEN, "%s",
+                        g_fs_type_opts[temp_int]);
+                snprintf(mkfs_job->fs_label, MAX_FS_LABEL, "%s",
+                        fs_label_buff);
+                mkfs_job->stripe_unit = stripe_unit;
+                mkfs_job->stripe_width = stripe_width;
+                snprintf(mkfs_job->mount_opts, MAX_MOUNT_OPTS_LEN, "%s",
+                        mount_opts);
+                mkfs_job->mount = questionDialog(main_cdk_screen,
+                        "Would you like to mount the new file system "
+                        "when its ready?", NULL);
+                snprintf(job_name, JOB_NAME_SIZE, "Make %s FS %s",
+                        g_fs_type_opts[temp_int], fs_label_buff);
+                jobQueuedDialog(main_cdk_screen, submitJob(job_name,
+                        makeFSJob, mkfs_job, FALSE));
             }
         }
         break;
     }
 
     /* All done */
-    destroyCDKSwindow(make_fs_info);
+    if (make_fs_info != NULL)
+        destroyCDKSwindow(make_fs_info);
     FREE_NULL(swindow_title);
     for (i = 0; i < MAX_MAKE_FS_INFO_LINES; i++)
         FREE_NULL(swindow_info[i]);
@@ -569,7 +1039,8 @@ void removeFSDialog(CDKSCREEN *main_cdk_screen) {
     char *confirm_msg = NULL, *error_msg = NULL;
     boolean mounted = FALSE, question = FALSE, confirm = FALSE;
     FILE *fstab_file = NULL, *new_fstab_file = NULL;
-    struct mntent *fstab_entry = NULL;
+    struct mntent *fstab_entry = NULL, fstab_ent;
+    char mnt_line_buffer[MAX_MNT_LINE_BUFFER] = {0};
     int ret_val = 0, exit_stat = 0;
 
     /* Have the user select a file system to remove */
@@ -608,8 +1079,11 @@ void removeFSDialog(CDKSCREEN *main_cdk_screen) {
 
     /* Remove file system entry from fstab file */
     if (confirm) {
+        /* A background job may be adding an entry */
+        pthread_mutex_lock(&g_fstab_mutex);
         /* Open the original file system tab file */
         if ((fstab_file = setmntent(FSTAB, "r")) == NULL) {
+            pthread_mutex_unlock(&g_fstab_mutex);
             SAFE_ASPRINTF(&error_msg, "setmntent(): %s", strerror(errno));
             errorDialog(main_cdk_screen, error_msg, NULL);
             FREE_NULL(error_msg);
@@ -618,13 +1092,16 @@ void removeFSDialog(CDKSCREEN *main_cdk_screen) {
         /* Open the new/temporary file system tab file */
         if ((new_fstab_file = setmntent(FSTAB_TMP, "w+")) == NULL) {
             SAFE_ASPRINTF(&error_msg, "setmntent(): %s", strerror(errno));
+            endmntent(fstab_file);
+            pthread_mutex_unlock(&g_fstab_mutex);
             errorDialog(main_cdk_screen, error_msg, NULL);
             FREE_NULL(error_msg);
             return;
         }
         /* Loop over the original fstab file, and skip the entry
          * we are removing when writing out the new file */
-        while ((fstab_entry = getmntent(fstab_file)) != NULL) {
+        while ((fstab_entry = getmntent_r(fstab_file, &fstab_ent,
+                mnt_line_buffer, MAX_MNT_LINE_BUFFER)) != NULL) {
             if (strcmp(fs_name, fstab_entry->mnt_fsname) != 0) {
                 addmntent(new_fstab_file, fstab_entry);
             }
@@ -633,11 +1110,13 @@ void removeFSDialog(CDKSCREEN *main_cdk_screen) {
         endmntent(new_fstab_file);
         endmntent(fstab_file);
         if ((rename(FSTAB_TMP, FSTAB)) == -1) {
+            pthread_mutex_unlock(&g_fstab_mutex);
             SAFE_ASPRINTF(&error_msg, "rename(): %s", strerror(errno));
             errorDialog(main_cdk_screen, error_msg, NULL);
             FREE_NULL(error_msg);
             return;
         }
+        pthread_mutex_unlock(&g_fstab_mutex);
 
         /* Remove the mount point directory */
         if ((rmdir(fs_path)) == -1) {
@@ -655,6 +1134,20 @@ void removeFSDialog(CDKSCREEN *main_cdk_screen) {
 }
 
 
+/**
+ * @brief The work for writing out a new (eager-zero) virtual disk file; runs
+ * as a background job so it must not touch the screen.
+ */
+boolean vdiskFileJob(job_t *job, void *arg) {
+    vdisk_job_t *vdisk_job = (vdisk_job_t *) arg;
+
+    setJobProgress(job, 0, vdisk_job->size);
+    setJobDestPath(job, vdisk_job->path);
+    return createVDiskFile(vdisk_job->path, vdisk_job->size, vdisk_job->mode,
+            vdisk_job->queue_depth, jobProgressCB, job, job->error_msg);
+}
+
+
 /**
  * @brief Run the "Add Virtual Disk File" dialog.
  */
@@ -663,27 +1156,28 @@ void addVDiskFileDialog(CDKSCREEN *main_cdk_screen) {
     CDKSCREEN *vdisk_screen = 0;
     CDKLABEL *vdisk_label = 0;
     CDKBUTTON *ok_button = 0, *cancel_button = 0;
-    CDKENTRY *vdisk_name = 0, *vdisk_size = 0;
-    CDKHISTOGRAM *vdisk_progress = 0;
+    CDKENTRY *vdisk_name = 0, *vdisk_size = 0, *queue_depth = 0;
+    CDKRADIO *prov_mode = 0;
     tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
     char fs_name[MAX_FS_ATTR_LEN] = {0}, fs_path[MAX_FS_ATTR_LEN] = {0},
             fs_type[MAX_FS_ATTR_LEN] = {0}, mount_cmd[MAX_SHELL_CMD_LEN] = {0},
             vdisk_name_buff[MAX_VDISK_NAME_LEN] = {0},
             gib_free_str[MISC_STRING_LEN] = {0},
             gib_total_str[MISC_STRING_LEN] = {0},
-            zero_buff[VDISK_WRITE_SIZE] = {0},
-            new_vdisk_file[MAX_VDISK_PATH_LEN] = {0};
-    char *error_msg = NULL, *histogram_title = NULL;
+            new_vdisk_file[MAX_VDISK_PATH_LEN] = {0},
+            create_err[MISC_STRING_LEN] = {0},
+            depth_str[MISC_STRING_LEN] = {0},
+            job_name[JOB_NAME_SIZE] = {0};
+    char *error_msg = NULL;
     char *vdisk_dialog_msg[ADD_VDISK_INFO_LINES] = {NULL};
-    boolean mounted = FALSE, question = FALSE, finished = FALSE;
+    boolean mounted = FALSE, question = FALSE;
     struct statvfs *fs_info = NULL;
     int window_y = 0, window_x = 0, traverse_ret = 0, i = 0, exit_stat = 0,
-            ret_val = 0, vdisk_size_int = 0, new_vdisk_fd = 0,
+            ret_val = 0, vdisk_size_int = 0, queue_depth_int = 0,
             vdisk_window_lines = 0, vdisk_window_cols = 0;
-    long long bytes_free = 0ll, bytes_total = 0ll, new_vdisk_bytes = 0ll,
-            new_vdisk_mib = 0ll;
-    off_t position = 0;
-    ssize_t bytes_written = 0, write_length = 0;
+    long long bytes_free = 0ll, bytes_total = 0ll, new_vdisk_bytes = 0ll;
+    vdisk_prov_t prov_choice = VDISK_THIN;
+    vdisk_job_t *vdisk_job = NULL;
 
     /* Have the user select a file system to remove */
     getFSChoice(main_cdk_screen, fs_name, fs_path, fs_type, &mounted);
@@ -711,7 +1205,7 @@ void addVDiskFileDialog(CDKSCREEN *main_cdk_screen) {
 
     while (1) {
         /* Setup a new small CDK screen for virtual disk information */
-        vdisk_window_lines = 12;
+        vdisk_window_lines = 16;
         vdisk_window_cols = 70;
         window_y = ((LINES / 2) - (vdisk_window_lines / 2));
         window_x = ((COLS / 2) - (vdisk_window_cols / 2));
@@ -799,18 +1293,53 @@ void addVDiskFileDialog(CDKSCREEN *main_cdk_screen) {
         setCDKEntryBackgroundAttrib(vdisk_size,
                     g_color_dialog_text[g_curr_theme]);
 
-        /* Buttons */
-        ok_button = newCDKButton(vdisk_screen, (window_x + 26), (window_y + 10),
-                g_ok_cancel_msg[0], ok_cb, FALSE, FALSE);
-        if (!ok_button) {
-            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+        /* Provisioning mode (radio); lazy thick is only quick where the
+         * file system has real fallocate() support */
+        prov_mode = newCDKRadio(vdisk_screen, (window_x + 1), (window_y + 9),
+                NONE, 4, 22, "</B>Provisioning", g_vdisk_prov_opts, 3,
+                '#' | g_color_dialog_select[g_curr_theme], 1,
+                g_color_dialog_select[g_curr_theme], FALSE, FALSE);
+        if (!prov_mode) {
+            errorDialog(main_cdk_screen, RADIO_ERR_MSG, NULL);
             break;
         }
-        setCDKButtonBackgroundAttrib(ok_button,
-                g_color_dialog_input[g_curr_theme]);
-        cancel_button = newCDKButton(vdisk_screen, (window_x + 36),
-                (window_y + 10), g_ok_cancel_msg[1], cancel_cb, FALSE, FALSE);
-        if (!cancel_button) {
+        setCDKRadioBackgroundAttrib(prov_mode,
+                g_color_dialog_text[g_curr_theme]);
+        if ((strcmp(fs_type, "xfs") == 0) || (strcmp(fs_type, "ext4") == 0) ||
+                (strcmp(fs_type, "btrfs") == 0))
+            setCDKRadioCurrentItem(prov_mode, VDISK_LAZY_THICK);
+        else
+            setCDKRadioCurrentItem(prov_mode, VDISK_EAGER_ZERO);
+
+        /* Eager-zero queue depth (writes in flight) */
+        queue_depth = newCDKEntry(vdisk_screen, (window_x + 30),
+                (window_y + 9), "</B>Eager-Zero Queue Depth", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                4, 1, 3, FALSE, FALSE);
+        if (!queue_depth) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(queue_depth,
+                g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(queue_depth,
+                    g_color_dialog_text[g_curr_theme]);
+        snprintf(depth_str, MISC_STRING_LEN, "%d", VDISK_DEF_QUEUE_DEPTH);
+        setCDKEntryValue(queue_depth, depth_str);
+
+        /* Buttons */
+        ok_button = newCDKButton(vdisk_screen, (window_x + 26), (window_y + 14),
+                g_ok_cancel_msg[0], ok_cb, FALSE, FALSE);
+        if (!ok_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(ok_button,
+                g_color_dialog_input[g_curr_theme]);
+        cancel_button = newCDKButton(vdisk_screen, (window_x + 36),
+                (window_y + 14), g_ok_cancel_msg[1], cancel_cb, FALSE, FALSE);
+        if (!cancel_button) {
             errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
             break;
         }
@@ -840,11 +1369,19 @@ void addVDiskFileDialog(CDKSCREEN *main_cdk_screen) {
                 break;
             }
             new_vdisk_bytes = vdisk_size_int * GIBIBYTE_SIZE;
+            /* A thin file takes no space up front, so it may be larger than
+             * what's available (over-committed); the others need it all */
+            prov_choice = (vdisk_prov_t) getCDKRadioSelectedItem(prov_mode);
             if (new_vdisk_bytes > bytes_free) {
-                errorDialog(main_cdk_screen,
-                        "The given size is greater than the available space!",
-                        NULL);
-                break;
+                if (prov_choice != VDISK_THIN) {
+                    errorDialog(main_cdk_screen, "The given size is greater "
+                            "than the available space!", NULL);
+                    break;
+                }
+                if (!questionDialog(main_cdk_screen, "The given size is "
+                        "greater than the available space;",
+                        "writes will fail if it fills up. Continue?"))
+                    break;
             }
 
             /* Check if the new (potential) virtual disk file exists already */
@@ -858,139 +1395,56 @@ void addVDiskFileDialog(CDKSCREEN *main_cdk_screen) {
                 break;
             }
 
+            /* Get the queue depth */
+            queue_depth_int = atoi(getCDKEntryValue(queue_depth));
+            if ((queue_depth_int < 1) ||
+                    (queue_depth_int > MAX_VDISK_QUEUE_DEPTH)) {
+                SAFE_ASPRINTF(&error_msg, "The queue depth must be "
+                        "between 1 and %d.", MAX_VDISK_QUEUE_DEPTH);
+                errorDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                break;
+            }
+
             /* Clean up the screen */
             destroyCDKScreenObjects(vdisk_screen);
             destroyCDKScreen(vdisk_screen);
             vdisk_screen = NULL;
             delwin(vdisk_window);
+            vdisk_window = NULL;
             refreshCDKScreen(main_cdk_screen);
 
-            /* Make a new histogram widget to display the virtual
-             * disk creation progress */
-            SAFE_ASPRINTF(&histogram_title,
-                    "<C></%d/B>Writing new virtual disk file (units = MiB):\n",
-                    g_color_dialog_title[g_curr_theme]);
-            vdisk_progress = newCDKHistogram(main_cdk_screen, CENTER, CENTER,
-                    1, 50, HORIZONTAL, histogram_title, TRUE, FALSE);
-            if (!vdisk_progress) {
-                errorDialog(main_cdk_screen, HISTOGRAM_ERR_MSG, NULL);
-                break;
-            }
-            setCDKScrollBoxAttribute(vdisk_progress,
-                    g_color_dialog_box[g_curr_theme]);
-            setCDKScrollBackgroundAttrib(vdisk_progress,
-                    g_color_dialog_text[g_curr_theme]);
-            drawCDKHistogram(vdisk_progress, TRUE);
-
-            /* We'll use mebibyte as our unit for the histogram widget; need to
-             * make sure an int can handle it, which is used by the
-             * histogram widget */
-            new_vdisk_mib = new_vdisk_bytes / MEBIBYTE_SIZE;
-            if (new_vdisk_mib > INT_MAX) {
-                errorDialog(main_cdk_screen, "An integer will not hold "
-                        "the virtual", "disk size (MiB) on this system!");
+            /* Thin and lazy thick files are created right away */
+            if (prov_choice != VDISK_EAGER_ZERO) {
+                if (!createVDiskFile(new_vdisk_file, new_vdisk_bytes,
+                        prov_choice, queue_depth_int, NULL, NULL,
+                        create_err))
+                    errorDialog(main_cdk_screen, create_err, NULL);
                 break;
             }
 
-            /* Open our (new) virtual disk file */
-            if ((new_vdisk_fd = open(new_vdisk_file,
-                    O_WRONLY | O_CREAT, 0666)) == -1) {
-                SAFE_ASPRINTF(&error_msg, "open(): %s", strerror(errno));
-                errorDialog(main_cdk_screen, error_msg, NULL);
-                FREE_NULL(error_msg);
+            /* Writing out the whole file takes a while, so that's done in
+             * the background */
+            if ((vdisk_job = calloc(1, sizeof (vdisk_job_t))) == NULL) {
+                errorDialog(main_cdk_screen, "Calling calloc() failed.", NULL);
                 break;
             }
-
-            /* Zero-out the new virtual disk file to the
-             * length specified (size) */
-            memset(zero_buff, 0, VDISK_WRITE_SIZE);
-            for (position = 0; position < new_vdisk_bytes;
-                    position += write_length) {
-                write_length = MIN((new_vdisk_bytes - position),
-                        VDISK_WRITE_SIZE);
-                /* Use fallocate() for modern file systems, and
-                 * write() for others */
-                if ((strcmp(fs_type, "xfs") == 0) ||
-                        (strcmp(fs_type, "ext4") == 0) ||
-                        (strcmp(fs_type, "btrfs") == 0)) {
-                    if (fallocate(new_vdisk_fd, 0, position,
-                            write_length) == -1) {
-                        SAFE_ASPRINTF(&error_msg, "fallocate(): %s",
-                                strerror(errno));
-                        errorDialog(main_cdk_screen, error_msg, NULL);
-                        FREE_NULL(error_msg);
-                        close(new_vdisk_fd);
-                        finished = TRUE;
-                        break;
-                    }
-                } else {
-                    bytes_written = write(new_vdisk_fd, zero_buff,
-                            write_length);
-                    if (bytes_written == -1) {
-                        SAFE_ASPRINTF(&error_msg, "write(): %s",
-                                strerror(errno));
-                        errorDialog(main_cdk_screen, error_msg, NULL);
-                        FREE_NULL(error_msg);
-                        close(new_vdisk_fd);
-                        finished = TRUE;
-                        break;
-                    } else if (bytes_written != write_length) {
-                        errorDialog(main_cdk_screen,
-                                "The number of bytes written is different",
-                                "than the requested write length!");
-                        close(new_vdisk_fd);
-                        finished = TRUE;
-                        break;
-                    }
-                }
-                /* This controls how often the progress bar is updated; it can
-                 * adversely affect performance of the write operation if its
-                 * updated too frequently */
-                if ((position % (VDISK_WRITE_SIZE * 1000)) == 0) {
-                    /* Since our maximum size was checked above against an int
-                     * type, we'll assume we're safe if we made it this far */
-                    setCDKHistogram(vdisk_progress, vPERCENT, CENTER,
-                            g_color_dialog_text[g_curr_theme], 0, new_vdisk_mib,
-                            (position / MEBIBYTE_SIZE), ' ' | A_REVERSE, TRUE);
-                    drawCDKHistogram(vdisk_progress, TRUE);
-                }
-            }
-            if (finished)
-                break;
-
-            /* We've completed writing the new file; update the progress bar */
-            setCDKHistogram(vdisk_progress, vPERCENT, CENTER,
-                    g_color_dialog_text[g_curr_theme],
-                    0, new_vdisk_mib, new_vdisk_mib,
-                    ' ' | A_REVERSE, TRUE);
-            drawCDKHistogram(vdisk_progress, TRUE);
-
-            // TODO: Do we actually need to flush to disk before returning?
-            if (fsync(new_vdisk_fd) == -1) {
-                SAFE_ASPRINTF(&error_msg, "fsync(): %s", strerror(errno));
-                errorDialog(main_cdk_screen, error_msg, NULL);
-                FREE_NULL(error_msg);
-                close(new_vdisk_fd);
-                break;
-            }
-            if (close(new_vdisk_fd) == -1) {
-                SAFE_ASPRINTF(&error_msg, "close(): %s", strerror(errno));
-                errorDialog(main_cdk_screen, error_msg, NULL);
-                FREE_NULL(error_msg);
-                break;
-            }
-            destroyCDKHistogram(vdisk_progress);
-            vdisk_progress = NULL;
+            snprintf(vdisk_job->path, MAX_VDISK_PATH_LEN, "%s",
+                    new_vdisk_file);
+            vdisk_job->size = new_vdisk_bytes;
+            vdisk_job->mode = prov_choice;
+            vdisk_job->queue_depth = queue_depth_int;
+            snprintf(job_name, JOB_NAME_SIZE, "Write vdisk %s",
+                    vdisk_name_buff);
+            jobQueuedDialog(main_cdk_screen, submitJob(job_name, vdiskFileJob,
+                    vdisk_job, TRUE));
         }
         break;
     }
 
     /* Done */
-    FREE_NULL(histogram_title);
     for (i = 0; i < ADD_VDISK_INFO_LINES; i++)
         FREE_NULL(vdisk_dialog_msg[i]);
-    if (vdisk_progress != NULL)
-        destroyCDKHistogram(vdisk_progress);
     if (vdisk_screen != NULL) {
         destroyCDKScreenObjects(vdisk_screen);
         destroyCDKScreen(vdisk_screen);
@@ -1086,17 +1540,610 @@ void delVDiskFileDialog(CDKSCREEN *main_cdk_screen) {
 
 
 /**
- * @brief Run the "Virtual Disk File List" dialog.
+ * @brief The work for cloning a virtual disk file; runs as a background job
+ * so it must not touch the screen. If the file is in use by SCST (checked
+ * now, the job may have waited in the queue), it's only cloned if the file
+ * system can reflink it.
+ */
+boolean cloneVDiskJob(job_t *job, void *arg) {
+    clone_job_t *clone_job = (clone_job_t *) arg;
+    char scst_dev[MISC_STRING_LEN] = {0};
+    boolean in_use = FALSE;
+
+    in_use = findSCSTFileDev(clone_job->src_path, scst_dev);
+    setJobDestPath(job, clone_job->dst_path);
+    return cloneVDiskFile(clone_job->src_path, clone_job->dst_path,
+            clone_job->threads, in_use, jobProgressCB, job, job->error_msg);
+}
+
+
+/**
+ * @brief Run the "Clone Virtual Disk File" dialog; the new file is made in
+ * the same file system (so it can be a reflink) and is ready to be added as
+ * a vdisk_fileio device once the job is done.
+ */
+void cloneVDiskFileDialog(CDKSCREEN *main_cdk_screen) {
+    WINDOW *clone_window = 0;
+    CDKSCREEN *clone_screen = 0;
+    CDKLABEL *clone_label = 0;
+    CDKBUTTON *ok_button = 0, *cancel_button = 0;
+    CDKENTRY *clone_name = 0, *clone_threads = 0;
+    CDKFSELECT *file_select = 0;
+    tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
+    char fs_name[MAX_FS_ATTR_LEN] = {0}, fs_path[MAX_FS_ATTR_LEN] = {0},
+            fs_type[MAX_FS_ATTR_LEN] = {0}, mount_cmd[MAX_SHELL_CMD_LEN] = {0},
+            src_file[MAX_VDISK_PATH_LEN] = {0},
+            scst_dev[MISC_STRING_LEN] = {0},
+            clone_name_buff[MAX_VDISK_NAME_LEN] = {0},
+            new_vdisk_file[MAX_VDISK_PATH_LEN] = {0},
+            threads_str[MISC_STRING_LEN] = {0},
+            job_name[JOB_NAME_SIZE] = {0};
+    char *error_msg = NULL, *selected_file = NULL, *fselect_title = NULL,
+            *src_dir = NULL;
+    char *clone_dialog_msg[CLONE_VDISK_INFO_LINES] = {NULL};
+    boolean mounted = FALSE, question = FALSE;
+    struct stat src_stat = {0};
+    struct statvfs fs_info = {0};
+    int window_y = 0, window_x = 0, traverse_ret = 0, i = 0, exit_stat = 0,
+            ret_val = 0, threads_int = 0, clone_window_lines = 0,
+            clone_window_cols = 0;
+    long long bytes_free = 0ll, bytes_alloc = 0ll;
+    clone_job_t *clone_job = NULL;
+
+    /* Have the user select a file system */
+    getFSChoice(main_cdk_screen, fs_name, fs_path, fs_type, &mounted);
+    if (fs_name[0] == '\0')
+        return;
+
+    if (!mounted) {
+        question = questionDialog(main_cdk_screen,
+                NOT_MOUNTED_1, NOT_MOUNTED_2);
+        if (question) {
+            /* Run mount */
+            snprintf(mount_cmd, MAX_SHELL_CMD_LEN, "%s %s > /dev/null 2>&1",
+                    MOUNT_BIN, fs_path);
+            ret_val = system(mount_cmd);
+            if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
+                SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR, MOUNT_BIN, exit_stat);
+                errorDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                return;
+            }
+        } else {
+            return;
+        }
+    }
+
+    /* Create the file selector widget */
+    SAFE_ASPRINTF(&fselect_title,
+            "<C></%d/B>Choose a virtual disk file to clone:\n",
+            g_color_dialog_title[g_curr_theme]);
+    file_select = newCDKFselect(main_cdk_screen, CENTER, CENTER, 20, 40,
+            fselect_title, "VDisk File: ", g_color_dialog_input[g_curr_theme],
+            '_' | g_color_dialog_input[g_curr_theme],
+            A_REVERSE, "</N>", "</B>", "</N>", "</N>", TRUE, FALSE);
+    if (!file_select) {
+        errorDialog(main_cdk_screen, FSELECT_ERR_MSG, NULL);
+        FREE_NULL(fselect_title);
+        return;
+    }
+    setCDKFselectBoxAttribute(file_select, g_color_dialog_box[g_curr_theme]);
+    setCDKFselectBackgroundAttrib(file_select,
+            g_color_dialog_text[g_curr_theme]);
+    setCDKFselectDirectory(file_select, fs_path);
+
+    /* Activate the widget and let the user choose a file */
+    selected_file = activateCDKFselect(file_select, 0);
+    if (file_select->exitType == vNORMAL)
+        snprintf(src_file, MAX_VDISK_PATH_LEN, "%s", selected_file);
+    destroyCDKFselect(file_select);
+    /* Using the file selector widget changes the CWD -- fix it */
+    if ((chdir(getenv("HOME"))) == -1) {
+        SAFE_ASPRINTF(&error_msg, "chdir(): %s", strerror(errno));
+        errorDialog(main_cdk_screen, error_msg, NULL);
+        FREE_NULL(error_msg);
+    }
+    FREE_NULL(fselect_title);
+    refreshCDKScreen(main_cdk_screen);
+    if (src_file[0] == '\0')
+        return;
+
+    while (1) {
+        /* The source file and how much space a full copy would take */
+        if (stat(src_file, &src_stat) == -1) {
+            SAFE_ASPRINTF(&error_msg, "stat(): %s", strerror(errno));
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+            break;
+        }
+        if (!S_ISREG(src_stat.st_mode)) {
+            errorDialog(main_cdk_screen, "The selected virtual disk file "
+                    "is not a regular file!", NULL);
+            break;
+        }
+        /* Copying a file that initiators are writing gives a torn clone,
+         * so one that's in use can only be shared (a reflink) */
+        if (findSCSTFileDev(src_file, scst_dev)) {
+            SAFE_ASPRINTF(&error_msg, "This file is in use by SCST device "
+                    "'%s'; it can only be reflinked.", scst_dev);
+            question = questionDialog(main_cdk_screen, error_msg,
+                    "If the file system can't, the clone will fail. Continue?");
+            FREE_NULL(error_msg);
+            if (!question)
+                break;
+        }
+        if (statvfs(fs_path, &fs_info) == -1) {
+            SAFE_ASPRINTF(&error_msg, "statvfs(): %s", strerror(errno));
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+            break;
+        }
+        bytes_free = fs_info.f_bavail * fs_info.f_bsize;
+        bytes_alloc = src_stat.st_blocks * 512LL;
+
+        /* Setup a new small CDK screen for the clone information */
+        clone_window_lines = 13;
+        clone_window_cols = 70;
+        window_y = ((LINES / 2) - (clone_window_lines / 2));
+        window_x = ((COLS / 2) - (clone_window_cols / 2));
+        clone_window = newwin(clone_window_lines, clone_window_cols,
+                window_y, window_x);
+        if (clone_window == NULL) {
+            errorDialog(main_cdk_screen, NEWWIN_ERR_MSG, NULL);
+            break;
+        }
+        clone_screen = initCDKScreen(clone_window);
+        if (clone_screen == NULL) {
+            errorDialog(main_cdk_screen, CDK_SCR_ERR_MSG, NULL);
+            break;
+        }
+        boxWindow(clone_window, g_color_dialog_box[g_curr_theme]);
+        wbkgd(clone_window, g_color_dialog_text[g_curr_theme]);
+        wrefresh(clone_window);
+
+        /* Fill the information label */
+        SAFE_ASPRINTF(&clone_dialog_msg[0],
+                "</%d/B>Cloning virtual disk file...",
+                g_color_dialog_title[g_curr_theme]);
+        SAFE_ASPRINTF(&clone_dialog_msg[1], " ");
+        SAFE_ASPRINTF(&clone_dialog_msg[2], "</B>Source:<!B>\t%.56s",
+                src_file);
+        SAFE_ASPRINTF(&clone_dialog_msg[3], "</B>Size:<!B> %lld GiB  "
+                "</B>Allocated:<!B> %lld GiB  </B>Available:<!B> %lld GiB",
+                ((long long) src_stat.st_size / GIBIBYTE_SIZE),
+                (bytes_alloc / GIBIBYTE_SIZE), (bytes_free / GIBIBYTE_SIZE));
+        clone_label = newCDKLabel(clone_screen, (window_x + 1), (window_y + 1),
+                clone_dialog_msg, CLONE_VDISK_INFO_LINES, FALSE, FALSE);
+        if (!clone_label) {
+            errorDialog(main_cdk_screen, LABEL_ERR_MSG, NULL);
+            break;
+        }
+        setCDKLabelBackgroundAttrib(clone_label,
+                g_color_dialog_text[g_curr_theme]);
+
+        /* New virtual disk file name */
+        clone_name = newCDKEntry(clone_screen, (window_x + 1), (window_y + 6),
+                "</B>New Virtual Disk File Name", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vLMIXED,
+                20, 0, MAX_VDISK_NAME_LEN, FALSE, FALSE);
+        if (!clone_name) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(clone_name,
+                g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(clone_name,
+                    g_color_dialog_text[g_curr_theme]);
+
+        /* Copy threads (when it can't be a reflink) */
+        clone_threads = newCDKEntry(clone_screen, (window_x + 34),
+                (window_y + 6), "</B>Copy Threads", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                4, 1, 2, FALSE, FALSE);
+        if (!clone_threads) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(clone_threads,
+                g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(clone_threads,
+                    g_color_dialog_text[g_curr_theme]);
+        snprintf(threads_str, MISC_STRING_LEN, "%d", VDISK_DEF_CLONE_THREADS);
+        setCDKEntryValue(clone_threads, threads_str);
+
+        /* Buttons */
+        ok_button = newCDKButton(clone_screen, (window_x + 26),
+                (window_y + 11), g_ok_cancel_msg[0], ok_cb, FALSE, FALSE);
+        if (!ok_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(ok_button,
+                g_color_dialog_input[g_curr_theme]);
+        cancel_button = newCDKButton(clone_screen, (window_x + 36),
+                (window_y + 11), g_ok_cancel_msg[1], cancel_cb, FALSE, FALSE);
+        if (!cancel_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(cancel_button,
+                g_color_dialog_input[g_curr_theme]);
+
+        /* Allow user to traverse the screen */
+        refreshCDKScreen(clone_screen);
+        traverse_ret = traverseCDKScreen(clone_screen);
+
+        /* User hit 'OK' button */
+        if (traverse_ret == 1) {
+            /* Turn the cursor off (pretty) */
+            curs_set(0);
+
+            /* Check the new file name value (field entry) */
+            strncpy(clone_name_buff, getCDKEntryValue(clone_name),
+                    MAX_VDISK_NAME_LEN);
+            if (!checkInputStr(main_cdk_screen, NAME_CHARS, clone_name_buff))
+                break;
+            threads_int = atoi(getCDKEntryValue(clone_threads));
+            if ((threads_int < 1) || (threads_int > MAX_VDISK_CLONE_THREADS)) {
+                SAFE_ASPRINTF(&error_msg, "The number of copy threads must "
+                        "be between 1 and %d.", MAX_VDISK_CLONE_THREADS);
+                errorDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                break;
+            }
+
+            /* The clone goes next to the original */
+            SAFE_ASPRINTF(&src_dir, "%s", src_file);
+            snprintf(new_vdisk_file, MAX_VDISK_PATH_LEN, "%s/%s",
+                    dirname(src_dir), clone_name_buff);
+            FREE_NULL(src_dir);
+            if (access(new_vdisk_file, F_OK) != -1) {
+                SAFE_ASPRINTF(&error_msg, "It appears the '%s'",
+                        new_vdisk_file);
+                errorDialog(main_cdk_screen, error_msg, "file already exists!");
+                FREE_NULL(error_msg);
+                break;
+            }
+
+            /* A copy (if the file system can't share the extents) needs
+             * the allocated space */
+            if ((bytes_alloc > bytes_free) && !questionDialog(main_cdk_screen,
+                    "A full copy of this file won't fit in the available "
+                    "space;", "only a reflink clone will work. Continue?"))
+                break;
+
+            if ((clone_job = calloc(1, sizeof (clone_job_t))) == NULL) {
+                errorDialog(main_cdk_screen, "Calling calloc() failed.", NULL);
+                break;
+            }
+            snprintf(clone_job->src_path, MAX_VDISK_PATH_LEN, "%s", src_file);
+            snprintf(clone_job->dst_path, MAX_VDISK_PATH_LEN, "%s",
+                    new_vdisk_file);
+            clone_job->threads = threads_int;
+
+            /* Clean up the screen */
+            destroyCDKScreenObjects(clone_screen);
+            destroyCDKScreen(clone_screen);
+            clone_screen = NULL;
+            delwin(clone_window);
+            clone_window = NULL;
+            refreshCDKScreen(main_cdk_screen);
+
+            snprintf(job_name, JOB_NAME_SIZE, "Clone vdisk %s",
+                    clone_name_buff);
+            jobQueuedDialog(main_cdk_screen, submitJob(job_name,
+                    cloneVDiskJob, clone_job, TRUE));
+        }
+        break;
+    }
+
+    /* Done */
+    for (i = 0; i < CLONE_VDISK_INFO_LINES; i++)
+        FREE_NULL(clone_dialog_msg[i]);
+    if (clone_screen != NULL) {
+        destroyCDKScreenObjects(clone_screen);
+        destroyCDKScreen(clone_screen);
+    }
+    if (clone_window != NULL)
+        delwin(clone_window);
+    refreshCDKScreen(main_cdk_screen);
+    return;
+}
+
+
+/**
+ * @brief The work for reclaiming the zeroed space in a virtual disk file;
+ * runs as a background job so it must not touch the screen.
+ */
+boolean reclaimVDiskJob(job_t *job, void *arg) {
+    reclaim_job_t *reclaim_job = (reclaim_job_t *) arg;
+    struct stat file_stat = {0};
+    char freed_str[MISC_STRING_LEN] = {0}, alloc_str[MISC_STRING_LEN] = {0},
+            scst_dev[MISC_STRING_LEN] = {0};
+    long long reclaimed = 0;
+
+    /* The job may have waited in the queue since the dialog checked, so
+     * make sure the file still isn't in use before punching anything */
+    if (findSCSTFileDev(reclaim_job->path, scst_dev)) {
+        snprintf(job->error_msg, MISC_STRING_LEN, "This file is in use by "
+                "SCST device '%s'.", scst_dev);
+        return FALSE;
+    }
+    if (!reclaimVDiskFile(reclaim_job->path, reclaim_job->rate_limit,
+            jobProgressCB, job, &reclaimed, job->error_msg))
+        return FALSE;
+    if (stat(reclaim_job->path, &file_stat) == 0)
+        prettyFormatBytesBuf((file_stat.st_blocks * 512ULL), alloc_str,
+                MISC_STRING_LEN);
+    snprintf(job->result_msg, MISC_STRING_LEN, "Freed %s; %s is allocated "
+            "now.", prettyFormatBytesBuf(reclaimed, freed_str,
+            MISC_STRING_LEN), ((alloc_str[0] != '\0') ? alloc_str : "?"));
+    return TRUE;
+}
+
+
+/**
+ * @brief Run the "Reclaim VDisk File" dialog; the zeroed blocks in a
+ * virtual disk file that isn't in use are punched out (in the background)
+ * so the file system gets the space back.
+ */
+void reclaimVDiskFileDialog(CDKSCREEN *main_cdk_screen) {
+    WINDOW *reclaim_window = 0;
+    CDKSCREEN *reclaim_screen = 0;
+    CDKLABEL *reclaim_label = 0;
+    CDKBUTTON *ok_button = 0, *cancel_button = 0;
+    CDKENTRY *rate_limit = 0;
+    CDKFSELECT *file_select = 0;
+    tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
+    char fs_name[MAX_FS_ATTR_LEN] = {0}, fs_path[MAX_FS_ATTR_LEN] = {0},
+            fs_type[MAX_FS_ATTR_LEN] = {0}, mount_cmd[MAX_SHELL_CMD_LEN] = {0},
+            vdisk_file[MAX_VDISK_PATH_LEN] = {0},
+            scst_dev[MISC_STRING_LEN] = {0},
+            rate_str[MISC_STRING_LEN] = {0},
+            size_str[MISC_STRING_LEN] = {0}, alloc_str[MISC_STRING_LEN] = {0},
+            job_name[JOB_NAME_SIZE] = {0};
+    char *error_msg = NULL, *selected_file = NULL, *fselect_title = NULL;
+    char *reclaim_dialog_msg[RECLAIM_VDISK_INFO_LINES] = {NULL};
+    boolean mounted = FALSE, question = FALSE;
+    struct stat file_stat = {0};
+    int window_y = 0, window_x = 0, traverse_ret = 0, i = 0, exit_stat = 0,
+            ret_val = 0, rate_int = 0, reclaim_window_lines = 0,
+            reclaim_window_cols = 0;
+    reclaim_job_t *reclaim_job = NULL;
+
+    /* Have the user select a file system */
+    getFSChoice(main_cdk_screen, fs_name, fs_path, fs_type, &mounted);
+    if (fs_name[0] == '\0')
+        return;
+
+    if (!mounted) {
+        question = questionDialog(main_cdk_screen,
+                NOT_MOUNTED_1, NOT_MOUNTED_2);
+        if (question) {
+            /* Run mount */
+            snprintf(mount_cmd, MAX_SHELL_CMD_LEN, "%s %s > /dev/null 2>&1",
+                    MOUNT_BIN, fs_path);
+            ret_val = system(mount_cmd);
+            if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
+                SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR, MOUNT_BIN, exit_stat);
+                errorDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                return;
+            }
+        } else {
+            return;
+        }
+    }
+
+    /* Create the file selector widget */
+    SAFE_ASPRINTF(&fselect_title,
+            "<C></%d/B>Choose a virtual disk file to reclaim:\n",
+            g_color_dialog_title[g_curr_theme]);
+    file_select = newCDKFselect(main_cdk_screen, CENTER, CENTER, 20, 40,
+            fselect_title, "VDisk File: ", g_color_dialog_input[g_curr_theme],
+            '_' | g_color_dialog_input[g_curr_theme],
+            A_REVERSE, "</N>", "</B>", "</N>", "</N>", TRUE, FALSE);
+    if (!file_select) {
+        errorDialog(main_cdk_screen, FSELECT_ERR_MSG, NULL);
+        FREE_NULL(fselect_title);
+        return;
+    }
+    setCDKFselectBoxAttribute(file_select, g_color_dialog_box[g_curr_theme]);
+    setCDKFselectBackgroundAttrib(file_select,
+            g_color_dialog_text[g_curr_theme]);
+    setCDKFselectDirectory(file_select, fs_path);
+
+    /* Activate the widget and let the user choose a file */
+    selected_file = activateCDKFselect(file_select, 0);
+    if (file_select->exitType == vNORMAL)
+        snprintf(vdisk_file, MAX_VDISK_PATH_LEN, "%s", selected_file);
+    destroyCDKFselect(file_select);
+    /* Using the file selector widget changes the CWD -- fix it */
+    if ((chdir(getenv("HOME"))) == -1) {
+        SAFE_ASPRINTF(&error_msg, "chdir(): %s", strerror(errno));
+        errorDialog(main_cdk_screen, error_msg, NULL);
+        FREE_NULL(error_msg);
+    }
+    FREE_NULL(fselect_title);
+    refreshCDKScreen(main_cdk_screen);
+    if (vdisk_file[0] == '\0')
+        return;
+
+    while (1) {
+        if (stat(vdisk_file, &file_stat) == -1) {
+            SAFE_ASPRINTF(&error_msg, "stat(): %s", strerror(errno));
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+            break;
+        }
+        if (!S_ISREG(file_stat.st_mode)) {
+            errorDialog(main_cdk_screen, "The selected virtual disk file "
+                    "is not a regular file!", NULL);
+            break;
+        }
+        /* A block written by an initiator between our read and the punch
+         * would be lost, so the file can't be in use */
+        if (findSCSTFileDev(vdisk_file, scst_dev)) {
+            SAFE_ASPRINTF(&error_msg, "This file is in use by SCST "
+                    "device '%s';", scst_dev);
+            errorDialog(main_cdk_screen, error_msg,
+                    "remove the device before reclaiming its space.");
+            FREE_NULL(error_msg);
+            break;
+        }
+
+        /* Setup a new small CDK screen for the reclaim information */
+        reclaim_window_lines = 12;
+        reclaim_window_cols = 70;
+        window_y = ((LINES / 2) - (reclaim_window_lines / 2));
+        window_x = ((COLS / 2) - (reclaim_window_cols / 2));
+        reclaim_window = newwin(reclaim_window_lines, reclaim_window_cols,
+                window_y, window_x);
+        if (reclaim_window == NULL) {
+            errorDialog(main_cdk_screen, NEWWIN_ERR_MSG, NULL);
+            break;
+        }
+        reclaim_screen = initCDKScreen(reclaim_window);
+        if (reclaim_screen == NULL) {
+            errorDialog(main_cdk_screen, CDK_SCR_ERR_MSG, NULL);
+            break;
+        }
+        boxWindow(reclaim_window, g_color_dialog_box[g_curr_theme]);
+        wbkgd(reclaim_window, g_color_dialog_text[g_curr_theme]);
+        wrefresh(reclaim_window);
+
+        /* Fill the information label */
+        SAFE_ASPRINTF(&reclaim_dialog_msg[0],
+                "</%d/B>Reclaiming zeroed virtual disk file space...",
+                g_color_dialog_title[g_curr_theme]);
+        SAFE_ASPRINTF(&reclaim_dialog_msg[1], " ");
+        SAFE_ASPRINTF(&reclaim_dialog_msg[2], "</B>File:<!B>\t%.56s",
+                vdisk_file);
+        SAFE_ASPRINTF(&reclaim_dialog_msg[3], "</B>Size:<!B> %s  "
+                "</B>Allocated:<!B> %s",
+                prettyFormatBytesBuf(file_stat.st_size, size_str,
+                MISC_STRING_LEN),
+                prettyFormatBytesBuf((file_stat.st_blocks * 512ULL),
+                alloc_str, MISC_STRING_LEN));
+        reclaim_label = newCDKLabel(reclaim_screen, (window_x + 1),
+                (window_y + 1), reclaim_dialog_msg, RECLAIM_VDISK_INFO_LINES,
+                FALSE, FALSE);
+        if (!reclaim_label) {
+            errorDialog(main_cdk_screen, LABEL_ERR_MSG, NULL);
+            break;
+        }
+        setCDKLabelBackgroundAttrib(reclaim_label,
+                g_color_dialog_text[g_curr_theme]);
+
+        /* Read rate limit */
+        rate_limit = newCDKEntry(reclaim_screen, (window_x + 1),
+                (window_y + 6), "</B>Read Rate Limit (MiB/s, 0 = none)",
+                NULL, g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                8, 1, 6, FALSE, FALSE);
+        if (!rate_limit) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(rate_limit,
+                g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(rate_limit,
+                    g_color_dialog_text[g_curr_theme]);
+        snprintf(rate_str, MISC_STRING_LEN, "%d", VDISK_DEF_RECLAIM_RATE);
+        setCDKEntryValue(rate_limit, rate_str);
+
+        /* Buttons */
+        ok_button = newCDKButton(reclaim_screen, (window_x + 26),
+                (window_y + 10), g_ok_cancel_msg[0], ok_cb, FALSE, FALSE);
+        if (!ok_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(ok_button,
+                g_color_dialog_input[g_curr_theme]);
+        cancel_button = newCDKButton(reclaim_screen, (window_x + 36),
+                (window_y + 10), g_ok_cancel_msg[1], cancel_cb, FALSE, FALSE);
+        if (!cancel_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(cancel_button,
+                g_color_dialog_input[g_curr_theme]);
+
+        /* Allow user to traverse the screen */
+        refreshCDKScreen(reclaim_screen);
+        traverse_ret = traverseCDKScreen(reclaim_screen);
+
+        /* User hit 'OK' button */
+        if (traverse_ret == 1) {
+            /* Turn the cursor off (pretty) */
+            curs_set(0);
+
+            rate_int = atoi(getCDKEntryValue(rate_limit));
+            if ((rate_int < 0) || (rate_int > MAX_VDISK_RECLAIM_RATE)) {
+                SAFE_ASPRINTF(&error_msg, "The read rate limit must be "
+                        "between 0 and %d MiB/s.", MAX_VDISK_RECLAIM_RATE);
+                errorDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                break;
+            }
+
+            if ((reclaim_job = calloc(1, sizeof (reclaim_job_t))) == NULL) {
+                errorDialog(main_cdk_screen, "Calling calloc() failed.", NULL);
+                break;
+            }
+            snprintf(reclaim_job->path, MAX_VDISK_PATH_LEN, "%s", vdisk_file);
+            reclaim_job->rate_limit = rate_int;
+
+            /* Clean up the screen */
+            destroyCDKScreenObjects(reclaim_screen);
+            destroyCDKScreen(reclaim_screen);
+            reclaim_screen = NULL;
+            delwin(reclaim_window);
+            reclaim_window = NULL;
+            refreshCDKScreen(main_cdk_screen);
+
+            snprintf(job_name, JOB_NAME_SIZE, "Reclaim vdisk %s",
+                    basename(vdisk_file));
+            jobQueuedDialog(main_cdk_screen, submitJob(job_name,
+                    reclaimVDiskJob, reclaim_job, TRUE));
+        }
+        break;
+    }
+
+    /* Done */
+    for (i = 0; i < RECLAIM_VDISK_INFO_LINES; i++)
+        FREE_NULL(reclaim_dialog_msg[i]);
+    if (reclaim_screen != NULL) {
+        destroyCDKScreenObjects(reclaim_screen);
+        destroyCDKScreen(reclaim_screen);
+    }
+    if (reclaim_window != NULL)
+        delwin(reclaim_window);
+    refreshCDKScreen(main_cdk_screen);
+    return;
+}
+
+
+/**
+ * @brief Run the "Virtual Disk File List" dialog; each file's size (what the
+ * initiators see) and the space it takes (blocks allocated) are shown, so
+ * sparse and reclaimable files stand out.
  */
 void vdiskFileListDialog(CDKSCREEN *main_cdk_screen) {
     CDKSWINDOW *vdisk_files = 0;
     char *swindow_info[MAX_VDLIST_INFO_LINES] = {NULL};
-    char *error_msg = NULL, *pretty_size = NULL;
+    char *error_msg = NULL;
     int i = 0, line_pos = 0;
     char fs_name[MAX_FS_ATTR_LEN] = {0}, fs_path[MAX_FS_ATTR_LEN] = {0},
             fs_type[MAX_FS_ATTR_LEN] = {0},
             vd_list_title[VDLIST_INFO_COLS] = {0},
-            file_path[MAX_SYSFS_PATH_SIZE] = {0};
+            file_path[MAX_SYSFS_PATH_SIZE] = {0},
+            size_str[MISC_STRING_LEN] = {0}, alloc_str[MISC_STRING_LEN] = {0},
+            used_str[MISC_STRING_LEN] = {0};
+    long long alloc_bytes = 0;
     boolean mounted = FALSE;
     DIR *dir_stream = NULL;
     struct dirent *dir_entry = NULL;
@@ -1132,8 +2179,9 @@ void vdiskFileListDialog(CDKSCREEN *main_cdk_screen) {
 
     /* Loop over each entry in the directory */
     if (line_pos < MAX_VDLIST_INFO_LINES) {
-        SAFE_ASPRINTF(&swindow_info[line_pos], "<C></B>%-20.20s %15.15s",
-                "File Name", "File Size");
+        SAFE_ASPRINTF(&swindow_info[line_pos],
+                "<C></B>%-24.24s %12.12s %12.12s %6.6s",
+                "File Name", "Size", "Allocated", "Used");
         line_pos++;
     }
     while ((dir_entry = readdir(dir_stream)) != NULL) {
@@ -1146,15 +2194,24 @@ void vdiskFileListDialog(CDKSCREEN *main_cdk_screen) {
                 if (stat(file_path, &file_stat) == -1) {
                     SAFE_ASPRINTF(&error_msg, "stat(): %s", strerror(errno));
                     SAFE_ASPRINTF(&swindow_info[line_pos],
-                            "<C>%-20.20s %15.15s",
+                            "<C>%-24.24s %-31.31s",
                             dir_entry->d_name, error_msg);
                     FREE_NULL(error_msg);
                 } else {
-                    pretty_size = prettyFormatBytes(file_stat.st_size);
+                    /* st_blocks is always in 512 byte units */
+                    alloc_bytes = file_stat.st_blocks * 512LL;
+                    if (file_stat.st_size > 0)
+                        snprintf(used_str, MISC_STRING_LEN, "%lld%%",
+                                ((alloc_bytes * 100) / file_stat.st_size));
+                    else
+                        snprintf(used_str, MISC_STRING_LEN, "-");
                     SAFE_ASPRINTF(&swindow_info[line_pos],
-                            "<C>%-20.20s %15.15s",
-                            dir_entry->d_name, pretty_size);
-                    FREE_NULL(pretty_size);
+                            "<C>%-24.24s %12.12s %12.12s %6.6s",
+                            dir_entry->d_name,
+                            prettyFormatBytesBuf(file_stat.st_size, size_str,
+                            MISC_STRING_LEN),
+                            prettyFormatBytesBuf(alloc_bytes, alloc_str,
+                            MISC_STRING_LEN), used_str);
                 }
                 line_pos++;
             }
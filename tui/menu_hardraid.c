@@ -47,12 +47,14 @@ int getCtrlrChoice(CDKSCREEN *cdk_screen, char type[], char id_num[],
             output_line[MAX_CMD_LINE_LEN] = {0};
     int ctrlr_cnt = 0, i = 0, status = 0, user_choice = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
         /* Put the command string together and execute it */
         snprintf(command_str, MAX_SHELL_CMD_LEN, "%s --list-controllers 2>&1",
                 HWRAID_CLI_TOOL);
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -84,6 +86,7 @@ int getCtrlrChoice(CDKSCREEN *cdk_screen, char type[], char id_num[],
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("hw_raid_cli --list-controllers", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
@@ -177,6 +180,7 @@ int getPDSelection(CDKSCREEN *cdk_screen, boolean avail_only, char type[],
             *selection_list[MAX_HWRAID_PDRVS] = {NULL};
     int pd_cnt = 0, i = 0, status = 0, chosen_pd_cnt = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
@@ -185,6 +189,7 @@ int getPDSelection(CDKSCREEN *cdk_screen, boolean avail_only, char type[],
                 "%s --list-physical-drives --type=%s --ctrlr-id=%s %s 2>&1",
                 HWRAID_CLI_TOOL, type, id_num,
                 (avail_only ? "--avail-only" : ""));
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -223,6 +228,7 @@ int getPDSelection(CDKSCREEN *cdk_screen, boolean avail_only, char type[],
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("hw_raid_cli --list-physical-drives", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
@@ -336,6 +342,7 @@ int getPDChoice(CDKSCREEN *cdk_screen, boolean avail_only, char type[],
             output_line[MAX_CMD_LINE_LEN] = {0};
     int pd_cnt = 0, i = 0, status = 0, user_choice = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
@@ -344,6 +351,7 @@ int getPDChoice(CDKSCREEN *cdk_screen, boolean avail_only, char type[],
                 "%s --list-physical-drives --type=%s --ctrlr-id=%s %s 2>&1",
                 HWRAID_CLI_TOOL, type, id_num,
                 (avail_only ? "--avail-only" : ""));
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -381,6 +389,7 @@ int getPDChoice(CDKSCREEN *cdk_screen, boolean avail_only, char type[],
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("hw_raid_cli --list-physical-drives", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
@@ -481,6 +490,7 @@ int getLDChoice(CDKSCREEN *cdk_screen, char type[], char id_num[],
             output_line[MAX_CMD_LINE_LEN] = {0};
     int ld_cnt = 0, i = 0, status = 0, user_choice = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
@@ -488,6 +498,7 @@ int getLDChoice(CDKSCREEN *cdk_screen, char type[], char id_num[],
         snprintf(command_str, MAX_SHELL_CMD_LEN,
                 "%s --list-logical-drives --type=%s --ctrlr-id=%s 2>&1",
                 HWRAID_CLI_TOOL, type, id_num);
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -525,6 +536,7 @@ int getLDChoice(CDKSCREEN *cdk_screen, char type[], char id_num[],
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("hw_raid_cli --list-logical-drives", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
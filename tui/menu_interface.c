@@ -244,6 +244,189 @@ void supportArchDialog(CDKSCREEN *main_cdk_screen) {
 }
 
 
+/**
+ * @brief Run the "Latency Stats" dialog; show the timing statistics for the
+ * start-up phases and the dialog data gathering, and then let the user write
+ * them to syslog or a file.
+ */
+void profileDialog(CDKSCREEN *main_cdk_screen) {
+    CDKSWINDOW *prof_info = 0;
+    CDKSCROLL *dump_list = 0;
+    char *swindow_title = NULL, *scroll_title = NULL, *error_msg = NULL;
+    char *dump_opts[3] = {NULL};
+    row_arena_t prof_rows = {0};
+    int dump_choice = 0, i = 0;
+    FILE *dump_file = NULL;
+
+    /* The statistics (plain text) are formatted after a bold title row */
+    if (!initRowArena(&prof_rows, (MAX_PROFILE_PHASES + 4),
+            PROFILE_ROW_SIZE)) {
+        errorDialog(main_cdk_screen, ROW_ARENA_ERR_MSG, NULL);
+        return;
+    }
+
+    while (1) {
+        addArenaRow(&prof_rows, "</B>Milliseconds per phase, since the "
+                "TUI started:<!B>");
+        addArenaRow(&prof_rows, " ");
+        formatProfileStats(&prof_rows);
+
+        /* Setup scrolling window widget */
+        SAFE_ASPRINTF(&swindow_title, "<C></%d/B>Latency Statistics\n",
+                g_color_dialog_title[g_curr_theme]);
+        prof_info = newCDKSwindow(main_cdk_screen, CENTER, CENTER,
+                (PROFILE_INFO_ROWS + 2), (PROFILE_INFO_COLS + 2),
+                swindow_title, (MAX_PROFILE_PHASES + 4), TRUE, FALSE);
+        if (!prof_info) {
+            errorDialog(main_cdk_screen, SWINDOW_ERR_MSG, NULL);
+            break;
+        }
+        setCDKSwindowBackgroundAttrib(prof_info,
+                g_color_dialog_text[g_curr_theme]);
+        setCDKSwindowBoxAttribute(prof_info,
+                g_color_dialog_box[g_curr_theme]);
+        setCDKSwindowContents(prof_info, prof_rows.lines, prof_rows.used);
+
+        /* The 'g' makes the swindow widget scroll to the top, then activate */
+        injectCDKSwindow(prof_info, 'g');
+        activateCDKSwindow(prof_info, 0);
+        destroyCDKSwindow(prof_info);
+        refreshCDKScreen(main_cdk_screen);
+
+        /* See if the user wants to keep a copy */
+        SAFE_ASPRINTF(&dump_opts[0], "<C>Done");
+        SAFE_ASPRINTF(&dump_opts[1], "<C>Write to Syslog");
+        SAFE_ASPRINTF(&dump_opts[2], "<C>Save to %s", PROFILE_DUMP);
+        SAFE_ASPRINTF(&scroll_title, "<C></%d/B>Keep the Timings?\n",
+                g_color_dialog_title[g_curr_theme]);
+        dump_list = newCDKScroll(main_cdk_screen, CENTER, CENTER, NONE,
+                8, 50, scroll_title, dump_opts, 3, FALSE,
+                g_color_dialog_select[g_curr_theme], TRUE, FALSE);
+        if (!dump_list) {
+            errorDialog(main_cdk_screen, SCROLL_ERR_MSG, NULL);
+            break;
+        }
+        setCDKScrollBoxAttribute(dump_list, g_color_dialog_box[g_curr_theme]);
+        setCDKScrollBackgroundAttrib(dump_list,
+                g_color_dialog_text[g_curr_theme]);
+        dump_choice = activateCDKScroll(dump_list, 0);
+        if (dump_list->exitType != vNORMAL)
+            break;
+
+        if (dump_choice == 1) {
+            if (dumpProfile(NULL))
+                informDialog(main_cdk_screen, PROFILE_SYSLOG_MSG, NULL);
+            else
+                errorDialog(main_cdk_screen, PROFILE_ROWS_ERR, NULL);
+        } else if (dump_choice == 2) {
+            if ((dump_file = fopen(PROFILE_DUMP, "w")) == NULL) {
+                SAFE_ASPRINTF(&error_msg, PROFILE_SAVE_ERR, strerror(errno));
+                errorDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+                break;
+            }
+            if (dumpProfile(dump_file)) {
+                SAFE_ASPRINTF(&error_msg, PROFILE_SAVED_MSG, PROFILE_DUMP);
+                informDialog(main_cdk_screen, error_msg, NULL);
+                FREE_NULL(error_msg);
+            } else {
+                errorDialog(main_cdk_screen, PROFILE_ROWS_ERR, NULL);
+            }
+            fclose(dump_file);
+        }
+        break;
+    }
+
+    /* Done */
+    if (dump_list)
+        destroyCDKScroll(dump_list);
+    refreshCDKScreen(main_cdk_screen);
+    FREE_NULL(swindow_title);
+    FREE_NULL(scroll_title);
+    for (i = 0; i < 3; i++)
+        FREE_NULL(dump_opts[i]);
+    freeRowArena(&prof_rows);
+    return;
+}
+
+
+/**
+ * @brief Run the "Jobs" dialog; the background jobs (queued, running and
+ * finished) with their progress, refreshed every couple of seconds until
+ * the user closes it. The jobs carry on either way.
+ */
+void jobsDialog(CDKSCREEN *main_cdk_screen) {
+    CDKSWINDOW *jobs_info = 0;
+    char *swindow_title = NULL;
+    row_arena_t job_rows = {0};
+    int key_pressed = 0, top_line = 0;
+
+    /* Failed jobs get a second row (the error) */
+    if (!initRowArena(&job_rows, ((MAX_JOBS * 2) + 3), JOBS_ROW_SIZE)) {
+        errorDialog(main_cdk_screen, ROW_ARENA_ERR_MSG, NULL);
+        return;
+    }
+
+    while (1) {
+        /* Setup scrolling window widget */
+        SAFE_ASPRINTF(&swindow_title, "<C></%d/B>Background Jobs\n",
+                g_color_dialog_title[g_curr_theme]);
+        jobs_info = newCDKSwindow(main_cdk_screen, CENTER, CENTER,
+                (JOBS_INFO_ROWS + 2), (JOBS_INFO_COLS + 2),
+                swindow_title, ((MAX_JOBS * 2) + 3), TRUE, FALSE);
+        if (!jobs_info) {
+            errorDialog(main_cdk_screen, SWINDOW_ERR_MSG, NULL);
+            break;
+        }
+        setCDKSwindowBackgroundAttrib(jobs_info,
+                g_color_dialog_text[g_curr_theme]);
+        setCDKSwindowBoxAttribute(jobs_info,
+                g_color_dialog_box[g_curr_theme]);
+        keypad(jobs_info->win, TRUE);
+
+        /* Refresh the rows until the user is done; only the scrolling keys
+         * are passed on to the widget */
+        halfdelay(REFRESH_DELAY);
+        for (;;) {
+            resetRowArena(&job_rows);
+            addArenaRow(&job_rows, "</B>Running at most %d at a time "
+                    "(tui:max_jobs); ESC or ENTER to close.<!B>",
+                    getJobLimit());
+            addArenaRow(&job_rows, " ");
+            formatJobRows(&job_rows);
+            /* Setting the contents scrolls back to the top */
+            top_line = jobs_info->currentTop;
+            setCDKSwindowContents(jobs_info, job_rows.lines, job_rows.used);
+            jobs_info->currentTop = MIN(top_line, jobs_info->maxTopLine);
+            drawCDKSwindow(jobs_info, TRUE);
+
+            key_pressed = wgetch(jobs_info->win);
+            if (key_pressed == ERR)
+                continue;
+            else if ((key_pressed == KEY_ESC) || (key_pressed == KEY_ENTER) ||
+                    (key_pressed == '\n') || (key_pressed == '\r') ||
+                    (key_pressed == 'q') || (key_pressed == 'Q'))
+                break;
+            else if ((key_pressed == KEY_UP) || (key_pressed == KEY_DOWN) ||
+                    (key_pressed == KEY_PPAGE) || (key_pressed == KEY_NPAGE) ||
+                    (key_pressed == KEY_HOME) || (key_pressed == KEY_END) ||
+                    (key_pressed == 'g') || (key_pressed == 'G'))
+                injectCDKSwindow(jobs_info, key_pressed);
+        }
+        cbreak();
+        break;
+    }
+
+    /* Done */
+    if (jobs_info)
+        destroyCDKSwindow(jobs_info);
+    refreshCDKScreen(main_cdk_screen);
+    FREE_NULL(swindow_title);
+    freeRowArena(&job_rows);
+    return;
+}
+
+
 /**
  * @brief Run the "About" dialog.
  */
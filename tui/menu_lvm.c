@@ -46,6 +46,7 @@ int getPVSelection(CDKSCREEN *cdk_screen, boolean avail_only,
             *selection_list[MAX_LVM_PVS] = {NULL};
     int pv_cnt = 0, i = 0, status = 0, chosen_pv_cnt = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
@@ -53,6 +54,7 @@ int getPVSelection(CDKSCREEN *cdk_screen, boolean avail_only,
         snprintf(command_str, MAX_SHELL_CMD_LEN, "%s --separator , "
                 "--noheadings --options pv_name,pv_size,vg_name %s 2>&1",
                 PVS_BIN, (avail_only ? "--select 'pv_pe_count=0'" : ""));
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -82,6 +84,7 @@ int getPVSelection(CDKSCREEN *cdk_screen, boolean avail_only,
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("pvs", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
@@ -192,6 +195,7 @@ int getVGChoice(CDKSCREEN *cdk_screen, char name[], char size[],
             output_line[MAX_CMD_LINE_LEN] = {0};
     int vg_cnt = 0, i = 0, status = 0, user_choice = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
@@ -199,6 +203,7 @@ int getVGChoice(CDKSCREEN *cdk_screen, char name[], char size[],
         snprintf(command_str, MAX_SHELL_CMD_LEN,
                 "%s --separator , --noheadings --options "
                 "vg_name,vg_size,vg_free,pv_count,lv_count 2>&1", VGS_BIN);
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -235,6 +240,7 @@ int getVGChoice(CDKSCREEN *cdk_screen, char name[], char size[],
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("vgs", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
@@ -331,12 +337,14 @@ int getLVChoice(CDKSCREEN *cdk_screen, char path[], char size[], char attr[]) {
             output_line[MAX_CMD_LINE_LEN] = {0};
     int lv_cnt = 0, i = 0, status = 0, user_choice = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
         /* Put the command string together and execute it */
         snprintf(command_str, MAX_SHELL_CMD_LEN, "%s --separator , "
                 "--noheadings --options lv_path,lv_size,lv_attr 2>&1", LVS_BIN);
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -365,6 +373,7 @@ int getLVChoice(CDKSCREEN *cdk_screen, char path[], char size[], char attr[]) {
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("lvs", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
@@ -446,9 +455,11 @@ void lvm2InfoDialog(CDKSCREEN *main_cdk_screen) {
     int i = 0, line_pos = 0, status = 0, ret_val = 0;
     char line[LVM2_INFO_COLS] = {0};
     FILE *lvdisplay_proc = NULL;
+    struct timespec prof_start = {0};
 
     /* Run the lvdisplay command */
     SAFE_ASPRINTF(&lvdisplay_cmd, "%s --all 2>&1", LVDISPLAY_BIN);
+    startProfile(&prof_start);
     if ((lvdisplay_proc = popen(lvdisplay_cmd, "r")) == NULL) {
         SAFE_ASPRINTF(&error_msg, "Couldn't open process for the %s command!",
                 LVDISPLAY_BIN);
@@ -483,6 +494,7 @@ void lvm2InfoDialog(CDKSCREEN *main_cdk_screen) {
             else
                 ret_val = -1;
         }
+        endProfile("lvdisplay --all", &prof_start);
         if (ret_val == 0) {
             /* Setup scrolling window widget */
             SAFE_ASPRINTF(&swindow_title,
@@ -815,11 +827,10 @@ void remVGDialog(CDKSCREEN *main_cdk_screen) {
 void addLVDialog(CDKSCREEN *main_cdk_screen) {
     WINDOW *new_lv_window = 0;
     CDKSCREEN *new_lv_screen = 0;
-    CDKLABEL *new_lv_label = 0, *add_lv_msg = 0;
+    CDKLABEL *new_lv_label = 0;
     CDKBUTTON *ok_button = 0, *cancel_button = 0;
     CDKENTRY *lv_name = 0, *lv_size = 0;
     tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
-    char *error_msg = NULL;
     char vg_name[MISC_STRING_LEN] = {0},
             vg_size[MISC_STRING_LEN] = {0},
             vg_free_space[MISC_STRING_LEN] = {0},
@@ -827,11 +838,11 @@ void addLVDialog(CDKSCREEN *main_cdk_screen) {
             vg_lv_cnt[MISC_STRING_LEN] = {0},
             lv_name_str[MISC_STRING_LEN] = {0},
             lv_size_str[MISC_STRING_LEN] = {0},
-            command_str[MAX_SHELL_CMD_LEN] = {0};
+            command_str[MAX_SHELL_CMD_LEN] = {0},
+            job_name[JOB_NAME_SIZE] = {0};
     char *new_lv_msg[NEW_LV_INFO_LINES] = {NULL};
     int vg_cnt = 0, window_y = 0, window_x = 0, traverse_ret = 0, i = 0,
-            exit_stat = 0, ret_val = 0, new_lv_window_lines = 0,
-            new_lv_window_cols = 0;
+            new_lv_window_lines = 0, new_lv_window_cols = 0;
 
     /* Let the user pick a LVM volume group */
     if ((vg_cnt = getVGChoice(main_cdk_screen, vg_name, vg_size,
@@ -958,34 +969,17 @@ void addLVDialog(CDKSCREEN *main_cdk_screen) {
         if (!checkInputStr(main_cdk_screen, ASCII_CHARS, lv_size_str))
             return;
 
-        /* Display a label message while adding the logical volume */
-        add_lv_msg = newCDKLabel(main_cdk_screen, CENTER, CENTER,
-                g_add_lv_label_msg, g_add_lv_label_msg_size(),
-                TRUE, FALSE);
-        if (!add_lv_msg) {
-            errorDialog(main_cdk_screen, LABEL_ERR_MSG, NULL);
-            return;
-        }
-        setCDKLabelBackgroundAttrib(add_lv_msg,
-                g_color_dialog_text[g_curr_theme]);
-        setCDKLabelBoxAttribute(add_lv_msg,
-                g_color_dialog_box[g_curr_theme]);
-        refreshCDKScreen(main_cdk_screen);
-
-        /* Add the new LVM logical volume */
+        /* Adding the new LVM logical volume can take a while (eg, if it
+         * gets zeroed) so it runs in the background */
         snprintf(command_str, MAX_SHELL_CMD_LEN, "%s --name %s --size %sG "
                 "--type linear %s > /dev/null 2>&1", LVCREATE_BIN, lv_name_str,
                 lv_size_str, vg_name);
-        ret_val = system(command_str);
-        if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
-            SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR, LVCREATE_BIN, exit_stat);
-            errorDialog(main_cdk_screen, error_msg, NULL);
-            FREE_NULL(error_msg);
-        }
+        snprintf(job_name, JOB_NAME_SIZE, "Create LV %s", lv_name_str);
+        jobQueuedDialog(main_cdk_screen,
+                submitCmdJob(job_name, LVCREATE_BIN, command_str));
     }
 
     /* Done */
-    destroyCDKLabel(add_lv_msg);
     refreshCDKScreen(main_cdk_screen);
     return;
 }
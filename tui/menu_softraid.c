@@ -47,6 +47,7 @@ int getMDArrayChoice(CDKSCREEN *cdk_screen, char level[], char dev_cnt[],
             output_line[MAX_CMD_LINE_LEN] = {0};
     int array_cnt = 0, i = 0, status = 0, user_choice = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
@@ -54,6 +55,7 @@ int getMDArrayChoice(CDKSCREEN *cdk_screen, char level[], char dev_cnt[],
         snprintf(command_str, MAX_SHELL_CMD_LEN,
                 "%s --detail --scan --export 2>&1",
                 MDADM_BIN);
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -96,6 +98,7 @@ int getMDArrayChoice(CDKSCREEN *cdk_screen, char level[], char dev_cnt[],
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("mdadm --detail --scan", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
@@ -188,12 +191,14 @@ int getMDMemberDevChoice(CDKSCREEN *cdk_screen, char dev_path[],
             output_line[MAX_CMD_LINE_LEN] = {0};
     int dev_cnt = 0, i = 0, status = 0, user_choice = 0;
     FILE *shell_cmd = NULL;
+    struct timespec prof_start = {0};
     boolean user_quit = FALSE;
 
     while (1) {
         /* Put the command string together and execute it */
         snprintf(command_str, MAX_SHELL_CMD_LEN,
                 "%s --detail %s --export 2>&1", MDADM_BIN, dev_path);
+        startProfile(&prof_start);
         shell_cmd = popen(command_str, "r");
         if (!shell_cmd) {
             SAFE_ASPRINTF(&error_msg, "popen(): %s", strerror(errno));
@@ -225,6 +230,7 @@ int getMDMemberDevChoice(CDKSCREEN *cdk_screen, char dev_path[],
                 }
             }
             status = pclose(shell_cmd);
+            endProfile("mdadm --detail", &prof_start);
             if (status == -1) {
                 SAFE_ASPRINTF(&error_msg, "pclose(): %s", strerror(errno));
                 errorDialog(cdk_screen, error_msg, NULL);
@@ -371,23 +377,23 @@ void softRAIDStatDialog(CDKSCREEN *main_cdk_screen) {
 void addArrayDialog(CDKSCREEN *main_cdk_screen) {
     WINDOW *new_array_window = 0;
     CDKSCREEN *new_array_screen = 0;
-    CDKLABEL *new_array_label = 0, *add_array_msg = 0;
+    CDKLABEL *new_array_label = 0;
     CDKBUTTON *ok_button = 0, *cancel_button = 0;
     CDKRADIO *chunk_size = 0, *raid_lvl = 0;
     CDKENTRY *array_name = 0;
     tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
-    int chosen_dev_cnt = 0, i = 0, ret_val = 0, exit_stat = 0,
-            traverse_ret = 0, window_y = 0, window_x = 0,
-            new_array_window_lines = 0, new_array_window_cols = 0,
+    int chosen_dev_cnt = 0, i = 0, traverse_ret = 0, window_y = 0,
+            window_x = 0, new_array_window_lines = 0, new_array_window_cols = 0,
             dev_info_size = 0, dev_info_line_size = 0;
-    char *error_msg = NULL, *temp_pstr = NULL;
+    char *temp_pstr = NULL;
     char *new_array_msg[NEW_ARRAY_INFO_LINES] = {NULL};
     char blk_dev_list[MAX_MD_MEMBERS][MISC_STRING_LEN] = {0, 0},
             dev_info_line_buffer[MAX_DEV_INFO_LINE_BUFF] = {0},
             array_name_str[MISC_STRING_LEN] = {0},
             raid_lvl_str[MISC_STRING_LEN] = {0},
             chunk_size_str[MISC_STRING_LEN] = {0},
-            command_str[MAX_SHELL_CMD_LEN] = {0};
+            command_str[MAX_SHELL_CMD_LEN] = {0},
+            job_name[JOB_NAME_SIZE] = {0};
     boolean finished = FALSE;
 
     /* The user first needs to select the block devices to use */
@@ -547,36 +553,19 @@ void addArrayDialog(CDKSCREEN *main_cdk_screen) {
         if (!checkInputStr(main_cdk_screen, NAME_CHARS, array_name_str))
             return;
 
-        /* Display a label message while adding the array */
-        add_array_msg = newCDKLabel(main_cdk_screen, CENTER, CENTER,
-                g_add_array_label_msg, g_add_array_label_msg_size(),
-                TRUE, FALSE);
-        if (!add_array_msg) {
-            errorDialog(main_cdk_screen, LABEL_ERR_MSG, NULL);
-            return;
-        }
-        setCDKLabelBackgroundAttrib(add_array_msg,
-                g_color_dialog_text[g_curr_theme]);
-        setCDKLabelBoxAttribute(add_array_msg,
-                g_color_dialog_box[g_curr_theme]);
-        refreshCDKScreen(main_cdk_screen);
-
-        /* Add the new MD array */
+        /* Creating the array runs in the background (mdadm can take a
+         * while to start it); the resync is shown in the MD status */
         snprintf(command_str, MAX_SHELL_CMD_LEN, "%s --create --run "
                 "/dev/md/%s --name=%s --level=%s --raid-devices=%d "
                 "--chunk=%s %s > /dev/null 2>&1", MDADM_BIN, array_name_str,
                 array_name_str, raid_lvl_str, chosen_dev_cnt, chunk_size_str,
                 dev_info_line_buffer);
-        ret_val = system(command_str);
-        if ((exit_stat = WEXITSTATUS(ret_val)) != 0) {
-            SAFE_ASPRINTF(&error_msg, CMD_FAILED_ERR, MDADM_BIN, exit_stat);
-            errorDialog(main_cdk_screen, error_msg, NULL);
-            FREE_NULL(error_msg);
-        }
+        snprintf(job_name, JOB_NAME_SIZE, "Create array %s", array_name_str);
+        jobQueuedDialog(main_cdk_screen,
+                submitCmdJob(job_name, MDADM_BIN, command_str));
     }
 
     /* Done */
-    destroyCDKLabel(add_array_msg);
     refreshCDKScreen(main_cdk_screen);
     return;
 }
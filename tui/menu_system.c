@@ -15,6 +15,9 @@
 #include <string.h>
 #include <cdk/swindow.h>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <fcntl.h>
 #include <assert.h>
 
 #include "prototypes.h"
@@ -2040,9 +2043,11 @@ void crmStatusDialog(CDKSCREEN *main_cdk_screen) {
     int i = 0, line_pos = 0, status = 0, ret_val = 0;
     char line[CRM_INFO_COLS] = {0};
     FILE *crm_proc = NULL;
+    struct timespec prof_start = {0};
 
     /* Run the crm command */
     SAFE_ASPRINTF(&crm_cmd, "%s status 2>&1", CRM_TOOL);
+    startProfile(&prof_start);
     if ((crm_proc = popen(crm_cmd, "r")) == NULL) {
         SAFE_ASPRINTF(&error_msg,
                 "Couldn't open process for the %s command!", CRM_TOOL);
@@ -2077,6 +2082,7 @@ void crmStatusDialog(CDKSCREEN *main_cdk_screen) {
             else
                 ret_val = -1;
         }
+        endProfile("crm status", &prof_start);
         if (ret_val == 0) {
             /* Setup scrolling window widget */
             SAFE_ASPRINTF(&swindow_title, "<C></%d/B>CRM Status\n",
@@ -2583,3 +2589,516 @@ void drbdStatDialog(CDKSCREEN *main_cdk_screen) {
         FREE_NULL(swindow_info[i]);
     return;
 }
+
+
+/**
+ * @brief Fill the rows for the benchmark window: the setup and the totals
+ * (so far) while it's running, then the results with the latency
+ * percentiles from its histogram once its jobs are finished.
+ */
+void formatBenchRows(row_arena_t *rows, bench_t *bench, long long ios,
+        long long bytes, long long elapsed, boolean running) {
+    static const double percentiles[] = {50.0, 90.0, 95.0, 99.0, 99.9, 99.99};
+    char size_str[MISC_STRING_LEN] = {0};
+    double secs = 0.0;
+    int i = 0;
+
+    secs = ((elapsed > 0) ? (elapsed / 1000000000.0) : 1.0);
+    addArenaRow(rows, "</B>Target:<!B>\t%.56s", bench->path);
+    addArenaRow(rows, "</B>Test:<!B>\t\t%s, %d KiB blocks, queue depth %d "
+            "x %d job(s)", g_bench_test_opts[bench->test],
+            (bench->block_size / 1024), bench->queue_depth, bench->jobs);
+    addArenaRow(rows, " ");
+    addArenaRow(rows, "</B>Elapsed:<!B>\t%.0f of %d seconds", secs,
+            bench->run_time);
+    addArenaRow(rows, "</B>I/O Done:<!B>\t%lld (%s)", ios,
+            prettyFormatBytesBuf(bytes, size_str, MISC_STRING_LEN));
+    addArenaRow(rows, "</B>IOPS:<!B>\t\t%.0f", (ios / secs));
+    addArenaRow(rows, "</B>Throughput:<!B>\t%.1f MiB/s",
+            ((bytes / secs) / 1048576.0));
+    if (running || (bench->hist.total == 0))
+        return;
+
+    addArenaRow(rows, " ");
+    addArenaRow(rows, "</B>Latency (usec):<!B>\tmin %.1f, mean %.1f, "
+            "max %.1f", (bench->hist.min / 1000.0),
+            ((bench->hist.sum / bench->hist.total) / 1000.0),
+            (bench->hist.max / 1000.0));
+    for (i = 0; i < (int) (sizeof (percentiles) / sizeof (*percentiles));
+            i++)
+        addArenaRow(rows, "\t\t%6.2fth percentile: %.1f", percentiles[i],
+                (histPercentile(&bench->hist, percentiles[i]) / 1000.0));
+    return;
+}
+
+
+/**
+ * @brief Run the "I/O Benchmark" dialog; a block device or a (vdisk) file
+ * is tested with direct, asynchronous I/O for a while, showing the totals
+ * as it goes and the IOPS, throughput and latency percentiles at the end.
+ * A write test destroys the data, so it's refused on a block device that's
+ * in use (mounted, held, etc.) or any target that SCST is using.
+ */
+void benchmarkDialog(CDKSCREEN *main_cdk_screen) {
+    CDKSCROLL *target_type_list = 0;
+    CDKFSELECT *file_select = 0;
+    WINDOW *bench_window = 0;
+    CDKSCREEN *bench_screen = 0;
+    CDKLABEL *bench_label = 0;
+    CDKRADIO *test_type = 0;
+    CDKENTRY *block_size = 0, *queue_depth = 0, *job_cnt = 0, *run_time = 0;
+    CDKBUTTON *ok_button = 0, *cancel_button = 0;
+    CDKSWINDOW *bench_info = 0;
+    tButtonCallback ok_cb = &okButtonCB, cancel_cb = &cancelButtonCB;
+    char fs_name[MAX_FS_ATTR_LEN] = {0}, fs_path[MAX_FS_ATTR_LEN] = {0},
+            fs_type[MAX_FS_ATTR_LEN] = {0},
+            target[MAX_VDISK_PATH_LEN] = {0},
+            scst_dev[MISC_STRING_LEN] = {0},
+            disk_name[MISC_STRING_LEN] = {0},
+            attr_path[MAX_SYSFS_PATH_SIZE] = {0},
+            attr_value[MAX_SYSFS_ATTR_SIZE] = {0},
+            size_str[MISC_STRING_LEN] = {0},
+            entry_str[MISC_STRING_LEN] = {0},
+            bench_err[MISC_STRING_LEN] = {0};
+    char *error_msg = NULL, *scroll_title = NULL, *fselect_title = NULL,
+            *selected_file = NULL, *block_dev = NULL, *swindow_title = NULL,
+            *confirm_msg = NULL;
+    char *bench_dialog_msg[BENCH_SETUP_INFO_LINES] = {NULL};
+    boolean mounted = FALSE, write_test = FALSE, confirm = FALSE,
+            running = FALSE, in_use = FALSE, stopped = FALSE;
+    struct stat target_stat = {0};
+    long long target_size = 0, ios = 0, bytes = 0, elapsed = 0;
+    int target_choice = 0, window_y = 0, window_x = 0, traverse_ret = 0,
+            i = 0, key_pressed = 0, top_line = 0, bench_window_lines = 0,
+            bench_window_cols = 0, block_kb = 0;
+    str_pool_t in_use_devs = {0};
+    row_arena_t bench_rows = {0};
+    bench_t *bench = NULL;
+
+    /* Choose block device or file on a file system */
+    SAFE_ASPRINTF(&scroll_title, "<C></%d/B>Choose a Benchmark Target\n",
+            g_color_dialog_title[g_curr_theme]);
+    target_type_list = newCDKScroll(main_cdk_screen, CENTER, CENTER, NONE,
+            8, 26, scroll_title, g_fio_types, 2,
+            FALSE, g_color_dialog_select[g_curr_theme], TRUE, FALSE);
+    if (!target_type_list) {
+        errorDialog(main_cdk_screen, SCROLL_ERR_MSG, NULL);
+        FREE_NULL(scroll_title);
+        return;
+    }
+    setCDKScrollBoxAttribute(target_type_list,
+            g_color_dialog_box[g_curr_theme]);
+    setCDKScrollBackgroundAttrib(target_type_list,
+            g_color_dialog_text[g_curr_theme]);
+    target_choice = activateCDKScroll(target_type_list, 0);
+    if (target_type_list->exitType != vNORMAL)
+        target_choice = -1;
+    destroyCDKScroll(target_type_list);
+    FREE_NULL(scroll_title);
+    refreshCDKScreen(main_cdk_screen);
+
+    if (target_choice == 0) {
+        /* Have the user select a file system, then a file on it */
+        getFSChoice(main_cdk_screen, fs_name, fs_path, fs_type, &mounted);
+        if (fs_name[0] == '\0')
+            return;
+        if (!mounted) {
+            errorDialog(main_cdk_screen,
+                    "The selected file system is not mounted!", NULL);
+            return;
+        }
+        SAFE_ASPRINTF(&fselect_title,
+                "<C></%d/B>Choose a file to benchmark:\n",
+                g_color_dialog_title[g_curr_theme]);
+        file_select = newCDKFselect(main_cdk_screen, CENTER, CENTER, 20, 40,
+                fselect_title, "File: ", g_color_dialog_input[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme],
+                A_REVERSE, "</N>", "</B>", "</N>", "</N>", TRUE, FALSE);
+        if (!file_select) {
+            errorDialog(main_cdk_screen, FSELECT_ERR_MSG, NULL);
+            FREE_NULL(fselect_title);
+            return;
+        }
+        setCDKFselectBoxAttribute(file_select,
+                g_color_dialog_box[g_curr_theme]);
+        setCDKFselectBackgroundAttrib(file_select,
+                g_color_dialog_text[g_curr_theme]);
+        setCDKFselectDirectory(file_select, fs_path);
+        selected_file = activateCDKFselect(file_select, 0);
+        if (file_select->exitType == vNORMAL)
+            snprintf(target, MAX_VDISK_PATH_LEN, "%s", selected_file);
+        destroyCDKFselect(file_select);
+        /* Using the file selector widget changes the CWD -- fix it */
+        if ((chdir(getenv("HOME"))) == -1) {
+            SAFE_ASPRINTF(&error_msg, "chdir(): %s", strerror(errno));
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+        }
+        FREE_NULL(fselect_title);
+        refreshCDKScreen(main_cdk_screen);
+
+    } else if (target_choice == 1) {
+        /* Get block device choice from user */
+        if ((block_dev = getBlockDevChoice(main_cdk_screen)) == NULL)
+            return;
+        snprintf(target, MAX_VDISK_PATH_LEN, "%s", block_dev);
+    }
+    if (target[0] == '\0')
+        return;
+
+    while (1) {
+        if (stat(target, &target_stat) == -1) {
+            SAFE_ASPRINTF(&error_msg, "stat(): %s", strerror(errno));
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+            break;
+        }
+        if (S_ISBLK(target_stat.st_mode)) {
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%u:%u/size",
+                    SYSFS_DEV_BLOCK, major(target_stat.st_rdev),
+                    minor(target_stat.st_rdev));
+            if (readAttribute(attr_path, attr_value) == 0)
+                target_size = strtoll(attr_value, NULL, 10) * 512LL;
+        } else if (S_ISREG(target_stat.st_mode)) {
+            target_size = target_stat.st_size;
+        } else {
+            errorDialog(main_cdk_screen, "The selected target is not a "
+                    "block device or a regular file!", NULL);
+            break;
+        }
+
+        /* Setup a new small CDK screen for the benchmark setup */
+        bench_window_lines = 15;
+        bench_window_cols = 70;
+        window_y = ((LINES / 2) - (bench_window_lines / 2));
+        window_x = ((COLS / 2) - (bench_window_cols / 2));
+        bench_window = newwin(bench_window_lines, bench_window_cols,
+                window_y, window_x);
+        if (bench_window == NULL) {
+            errorDialog(main_cdk_screen, NEWWIN_ERR_MSG, NULL);
+            break;
+        }
+        bench_screen = initCDKScreen(bench_window);
+        if (bench_screen == NULL) {
+            errorDialog(main_cdk_screen, CDK_SCR_ERR_MSG, NULL);
+            break;
+        }
+        boxWindow(bench_window, g_color_dialog_box[g_curr_theme]);
+        wbkgd(bench_window, g_color_dialog_text[g_curr_theme]);
+        wrefresh(bench_window);
+
+        /* Fill the information label */
+        SAFE_ASPRINTF(&bench_dialog_msg[0],
+                "</%d/B>Benchmarking a %s...",
+                g_color_dialog_title[g_curr_theme],
+                (S_ISBLK(target_stat.st_mode) ? "block device" : "file"));
+        SAFE_ASPRINTF(&bench_dialog_msg[1], " ");
+        SAFE_ASPRINTF(&bench_dialog_msg[2], "</B>Target:<!B>\t%.56s", target);
+        SAFE_ASPRINTF(&bench_dialog_msg[3], "</B>Size:<!B>\t%s",
+                prettyFormatBytesBuf(target_size, size_str,
+                MISC_STRING_LEN));
+        bench_label = newCDKLabel(bench_screen, (window_x + 1),
+                (window_y + 1), bench_dialog_msg, BENCH_SETUP_INFO_LINES,
+                FALSE, FALSE);
+        if (!bench_label) {
+            errorDialog(main_cdk_screen, LABEL_ERR_MSG, NULL);
+            break;
+        }
+        setCDKLabelBackgroundAttrib(bench_label,
+                g_color_dialog_text[g_curr_theme]);
+
+        /* Test (radio) */
+        test_type = newCDKRadio(bench_screen, (window_x + 1), (window_y + 6),
+                NONE, 5, 22, "</B>Test", g_bench_test_opts, 4,
+                '#' | g_color_dialog_select[g_curr_theme], 1,
+                g_color_dialog_select[g_curr_theme], FALSE, FALSE);
+        if (!test_type) {
+            errorDialog(main_cdk_screen, RADIO_ERR_MSG, NULL);
+            break;
+        }
+        setCDKRadioBackgroundAttrib(test_type,
+                g_color_dialog_text[g_curr_theme]);
+        setCDKRadioCurrentItem(test_type, BENCH_RAND_READ);
+
+        /* Block size, queue depth, jobs and run time */
+        block_size = newCDKEntry(bench_screen, (window_x + 30),
+                (window_y + 6), "</B>Block Size (KiB)", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                6, 1, 4, FALSE, FALSE);
+        if (!block_size) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(block_size,
+                g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(block_size,
+                g_color_dialog_text[g_curr_theme]);
+        snprintf(entry_str, MISC_STRING_LEN, "%d", BENCH_DEF_BLOCK_KB);
+        setCDKEntryValue(block_size, entry_str);
+
+        queue_depth = newCDKEntry(bench_screen, (window_x + 50),
+                (window_y + 6), "</B>Queue Depth", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                4, 1, 3, FALSE, FALSE);
+        if (!queue_depth) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(queue_depth,
+                g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(queue_depth,
+                g_color_dialog_text[g_curr_theme]);
+        snprintf(entry_str, MISC_STRING_LEN, "%d", BENCH_DEF_QUEUE_DEPTH);
+        setCDKEntryValue(queue_depth, entry_str);
+
+        job_cnt = newCDKEntry(bench_screen, (window_x + 30),
+                (window_y + 9), "</B>Jobs", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                4, 1, 2, FALSE, FALSE);
+        if (!job_cnt) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(job_cnt, g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(job_cnt,
+                g_color_dialog_text[g_curr_theme]);
+        snprintf(entry_str, MISC_STRING_LEN, "%d", BENCH_DEF_JOBS);
+        setCDKEntryValue(job_cnt, entry_str);
+
+        run_time = newCDKEntry(bench_screen, (window_x + 50),
+                (window_y + 9), "</B>Run Time (s)", NULL,
+                g_color_dialog_select[g_curr_theme],
+                '_' | g_color_dialog_input[g_curr_theme], vINT,
+                6, 1, 4, FALSE, FALSE);
+        if (!run_time) {
+            errorDialog(main_cdk_screen, ENTRY_ERR_MSG, NULL);
+            break;
+        }
+        setCDKEntryBoxAttribute(run_time, g_color_dialog_input[g_curr_theme]);
+        setCDKEntryBackgroundAttrib(run_time,
+                g_color_dialog_text[g_curr_theme]);
+        snprintf(entry_str, MISC_STRING_LEN, "%d", BENCH_DEF_RUN_TIME);
+        setCDKEntryValue(run_time, entry_str);
+
+        /* Buttons */
+        ok_button = newCDKButton(bench_screen, (window_x + 26),
+                (window_y + 13), g_ok_cancel_msg[0], ok_cb, FALSE, FALSE);
+        if (!ok_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(ok_button,
+                g_color_dialog_input[g_curr_theme]);
+        cancel_button = newCDKButton(bench_screen, (window_x + 36),
+                (window_y + 13), g_ok_cancel_msg[1], cancel_cb, FALSE, FALSE);
+        if (!cancel_button) {
+            errorDialog(main_cdk_screen, BUTTON_ERR_MSG, NULL);
+            break;
+        }
+        setCDKButtonBackgroundAttrib(cancel_button,
+                g_color_dialog_input[g_curr_theme]);
+
+        /* Allow user to traverse the screen */
+        refreshCDKScreen(bench_screen);
+        traverse_ret = traverseCDKScreen(bench_screen);
+        if (traverse_ret != 1)
+            break;
+
+        /* User hit 'OK' button; turn the cursor off (pretty) */
+        curs_set(0);
+        if ((bench = calloc(1, sizeof (bench_t))) == NULL) {
+            errorDialog(main_cdk_screen, "Calling calloc() failed.", NULL);
+            break;
+        }
+        snprintf(bench->path, MAX_VDISK_PATH_LEN, "%s", target);
+        bench->fd = -1;
+        bench->test = (bench_test_t) getCDKRadioSelectedItem(test_type);
+        block_kb = atoi(getCDKEntryValue(block_size));
+        if ((block_kb < (BENCH_ALIGN / 1024)) ||
+                (block_kb > MAX_BENCH_BLOCK_KB) ||
+                ((block_kb % (BENCH_ALIGN / 1024)) != 0)) {
+            SAFE_ASPRINTF(&error_msg, "The block size must be a multiple "
+                    "of %d KiB, up to %d KiB.", (BENCH_ALIGN / 1024),
+                    MAX_BENCH_BLOCK_KB);
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+            break;
+        }
+        bench->block_size = (block_kb * 1024);
+        bench->queue_depth = atoi(getCDKEntryValue(queue_depth));
+        if ((bench->queue_depth < 1) ||
+                (bench->queue_depth > MAX_BENCH_QUEUE_DEPTH)) {
+            SAFE_ASPRINTF(&error_msg, "The queue depth must be "
+                    "between 1 and %d.", MAX_BENCH_QUEUE_DEPTH);
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+            break;
+        }
+        bench->jobs = atoi(getCDKEntryValue(job_cnt));
+        if ((bench->jobs < 1) || (bench->jobs > MAX_BENCH_JOBS)) {
+            SAFE_ASPRINTF(&error_msg, "The number of jobs must be "
+                    "between 1 and %d.", MAX_BENCH_JOBS);
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+            break;
+        }
+        bench->run_time = atoi(getCDKEntryValue(run_time));
+        if ((bench->run_time < 1) || (bench->run_time > MAX_BENCH_RUN_TIME)) {
+            SAFE_ASPRINTF(&error_msg, "The run time must be between 1 "
+                    "and %d seconds.", MAX_BENCH_RUN_TIME);
+            errorDialog(main_cdk_screen, error_msg, NULL);
+            FREE_NULL(error_msg);
+            break;
+        }
+
+        /* Clean up the screen */
+        destroyCDKScreenObjects(bench_screen);
+        destroyCDKScreen(bench_screen);
+        bench_screen = NULL;
+        delwin(bench_window);
+        bench_window = NULL;
+        refreshCDKScreen(main_cdk_screen);
+
+        /* Writing destroys the data, so only unused targets are allowed */
+        write_test = ((bench->test == BENCH_SEQ_WRITE) ||
+                (bench->test == BENCH_RAND_WRITE));
+        if (write_test) {
+            if (findSCSTFileDev(target, scst_dev)) {
+                SAFE_ASPRINTF(&error_msg, "This target is in use by SCST "
+                        "device '%s';", scst_dev);
+                errorDialog(main_cdk_screen, error_msg,
+                        "write tests are only allowed on unused targets.");
+                FREE_NULL(error_msg);
+                break;
+            }
+            if (S_ISBLK(target_stat.st_mode)) {
+                if (!findBlockDevsInUse(&in_use_devs)) {
+                    errorDialog(main_cdk_screen, "Calling malloc() failed.",
+                            NULL);
+                    break;
+                }
+                snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%u:%u",
+                        SYSFS_DEV_BLOCK, major(target_stat.st_rdev),
+                        minor(target_stat.st_rdev));
+                in_use = (getBlockDiskName(AT_FDCWD, attr_path, disk_name) &&
+                        (lookupStr(&in_use_devs, disk_name) != -1));
+                if (in_use) {
+                    SAFE_ASPRINTF(&error_msg, "Block device %s (or another "
+                            "part of disk %s) is in use;", target, disk_name);
+                    errorDialog(main_cdk_screen, error_msg,
+                            "write tests are only allowed on unused targets.");
+                    FREE_NULL(error_msg);
+                    break;
+                }
+            }
+            SAFE_ASPRINTF(&confirm_msg, "%s will be overwritten!", target);
+            confirm = confirmDialog(main_cdk_screen, confirm_msg,
+                    "All of the data on it will be lost.");
+            FREE_NULL(confirm_msg);
+            if (!confirm)
+                break;
+        }
+
+        if (!startBenchmark(bench, bench_err)) {
+            errorDialog(main_cdk_screen, bench_err, NULL);
+            break;
+        }
+        running = TRUE;
+
+        /* Show the totals while it runs, then the results */
+        if (!initRowArena(&bench_rows, MAX_BENCH_INFO_LINES,
+                BENCH_ROW_SIZE)) {
+            errorDialog(main_cdk_screen, ROW_ARENA_ERR_MSG, NULL);
+            break;
+        }
+        SAFE_ASPRINTF(&swindow_title, "<C></%d/B>I/O Benchmark\n",
+                g_color_dialog_title[g_curr_theme]);
+        bench_info = newCDKSwindow(main_cdk_screen, CENTER, CENTER,
+                (BENCH_INFO_ROWS + 2), (BENCH_INFO_COLS + 2),
+                swindow_title, MAX_BENCH_INFO_LINES, TRUE, FALSE);
+        if (!bench_info) {
+            errorDialog(main_cdk_screen, SWINDOW_ERR_MSG, NULL);
+            break;
+        }
+        setCDKSwindowBackgroundAttrib(bench_info,
+                g_color_dialog_text[g_curr_theme]);
+        setCDKSwindowBoxAttribute(bench_info,
+                g_color_dialog_box[g_curr_theme]);
+        keypad(bench_info->win, TRUE);
+
+        halfdelay(REFRESH_DELAY);
+        for (;;) {
+            /* The jobs are collected as soon as they're all done */
+            if (running && !benchProgress(bench, &ios, &bytes, &elapsed)) {
+                finishBenchmark(bench, bench_err);
+                running = FALSE;
+            }
+            resetRowArena(&bench_rows);
+            if (running)
+                addArenaRow(&bench_rows, "</B>Running; ESC to stop "
+                        "early.<!B>");
+            else if (bench_err[0] != '\0')
+                addArenaRow(&bench_rows, "</B>Failed: %.60s<!B>",
+                        bench_err);
+            else
+                addArenaRow(&bench_rows, "</B>%s; ESC or ENTER to "
+                        "close.<!B>", (stopped ? "Stopped early" :
+                        "Finished"));
+            addArenaRow(&bench_rows, " ");
+            formatBenchRows(&bench_rows, bench, ios, bytes, elapsed,
+                    running);
+            /* Setting the contents scrolls back to the top */
+            top_line = bench_info->currentTop;
+            setCDKSwindowContents(bench_info, bench_rows.lines,
+                    bench_rows.used);
+            bench_info->currentTop = MIN(top_line, bench_info->maxTopLine);
+            drawCDKSwindow(bench_info, TRUE);
+
+            key_pressed = wgetch(bench_info->win);
+            if (key_pressed == ERR) {
+                continue;
+            } else if ((key_pressed == KEY_ESC) ||
+                    (key_pressed == KEY_ENTER) || (key_pressed == '\n') ||
+                    (key_pressed == '\r') || (key_pressed == 'q') ||
+                    (key_pressed == 'Q')) {
+                if (!running)
+                    break;
+                stopBenchmark(bench);
+                stopped = TRUE;
+            } else if ((key_pressed == KEY_UP) ||
+                    (key_pressed == KEY_DOWN) ||
+                    (key_pressed == KEY_PPAGE) ||
+                    (key_pressed == KEY_NPAGE) ||
+                    (key_pressed == KEY_HOME) || (key_pressed == KEY_END)) {
+                injectCDKSwindow(bench_info, key_pressed);
+            }
+        }
+        cbreak();
+        break;
+    }
+
+    /* Done; a run that's still going (we bailed out) is stopped */
+    if (running) {
+        stopBenchmark(bench);
+        finishBenchmark(bench, bench_err);
+    }
+    for (i = 0; i < BENCH_SETUP_INFO_LINES; i++)
+        FREE_NULL(bench_dialog_msg[i]);
+    if (bench_screen != NULL) {
+        destroyCDKScreenObjects(bench_screen);
+        destroyCDKScreen(bench_screen);
+    }
+    if (bench_window != NULL)
+        delwin(bench_window);
+    if (bench_info)
+        destroyCDKSwindow(bench_info);
+    refreshCDKScreen(main_cdk_screen);
+    FREE_NULL(swindow_title);
+    freeRowArena(&bench_rows);
+    freeStrPool(&in_use_devs);
+    FREE_NULL(bench);
+    return;
+}
@@ -255,9 +255,16 @@ void issueLIPDialog(CDKSCREEN *main_cdk_screen) {
     char *error_msg = NULL, *swindow_title = NULL;
     char *swindow_msg[MAX_LIP_INFO_LINES] = {NULL};
     char attr_path[MAX_SYSFS_PATH_SIZE] = {0};
-    int i = 0, temp_int = 0;
+    int i = 0;
     DIR *dir_stream = NULL;
     struct dirent *dir_entry = NULL;
+    mgmt_batch_t lip_batch;
+
+    /* The LIPs are all issued at once (each host is independent) */
+    if (!initMgmtBatch(&lip_batch)) {
+        errorDialog(main_cdk_screen, MGMT_BATCH_ERR, NULL);
+        return;
+    }
 
     /* Setup scrolling window widget */
     SAFE_ASPRINTF(&swindow_title,
@@ -268,6 +275,8 @@ void issueLIPDialog(CDKSCREEN *main_cdk_screen) {
             swindow_title, MAX_LIP_INFO_LINES, TRUE, FALSE);
     if (!lip_info) {
         errorDialog(main_cdk_screen, SWINDOW_ERR_MSG, NULL);
+        FREE_NULL(swindow_title);
+        freeMgmtBatch(&lip_batch);
         return;
     }
     setCDKSwindowBackgroundAttrib(lip_info, g_color_dialog_text[g_curr_theme]);
@@ -295,21 +304,25 @@ void issueLIPDialog(CDKSCREEN *main_cdk_screen) {
                     i++;
                 }
 
-                /* Write the sysfs attribute (issue_lip) */
+                /* Queue the sysfs attribute write (issue_lip) */
                 snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/issue_lip",
                         SYSFS_FC_HOST, dir_entry->d_name);
-                if ((temp_int = writeAttribute(attr_path, "1")) != 0) {
-                    SAFE_ASPRINTF(&error_msg,
-                            "Couldn't issue LIP on FC host %s: %s",
-                            dir_entry->d_name, strerror(temp_int));
-                    errorDialog(main_cdk_screen, error_msg, NULL);
-                    FREE_NULL(error_msg);
+                if (addMgmtOp(&lip_batch, MGMT_OP_NO_DEP, attr_path,
+                        "1") == -1) {
+                    errorDialog(main_cdk_screen, MGMT_BATCH_ERR, NULL);
+                    break;
                 }
             }
         }
 
         /* Close the directory stream */
         closedir(dir_stream);
+
+        /* Issue them, and show how it went */
+        runMgmtBatch(&lip_batch);
+        if (lip_batch.failed > 0)
+            mgmtBatchDialog(main_cdk_screen, &lip_batch,
+                    "Issue LIP Results");
     }
 
     /* Done */
@@ -318,6 +331,7 @@ void issueLIPDialog(CDKSCREEN *main_cdk_screen) {
     for (i = 0; i < MAX_LIP_INFO_LINES; i++) {
         FREE_NULL(swindow_msg[i]);
     }
+    freeMgmtBatch(&lip_batch);
     return;
 }
 
@@ -0,0 +1,211 @@
+/**
+ * @file mgmt_batch.c
+ * @brief Functions for batches of SCST management (sysfs) writes; the
+ * independent writes are issued by a small pool of worker threads, and each
+ * operation gets its own result.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <syslog.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "mgmt_batch.h"
+
+
+/**
+ * @brief Setup an (empty) batch. Return FALSE if the lock or condition
+ * variable couldn't be initialized.
+ */
+boolean initMgmtBatch(mgmt_batch_t *batch) {
+    int ret_val = 0;
+
+    batch->ops = NULL;
+    batch->cnt = 0;
+    batch->alloc = 0;
+    batch->remaining = 0;
+    batch->failed = 0;
+    if ((ret_val = pthread_mutex_init(&batch->mutex, NULL)) != 0) {
+        DEBUG_LOG("pthread_mutex_init(): %s", strerror(ret_val));
+        return FALSE;
+    }
+    if ((ret_val = pthread_cond_init(&batch->cond, NULL)) != 0) {
+        DEBUG_LOG("pthread_cond_init(): %s", strerror(ret_val));
+        pthread_mutex_destroy(&batch->mutex);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
+/**
+ * @brief Add an operation to the batch; the value is formatted (printf
+ * style) and written to the given sysfs attribute when the batch is run.
+ * The operation is only issued once the (earlier) operation given by
+ * 'depends_on' has worked; use MGMT_OP_NO_DEP if it doesn't depend on
+ * anything. Return the operation index, or -1 if it couldn't be added.
+ */
+int addMgmtOp(mgmt_batch_t *batch, int depends_on, const char *path,
+        const char *format, ...) {
+    mgmt_op_t *new_ops = NULL, *op = NULL;
+    int new_alloc = 0;
+    va_list args;
+
+    /* An operation can only depend on one that is already in the batch */
+    if ((depends_on != MGMT_OP_NO_DEP) &&
+            ((depends_on < 0) || (depends_on >= batch->cnt))) {
+        DEBUG_LOG("Invalid mgmt operation dependency: %d", depends_on);
+        return -1;
+    }
+
+    /* Grow the operation list (doubling) */
+    if (batch->cnt == batch->alloc) {
+        new_alloc = (batch->alloc == 0) ? MGMT_BATCH_INIT_OPS :
+                (batch->alloc * 2);
+        if ((new_ops = realloc(batch->ops,
+                (sizeof (mgmt_op_t) * new_alloc))) == NULL) {
+            DEBUG_LOG("realloc(): %s", strerror(errno));
+            return -1;
+        }
+        batch->ops = new_ops;
+        batch->alloc = new_alloc;
+    }
+
+    op = &batch->ops[batch->cnt];
+    snprintf(op->path, MAX_SYSFS_PATH_SIZE, "%s", path);
+    va_start(args, format);
+    vsnprintf(op->value, MAX_SYSFS_ATTR_SIZE, format, args);
+    va_end(args);
+    op->depends_on = depends_on;
+    op->state = MGMT_OP_PENDING;
+    op->status = 0;
+    return batch->cnt++;
+}
+
+
+/**
+ * @brief A batch worker; keep taking the first pending operation that is
+ * ready (its dependency is done) and issue it, until every operation in the
+ * batch is done. An operation whose dependency failed is cancelled instead.
+ * The lock is never held across a sysfs write.
+ */
+void *mgmtBatchWorker(void *arg) {
+    mgmt_batch_t *batch = (mgmt_batch_t *) arg;
+    mgmt_op_t *op = NULL, *dep = NULL;
+    int i = 0, ret_val = 0;
+
+    pthread_mutex_lock(&batch->mutex);
+    while (batch->remaining > 0) {
+        op = NULL;
+        for (i = 0; i < batch->cnt; i++) {
+            if (batch->ops[i].state != MGMT_OP_PENDING)
+                continue;
+            if (batch->ops[i].depends_on == MGMT_OP_NO_DEP) {
+                op = &batch->ops[i];
+                break;
+            }
+            dep = &batch->ops[batch->ops[i].depends_on];
+            if (dep->state != MGMT_OP_DONE)
+                continue;
+            if (dep->status != 0) {
+                /* Anything depending on this one is cancelled (later in
+                 * this same pass) too */
+                batch->ops[i].state = MGMT_OP_DONE;
+                batch->ops[i].status = ECANCELED;
+                batch->failed++;
+                batch->remaining--;
+                pthread_cond_broadcast(&batch->cond);
+                continue;
+            }
+            op = &batch->ops[i];
+            break;
+        }
+
+        if (op == NULL) {
+            /* Everything left is waiting on a running operation */
+            if (batch->remaining > 0)
+                pthread_cond_wait(&batch->cond, &batch->mutex);
+            continue;
+        }
+
+        op->state = MGMT_OP_RUNNING;
+        pthread_mutex_unlock(&batch->mutex);
+        ret_val = writeAttribute(op->path, op->value);
+        pthread_mutex_lock(&batch->mutex);
+        op->status = ret_val;
+        op->state = MGMT_OP_DONE;
+        if (ret_val != 0)
+            batch->failed++;
+        batch->remaining--;
+        pthread_cond_broadcast(&batch->cond);
+    }
+    pthread_mutex_unlock(&batch->mutex);
+    return NULL;
+}
+
+
+/**
+ * @brief Run (issue) every operation in the batch, and wait for them all;
+ * the calling thread is one of the workers, so if no worker threads can be
+ * created the operations are simply issued one at a time. Return the number
+ * of operations that failed (or were cancelled); the result of each one is
+ * in its status.
+ */
+int runMgmtBatch(mgmt_batch_t *batch) {
+    pthread_t workers[MGMT_BATCH_WORKERS];
+    sigset_t old_set;
+    int i = 0, worker_cnt = 0, want_workers = 0, ret_val = 0;
+
+    if (batch->cnt == 0)
+        return 0;
+    for (i = 0; i < batch->cnt; i++) {
+        batch->ops[i].state = MGMT_OP_PENDING;
+        batch->ops[i].status = 0;
+    }
+    batch->remaining = batch->cnt;
+    batch->failed = 0;
+
+    /* Leave signal handling (SIGWINCH, SIGINT, etc.) to the UI thread; the
+     * new threads inherit this mask */
+    want_workers = ((batch->cnt < MGMT_BATCH_WORKERS) ? batch->cnt :
+            MGMT_BATCH_WORKERS) - 1;
+    blockThreadSignals(&old_set);
+    for (i = 0; i < want_workers; i++) {
+        if ((ret_val = pthread_create(&workers[worker_cnt], NULL,
+                mgmtBatchWorker, batch)) != 0) {
+            DEBUG_LOG("pthread_create(): %s", strerror(ret_val));
+            break;
+        }
+        worker_cnt++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+
+    /* We work on the batch too, then wait for the others */
+    mgmtBatchWorker(batch);
+    for (i = 0; i < worker_cnt; i++)
+        pthread_join(workers[i], NULL);
+    return batch->failed;
+}
+
+
+/**
+ * @brief Free the operations of a batch (and its lock).
+ */
+void freeMgmtBatch(mgmt_batch_t *batch) {
+    FREE_NULL(batch->ops);
+    batch->cnt = 0;
+    batch->alloc = 0;
+    pthread_mutex_destroy(&batch->mutex);
+    pthread_cond_destroy(&batch->cond);
+}
@@ -0,0 +1,56 @@
+/**
+ * @file mgmt_batch.h
+ * @brief Data structures for batches of SCST management (sysfs) writes.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _MGMT_BATCH_H
+#define	_MGMT_BATCH_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+#include "system.h"
+
+/* The most writes that are issued at the same time; SCST queues the mgmt
+ * commands (and waits for them) per write, so a few in flight is plenty */
+#define MGMT_BATCH_WORKERS      4
+#define MGMT_BATCH_INIT_OPS     32
+/* An operation that doesn't depend on an earlier one */
+#define MGMT_OP_NO_DEP          -1
+
+typedef enum {
+    MGMT_OP_PENDING, MGMT_OP_RUNNING, MGMT_OP_DONE
+} mgmt_op_state_t;
+
+/* One sysfs write (normally a "mgmt" command); the status is zero if it
+ * worked, otherwise the errno value (ECANCELED if the operation it depends
+ * on failed, so it was never issued) */
+typedef struct {
+    char path[MAX_SYSFS_PATH_SIZE];
+    char value[MAX_SYSFS_ATTR_SIZE];
+    int depends_on;
+    mgmt_op_state_t state;
+    int status;
+} mgmt_op_t;
+
+/* A list of operations; an operation only depends on an earlier one (eg,
+ * create a group, then add LUNs to it) so there are never any cycles */
+typedef struct {
+    mgmt_op_t *ops;
+    int cnt;
+    int alloc;
+    int remaining;
+    int failed;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} mgmt_batch_t;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _MGMT_BATCH_H */
@@ -0,0 +1,234 @@
+/**
+ * @file profile.c
+ * @brief Functions for timing the start-up phases and the (slow) data
+ * gathering parts of the dialogs; the timings are kept in memory as running
+ * statistics (with a histogram for the percentiles) per phase, and a ring
+ * buffer of the most recent ones.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <pthread.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "dialogs.h"
+#include "profile.h"
+
+
+/* Timings can come from any thread (eg, the start-up thread) so all of this
+ * is protected by the lock */
+pthread_mutex_t g_prof_mutex = PTHREAD_MUTEX_INITIALIZER;
+prof_phase_t g_prof_phases[MAX_PROFILE_PHASES];
+int g_prof_phase_cnt = 0;
+prof_sample_t g_prof_ring[PROFILE_RING_SIZE];
+unsigned long g_prof_ring_next = 0;
+struct timespec g_prof_epoch = {0};
+
+
+/**
+ * @brief Set the time everything else is relative to; called when the TUI
+ * starts.
+ */
+void initProfile() {
+    clock_gettime(CLOCK_MONOTONIC, &g_prof_epoch);
+}
+
+
+/**
+ * @brief Return the number of milliseconds from 'start' to 'end'.
+ */
+double profileDiffMsec(const struct timespec *start,
+        const struct timespec *end) {
+    return (((end->tv_sec - start->tv_sec) * 1000.0) +
+            ((end->tv_nsec - start->tv_nsec) / 1000000.0));
+}
+
+
+/**
+ * @brief Start timing a phase; the time is kept by the caller.
+ */
+void startProfile(struct timespec *start) {
+    clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+
+/**
+ * @brief Finish timing a phase (started with startProfile()) and record it;
+ * return the number of milliseconds it took.
+ */
+double endProfile(const char *phase, const struct timespec *start) {
+    struct timespec now = {0};
+    double msec = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    msec = profileDiffMsec(start, &now);
+    recordProfile(phase, msec);
+    return msec;
+}
+
+
+/**
+ * @brief Record a timing (in milliseconds) for the named phase. If the phase
+ * table is full, the timing only goes in the ring buffer (as phase -1).
+ */
+void recordProfile(const char *phase, double msec) {
+    struct timespec now = {0};
+    prof_phase_t *stats = NULL;
+    prof_sample_t *sample = NULL;
+    long usec = 0;
+    int i = 0, index = -1, bucket = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (msec < 0)
+        msec = 0;
+
+    pthread_mutex_lock(&g_prof_mutex);
+    for (i = 0; i < g_prof_phase_cnt; i++) {
+        if (strcmp(g_prof_phases[i].name, phase) == 0) {
+            index = i;
+            break;
+        }
+    }
+    if ((index == -1) && (g_prof_phase_cnt < MAX_PROFILE_PHASES)) {
+        index = g_prof_phase_cnt++;
+        memset(&g_prof_phases[index], 0, sizeof (prof_phase_t));
+        snprintf(g_prof_phases[index].name, PROFILE_PHASE_SIZE, "%s", phase);
+    }
+
+    if (index != -1) {
+        stats = &g_prof_phases[index];
+        if ((stats->count == 0) || (msec < stats->min_ms))
+            stats->min_ms = msec;
+        if (msec > stats->max_ms)
+            stats->max_ms = msec;
+        stats->total_ms += msec;
+        stats->count++;
+        /* Bucket N holds anything under 2^N microseconds */
+        usec = (long) (msec * 1000.0);
+        for (bucket = 0; bucket < (PROFILE_HIST_BUCKETS - 1); bucket++) {
+            if (usec < (1L << bucket))
+                break;
+        }
+        stats->hist[bucket]++;
+    }
+
+    sample = &g_prof_ring[g_prof_ring_next % PROFILE_RING_SIZE];
+    sample->phase = index;
+    sample->offset_ms = profileDiffMsec(&g_prof_epoch, &now) - msec;
+    sample->msec = msec;
+    g_prof_ring_next++;
+    pthread_mutex_unlock(&g_prof_mutex);
+}
+
+
+/**
+ * @brief Return (an upper bound of) the given percentile of a phase's
+ * timings in milliseconds, from its histogram; it is never more than the
+ * longest timing seen.
+ */
+double profilePercentile(const prof_phase_t *stats, double percent) {
+    unsigned long wanted = 0, seen = 0;
+    double bound = 0;
+    int i = 0;
+
+    if (stats->count == 0)
+        return 0;
+    wanted = (unsigned long) ((stats->count * percent) / 100.0);
+    if (wanted < 1)
+        wanted = 1;
+    for (i = 0; i < PROFILE_HIST_BUCKETS; i++) {
+        seen += stats->hist[i];
+        if (seen >= wanted)
+            break;
+    }
+    bound = (1L << i) / 1000.0;
+    return ((bound < stats->max_ms) ? bound : stats->max_ms);
+}
+
+
+/**
+ * @brief Format the statistics for each phase (plain text, one row each,
+ * with a header row) into the row arena. Return FALSE if the arena filled
+ * up before all of the phases were added.
+ */
+boolean formatProfileStats(row_arena_t *rows) {
+    prof_phase_t *stats = NULL;
+    boolean all_fit = TRUE;
+    int i = 0;
+
+    pthread_mutex_lock(&g_prof_mutex);
+    if (!addArenaRow(rows, "%-30.30s %6s %8s %8s %8s %8s", "Phase",
+            "Count", "Min ms", "Avg ms", "P99 ms", "Max ms"))
+        all_fit = FALSE;
+    for (i = 0; (i < g_prof_phase_cnt) && all_fit; i++) {
+        stats = &g_prof_phases[i];
+        if (!addArenaRow(rows, "%-30.30s %6lu %8.1f %8.1f %8.1f %8.1f",
+                stats->name, stats->count, stats->min_ms,
+                (stats->total_ms / stats->count),
+                profilePercentile(stats, 99.0), stats->max_ms))
+            all_fit = FALSE;
+    }
+    pthread_mutex_unlock(&g_prof_mutex);
+    return all_fit;
+}
+
+
+/**
+ * @brief Write the per-phase statistics out; to the given (open) file, or
+ * to syslog if it is NULL. Return FALSE if the rows couldn't be formatted.
+ */
+boolean dumpProfile(FILE *out) {
+    row_arena_t prof_rows = {0};
+    int i = 0;
+
+    if (!initRowArena(&prof_rows, (MAX_PROFILE_PHASES + 1),
+            PROFILE_ROW_SIZE))
+        return FALSE;
+    formatProfileStats(&prof_rows);
+    for (i = 0; i < prof_rows.used; i++) {
+        if (out == NULL)
+            syslog(LOG_INFO, "profile: %s", prof_rows.lines[i]);
+        else
+            fprintf(out, "%s\n", prof_rows.lines[i]);
+    }
+    freeRowArena(&prof_rows);
+    return TRUE;
+}
+
+
+/**
+ * @brief Print the start-up breakdown (for '--profile'); each start-up phase
+ * timing in the order they happened, with when it started, then the
+ * statistics for every phase that was timed.
+ */
+void printStartupProfile(FILE *out) {
+    prof_sample_t *sample = NULL;
+    unsigned long first = 0, i = 0;
+
+    fprintf(out, "Start-up timing breakdown:\n");
+    fprintf(out, "%10s %10s  %s\n", "Start ms", "Took ms", "Phase");
+    pthread_mutex_lock(&g_prof_mutex);
+    if (g_prof_ring_next > PROFILE_RING_SIZE)
+        first = g_prof_ring_next - PROFILE_RING_SIZE;
+    for (i = first; i < g_prof_ring_next; i++) {
+        sample = &g_prof_ring[i % PROFILE_RING_SIZE];
+        if ((sample->phase == -1) ||
+                (strncmp(g_prof_phases[sample->phase].name,
+                PROFILE_STARTUP_PREFIX, strlen(PROFILE_STARTUP_PREFIX)) != 0))
+            continue;
+        fprintf(out, "%10.1f %10.1f  %s\n", sample->offset_ms, sample->msec,
+                (g_prof_phases[sample->phase].name +
+                strlen(PROFILE_STARTUP_PREFIX)));
+    }
+    pthread_mutex_unlock(&g_prof_mutex);
+    fprintf(out, "\n");
+    dumpProfile(out);
+}
@@ -0,0 +1,48 @@
+/**
+ * @file profile.h
+ * @brief Data structures for the start-up and dialog latency profile.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _PROFILE_H
+#define	_PROFILE_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <time.h>
+
+#include "system.h"
+
+#define MAX_PROFILE_PHASES      96
+#define PROFILE_PHASE_SIZE      48
+#define PROFILE_RING_SIZE       1024
+/* Histogram buckets are powers of two in microseconds; the last one holds
+ * everything over ~8 seconds */
+#define PROFILE_HIST_BUCKETS    24
+/* The main() phases have this prefix (for the start-up breakdown) */
+#define PROFILE_STARTUP_PREFIX  "startup: "
+
+/* The running statistics for one named phase */
+typedef struct {
+    char name[PROFILE_PHASE_SIZE];
+    unsigned long count;
+    double min_ms;
+    double max_ms;
+    double total_ms;
+    unsigned long hist[PROFILE_HIST_BUCKETS];
+} prof_phase_t;
+
+/* One timing in the ring buffer; the offset is from when the TUI started */
+typedef struct {
+    int phase;
+    double offset_ms;
+    double msec;
+} prof_sample_t;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _PROFILE_H */
@@ -12,9 +12,20 @@ extern "C" {
 #endif
 
 #include <inttypes.h>
+#include <stdarg.h>
+#include <dirent.h>
+#include <signal.h>
+#include <blkid/blkid.h>
 
 #include "system.h"
 #include "dialogs.h"
+#include "topology.h"
+#include "dev_table.h"
+#include "mgmt_batch.h"
+#include "profile.h"
+#include "vdisk_io.h"
+#include "disk_bench.h"
+#include "jobs.h"
 
 
 /* main.c */
@@ -30,11 +41,206 @@ void cleanExit(int signal_num);
 /* info_labels.c */
 boolean updateInfoLabels(CDKSCREEN *cdk_screen,
         CDKLABEL **tgt_info, CDKLABEL **sess_info,
-        char *tgt_info_msg[], char *sess_info_msg[],
+        row_arena_t *tgt_label_rows, row_arena_t *sess_label_rows,
         int *last_scr_y, int *last_scr_x,
         int *last_tgt_rows, int *last_sess_rows);
-int readTargetData(char *label_msg[]);
-int readSessionData(char *label_msg[]);
+int readTargetData(scst_topo_t *topo, row_arena_t *label_rows);
+int readSessionData(scst_topo_t *topo, row_arena_t *label_rows);
+int compareSessions(const void *a, const void *b, void *arg);
+int readDeviceData(scst_topo_t *topo, row_arena_t *label_rows);
+int compareDevices(const void *a, const void *b, void *arg);
+void toggleDevicePanel();
+void nextSessSortKey();
+void nextSessTopN();
+void resetInfoLabel(info_label_t *lbl_state, CDKLABEL *label);
+boolean placeInfoLabel(info_label_t *lbl_state, int y_pos, int rows);
+void drawInfoLabelRows(info_label_t *lbl_state, char *label_msg[],
+        int msg_rows, boolean force_refresh);
+
+/* topology.c */
+void *growColumn(void *column, size_t elem_size, int rows, boolean *success);
+boolean growTgtTable(scst_tgt_tbl_t *tbl, int rows);
+boolean growSessTable(scst_sess_tbl_t *tbl, int rows);
+boolean growDevTable(scst_dev_tbl_t *tbl, int rows);
+boolean resetStrPool(str_pool_t *pool);
+boolean rehashStrPool(str_pool_t *pool, int index_size);
+int internStr(str_pool_t *pool, char string[]);
+int lookupStr(str_pool_t *pool, char string[]);
+void freeStrPool(str_pool_t *pool);
+char *poolStr(str_pool_t *pool, int offset);
+boolean copyStrPool(str_pool_t *dest, str_pool_t *src);
+boolean copySCSTTopology(scst_topo_t *dest, scst_topo_t *src);
+boolean dirSigChangedAt(int dir_fd, const char *dir_name,
+        dir_sig_t *dir_sig);
+boolean dirSigChanged(char dir_path[], dir_sig_t *dir_sig);
+boolean topologyChanged(scst_topo_t *topo);
+boolean readSCSTAdapters(scst_topo_t *topo);
+boolean rebuildSCSTTopology(scst_topo_t *topo);
+boolean readSCSTCounters(scst_topo_t *topo);
+dev_t findBackingDev(int hndlr_fd, char hndlr_name[], char dev_name[],
+        char backing_name[]);
+boolean rebuildSCSTDevices(scst_topo_t *topo);
+void readSCSTDevStats(scst_topo_t *topo);
+boolean updateSCSTTopology(scst_topo_t *topo);
+
+/* collector.c */
+void *collectorThread(void *arg);
+boolean startCollector();
+void stopCollector();
+boolean getTopoSnapshot(scst_topo_t *topo, unsigned long *last_seq);
+int topoSnapshotAge(scst_topo_t *topo);
+
+/* dev_table.c */
+boolean growBlkDevTable(dev_table_t *tbl, int rows);
+boolean growSCSIDevTable(dev_table_t *tbl, int rows);
+int findBlkDevEntry(dev_table_t *tbl, const char *dev_name);
+boolean readBlkDevEntry(int block_fd, const char *dev_name,
+        blk_dev_ent_t *entry);
+void setBlkDevLinks(struct udev_device *udev_dev, blk_dev_ent_t *entry);
+void readByIdLinks(dev_table_t *tbl);
+boolean readSCSIDevEntry(int scsi_fd, const char *hctl,
+        scsi_dev_ent_t *entry);
+boolean scanBlkDevs(dev_table_t *tbl, struct udev *udev);
+boolean scanSCSIDevs(dev_table_t *tbl);
+void swapDevTable(dev_table_t *tbl, boolean blk_devs, boolean scsi_devs);
+boolean rescanDevTable(struct udev *udev);
+void handleDevEvent(struct udev_device *udev_dev, int block_fd,
+        dev_table_t *scratch);
+void *devTableThread(void *arg);
+boolean startDevTable();
+void stopDevTable();
+void readyDevTable();
+boolean refreshDevTableInUse();
+boolean getDevTableLink(const char *dev_name, char dev_link[]);
+
+/* batch.c */
+void writeJSONStr(FILE *stream, const char *string);
+void writeCSVStr(FILE *stream, const char *string);
+void writeBatchJSON(FILE *stream, scst_topo_t *topo, time_t sample_time);
+void writeBatchCSV(FILE *stream, scst_topo_t *topo, time_t sample_time);
+int batchMode(int interval, batch_fmt_t format, int count);
+
+/* rates.c */
+unsigned long hashRateKey(char key[]);
+boolean rehashSessRates(int entries);
+int allocSessRate();
+int findSessRate(char key[], unsigned long generation);
+void purgeSessRates(unsigned long generation);
+void updateSessRate(int rate_idx, struct timespec *sample_time,
+        unsigned long long read_kb, unsigned long long write_kb,
+        unsigned long long cmds);
+double currSessRate(int rate_idx);
+double peakSessRate(int rate_idx);
+
+/* row_arena.c */
+boolean initRowArena(row_arena_t *arena, int rows, int cols);
+void resetRowArena(row_arena_t *arena);
+char *vsetArenaRow(row_arena_t *arena, int row, const char *format,
+        va_list args);
+char *setArenaRow(row_arena_t *arena, int row, const char *format, ...);
+boolean addArenaRow(row_arena_t *arena, const char *format, ...);
+void freeRowArena(row_arena_t *arena);
+
+/* startup.c */
+void *startupThread(void *arg);
+boolean startStartupThread();
+void setUsageReport(const char *install_id);
+boolean getInetResult(boolean *inet_works);
+boolean getStartupResult(char error_msg[], boolean *usage_posted);
+boolean postUsageReport(const char *install_id, char error_msg[]);
+boolean recordUsageVersion(char error_msg[]);
+
+/* profile.c */
+void initProfile();
+double profileDiffMsec(const struct timespec *start,
+        const struct timespec *end);
+void startProfile(struct timespec *start);
+double endProfile(const char *phase, const struct timespec *start);
+void recordProfile(const char *phase, double msec);
+double profilePercentile(const prof_phase_t *stats, double percent);
+boolean formatProfileStats(row_arena_t *rows);
+boolean dumpProfile(FILE *out);
+void printStartupProfile(FILE *out);
+
+/* vdisk_io.c */
+boolean eagerZeroFile(int fd, long long size, int queue_depth,
+        vdisk_progress_fn progress, void *progress_arg, char error_msg[]);
+boolean createVDiskFile(const char *path, long long size, vdisk_prov_t mode,
+        int queue_depth, vdisk_progress_fn progress, void *progress_arg,
+        char error_msg[]);
+boolean nextCloneChunk(vdisk_clone_t *clone, long long *offset,
+        long long *length);
+int copyCloneRange(vdisk_clone_t *clone, char *buffer, long long offset,
+        long long length);
+void *cloneThread(void *arg);
+long long fileDataBytes(int fd, long long size);
+boolean cloneVDiskFile(const char *src_path, const char *dst_path,
+        int threads, boolean reflink_only, vdisk_progress_fn progress,
+        void *progress_arg, char error_msg[]);
+boolean zeroBlockGeneric(const unsigned char *block, size_t len);
+#if defined(__x86_64__)
+boolean zeroBlockSSE2(const unsigned char *block, size_t len);
+boolean zeroBlockAVX2(const unsigned char *block, size_t len);
+#endif
+zero_check_fn getZeroCheck();
+void throttleReads(struct timespec *start, long long bytes_read,
+        int rate_limit);
+int punchZeroRun(int fd, long long offset, long long length,
+        long long *punched);
+boolean reclaimVDiskFile(const char *path, int rate_limit,
+        vdisk_progress_fn progress, void *progress_arg,
+        long long *reclaimed, char error_msg[]);
+
+/* disk_bench.c */
+long long timespecNsec(const struct timespec *time);
+int histBucket(uint64_t value);
+uint64_t histBucketValue(int bucket);
+void histAdd(bench_hist_t *hist, uint64_t value);
+void histMerge(bench_hist_t *dest, const bench_hist_t *src);
+uint64_t histPercentile(const bench_hist_t *hist, double percent);
+uint64_t benchRandom(uint64_t *state);
+void *benchThread(void *arg);
+boolean startBenchmark(bench_t *bench, char error_msg[]);
+void stopBenchmark(bench_t *bench);
+boolean benchProgress(bench_t *bench, long long *ios, long long *bytes,
+        long long *elapsed);
+boolean finishBenchmark(bench_t *bench, char error_msg[]);
+
+/* jobs.c */
+void startJobs();
+int getJobLimit();
+void *jobThread(void *arg);
+void startQueuedJobs();
+int submitJob(const char *name, job_fn run, void *arg, boolean bytes);
+void setJobProgress(job_t *job, long long done, long long total);
+boolean jobProgressCB(void *arg, long long done, long long total);
+void setJobDestPath(job_t *job, const char *dst_path);
+boolean runJobCmd(job_t *job, const char *tool, const char *command,
+        char error_msg[]);
+boolean cmdJob(job_t *job, void *arg);
+int submitCmdJob(const char *name, const char *tool, const char *command);
+int activeJobCount();
+void stopJobs();
+void formatJobTime(double secs, char time_str[]);
+boolean getFinishedJob(char job_msg[], char result_msg[], char error_msg[]);
+boolean formatJobRows(row_arena_t *rows);
+
+/* mgmt_batch.c */
+boolean initMgmtBatch(mgmt_batch_t *batch);
+int addMgmtOp(mgmt_batch_t *batch, int depends_on, const char *path,
+        const char *format, ...);
+void *mgmtBatchWorker(void *arg);
+int runMgmtBatch(mgmt_batch_t *batch);
+void freeMgmtBatch(mgmt_batch_t *batch);
+
+/* attr_cache.c */
+boolean initAttrCache();
+void lruUnlinkAttr(int handle);
+void lruPushAttr(int handle);
+void dropAttrHandle(int handle);
+void closeAttrHandles();
+int getAttrHandle(char sysfs_attr[]);
+int readAttrCached(char sysfs_attr[], char attr_value[]);
 
 /* menu_common.c */
 void errorDialog(CDKSCREEN *screen, char *msg_line_1, char *msg_line_2);
@@ -53,11 +259,15 @@ void getSCSTDevChoice(CDKSCREEN *cdk_screen, char dev_name[],
         char dev_handler[]);
 void getSCSTInitChoice(CDKSCREEN *cdk_screen, char tgt_name[],
         char tgt_driver[], char tgt_group[], char initiator[]);
-void syncConfig(CDKSCREEN *main_cdk_screen);
+void jobQueuedDialog(CDKSCREEN *main_cdk_screen, int job_id);
+boolean syncConfigJob(job_t *job, void *arg);
+void syncConfig(CDKSCREEN *main_cdk_screen, boolean foreground);
 void getUserAcct(CDKSCREEN *cdk_screen, char user_acct[]);
 boolean questionDialog(CDKSCREEN *screen, char *msg_line_1, char *msg_line_2);
 void getFSChoice(CDKSCREEN *cdk_screen, char fs_name[], char fs_path[],
         char fs_type[], boolean *mounted);
+boolean getMountProfileChoice(CDKSCREEN *cdk_screen, char fs_type[],
+        char mount_opts[]);
 char *getBlockDevChoice(CDKSCREEN *cdk_screen);
 char *getSCSIDevChoice(CDKSCREEN *cdk_screen, int scsi_dev_type);
 void getSCSTDevGrpChoice(CDKSCREEN *cdk_screen, char dev_group[]);
@@ -75,6 +285,12 @@ void getNetConfChoice(CDKSCREEN* cdk_screen, boolean *general_opt,
         char **slaves, int *slave_cnt, char **br_members, int *br_member_cnt);
 int getBlockDevSelection(CDKSCREEN *cdk_screen,
         char blk_dev_list[MAX_BLOCK_DEVS][MISC_STRING_LEN]);
+int getSCSTDevSelection(CDKSCREEN *cdk_screen,
+        char dev_list[MAX_SCST_DEVS][MISC_STRING_LEN]);
+int getSCSTDestSelection(CDKSCREEN *cdk_screen,
+        char dest_luns[MAX_MAP_DESTS][MAX_SYSFS_PATH_SIZE],
+        char dest_desc[MAX_MAP_DESTS][MISC_STRING_LEN]);
+void mgmtBatchDialog(CDKSCREEN *screen, mgmt_batch_t *batch, char *title);
 
 /* menu_system.c */
 void networkDialog(CDKSCREEN *main_cdk_screen);
@@ -88,6 +304,9 @@ void scstInfoDialog(CDKSCREEN *main_cdk_screen);
 void crmStatusDialog(CDKSCREEN *main_cdk_screen);
 void dateTimeDialog(CDKSCREEN *main_cdk_screen);
 void drbdStatDialog(CDKSCREEN *main_cdk_screen);
+void formatBenchRows(row_arena_t *rows, bench_t *bench, long long ios,
+        long long bytes, long long elapsed, boolean running);
+void benchmarkDialog(CDKSCREEN *main_cdk_screen);
 
 /* menu_hardraid.c */
 int getCtrlrChoice(CDKSCREEN *cdk_screen, char type[], char id_num[],
@@ -132,10 +351,25 @@ void addLVDialog(CDKSCREEN *main_cdk_screen);
 void remLVDialog(CDKSCREEN *main_cdk_screen);
 
 /* menu_filesys.c */
+boolean makeFSJob(job_t *job, void *arg);
+int readMountProfiles(mount_profile_t profiles[]);
+void profileMountOpts(const char *options, const char *fs_type,
+        char mount_opts[]);
+boolean getMountedOpts(const char *mnt_dir, char mount_opts[]);
+boolean setFstabMountOpts(const char *mnt_dir, const char *mount_opts,
+        char error_msg[]);
+void mountOptsDialog(CDKSCREEN *main_cdk_screen);
+boolean stripeGeomDialog(CDKSCREEN *main_cdk_screen, char blk_dev_node[],
+        char fs_type[], unsigned long *stripe_unit, int *stripe_width);
 void createFSDialog(CDKSCREEN *main_cdk_screen);
 void removeFSDialog(CDKSCREEN *main_cdk_screen);
+boolean vdiskFileJob(job_t *job, void *arg);
 void addVDiskFileDialog(CDKSCREEN *main_cdk_screen);
 void delVDiskFileDialog(CDKSCREEN *main_cdk_screen);
+boolean cloneVDiskJob(job_t *job, void *arg);
+void cloneVDiskFileDialog(CDKSCREEN *main_cdk_screen);
+boolean reclaimVDiskJob(job_t *job, void *arg);
+void reclaimVDiskFileDialog(CDKSCREEN *main_cdk_screen);
 void vdiskFileListDialog(CDKSCREEN *main_cdk_screen);
 
 /* menu_hosts.c */
@@ -175,12 +409,20 @@ void remTgtFromGrpDialog(CDKSCREEN *main_cdk_screen);
 void themeDialog(CDKSCREEN *main_cdk_screen);
 void helpDialog(CDKSCREEN *main_cdk_screen);
 void supportArchDialog(CDKSCREEN *main_cdk_screen);
+void profileDialog(CDKSCREEN *main_cdk_screen);
+void jobsDialog(CDKSCREEN *main_cdk_screen);
 void aboutDialog(CDKSCREEN *main_cdk_screen);
 
 /* utility.c */
 char *strStrip(char *string);
-void readAttribute(char sysfs_attr[], char attr_value[]);
+int readAttribute(char sysfs_attr[], char attr_value[]);
 int writeAttribute(char sysfs_attr[], char attr_value[]);
+int openDirAt(int dir_fd, const char *dir_name);
+DIR *openDirStreamAt(int dir_fd, const char *dir_name);
+int readAttributeAt(int dir_fd, const char *attr_name, char attr_value[]);
+int countDirEntriesAt(int dir_fd, const char *dir_name,
+        unsigned char entry_type, const char *entry_name);
+boolean setSysRoot(const char *root_dir);
 int isSCSTLoaded();
 boolean isSCSTInitInGroup(char tgt_name[], char tgt_driver[],
         char group_name[], char init_name[]);
@@ -188,19 +430,34 @@ int countSCSTInitUses(char tgt_name[], char tgt_driver[], char init_name[]);
 boolean listSCSTTgtDrivers(char tgt_drivers[][MISC_STRING_LEN],
         int *driver_cnt);
 int countSCSTSessLUNs(char tgt_name[], char tgt_driver[], char init_name[]);
+int findFreeLUNs(char luns_dirs[][MAX_SYSFS_PATH_SIZE], int dir_cnt,
+        int lun_cnt, int luns[]);
 char *prettyFormatBytes(uint64_t size);
+char *prettyFormatBytesBuf(uint64_t size, char buffer[], size_t buffer_size);
 boolean checkInetAccess();
 char *prettyShrinkStr(size_t max_len, char *string);
+char *prettyShrinkStrBuf(size_t max_len, const char *string, char buffer[],
+        size_t buffer_size);
 int getUsableBlockDevs(CDKSCREEN *cdk_screen,
         char blk_dev_name[MAX_BLOCK_DEVS][MISC_STRING_LEN],
         char blk_dev_info[MAX_BLOCK_DEVS][MISC_STRING_LEN],
         char blk_dev_size[MAX_BLOCK_DEVS][MISC_STRING_LEN]);
+blkid_cache getBlkidCache();
+void getBootDiskName(char disk_name[]);
+boolean getBlockDiskName(int dir_fd, const char *link_name, char disk_name[]);
+boolean markBlockDevInUse(str_pool_t *in_use, dev_t dev_num);
+boolean findBlockDevsInUse(str_pool_t *in_use);
+boolean findSCSTFileDev(const char *path, char scst_dev[]);
+boolean findStripeGeometry(const char *blk_dev_node,
+        unsigned long *stripe_unit, int *stripe_width, char source[]);
+int readLUNLayout(row_arena_t *layout);
+void blockThreadSignals(sigset_t *old_set);
 
 /* strings.c */
 size_t g_scst_dev_types_size();
 size_t g_scst_handlers_size();
 size_t g_sync_label_msg_size();
-size_t g_usage_label_msg_size();
+size_t g_mount_profile_names_size();
 
 #ifdef	__cplusplus
 }
@@ -0,0 +1,275 @@
+/**
+ * @file rates.c
+ * @brief Functions for computing per-session throughput and IOPS rates.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include <cdk.h>
+#include <assert.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "topology.h"
+
+
+/* The session rate entries; an entry keeps its index for as long as the
+ * session exists (the topology holds it), so entries never move, freed ones
+ * are reused from the free list */
+sess_rate_t *g_sess_rates = NULL;
+int g_sess_rate_alloc = 0, g_sess_rate_free = -1;
+
+/* The rate key index (open addressing, linear probing); each slot holds an
+ * entry index, RATE_SLOT_EMPTY or RATE_SLOT_DELETED. The index is rebuilt
+ * (grown, and the tombstones dropped) when it gets too full. */
+int *g_rate_slots = NULL;
+int g_rate_slot_cnt = 0, g_rate_slots_used = 0, g_rate_slots_deleted = 0;
+
+
+/**
+ * @brief Simple FNV-1a string hash; used for the session rate table.
+ */
+unsigned long hashRateKey(char key[]) {
+    unsigned long hash = 2166136261UL;
+    unsigned char *curr_char = (unsigned char *) key;
+
+    while (*curr_char != '\0') {
+        hash ^= *curr_char;
+        hash *= 16777619UL;
+        curr_char++;
+    }
+    return hash;
+}
+
+
+/**
+ * @brief Rebuild the rate key index with room for at least 'entries' keys
+ * at no more than half full; all of the tombstones are dropped. Return
+ * FALSE if we couldn't allocate it (the old index is kept).
+ */
+boolean rehashSessRates(int entries) {
+    int *new_slots = NULL;
+    int new_cnt = SESS_RATE_INIT_SLOTS, i = 0;
+    unsigned long slot = 0;
+
+    while (new_cnt < (entries * 2))
+        new_cnt *= 2;
+    if ((new_slots = malloc(sizeof (int) * new_cnt)) == NULL) {
+        DEBUG_LOG("malloc(): %s", strerror(errno));
+        return FALSE;
+    }
+    for (i = 0; i < new_cnt; i++)
+        new_slots[i] = RATE_SLOT_EMPTY;
+
+    for (i = 0; i < g_sess_rate_alloc; i++) {
+        if (!g_sess_rates[i].used)
+            continue;
+        slot = hashRateKey(g_sess_rates[i].key) & (new_cnt - 1);
+        while (new_slots[slot] != RATE_SLOT_EMPTY)
+            slot = (slot + 1) & (new_cnt - 1);
+        new_slots[slot] = i;
+    }
+
+    FREE_NULL(g_rate_slots);
+    g_rate_slots = new_slots;
+    g_rate_slot_cnt = new_cnt;
+    g_rate_slots_deleted = 0;
+    return TRUE;
+}
+
+
+/**
+ * @brief Take a free session rate entry, growing (doubling) the entries
+ * when there are none left. Return the entry index, or -1 if we couldn't
+ * allocate it.
+ */
+int allocSessRate() {
+    sess_rate_t *new_rates = NULL;
+    int new_alloc = 0, i = 0, entry_idx = 0;
+
+    if (g_sess_rate_free == -1) {
+        new_alloc = (g_sess_rate_alloc > 0) ? (g_sess_rate_alloc * 2) :
+                SESS_RATE_INIT_SLOTS;
+        if ((new_rates = realloc(g_sess_rates,
+                (sizeof (sess_rate_t) * new_alloc))) == NULL) {
+            DEBUG_LOG("realloc(): %s", strerror(errno));
+            return -1;
+        }
+        /* Chain the new entries onto the free list */
+        for (i = g_sess_rate_alloc; i < new_alloc; i++) {
+            new_rates[i].used = FALSE;
+            new_rates[i].key = NULL;
+            new_rates[i].next_free = ((i + 1) < new_alloc) ? (i + 1) : -1;
+        }
+        g_sess_rates = new_rates;
+        g_sess_rate_free = g_sess_rate_alloc;
+        g_sess_rate_alloc = new_alloc;
+    }
+
+    entry_idx = g_sess_rate_free;
+    g_sess_rate_free = g_sess_rates[entry_idx].next_free;
+    return entry_idx;
+}
+
+
+/**
+ * @brief Find the session rate entry for the given key ("driver/target/
+ * session"), adding a new entry if it doesn't exist. The entry is marked as
+ * seen in the given topology generation. Return the entry index, or -1 if
+ * we couldn't allocate a new entry.
+ */
+int findSessRate(char key[], unsigned long generation) {
+    unsigned long slot = 0;
+    int i = 0, free_slot = -1, entry_idx = 0;
+    sess_rate_t *entry = NULL;
+
+    /* Keep the index at most 3/4 full (counting tombstones); if it can't be
+     * rebuilt we carry on with the old one, while it has room */
+    if (((g_rate_slots_used + g_rate_slots_deleted + 1) * 4) >
+            (g_rate_slot_cnt * 3))
+        rehashSessRates(g_rate_slots_used + 1);
+
+    slot = hashRateKey(key) & (g_rate_slot_cnt - 1);
+    for (i = 0; i < g_rate_slot_cnt; i++) {
+        if (g_rate_slots[slot] == RATE_SLOT_EMPTY) {
+            if (free_slot == -1)
+                free_slot = slot;
+            break;
+        } else if (g_rate_slots[slot] == RATE_SLOT_DELETED) {
+            if (free_slot == -1)
+                free_slot = slot;
+        } else if (strcmp(g_sess_rates[g_rate_slots[slot]].key, key) == 0) {
+            g_sess_rates[g_rate_slots[slot]].generation = generation;
+            return g_rate_slots[slot];
+        }
+        slot = (slot + 1) & (g_rate_slot_cnt - 1);
+    }
+
+    /* Not found, so add it */
+    if (free_slot == -1)
+        return -1;
+    if ((entry_idx = allocSessRate()) == -1)
+        return -1;
+    entry = &g_sess_rates[entry_idx];
+    memset(entry, 0, sizeof (sess_rate_t));
+    SAFE_ASPRINTF(&entry->key, "%s", key);
+    entry->used = TRUE;
+    entry->next_free = -1;
+    entry->generation = generation;
+    if (g_rate_slots[free_slot] == RATE_SLOT_DELETED)
+        g_rate_slots_deleted--;
+    g_rate_slots[free_slot] = entry_idx;
+    g_rate_slots_used++;
+    return entry_idx;
+}
+
+
+/**
+ * @brief Remove any session rate entries that were not seen in the given
+ * topology generation (the session went away). The entries go back on the
+ * free list; if the index is then mostly tombstones, it's rebuilt.
+ */
+void purgeSessRates(unsigned long generation) {
+    int i = 0;
+
+    for (i = 0; i < g_rate_slot_cnt; i++) {
+        if ((g_rate_slots[i] < 0) ||
+                (g_sess_rates[g_rate_slots[i]].generation == generation))
+            continue;
+        FREE_NULL(g_sess_rates[g_rate_slots[i]].key);
+        g_sess_rates[g_rate_slots[i]].used = FALSE;
+        g_sess_rates[g_rate_slots[i]].next_free = g_sess_rate_free;
+        g_sess_rate_free = g_rate_slots[i];
+        g_rate_slots[i] = RATE_SLOT_DELETED;
+        g_rate_slots_used--;
+        g_rate_slots_deleted++;
+    }
+
+    /* A failed rebuild is fine, we just keep the tombstones for now */
+    if ((g_rate_slots_deleted * 4) > g_rate_slot_cnt)
+        rehashSessRates(g_rate_slots_used);
+}
+
+
+/**
+ * @brief Take a new counter sample for a session and update its rates; the
+ * rates are computed over the real elapsed time between the two samples
+ * (monotonic clock). If the counters went backwards (the session was
+ * re-created), the sample simply becomes the new baseline.
+ */
+void updateSessRate(int rate_idx, struct timespec *sample_time,
+        unsigned long long read_kb, unsigned long long write_kb,
+        unsigned long long cmds) {
+    sess_rate_t *entry = NULL;
+    double elapsed = 0;
+
+    if (rate_idx < 0)
+        return;
+    entry = &g_sess_rates[rate_idx];
+
+    if (entry->have_sample && (read_kb >= entry->read_kb) &&
+            (write_kb >= entry->write_kb) && (cmds >= entry->cmds)) {
+        elapsed = (double) (sample_time->tv_sec -
+                entry->sample_time.tv_sec) +
+                ((double) (sample_time->tv_nsec -
+                entry->sample_time.tv_nsec) / 1000000000.0);
+        if (elapsed <= 0)
+            return;
+        entry->read_kbps = (double) (read_kb - entry->read_kb) / elapsed;
+        entry->write_kbps = (double) (write_kb - entry->write_kb) / elapsed;
+        entry->iops = (double) (cmds - entry->cmds) / elapsed;
+        /* Keep a short history so spikes can be seen */
+        entry->hist_kbps[entry->hist_pos] = entry->read_kbps +
+                entry->write_kbps;
+        entry->hist_pos = (entry->hist_pos + 1) % SESS_RATE_HIST_LEN;
+        if (entry->hist_cnt < SESS_RATE_HIST_LEN)
+            entry->hist_cnt++;
+    } else {
+        entry->read_kbps = 0;
+        entry->write_kbps = 0;
+        entry->iops = 0;
+    }
+
+    /* Save this sample for next time */
+    entry->have_sample = TRUE;
+    entry->sample_time = *sample_time;
+    entry->read_kb = read_kb;
+    entry->write_kb = write_kb;
+    entry->cmds = cmds;
+}
+
+
+/**
+ * @brief Return the current throughput (read + write KB/s) for a session.
+ */
+double currSessRate(int rate_idx) {
+    if (rate_idx < 0)
+        return 0;
+    return g_sess_rates[rate_idx].read_kbps + g_sess_rates[rate_idx].write_kbps;
+}
+
+
+/**
+ * @brief Return the peak throughput (KB/s) over the recent rate history.
+ */
+double peakSessRate(int rate_idx) {
+    sess_rate_t *entry = NULL;
+    double peak = 0;
+    int i = 0;
+
+    if (rate_idx < 0)
+        return 0;
+    entry = &g_sess_rates[rate_idx];
+    for (i = 0; i < entry->hist_cnt; i++) {
+        if (entry->hist_kbps[i] > peak)
+            peak = entry->hist_kbps[i];
+    }
+    return peak;
+}
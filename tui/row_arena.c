@@ -0,0 +1,123 @@
+/**
+ * @file row_arena.c
+ * @brief Functions for the row arenas; a fixed set of line buffers that the
+ * information labels and scroll windows format their rows into, so a refresh
+ * doesn't allocate (and free) every row again.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <syslog.h>
+#include <errno.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+
+
+/**
+ * @brief Allocate the line buffers (and the line pointer array handed to the
+ * widgets) for a row arena; this is only done once, calling it again for an
+ * arena that is already setup does nothing. Return FALSE if we couldn't
+ * allocate the memory.
+ */
+boolean initRowArena(row_arena_t *arena, int rows, int cols) {
+    if (arena->buffer != NULL)
+        return TRUE;
+
+    /* The line pointers get a NULL terminator */
+    arena->buffer = calloc(((size_t) rows * cols), sizeof (char));
+    arena->lines = calloc((rows + 1), sizeof (char *));
+    if ((arena->buffer == NULL) || (arena->lines == NULL)) {
+        DEBUG_LOG("calloc(): %s", strerror(errno));
+        FREE_NULL(arena->buffer);
+        FREE_NULL(arena->lines);
+        return FALSE;
+    }
+    arena->rows = rows;
+    arena->cols = cols;
+    arena->used = 0;
+    return TRUE;
+}
+
+
+/**
+ * @brief Empty a row arena (the rows from last time are no longer handed to
+ * the widgets); the line buffers are kept for the next refresh.
+ */
+void resetRowArena(row_arena_t *arena) {
+    int i = 0;
+
+    if (arena->lines == NULL)
+        return;
+    for (i = 0; i < arena->used; i++)
+        arena->lines[i] = NULL;
+    arena->used = 0;
+}
+
+
+/**
+ * @brief Format the given row (with a va_list); see setArenaRow().
+ */
+char *vsetArenaRow(row_arena_t *arena, int row, const char *format,
+        va_list args) {
+    char *line = NULL;
+
+    if ((arena->buffer == NULL) || (row < 0) || (row >= arena->rows))
+        return NULL;
+    line = arena->buffer + ((size_t) row * arena->cols);
+    vsnprintf(line, arena->cols, format, args);
+    arena->lines[row] = line;
+    if (row >= arena->used)
+        arena->used = row + 1;
+    return line;
+}
+
+
+/**
+ * @brief Format (printf style) a row of the arena in place; anything longer
+ * than the row buffer is truncated. Return the row, or NULL if the row
+ * number is out of range (or the arena isn't setup).
+ */
+char *setArenaRow(row_arena_t *arena, int row, const char *format, ...) {
+    char *line = NULL;
+    va_list args;
+
+    va_start(args, format);
+    line = vsetArenaRow(arena, row, format, args);
+    va_end(args);
+    return line;
+}
+
+
+/**
+ * @brief Format (printf style) the next row of the arena in place. Return
+ * FALSE if the arena is full.
+ */
+boolean addArenaRow(row_arena_t *arena, const char *format, ...) {
+    char *line = NULL;
+    va_list args;
+
+    va_start(args, format);
+    line = vsetArenaRow(arena, arena->used, format, args);
+    va_end(args);
+    return (line != NULL);
+}
+
+
+/**
+ * @brief Free the line buffers of a row arena.
+ */
+void freeRowArena(row_arena_t *arena) {
+    FREE_NULL(arena->buffer);
+    FREE_NULL(arena->lines);
+    arena->rows = 0;
+    arena->cols = 0;
+    arena->used = 0;
+}
@@ -0,0 +1,258 @@
+/**
+ * @file startup.c
+ * @brief Background thread for the slow start-up work (the Internet access
+ * check and the usage report) so the main screen is usable right away; the
+ * results are picked up by the UI thread later.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <iniparser.h>
+#include <curl/curl.h>
+#include <cdk.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "strings.h"
+
+
+/* The start-up thread only touches these with the lock held; once the
+ * Internet access result is delivered, the UI thread decides if a usage
+ * report is due (it may prompt the user) and the start-up thread waits for
+ * that before it transmits anything */
+pthread_mutex_t g_startup_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_startup_cond = PTHREAD_COND_INITIALIZER;
+pthread_t g_startup_thread;
+boolean g_startup_running = FALSE;
+boolean g_startup_done = FALSE;
+boolean g_startup_delivered = FALSE;
+boolean g_inet_checked = FALSE;
+boolean g_inet_delivered = FALSE;
+boolean g_inet_works = FALSE;
+boolean g_usage_decided = FALSE;
+boolean g_usage_posted = FALSE;
+char g_usage_install_id[UUID_STR_SIZE] = {0};
+char g_startup_error[MISC_STRING_LEN] = {0};
+
+
+/**
+ * @brief The start-up thread; check for Internet access, then (once the UI
+ * thread has decided) transmit the usage report if it is due.
+ */
+void *startupThread(void *arg) {
+    char install_id[UUID_STR_SIZE] = {0}, error_msg[MISC_STRING_LEN] = {0};
+    boolean has_inet = FALSE, posted = FALSE;
+    struct timespec phase_start = {0};
+
+    (void) arg;
+
+    blockThreadSignals(NULL);
+
+    /* This can take a while (it times out) on isolated networks */
+    startProfile(&phase_start);
+    has_inet = checkInetAccess();
+    endProfile(PROFILE_STARTUP_PREFIX "inet check", &phase_start);
+
+    /* Wait for the UI thread to say if a usage report is due */
+    pthread_mutex_lock(&g_startup_mutex);
+    g_inet_works = has_inet;
+    g_inet_checked = TRUE;
+    while (!g_usage_decided)
+        pthread_cond_wait(&g_startup_cond, &g_startup_mutex);
+    snprintf(install_id, UUID_STR_SIZE, "%s", g_usage_install_id);
+    pthread_mutex_unlock(&g_startup_mutex);
+
+    if (has_inet && (install_id[0] != '\0')) {
+        startProfile(&phase_start);
+        posted = postUsageReport(install_id, error_msg);
+        endProfile("usage report", &phase_start);
+    }
+
+    pthread_mutex_lock(&g_startup_mutex);
+    snprintf(g_startup_error, MISC_STRING_LEN, "%s", error_msg);
+    g_usage_posted = posted;
+    g_startup_done = TRUE;
+    pthread_mutex_unlock(&g_startup_mutex);
+    return NULL;
+}
+
+
+/**
+ * @brief Start the start-up thread (once). Return FALSE if the thread
+ * couldn't be created; there is simply no usage report in that case.
+ */
+boolean startStartupThread() {
+    int ret_val = 0;
+
+    if (g_startup_running)
+        return TRUE;
+    if ((ret_val = pthread_create(&g_startup_thread, NULL,
+            startupThread, NULL)) != 0) {
+        DEBUG_LOG("pthread_create(): %s", strerror(ret_val));
+        return FALSE;
+    }
+    pthread_detach(g_startup_thread);
+    g_startup_running = TRUE;
+    return TRUE;
+}
+
+
+/**
+ * @brief Tell the start-up thread whether a usage report is due; pass the
+ * installation ID to transmit one, or NULL if not. Only the first call
+ * counts (the screen may be setup again after a resize).
+ */
+void setUsageReport(const char *install_id) {
+    pthread_mutex_lock(&g_startup_mutex);
+    if (!g_usage_decided) {
+        snprintf(g_usage_install_id, UUID_STR_SIZE, "%s",
+                ((install_id != NULL) ? install_id : ""));
+        g_usage_decided = TRUE;
+        pthread_cond_signal(&g_startup_cond);
+    }
+    pthread_mutex_unlock(&g_startup_mutex);
+}
+
+
+/**
+ * @brief Check if the Internet access check has finished; return TRUE only
+ * the first time it is seen finished, with the result. The UI thread must
+ * then call setUsageReport() (the start-up thread waits for it).
+ */
+boolean getInetResult(boolean *inet_works) {
+    boolean finished = FALSE;
+
+    pthread_mutex_lock(&g_startup_mutex);
+    if (g_inet_checked && !g_inet_delivered) {
+        *inet_works = g_inet_works;
+        g_inet_delivered = TRUE;
+        finished = TRUE;
+    }
+    pthread_mutex_unlock(&g_startup_mutex);
+    return finished;
+}
+
+
+/**
+ * @brief Check if the start-up thread has finished; return TRUE only the
+ * first time it is seen finished, and fill the error message (empty if
+ * everything worked) for the UI thread to show. If a usage report was
+ * transmitted, the UI thread records it with recordUsageVersion().
+ */
+boolean getStartupResult(char error_msg[], boolean *usage_posted) {
+    boolean finished = FALSE;
+
+    pthread_mutex_lock(&g_startup_mutex);
+    if (g_startup_done && !g_startup_delivered) {
+        snprintf(error_msg, MISC_STRING_LEN, "%s", g_startup_error);
+        *usage_posted = g_usage_posted;
+        g_startup_delivered = TRUE;
+        finished = TRUE;
+    }
+    pthread_mutex_unlock(&g_startup_mutex);
+    return finished;
+}
+
+
+/**
+ * @brief Transmit the usage report (an HTTP POST). This doesn't touch the
+ * screen or the ESOS configuration file (the UI thread records the version
+ * afterwards) and cURL must already be initialized (curl_global_init() isn't
+ * thread-safe, so main() does it before any thread is started). On failure,
+ * the error message is filled and FALSE is returned.
+ */
+boolean postUsageReport(const char *install_id, char error_msg[]) {
+    CURL *curl = NULL;
+    CURLcode result = 0;
+    struct curl_httppost *form_post = NULL, *last_ptr = NULL;
+    boolean success = FALSE;
+
+    if ((curl = curl_easy_init()) == NULL) {
+        snprintf(error_msg, MISC_STRING_LEN, "curl_easy_init() failed");
+        return FALSE;
+    }
+
+    while (1) {
+        /* Fill in our form fields */
+        curl_formadd(&form_post, &last_ptr, CURLFORM_COPYNAME,
+                "branch", CURLFORM_COPYCONTENTS,
+                GIT_BRANCH, CURLFORM_END);
+        curl_formadd(&form_post, &last_ptr, CURLFORM_COPYNAME,
+                "ver_string", CURLFORM_COPYCONTENTS,
+                ESOS_VERSION, CURLFORM_END);
+        curl_formadd(&form_post, &last_ptr, CURLFORM_COPYNAME,
+                "install_id", CURLFORM_COPYCONTENTS,
+                install_id, CURLFORM_END);
+
+        /* Set cURL options for our HTTP POST */
+        curl_easy_setopt(curl, CURLOPT_URL, USAGE_POST_URL);
+        curl_easy_setopt(curl, CURLOPT_HTTPPOST, form_post);
+        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, TUI_LOG_PREFIX);
+
+        /* Perform the request */
+        result = curl_easy_perform(curl);
+        if (result != CURLE_OK) {
+            snprintf(error_msg, MISC_STRING_LEN, "curl_easy_perform(): %s",
+                    curl_easy_strerror(result));
+            break;
+        }
+
+        success = TRUE;
+        break;
+    }
+
+    /* Done */
+    curl_easy_cleanup(curl);
+    curl_formfree(form_post);
+    return success;
+}
+
+
+/**
+ * @brief Record the version that was reported in the ESOS configuration
+ * file; this is called by the UI thread, like the dialogs that write the
+ * file, so the writes can't overlap. On failure, the error message is
+ * filled and FALSE is returned.
+ */
+boolean recordUsageVersion(char error_msg[]) {
+    dictionary *ini_dict = NULL;
+    FILE *ini_file = NULL;
+    boolean success = FALSE;
+
+    while (1) {
+        if ((ini_dict = iniparser_load(ESOS_CONF)) == NULL) {
+            snprintf(error_msg, MISC_STRING_LEN, "%s", ESOS_CONF_READ_ERR_1);
+            break;
+        }
+        if (iniparser_set(ini_dict, "usage:last_ver", ESOS_VERSION) == -1) {
+            snprintf(error_msg, MISC_STRING_LEN, "%s", SET_FILE_VAL_ERR);
+            break;
+        }
+        /* Save the file */
+        if ((ini_file = fopen(ESOS_CONF, "w")) == NULL) {
+            snprintf(error_msg, MISC_STRING_LEN, ESOS_CONF_WRITE_ERR,
+                    strerror(errno));
+            break;
+        }
+        iniparser_dump_ini(ini_dict, ini_file);
+        fclose(ini_file);
+        success = TRUE;
+        break;
+    }
+
+    /* Done */
+    if (ini_dict != NULL)
+        iniparser_freedict(ini_dict);
+    return success;
+}
@@ -9,6 +9,22 @@
 
 #include "prototypes.h"
 
+/* The sysfs and procfs paths (see system.h); setSysRoot() prefixes them */
+char *g_sys_paths[] = {
+    [SYS_PATH_FC_HOST] = "/sys/class/fc_host",
+    [SYS_PATH_INFINIBAND] = "/sys/class/infiniband",
+    [SYS_PATH_SCST_TGT] = "/sys/kernel/scst_tgt",
+    [SYS_PATH_SCSI_DISK] = "/sys/class/scsi_disk",
+    [SYS_PATH_SCSI_DEVICE] = "/sys/class/scsi_device",
+    [SYS_PATH_BLOCK] = "/sys/block",
+    [SYS_PATH_DEV_BLOCK] = "/sys/dev/block",
+    [SYS_PATH_NET] = "/sys/class/net",
+    [SYS_PATH_DRBD] = "/proc/drbd",
+    [SYS_PATH_MDSTAT] = "/proc/mdstat",
+    [SYS_PATH_MOUNTINFO] = "/proc/self/mountinfo",
+    [SYS_PATH_SWAPS] = "/proc/swaps"
+};
+
 /* Dialog radio widget options */
 char *g_no_yes_opts[] = {"No", "Yes"},
         *g_auth_meth_opts[] = {"None", "Plain Text", "CRAM-MD5"},
@@ -18,9 +34,22 @@ char *g_no_yes_opts[] = {"No", "Yes"},
         *g_hw_raid_opts[] = {"0", "1", "5", "6"},
         *g_dsbl_enbl_opts[] = {"Disabled (0)", "Enabled (1)"},
         *g_fs_type_opts[] = {"xfs", "btrfs", "ext3", "ext4"},
+        *g_vdisk_prov_opts[] = {"Thin (Sparse)", "Lazy Thick",
+        "Eager-Zero Thick"},
         *g_md_level_opts[] = {"raid0", "raid1", "raid10",
         "raid6", "raid5", "raid4"},
-        *g_md_chunk_opts[] = {"8K", "16K", "32K", "64K", "128K", "512K"};
+        *g_md_chunk_opts[] = {"8K", "16K", "32K", "64K", "128K", "512K"},
+        *g_bench_test_opts[] = {"Sequential Read", "Sequential Write",
+        "Random Read", "Random Write"};
+
+/* The mount option profiles used when none are set in the ESOS config.
+ * file; an option prefixed with a file system type only applies to it */
+char *g_mount_profile_names[] = {"defaults", "large sequential vdisk",
+        "many small vdisks", "SSD backed"},
+        *g_mount_profile_opts[] = {"defaults",
+        "noatime,xfs:inode64,xfs:logbsize=256k,xfs:allocsize=64m",
+        "noatime,xfs:inode64,xfs:allocsize=1m",
+        "noatime,xfs:inode64,discard"};
 
 /* Misc. widget related strings */
 char *g_choice_char[] = {"[ ] ", "[*] "},
@@ -33,13 +62,7 @@ char *g_choice_char[] = {"[ ] ", "[*] "},
         *g_sync_label_msg[] = {"", "",
         "</B>   Synchronizing ESOS configuration...   ", "", ""},
         *g_add_ld_label_msg[] = {"", "",
-        "</B>   Adding the new logical drive...   ", "", ""},
-        *g_add_array_label_msg[] = {"", "",
-        "</B>   Adding the new MD array...   ", "", ""},
-        *g_add_lv_label_msg[] = {"", "",
-        "</B>   Adding the new LVM LV...   ", "", ""},
-        *g_usage_label_msg[] = {"", "",
-        "</B>   Transmitting ESOS usage count...   ", "", ""};
+        "</B>   Adding the new logical drive...   ", "", ""};
 
 /* Button strings */
 char *g_ok_cancel_msg[] = {"</B>   OK   ", "</B> Cancel "},
@@ -51,7 +74,9 @@ char *g_transports[] = {"unknown", "scsi", "ide", "dac960", "cpqarray",
         "file", "ataraid", "i2o", "ubd", "dasd", "viodasd", "sx8", "dm"},
         *g_scst_handlers[] = {"dev_disk", "dev_disk_perf", "vcdrom",
         "vdisk_blockio", "vdisk_fileio", "vdisk_nullio", "dev_changer",
-        "dev_tape", "dev_tape_perf"};
+        "dev_tape", "dev_tape_perf"},
+        *g_sess_sort_keys[] = {"Read/s", "Write/s", "Cmds", "LUNs",
+        "Initiator"};
 
 /* Functions to return the sizes */
 size_t g_scst_dev_types_size() {
@@ -66,12 +91,6 @@ size_t g_sync_label_msg_size() {
 size_t g_add_ld_label_msg_size() {
     return (sizeof g_add_ld_label_msg) / (sizeof g_add_ld_label_msg[0]);
 }
-size_t g_add_array_label_msg_size() {
-    return (sizeof g_add_array_label_msg) / (sizeof g_add_array_label_msg[0]);
-}
-size_t g_add_lv_label_msg_size() {
-    return (sizeof g_add_lv_label_msg) / (sizeof g_add_lv_label_msg[0]);
-}
-size_t g_usage_label_msg_size() {
-    return (sizeof g_usage_label_msg) / (sizeof g_usage_label_msg[0]);
+size_t g_mount_profile_names_size() {
+    return (sizeof g_mount_profile_names) / (sizeof g_mount_profile_names[0]);
 }
@@ -38,15 +38,51 @@ extern "C" {
 #define DIALOG_ERR_MSG          "Couldn't create dialog widget!"
 #define MENTRY_ERR_MSG          "Couldn't create multiple line entry widget!"
 #define CALENDAR_ERR_MSG        "Couldn't create calendar widget!"
+#define ROW_ARENA_ERR_MSG       "Couldn't allocate the widget row buffers!"
 
 /* Common SCST related error messages */
 #define TGT_DRIVERS_ERR     "An error occurred while retrieving the " \
         "list of drivers."
+#define TOPO_MEM_ERR        "Couldn't allocate memory for the SCST " \
+        "target/session tables."
 #define SET_REL_TGT_ID_ERR  "Couldn't set SCST relative target ID: %s"
+#define MGMT_BATCH_ERR      "Couldn't setup the SCST management batch!"
 
 /* Canned dialog messages */
 #define CONTINUE_MSG        "<C></B><Press ENTER to continue...>"
 #define NO_SCST_MSG         "<C></B><SCST is not loaded!>"
+#define COLLECT_WAIT_MSG    "<C></B><Collecting SCST information...>"
+#define SESS_SORT_MSG       "</B>Sorted by %s; %d of %d ('k' key, " \
+        "'n' top-N, 'v' devices)<!B>"
+#define DEV_PANEL_MSG       "</B>Busiest first; %d of %d ('n' top-N, " \
+        "'v' sessions)<!B>"
+#define COLLECTOR_ERR_MSG   "Couldn't start the SCST information collector!"
+#define MGMT_BATCH_OK_MSG   "All %d SCST management operations worked."
+#define MGMT_BATCH_FAIL_MSG "<C></B>%d of %d SCST management operations " \
+        "failed:<!B>"
+#define COLLECT_STALL_MSG   "<C></B><No update for %d seconds; waiting " \
+        "on sysfs...>"
+#define PROFILE_SYSLOG_MSG  "The timings were written to syslog."
+#define PROFILE_SAVED_MSG   "The timings were saved to '%s'."
+#define PROFILE_SAVE_ERR    "Couldn't save the timings: %s"
+#define PROFILE_ROWS_ERR    "Couldn't format the timings!"
+#define JOB_QUEUED_MSG      "Queued as background job %d;"
+#define JOB_WATCH_MSG       "press 'j' (or Interface -> Jobs) to watch it."
+#define JOB_SUBMIT_ERR      "Couldn't queue the background job; too many " \
+        "jobs!"
+#define JOB_DONE_MSG        "Background job %d (%s) finished in %s."
+#define JOB_FAILED_MSG      "Background job %d (%s) failed:"
+#define JOBS_ACTIVE_MSG     "%d background job(s) are still queued or " \
+        "running;"
+#define JOBS_QUIT_MSG       "quitting will stop them. Quit anyway?"
+
+/* Batch (headless) mode */
+#define BATCH_USAGE_MSG     "Usage: %s [--sysroot DIR] [--profile] [--batch " \
+        "[--interval SECS] [--format json|csv] [--count N]]\n"
+#define BATCH_NO_SCST_MSG   "SCST is not loaded!"
+#define BATCH_CSV_HEADER    "time,type,driver,target,session,initiator," \
+        "state,link_speed,luns,active_cmds,read_io_kb,write_io_kb," \
+        "read_cmds,write_cmds,read_kbps,write_kbps,iops"
 
 /* Input string validation messages */
 #define EMPTY_FIELD_ERR     "The input/entry field cannot be empty!"
@@ -61,6 +97,9 @@ extern "C" {
         "would you like to try mounting it now?"
 #define NOT_MOUNTED_2       "(The file system must be mounted before " \
         "proceeding.)"
+/* What a mount option profile may contain (it goes on a command line) */
+#define MOUNT_OPTS_CHARS    "abcdefghijklmnopqrstuvwxyz" \
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789=,_.:/-"
 
 /* INI parser messages */
 #define SET_FILE_VAL_ERR        "Couldn't set configuration file value!"
@@ -82,24 +121,28 @@ extern "C" {
 /* Misc. common strings/messages */
 #define DEFAULT_CASE_HIT    "The 'default' case was reached."
 #define CMD_FAILED_ERR      "Running %s failed; exited with %d."
+#define NO_DEV_LINK_ERR     "No unique (udev) link was found for %s."
 
 /* Dialog radio widget options */
 extern char *g_no_yes_opts[], *g_auth_meth_opts[], *g_ip_opts[],
         *g_cache_opts[], *g_hw_write_opts[], *g_hw_read_opts[], *g_bbu_opts[],
         *g_hw_raid_opts[], *g_strip_opts[], *g_dsbl_enbl_opts[],
-        *g_fs_type_opts[], *g_md_level_opts[], *g_md_chunk_opts[];
+        *g_fs_type_opts[], *g_md_level_opts[], *g_md_chunk_opts[],
+        *g_vdisk_prov_opts[], *g_bench_test_opts[];
+
+/* Built-in mount option profiles */
+extern char *g_mount_profile_names[], *g_mount_profile_opts[];
 
 /* Misc. widget related strings */
 extern char *g_choice_char[], *g_bonding_map[], *g_scst_dev_types[],
         *g_scst_bs_list[], *g_fio_types[], *g_sync_label_msg[],
-        *g_add_ld_label_msg[], *g_add_array_label_msg[],
-        *g_add_lv_label_msg[], *g_usage_label_msg[];
+        *g_add_ld_label_msg[];
 
 /* Button strings */
 extern char *g_ok_msg[], *g_ok_cancel_msg[], *g_yes_no_msg[];
 
 /* Other string stuff */
-extern char *g_transports[], *g_scst_handlers[];
+extern char *g_transports[], *g_scst_handlers[], *g_sess_sort_keys[];
 
 #ifdef	__cplusplus
 }
@@ -13,6 +13,10 @@ extern "C" {
 
 /* User interface (text/curses) settings */
 #define REFRESH_DELAY           20
+#define COLLECT_INTERVAL_MSEC   2000
+#define DEV_TABLE_POLL_MSEC     1000
+#define COLLECT_STALL_SECS      10
+#define BATCH_DEFAULT_INTERVAL  1
 #define MIN_SCR_X               80
 #define MIN_SCR_Y               24
 #define MAX_LABEL_LENGTH        50
@@ -49,6 +53,7 @@ extern "C" {
 #define SYSTEM_CRM_STATUS       10
 #define SYSTEM_DRBD_STATUS      11
 #define SYSTEM_DATE_TIME        12
+#define SYSTEM_BENCHMARK        13
 
 /* Hardware RAID menu layout */
 #define HW_RAID_MENU            1
@@ -81,8 +86,11 @@ extern "C" {
 #define FILE_SYS_VDISK_LIST     1
 #define FILE_SYS_ADD_FS         2
 #define FILE_SYS_REM_FS         3
-#define FILE_SYS_ADD_VDISK      4
-#define FILE_SYS_REM_VDISK      5
+#define FILE_SYS_MNT_OPTS       4
+#define FILE_SYS_ADD_VDISK      5
+#define FILE_SYS_CLONE_VDISK    6
+#define FILE_SYS_RECLAIM_VDISK  7
+#define FILE_SYS_REM_VDISK      8
 
 /* Hosts menu layout */
 #define HOSTS_MENU              0
@@ -128,12 +136,13 @@ extern "C" {
 #define INTERFACE_THEME         3
 #define INTERFACE_HELP          4
 #define INTERFACE_SUPPORT_PKG   5
-#define INTERFACE_ABOUT         6
+#define INTERFACE_PROFILE       6
+#define INTERFACE_JOBS          7
+#define INTERFACE_ABOUT         8
 
 /* Misc. limits */
 #define GIBIBYTE_SIZE           1073741824LL
 #define MEBIBYTE_SIZE           1048576LL
-#define VDISK_WRITE_SIZE        262144
 #define MAX_SHELL_CMD_LEN       256
 #define MISC_STRING_LEN         128
 #define UUID_STR_SIZE           64
@@ -144,6 +153,8 @@ extern "C" {
 #define MAX_INFO_LABEL_ROWS     512
 #define TARGETS_LABEL_COLS      76
 #define SESSIONS_LABEL_COLS     76
+/* The label rows include the color/attribute markup (the headers) */
+#define INFO_LABEL_ROW_SIZE     384
 #define TARGETS_LABEL_TITLE     "FC HBAs / IB HCAs / FCoE Adapters"
 #define SESSIONS_LABEL_TITLE    "Active Sessions"
 
@@ -178,22 +189,36 @@ extern "C" {
 #define LVCREATE_BIN    "/usr/sbin/lvcreate"
 #define LVREMOVE_BIN    "/usr/sbin/lvremove"
 
+/* The sysfs and procfs paths are looked up at run time, so they can all be
+ * moved under another root directory (see setSysRoot()) */
+typedef enum {
+    SYS_PATH_FC_HOST, SYS_PATH_INFINIBAND, SYS_PATH_SCST_TGT,
+    SYS_PATH_SCSI_DISK, SYS_PATH_SCSI_DEVICE, SYS_PATH_BLOCK,
+    SYS_PATH_DEV_BLOCK, SYS_PATH_NET, SYS_PATH_DRBD, SYS_PATH_MDSTAT,
+    SYS_PATH_MOUNTINFO, SYS_PATH_SWAPS, SYS_PATH_CNT
+} sys_path_t;
+extern char *g_sys_paths[];
+
 /* A few sysfs settings */
-#define SYSFS_FC_HOST           "/sys/class/fc_host"
-#define SYSFS_INFINIBAND        "/sys/class/infiniband"
-#define SYSFS_SCST_TGT          "/sys/kernel/scst_tgt"
-#define SYSFS_SCSI_DISK         "/sys/class/scsi_disk"
-#define SYSFS_SCSI_DEVICE       "/sys/class/scsi_device"
-#define SYSFS_BLOCK             "/sys/block"
-#define SYSFS_NET               "/sys/class/net"
+#define SYSFS_FC_HOST           g_sys_paths[SYS_PATH_FC_HOST]
+#define SYSFS_INFINIBAND        g_sys_paths[SYS_PATH_INFINIBAND]
+#define SYSFS_SCST_TGT          g_sys_paths[SYS_PATH_SCST_TGT]
+#define SYSFS_SCSI_DISK         g_sys_paths[SYS_PATH_SCSI_DISK]
+#define SYSFS_SCSI_DEVICE       g_sys_paths[SYS_PATH_SCSI_DEVICE]
+#define SYSFS_BLOCK             g_sys_paths[SYS_PATH_BLOCK]
+#define SYSFS_DEV_BLOCK         g_sys_paths[SYS_PATH_DEV_BLOCK]
+#define DEV_DISK_BY_ID          "/dev/disk/by-id"
+#define SYSFS_NET               g_sys_paths[SYS_PATH_NET]
 #define MAX_SYSFS_ATTR_SIZE     256
 #define MAX_SYSFS_PATH_SIZE     256
 #define SCSI_CHANGER_TYPE       8
 #define SCSI_TAPE_TYPE          1
 
 /* System files (configuration, etc.) */
-#define PROC_DRBD       "/proc/drbd"
-#define PROC_MDSTAT     "/proc/mdstat"
+#define PROC_DRBD       g_sys_paths[SYS_PATH_DRBD]
+#define PROC_MDSTAT     g_sys_paths[SYS_PATH_MDSTAT]
+#define PROC_MOUNTINFO  g_sys_paths[SYS_PATH_MOUNTINFO]
+#define PROC_SWAPS      g_sys_paths[SYS_PATH_SWAPS]
 #define SSMTP_CONF      "/etc/ssmtp/ssmtp.conf"
 #define NETWORK_CONF    "/etc/network.conf"
 #define NTP_SERVER      "/etc/ntp_server"
@@ -209,6 +234,7 @@ extern "C" {
 #define VDISK_MNT_BASE  "/mnt/vdisks"
 #define LOCALTIME       "/etc/localtime"
 #define ZONEINFO        "/usr/share/zoneinfo/posix"
+#define PROFILE_DUMP    "/tmp/esos_tui_profile.txt"
 
 /* Size/limits settings */
 #define MAX_SCST_TGTS               256
@@ -218,7 +244,14 @@ extern "C" {
 #define MAX_SCST_DEVS               128
 #define MAX_SCST_INITS              128
 #define MAX_SCST_DRIVERS            16
-#define MAX_SCST_SESSNS             512
+#define MAX_MAP_DESTS               256
+#define SCST_TBL_INIT_ROWS          64
+#define STR_POOL_INIT_SIZE          4096
+#define SESS_RATE_INIT_SLOTS        256
+#define SESS_RATE_HIST_LEN          16
+#define ATTR_CACHE_MAX_FDS          4096
+#define ATTR_CACHE_MIN_FDS          16
+#define ATTR_CACHE_FD_RESERVE       128
 #define MAX_SCST_SESS_INITS         128
 #define MAX_SCST_DEV_GRPS           64
 #define MAX_SCST_TGT_GRPS           64
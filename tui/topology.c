@@ -0,0 +1,1241 @@
+/**
+ * @file topology.c
+ * @brief Functions for caching the SCST target/session topology (sysfs).
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syslog.h>
+#include <errno.h>
+#include <cdk.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "prototypes.h"
+#include "system.h"
+#include "topology.h"
+#include "strings.h"
+
+
+/* The cached SCST topology (used by the main screen labels) */
+scst_topo_t g_scst_topo;
+
+
+/**
+ * @brief Grow (realloc) one column of a struct-of-arrays table to the given
+ * number of rows. On failure the original column is returned (still valid)
+ * and 'success' is set to FALSE.
+ */
+void *growColumn(void *column, size_t elem_size, int rows, boolean *success) {
+    void *new_column = NULL;
+
+    if ((new_column = realloc(column, (elem_size * rows))) == NULL) {
+        DEBUG_LOG("realloc(): %s", strerror(errno));
+        *success = FALSE;
+        return column;
+    }
+    return new_column;
+}
+
+
+/**
+ * @brief Make sure the target table has room for at least 'rows' rows; the
+ * table only ever grows (doubling). Return FALSE if we couldn't allocate it.
+ */
+boolean growTgtTable(scst_tgt_tbl_t *tbl, int rows) {
+    int new_alloc = 0;
+    boolean success = TRUE;
+
+    if (rows <= tbl->alloc)
+        return TRUE;
+    new_alloc = (tbl->alloc > 0) ? tbl->alloc : SCST_TBL_INIT_ROWS;
+    while (new_alloc < rows)
+        new_alloc *= 2;
+
+    tbl->driver = growColumn(tbl->driver, sizeof (int), new_alloc, &success);
+    tbl->name = growColumn(tbl->name, sizeof (int), new_alloc, &success);
+    tbl->adapter = growColumn(tbl->adapter, sizeof (int), new_alloc, &success);
+    tbl->sess_sig = growColumn(tbl->sess_sig, sizeof (dir_sig_t), new_alloc,
+            &success);
+    tbl->enabled = growColumn(tbl->enabled, sizeof (boolean), new_alloc,
+            &success);
+    if (!success)
+        return FALSE;
+    tbl->alloc = new_alloc;
+    return TRUE;
+}
+
+
+/**
+ * @brief Make sure the session table has room for at least 'rows' rows; the
+ * table only ever grows (doubling). Return FALSE if we couldn't allocate it.
+ */
+boolean growSessTable(scst_sess_tbl_t *tbl, int rows) {
+    int new_alloc = 0;
+    boolean success = TRUE;
+
+    if (rows <= tbl->alloc)
+        return TRUE;
+    new_alloc = (tbl->alloc > 0) ? tbl->alloc : SCST_TBL_INIT_ROWS;
+    while (new_alloc < rows)
+        new_alloc *= 2;
+
+    tbl->target = growColumn(tbl->target, sizeof (int), new_alloc, &success);
+    tbl->rate = growColumn(tbl->rate, sizeof (int), new_alloc, &success);
+    tbl->name = growColumn(tbl->name, sizeof (int), new_alloc, &success);
+    tbl->initiator = growColumn(tbl->initiator, sizeof (int), new_alloc,
+            &success);
+    tbl->luns_sig = growColumn(tbl->luns_sig, sizeof (dir_sig_t), new_alloc,
+            &success);
+    tbl->has_cmd_cnts = growColumn(tbl->has_cmd_cnts, sizeof (boolean),
+            new_alloc, &success);
+    tbl->lun_cnt = growColumn(tbl->lun_cnt, sizeof (int), new_alloc,
+            &success);
+    tbl->active_cmds = growColumn(tbl->active_cmds, sizeof (int), new_alloc,
+            &success);
+    tbl->read_io_kb = growColumn(tbl->read_io_kb, sizeof (unsigned long long),
+            new_alloc, &success);
+    tbl->write_io_kb = growColumn(tbl->write_io_kb,
+            sizeof (unsigned long long), new_alloc, &success);
+    tbl->read_cmds = growColumn(tbl->read_cmds, sizeof (unsigned long long),
+            new_alloc, &success);
+    tbl->write_cmds = growColumn(tbl->write_cmds, sizeof (unsigned long long),
+            new_alloc, &success);
+    tbl->have_rate = growColumn(tbl->have_rate, sizeof (boolean), new_alloc,
+            &success);
+    tbl->read_kbps = growColumn(tbl->read_kbps, sizeof (double), new_alloc,
+            &success);
+    tbl->write_kbps = growColumn(tbl->write_kbps, sizeof (double), new_alloc,
+            &success);
+    tbl->iops = growColumn(tbl->iops, sizeof (double), new_alloc, &success);
+    tbl->peak_kbps = growColumn(tbl->peak_kbps, sizeof (double), new_alloc,
+            &success);
+    if (!success)
+        return FALSE;
+    tbl->alloc = new_alloc;
+    return TRUE;
+}
+
+
+/**
+ * @brief Make sure the device table has room for at least 'rows' rows; the
+ * table only ever grows (doubling). Return FALSE if we couldn't allocate it.
+ */
+boolean growDevTable(scst_dev_tbl_t *tbl, int rows) {
+    int new_alloc = 0;
+    boolean success = TRUE;
+
+    if (rows <= tbl->alloc)
+        return TRUE;
+    new_alloc = (tbl->alloc > 0) ? tbl->alloc : SCST_TBL_INIT_ROWS;
+    while (new_alloc < rows)
+        new_alloc *= 2;
+
+    tbl->handler = growColumn(tbl->handler, sizeof (int), new_alloc,
+            &success);
+    tbl->name = growColumn(tbl->name, sizeof (int), new_alloc, &success);
+    tbl->backing = growColumn(tbl->backing, sizeof (int), new_alloc,
+            &success);
+    tbl->backing_dev = growColumn(tbl->backing_dev, sizeof (dev_t),
+            new_alloc, &success);
+    tbl->have_stat = growColumn(tbl->have_stat, sizeof (boolean), new_alloc,
+            &success);
+    tbl->last_stat = growColumn(tbl->last_stat, sizeof (blk_stat_t),
+            new_alloc, &success);
+    tbl->stat_time = growColumn(tbl->stat_time, sizeof (struct timespec),
+            new_alloc, &success);
+    tbl->have_rate = growColumn(tbl->have_rate, sizeof (boolean), new_alloc,
+            &success);
+    tbl->read_iops = growColumn(tbl->read_iops, sizeof (double), new_alloc,
+            &success);
+    tbl->write_iops = growColumn(tbl->write_iops, sizeof (double), new_alloc,
+            &success);
+    tbl->read_mbps = growColumn(tbl->read_mbps, sizeof (double), new_alloc,
+            &success);
+    tbl->write_mbps = growColumn(tbl->write_mbps, sizeof (double), new_alloc,
+            &success);
+    tbl->svc_msec = growColumn(tbl->svc_msec, sizeof (double), new_alloc,
+            &success);
+    tbl->in_flight = growColumn(tbl->in_flight, sizeof (unsigned long long),
+            new_alloc, &success);
+    if (!success)
+        return FALSE;
+    tbl->alloc = new_alloc;
+    return TRUE;
+}
+
+
+/**
+ * @brief Empty the string pool, keeping its memory for re-use. Return FALSE
+ * if the pool couldn't be allocated (the first time).
+ */
+boolean resetStrPool(str_pool_t *pool) {
+    int i = 0;
+
+    if (pool->data == NULL) {
+        if ((pool->data = malloc(STR_POOL_INIT_SIZE)) == NULL) {
+            DEBUG_LOG("malloc(): %s", strerror(errno));
+            return FALSE;
+        }
+        pool->size = STR_POOL_INIT_SIZE;
+    }
+    /* Offset 0 is the empty string */
+    pool->data[0] = '\0';
+    pool->used = 1;
+    pool->str_cnt = 0;
+    for (i = 0; i < pool->index_size; i++)
+        pool->index[i] = -1;
+    return TRUE;
+}
+
+
+/**
+ * @brief Rebuild the string pool hash index with the given number of slots
+ * (a power of two). Return FALSE if we couldn't allocate it.
+ */
+boolean rehashStrPool(str_pool_t *pool, int index_size) {
+    int *new_index = NULL;
+    int i = 0, offset = 0;
+    unsigned long slot = 0;
+
+    if ((new_index = malloc(sizeof (int) * index_size)) == NULL) {
+        DEBUG_LOG("malloc(): %s", strerror(errno));
+        return FALSE;
+    }
+    for (i = 0; i < index_size; i++)
+        new_index[i] = -1;
+    for (i = 0; i < pool->index_size; i++) {
+        if ((offset = pool->index[i]) == -1)
+            continue;
+        slot = hashRateKey(pool->data + offset) & (index_size - 1);
+        while (new_index[slot] != -1)
+            slot = (slot + 1) & (index_size - 1);
+        new_index[slot] = offset;
+    }
+    FREE_NULL(pool->index);
+    pool->index = new_index;
+    pool->index_size = index_size;
+    return TRUE;
+}
+
+
+/**
+ * @brief Add a string to the pool (unless the same string is already there)
+ * and return its offset; -1 is returned if we couldn't grow the pool.
+ */
+int internStr(str_pool_t *pool, char string[]) {
+    unsigned long slot = 0;
+    int offset = 0, str_len = 0, new_size = 0;
+    char *new_data = NULL;
+
+    if (string[0] == '\0')
+        return 0;
+
+    /* Keep the index at most half full */
+    if (((pool->str_cnt + 1) * 2) > pool->index_size) {
+        if (!rehashStrPool(pool, ((pool->index_size > 0) ?
+                (pool->index_size * 2) : 256)))
+            return -1;
+    }
+
+    /* Is it already in the pool? */
+    slot = hashRateKey(string) & (pool->index_size - 1);
+    while ((offset = pool->index[slot]) != -1) {
+        if (strcmp(pool->data + offset, string) == 0)
+            return offset;
+        slot = (slot + 1) & (pool->index_size - 1);
+    }
+
+    /* Nope, so add it */
+    str_len = strlen(string) + 1;
+    if ((pool->used + str_len) > pool->size) {
+        new_size = pool->size;
+        while ((pool->used + str_len) > new_size)
+            new_size *= 2;
+        if ((new_data = realloc(pool->data, new_size)) == NULL) {
+            DEBUG_LOG("realloc(): %s", strerror(errno));
+            return -1;
+        }
+        pool->data = new_data;
+        pool->size = new_size;
+    }
+    offset = pool->used;
+    memcpy(pool->data + offset, string, str_len);
+    pool->used += str_len;
+    pool->index[slot] = offset;
+    pool->str_cnt++;
+    return offset;
+}
+
+
+/**
+ * @brief Return the offset of a string if it's in the pool, otherwise -1
+ * (the pool isn't changed).
+ */
+int lookupStr(str_pool_t *pool, char string[]) {
+    unsigned long slot = 0;
+    int offset = 0;
+
+    if (string[0] == '\0')
+        return 0;
+    if (pool->index_size == 0)
+        return -1;
+    slot = hashRateKey(string) & (pool->index_size - 1);
+    while ((offset = pool->index[slot]) != -1) {
+        if (strcmp(pool->data + offset, string) == 0)
+            return offset;
+        slot = (slot + 1) & (pool->index_size - 1);
+    }
+    return -1;
+}
+
+
+/**
+ * @brief Free the memory held by a string pool (it can be used again).
+ */
+void freeStrPool(str_pool_t *pool) {
+    FREE_NULL(pool->data);
+    FREE_NULL(pool->index);
+    pool->used = 0;
+    pool->size = 0;
+    pool->index_size = 0;
+    pool->str_cnt = 0;
+}
+
+
+/**
+ * @brief Return the string for a pool offset.
+ */
+char *poolStr(str_pool_t *pool, int offset) {
+    return pool->data + offset;
+}
+
+
+/**
+ * @brief Copy the strings of one pool into another (the hash index isn't
+ * copied, so the copy can only be read). Return FALSE if we couldn't allocate
+ * the memory.
+ */
+boolean copyStrPool(str_pool_t *dest, str_pool_t *src) {
+    char *new_data = NULL;
+
+    if (dest->size < src->used) {
+        if ((new_data = realloc(dest->data, src->size)) == NULL) {
+            DEBUG_LOG("realloc(): %s", strerror(errno));
+            return FALSE;
+        }
+        dest->data = new_data;
+        dest->size = src->size;
+    }
+    if (src->used > 0)
+        memcpy(dest->data, src->data, src->used);
+    dest->used = src->used;
+    dest->str_cnt = src->str_cnt;
+    return TRUE;
+}
+
+
+/**
+ * @brief Copy a topology (eg, into a snapshot); the destination tables and
+ * string pool are grown as needed and otherwise re-used. Return FALSE if we
+ * couldn't allocate memory (the destination is then left empty, with the
+ * error message set).
+ */
+boolean copySCSTTopology(scst_topo_t *dest, scst_topo_t *src) {
+    str_pool_t dest_strings = dest->strings, dest_dev_strings =
+            dest->dev_strings;
+    scst_tgt_tbl_t dest_tgts = dest->tgts;
+    scst_sess_tbl_t dest_sess = dest->sess;
+    scst_dev_tbl_t dest_devs = dest->devs;
+    int tgt_cnt = src->tgts.cnt, sess_cnt = src->sess.cnt,
+            dev_cnt = src->devs.cnt;
+
+    /* The scalar parts, then put our own tables back */
+    *dest = *src;
+    dest->strings = dest_strings;
+    dest->dev_strings = dest_dev_strings;
+    dest->tgts = dest_tgts;
+    dest->sess = dest_sess;
+    dest->devs = dest_devs;
+    dest->tgts.cnt = 0;
+    dest->sess.cnt = 0;
+    dest->devs.cnt = 0;
+
+    /* The strings (the hash index isn't needed in a copy) */
+    if (!copyStrPool(&dest->strings, &src->strings) ||
+            !copyStrPool(&dest->dev_strings, &src->dev_strings)) {
+        snprintf(dest->error_msg, MISC_STRING_LEN, "%s", TOPO_MEM_ERR);
+        return FALSE;
+    }
+
+    /* The targets */
+    if (!growTgtTable(&dest->tgts, tgt_cnt)) {
+        snprintf(dest->error_msg, MISC_STRING_LEN, "%s", TOPO_MEM_ERR);
+        return FALSE;
+    }
+    memcpy(dest->tgts.driver, src->tgts.driver, sizeof (int) * tgt_cnt);
+    memcpy(dest->tgts.name, src->tgts.name, sizeof (int) * tgt_cnt);
+    memcpy(dest->tgts.adapter, src->tgts.adapter, sizeof (int) * tgt_cnt);
+    memcpy(dest->tgts.sess_sig, src->tgts.sess_sig,
+            sizeof (dir_sig_t) * tgt_cnt);
+    memcpy(dest->tgts.enabled, src->tgts.enabled, sizeof (boolean) * tgt_cnt);
+
+    /* The sessions */
+    if (!growSessTable(&dest->sess, sess_cnt)) {
+        snprintf(dest->error_msg, MISC_STRING_LEN, "%s", TOPO_MEM_ERR);
+        return FALSE;
+    }
+    memcpy(dest->sess.target, src->sess.target, sizeof (int) * sess_cnt);
+    memcpy(dest->sess.rate, src->sess.rate, sizeof (int) * sess_cnt);
+    memcpy(dest->sess.name, src->sess.name, sizeof (int) * sess_cnt);
+    memcpy(dest->sess.initiator, src->sess.initiator,
+            sizeof (int) * sess_cnt);
+    memcpy(dest->sess.luns_sig, src->sess.luns_sig,
+            sizeof (dir_sig_t) * sess_cnt);
+    memcpy(dest->sess.has_cmd_cnts, src->sess.has_cmd_cnts,
+            sizeof (boolean) * sess_cnt);
+    memcpy(dest->sess.lun_cnt, src->sess.lun_cnt, sizeof (int) * sess_cnt);
+    memcpy(dest->sess.active_cmds, src->sess.active_cmds,
+            sizeof (int) * sess_cnt);
+    memcpy(dest->sess.read_io_kb, src->sess.read_io_kb,
+            sizeof (unsigned long long) * sess_cnt);
+    memcpy(dest->sess.write_io_kb, src->sess.write_io_kb,
+            sizeof (unsigned long long) * sess_cnt);
+    memcpy(dest->sess.read_cmds, src->sess.read_cmds,
+            sizeof (unsigned long long) * sess_cnt);
+    memcpy(dest->sess.write_cmds, src->sess.write_cmds,
+            sizeof (unsigned long long) * sess_cnt);
+    memcpy(dest->sess.have_rate, src->sess.have_rate,
+            sizeof (boolean) * sess_cnt);
+    memcpy(dest->sess.read_kbps, src->sess.read_kbps,
+            sizeof (double) * sess_cnt);
+    memcpy(dest->sess.write_kbps, src->sess.write_kbps,
+            sizeof (double) * sess_cnt);
+    memcpy(dest->sess.iops, src->sess.iops, sizeof (double) * sess_cnt);
+    memcpy(dest->sess.peak_kbps, src->sess.peak_kbps,
+            sizeof (double) * sess_cnt);
+
+    /* The devices */
+    if (!growDevTable(&dest->devs, dev_cnt)) {
+        snprintf(dest->error_msg, MISC_STRING_LEN, "%s", TOPO_MEM_ERR);
+        return FALSE;
+    }
+    memcpy(dest->devs.handler, src->devs.handler, sizeof (int) * dev_cnt);
+    memcpy(dest->devs.name, src->devs.name, sizeof (int) * dev_cnt);
+    memcpy(dest->devs.backing, src->devs.backing, sizeof (int) * dev_cnt);
+    memcpy(dest->devs.backing_dev, src->devs.backing_dev,
+            sizeof (dev_t) * dev_cnt);
+    memcpy(dest->devs.have_stat, src->devs.have_stat,
+            sizeof (boolean) * dev_cnt);
+    memcpy(dest->devs.last_stat, src->devs.last_stat,
+            sizeof (blk_stat_t) * dev_cnt);
+    memcpy(dest->devs.stat_time, src->devs.stat_time,
+            sizeof (struct timespec) * dev_cnt);
+    memcpy(dest->devs.have_rate, src->devs.have_rate,
+            sizeof (boolean) * dev_cnt);
+    memcpy(dest->devs.read_iops, src->devs.read_iops,
+            sizeof (double) * dev_cnt);
+    memcpy(dest->devs.write_iops, src->devs.write_iops,
+            sizeof (double) * dev_cnt);
+    memcpy(dest->devs.read_mbps, src->devs.read_mbps,
+            sizeof (double) * dev_cnt);
+    memcpy(dest->devs.write_mbps, src->devs.write_mbps,
+            sizeof (double) * dev_cnt);
+    memcpy(dest->devs.svc_msec, src->devs.svc_msec,
+            sizeof (double) * dev_cnt);
+    memcpy(dest->devs.in_flight, src->devs.in_flight,
+            sizeof (unsigned long long) * dev_cnt);
+
+    /* Done */
+    dest->tgts.cnt = tgt_cnt;
+    dest->sess.cnt = sess_cnt;
+    dest->devs.cnt = dev_cnt;
+    return TRUE;
+}
+
+
+/**
+ * @brief Check the directory signature (inode, link count and mtime) of the
+ * given directory, relative to an open directory (or AT_FDCWD), against the
+ * saved signature; an empty name checks the open directory itself. The saved
+ * signature is updated with the current value. Return TRUE if the directory
+ * changed (or can't be checked), otherwise FALSE.
+ */
+boolean dirSigChangedAt(int dir_fd, const char *dir_name,
+        dir_sig_t *dir_sig) {
+    struct stat dir_stat = {0};
+    boolean changed = FALSE;
+
+    if (fstatat(dir_fd, dir_name, &dir_stat,
+            ((dir_name[0] == '\0') ? AT_EMPTY_PATH : 0)) == -1) {
+        /* A missing directory is a change only if it used to be there */
+        changed = dir_sig->valid;
+        dir_sig->valid = FALSE;
+        return changed;
+    }
+
+    if ((!dir_sig->valid) || (dir_sig->ino != dir_stat.st_ino) ||
+            (dir_sig->nlink != dir_stat.st_nlink) ||
+            (dir_sig->mtime.tv_sec != dir_stat.st_mtim.tv_sec) ||
+            (dir_sig->mtime.tv_nsec != dir_stat.st_mtim.tv_nsec))
+        changed = TRUE;
+
+    dir_sig->valid = TRUE;
+    dir_sig->ino = dir_stat.st_ino;
+    dir_sig->nlink = dir_stat.st_nlink;
+    dir_sig->mtime = dir_stat.st_mtim;
+    return changed;
+}
+
+
+/**
+ * @brief Same as dirSigChangedAt() using a full path.
+ */
+boolean dirSigChanged(char dir_path[], dir_sig_t *dir_sig) {
+    return dirSigChangedAt(AT_FDCWD, dir_path, dir_sig);
+}
+
+
+/**
+ * @brief Check all of the cached directory signatures (drivers, targets,
+ * sessions and adapters) and return TRUE if any of them changed, which means
+ * the cached topology needs to be rebuilt. Everything under the SCST
+ * "targets" directory is checked relative to it (one path lookup).
+ */
+boolean topologyChanged(scst_topo_t *topo) {
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0};
+    boolean changed = FALSE;
+    int i = 0, targets_fd = -1;
+
+    /* A missing "targets" directory (fd is -1) fails every check below */
+    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/targets", SYSFS_SCST_TGT);
+    targets_fd = openDirAt(AT_FDCWD, dir_name);
+
+    /* Check every signature (each call also refreshes the saved value) */
+    if (dirSigChangedAt(targets_fd, "", &topo->drivers_sig))
+        changed = TRUE;
+    for (i = 0; i < topo->driver_cnt; i++) {
+        if (dirSigChangedAt(targets_fd, topo->drivers[i],
+                &topo->driver_sig[i]))
+            changed = TRUE;
+    }
+    for (i = 0; i < topo->tgts.cnt; i++) {
+        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/sessions",
+                poolStr(&topo->strings, topo->tgts.driver[i]),
+                poolStr(&topo->strings, topo->tgts.name[i]));
+        if (dirSigChangedAt(targets_fd, dir_name, &topo->tgts.sess_sig[i]))
+            changed = TRUE;
+    }
+    if (targets_fd != -1)
+        close(targets_fd);
+    if (dirSigChanged(SYSFS_FC_HOST, &topo->fc_sig))
+        changed = TRUE;
+    if (dirSigChanged(SYSFS_INFINIBAND, &topo->ib_sig))
+        changed = TRUE;
+
+    /* Done */
+    return changed;
+}
+
+
+/**
+ * @brief Fill the adapter list with all FC / FCoE adapters and IB HCAs. The
+ * FC port names are converted to match the SCST target names. A missing
+ * class directory simply means there are no adapters of that type. Return
+ * FALSE if an error occurs (and set the error message), otherwise TRUE.
+ */
+boolean readSCSTAdapters(scst_topo_t *topo) {
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    scst_adapter_t *adapter = NULL;
+    char attr_path[MAX_SYSFS_PATH_SIZE] = {0},
+            attr_val[MAX_SYSFS_ATTR_SIZE] = {0};
+    char *temp_pstr = NULL;
+    size_t port_name_size = 0;
+
+    topo->adapter_cnt = 0;
+
+    /* Fibre Channel / FCoE adapter information */
+    if ((dir_stream = opendir(SYSFS_FC_HOST)) == NULL) {
+        if (errno != ENOENT) {
+            snprintf(topo->error_msg, MISC_STRING_LEN, "opendir(): %s",
+                    strerror(errno));
+            return FALSE;
+        }
+    } else {
+        while ((dir_entry = readdir(dir_stream)) != NULL) {
+            /* The hostX directory names are links */
+            if ((dir_entry->d_type != DT_LNK) ||
+                    (topo->adapter_cnt >= MAX_FC_ADAPTERS))
+                continue;
+            adapter = &topo->adapters[topo->adapter_cnt];
+            adapter->type = FC_ADAPTER;
+            snprintf(adapter->host, MISC_STRING_LEN, "%s", dir_entry->d_name);
+            adapter->speed[0] = '\0';
+            /* Make the port name match a SCST target name */
+            adapter->port_name[0] = '\0';
+            port_name_size = 0;
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/port_name",
+                    SYSFS_FC_HOST, dir_entry->d_name);
+            readAttribute(attr_path, attr_val);
+            temp_pstr = strchr(attr_val, 'x');
+            if (temp_pstr != NULL) {
+                temp_pstr++;
+                while ((strlen(temp_pstr) >= 2) &&
+                        ((port_name_size + 3) < MAX_SYSFS_ATTR_SIZE)) {
+                    strncat(adapter->port_name, temp_pstr, 2);
+                    port_name_size = port_name_size + 2;
+                    temp_pstr = temp_pstr + 2;
+                    if (*temp_pstr != '\0') {
+                        strncat(adapter->port_name, ":", 1);
+                        port_name_size++;
+                    }
+                }
+            }
+            topo->adapter_cnt++;
+        }
+        closedir(dir_stream);
+    }
+
+    /* InfiniBand HCA information */
+    if ((dir_stream = opendir(SYSFS_INFINIBAND)) == NULL) {
+        if (errno != ENOENT) {
+            snprintf(topo->error_msg, MISC_STRING_LEN, "opendir(): %s",
+                    strerror(errno));
+            return FALSE;
+        }
+    } else {
+        while ((dir_entry = readdir(dir_stream)) != NULL) {
+            /* The IB directory names are links */
+            if ((dir_entry->d_type != DT_LNK) ||
+                    (topo->adapter_cnt >= (MAX_FC_ADAPTERS + MAX_IB_ADAPTERS)))
+                continue;
+            adapter = &topo->adapters[topo->adapter_cnt];
+            adapter->type = IB_ADAPTER;
+            snprintf(adapter->host, MISC_STRING_LEN, "%s", dir_entry->d_name);
+            adapter->speed[0] = '\0';
+            /* Get the HCA node GUID (this matches what SCST has) */
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/node_guid",
+                    SYSFS_INFINIBAND, dir_entry->d_name);
+            readAttribute(attr_path, attr_val);
+            snprintf(adapter->port_name, MAX_SYSFS_ATTR_SIZE, "%s", attr_val);
+            topo->adapter_cnt++;
+        }
+        closedir(dir_stream);
+    }
+
+    /* Done */
+    return TRUE;
+}
+
+
+/**
+ * @brief Walk the SCST sysfs structure and rebuild the cached topology (target
+ * drivers, targets, sessions and adapters). The tree is walked with openat()
+ * relative to the directories already open, and each directory signature is
+ * taken from the open directory before it is read, so anything that changes
+ * during the walk is caught on the next update. The tables and string pool are
+ * re-used (they only grow). Return FALSE if an error occurs (and set the
+ * error message), otherwise TRUE.
+ */
+boolean rebuildSCSTTopology(scst_topo_t *topo) {
+    DIR *tgt_dir_stream = NULL, *sess_dir_stream = NULL;
+    struct dirent *tgt_dir_entry = NULL, *sess_dir_entry = NULL;
+    scst_tgt_tbl_t *tgts = &topo->tgts;
+    scst_sess_tbl_t *sess = &topo->sess;
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0},
+            rate_key[MAX_SYSFS_PATH_SIZE] = {0},
+            attr_val[MAX_SYSFS_ATTR_SIZE] = {0};
+    char *tgt_name = NULL, *sess_name = NULL;
+    int i = 0, j = 0, tgt = 0, row = 0, targets_fd = -1, sess_fd = -1;
+    boolean walk_ok = TRUE;
+
+    topo->generation++;
+    topo->stale = TRUE;
+    topo->driver_cnt = 0;
+    tgts->cnt = 0;
+    sess->cnt = 0;
+
+    /* Don't hold on to handles for targets/sessions that went away */
+    closeAttrHandles();
+    if (!resetStrPool(&topo->strings)) {
+        snprintf(topo->error_msg, MISC_STRING_LEN, "%s", TOPO_MEM_ERR);
+        return FALSE;
+    }
+
+    /* Everything else is opened relative to the "targets" directory */
+    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/targets", SYSFS_SCST_TGT);
+    if ((targets_fd = openDirAt(AT_FDCWD, dir_name)) == -1) {
+        snprintf(topo->error_msg, MISC_STRING_LEN, "openat(): %s",
+                strerror(errno));
+        return FALSE;
+    }
+    dirSigChangedAt(targets_fd, "", &topo->drivers_sig);
+
+    /* Fill the array with current SCST target drivers */
+    if (!listSCSTTgtDrivers(topo->drivers, &topo->driver_cnt)) {
+        close(targets_fd);
+        snprintf(topo->error_msg, MISC_STRING_LEN, "%s", TGT_DRIVERS_ERR);
+        return FALSE;
+    }
+
+    for (i = 0; (i < topo->driver_cnt) && walk_ok; i++) {
+        /* Open the directory for targets */
+        if ((tgt_dir_stream = openDirStreamAt(targets_fd,
+                topo->drivers[i])) == NULL) {
+            snprintf(topo->error_msg, MISC_STRING_LEN, "opendir(): %s",
+                    strerror(errno));
+            walk_ok = FALSE;
+            break;
+        }
+        topo->driver_sig[i].valid = FALSE;
+        dirSigChangedAt(dirfd(tgt_dir_stream), "", &topo->driver_sig[i]);
+        while (walk_ok && (tgt_dir_entry = readdir(tgt_dir_stream)) != NULL) {
+            /* The target names are directories */
+            if ((tgt_dir_entry->d_type != DT_DIR) ||
+                    (strcmp(tgt_dir_entry->d_name, ".") == 0) ||
+                    (strcmp(tgt_dir_entry->d_name, "..") == 0))
+                continue;
+            if (!growTgtTable(tgts, (tgts->cnt + 1))) {
+                snprintf(topo->error_msg, MISC_STRING_LEN, "%s",
+                        TOPO_MEM_ERR);
+                walk_ok = FALSE;
+                break;
+            }
+            tgt = tgts->cnt;
+            tgts->driver[tgt] = internStr(&topo->strings, topo->drivers[i]);
+            tgts->name[tgt] = internStr(&topo->strings, tgt_dir_entry->d_name);
+            if ((tgts->driver[tgt] == -1) || (tgts->name[tgt] == -1)) {
+                snprintf(topo->error_msg, MISC_STRING_LEN, "%s",
+                        TOPO_MEM_ERR);
+                walk_ok = FALSE;
+                break;
+            }
+            tgts->adapter[tgt] = -1;
+            tgts->enabled[tgt] = FALSE;
+
+            /* Open the directory for sessions */
+            snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/sessions",
+                    tgt_dir_entry->d_name);
+            if ((sess_dir_stream = openDirStreamAt(dirfd(tgt_dir_stream),
+                    dir_name)) == NULL) {
+                snprintf(topo->error_msg, MISC_STRING_LEN, "opendir(): %s",
+                        strerror(errno));
+                walk_ok = FALSE;
+                break;
+            }
+            tgts->sess_sig[tgt].valid = FALSE;
+            dirSigChangedAt(dirfd(sess_dir_stream), "", &tgts->sess_sig[tgt]);
+            while ((sess_dir_entry = readdir(sess_dir_stream)) != NULL) {
+                /* The session names are directories */
+                if ((sess_dir_entry->d_type != DT_DIR) ||
+                        (strcmp(sess_dir_entry->d_name, ".") == 0) ||
+                        (strcmp(sess_dir_entry->d_name, "..") == 0))
+                    continue;
+                /* If the session just went away, the signature (taken
+                 * above) catches it on the next update */
+                if ((sess_fd = openDirAt(dirfd(sess_dir_stream),
+                        sess_dir_entry->d_name)) == -1)
+                    continue;
+                if (!growSessTable(sess, (sess->cnt + 1))) {
+                    close(sess_fd);
+                    snprintf(topo->error_msg, MISC_STRING_LEN, "%s",
+                            TOPO_MEM_ERR);
+                    walk_ok = FALSE;
+                    break;
+                }
+                row = sess->cnt;
+                sess->target[row] = tgt;
+                /* The initiator name doesn't change for a session */
+                readAttributeAt(sess_fd, "initiator_name", attr_val);
+                /* Older SCST versions don't have the command counts */
+                sess->has_cmd_cnts[row] = (faccessat(sess_fd,
+                        "read_cmd_count", F_OK, 0) == 0) ? TRUE : FALSE;
+                close(sess_fd);
+                sess->initiator[row] = internStr(&topo->strings, attr_val);
+                sess->name[row] = internStr(&topo->strings,
+                        sess_dir_entry->d_name);
+                if ((sess->name[row] == -1) || (sess->initiator[row] == -1)) {
+                    snprintf(topo->error_msg, MISC_STRING_LEN, "%s",
+                            TOPO_MEM_ERR);
+                    walk_ok = FALSE;
+                    break;
+                }
+                /* The pool may have moved */
+                tgt_name = poolStr(&topo->strings, tgts->name[tgt]);
+                sess_name = poolStr(&topo->strings, sess->name[row]);
+                /* Rates are kept by driver/target/session across rebuilds */
+                snprintf(rate_key, MAX_SYSFS_PATH_SIZE, "%s/%s/%s",
+                        topo->drivers[i], tgt_name, sess_name);
+                sess->rate[row] = findSessRate(rate_key, topo->generation);
+                /* The LUN count is filled in with the counters */
+                sess->luns_sig[row].valid = FALSE;
+                sess->lun_cnt[row] = 0;
+                sess->active_cmds[row] = 0;
+                sess->read_io_kb[row] = 0;
+                sess->write_io_kb[row] = 0;
+                sess->read_cmds[row] = 0;
+                sess->write_cmds[row] = 0;
+                sess->have_rate[row] = FALSE;
+                sess->read_kbps[row] = 0;
+                sess->write_kbps[row] = 0;
+                sess->iops[row] = 0;
+                sess->peak_kbps[row] = 0;
+                sess->cnt++;
+            }
+            closedir(sess_dir_stream);
+            if (walk_ok)
+                tgts->cnt++;
+        }
+        closedir(tgt_dir_stream);
+    }
+    close(targets_fd);
+    if (!walk_ok)
+        return FALSE;
+
+    /* Drop the rate history for any sessions that went away */
+    purgeSessRates(topo->generation);
+
+    /* Now the adapters, and match them up with targets */
+    dirSigChanged(SYSFS_FC_HOST, &topo->fc_sig);
+    dirSigChanged(SYSFS_INFINIBAND, &topo->ib_sig);
+    if (!readSCSTAdapters(topo))
+        return FALSE;
+    for (i = 0; i < tgts->cnt; i++) {
+        for (j = 0; j < topo->adapter_cnt; j++) {
+            if (strcmp(poolStr(&topo->strings, tgts->name[i]),
+                    topo->adapters[j].port_name) == 0) {
+                tgts->adapter[i] = j;
+                break;
+            }
+        }
+    }
+
+    /* Done */
+    topo->stale = FALSE;
+    return TRUE;
+}
+
+
+/**
+ * @brief Read the volatile values for the cached topology: target state,
+ * adapter link speed, and the session counters (which also update the session
+ * rates). A session LUN count is only re-counted when its "luns" directory
+ * signature changes; those are checked relative to the target's (open)
+ * "sessions" directory. The counters themselves are read with the persistent
+ * attribute handles. Return FALSE if a session or its counters have
+ * disappeared (the topology is stale), otherwise TRUE; a target state or
+ * link speed that can't be read just shows the error.
+ */
+boolean readSCSTCounters(scst_topo_t *topo) {
+    scst_tgt_tbl_t *tgts = &topo->tgts;
+    scst_sess_tbl_t *sess = &topo->sess;
+    struct timespec sample_time = {0};
+    char attr_path[MAX_SYSFS_PATH_SIZE] = {0},
+            attr_val[MAX_SYSFS_ATTR_SIZE] = {0},
+            sess_path[MAX_SYSFS_PATH_SIZE] = {0};
+    char *tgt_name = NULL, *tgt_driver = NULL, *sess_name = NULL;
+    int i = 0, rate = 0, targets_fd = -1, sessions_fd = -1, curr_tgt = -1;
+    boolean counters_ok = TRUE;
+
+    /* All of the session samples get the same (monotonic) time stamp */
+    clock_gettime(CLOCK_MONOTONIC, &sample_time);
+
+    for (i = 0; i < tgts->cnt; i++) {
+        /* Get the target enabled/disabled attribute */
+        snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/targets/%s/%s/enabled",
+                SYSFS_SCST_TGT, poolStr(&topo->strings, tgts->driver[i]),
+                poolStr(&topo->strings, tgts->name[i]));
+        /* On failure the value is the error text, so it reads as disabled */
+        readAttrCached(attr_path, attr_val);
+        tgts->enabled[i] = (atoi(attr_val) == 1) ? TRUE : FALSE;
+    }
+
+    for (i = 0; i < topo->adapter_cnt; i++) {
+        /* Get the link speed / port rate */
+        // TODO: It may be incorrect to assume there is only 1 IB port!
+        if (topo->adapters[i].type == FC_ADAPTER)
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/speed",
+                    SYSFS_FC_HOST, topo->adapters[i].host);
+        else
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/ports/1/rate",
+                    SYSFS_INFINIBAND, topo->adapters[i].host);
+        /* Not every adapter has one; the error text is shown instead */
+        readAttrCached(attr_path, topo->adapters[i].speed);
+    }
+
+    /* The sessions are grouped by target (in walk order) */
+    snprintf(sess_path, MAX_SYSFS_PATH_SIZE, "%s/targets", SYSFS_SCST_TGT);
+    if ((sess->cnt > 0) &&
+            ((targets_fd = openDirAt(AT_FDCWD, sess_path)) == -1))
+        return FALSE;
+
+    for (i = 0; i < sess->cnt; i++) {
+        tgt_driver = poolStr(&topo->strings, tgts->driver[sess->target[i]]);
+        tgt_name = poolStr(&topo->strings, tgts->name[sess->target[i]]);
+        sess_name = poolStr(&topo->strings, sess->name[i]);
+        if (sess->target[i] != curr_tgt) {
+            if (sessions_fd != -1)
+                close(sessions_fd);
+            curr_tgt = sess->target[i];
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/sessions",
+                    tgt_driver, tgt_name);
+            if ((sessions_fd = openDirAt(targets_fd, attr_path)) == -1) {
+                counters_ok = FALSE;
+                break;
+            }
+        }
+        /* Only re-count the LUNs if the directory changed */
+        snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/luns", sess_name);
+        if (dirSigChangedAt(sessions_fd, attr_path, &sess->luns_sig[i])) {
+            if (!sess->luns_sig[i].valid) {
+                counters_ok = FALSE;
+                break;
+            }
+            sess->lun_cnt[i] = countDirEntriesAt(sessions_fd, attr_path,
+                    DT_DIR, NULL);
+        }
+        /* The counters are read using persistent handles (by path) */
+        snprintf(sess_path, MAX_SYSFS_PATH_SIZE, "%s/targets/%s/%s/sessions/%s",
+                SYSFS_SCST_TGT, tgt_driver, tgt_name, sess_name);
+        /* Get the active commands attribute */
+        snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/active_commands",
+                sess_path);
+        if (readAttrCached(attr_path, attr_val) != 0) {
+            counters_ok = FALSE;
+            break;
+        }
+        sess->active_cmds[i] = atoi(attr_val);
+        /* Get the read IO (in KB) attribute */
+        snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/read_io_count_kb",
+                sess_path);
+        if (readAttrCached(attr_path, attr_val) != 0) {
+            counters_ok = FALSE;
+            break;
+        }
+        sess->read_io_kb[i] = strtoull(attr_val, NULL, 10);
+        /* Get the write IO (in KB) attribute */
+        snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/write_io_count_kb",
+                sess_path);
+        if (readAttrCached(attr_path, attr_val) != 0) {
+            counters_ok = FALSE;
+            break;
+        }
+        sess->write_io_kb[i] = strtoull(attr_val, NULL, 10);
+        if (sess->has_cmd_cnts[i]) {
+            /* Get the read/write command counts (for IOPS) */
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/read_cmd_count",
+                    sess_path);
+            if (readAttrCached(attr_path, attr_val) != 0) {
+                counters_ok = FALSE;
+                break;
+            }
+            sess->read_cmds[i] = strtoull(attr_val, NULL, 10);
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/write_cmd_count",
+                    sess_path);
+            if (readAttrCached(attr_path, attr_val) != 0) {
+                counters_ok = FALSE;
+                break;
+            }
+            sess->write_cmds[i] = strtoull(attr_val, NULL, 10);
+        }
+        rate = sess->rate[i];
+        updateSessRate(rate, &sample_time, sess->read_io_kb[i],
+                sess->write_io_kb[i],
+                (sess->read_cmds[i] + sess->write_cmds[i]));
+        /* The rates go with the session (snapshot) for display */
+        sess->have_rate[i] = (rate != -1);
+        if (sess->have_rate[i]) {
+            sess->read_kbps[i] = g_sess_rates[rate].read_kbps;
+            sess->write_kbps[i] = g_sess_rates[rate].write_kbps;
+            sess->iops[i] = g_sess_rates[rate].iops;
+            sess->peak_kbps[i] = peakSessRate(rate);
+        }
+    }
+    if (sessions_fd != -1)
+        close(sessions_fd);
+    if (targets_fd != -1)
+        close(targets_fd);
+
+    /* Done */
+    return counters_ok;
+}
+
+
+/**
+ * @brief Find the block device backing a SCST device: for the vdisk handlers
+ * it's the "filename" (the block device itself, or the one holding the file
+ * system the file lives on), and for the pass-through handlers it's the SCSI
+ * disk (the device name is the H:C:T:L). The device number is returned (zero
+ * if there isn't one, eg, nullio) and the name is filled in; device-mapper
+ * devices use their DM name.
+ */
+dev_t findBackingDev(int hndlr_fd, char hndlr_name[], char dev_name[],
+        char backing_name[]) {
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    struct stat file_stat = {0};
+    char attr_path[MAX_SYSFS_PATH_SIZE] = {0},
+            attr_val[MAX_SYSFS_ATTR_SIZE] = {0},
+            link_path[MAX_SYSFS_PATH_SIZE] = {0};
+    unsigned int dev_major = 0, dev_minor = 0;
+    ssize_t link_size = 0;
+    dev_t backing = 0;
+
+    backing_name[0] = '\0';
+    snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/filename", dev_name);
+    if (readAttributeAt(hndlr_fd, attr_path, attr_val) == 0) {
+        if ((attr_val[0] == '\0') || (stat(attr_val, &file_stat) == -1))
+            return 0;
+        backing = S_ISBLK(file_stat.st_mode) ? file_stat.st_rdev :
+                file_stat.st_dev;
+    } else if (strncmp(hndlr_name, "dev_disk", 8) == 0) {
+        snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%s/device/block",
+                SYSFS_SCSI_DEVICE, dev_name);
+        if ((dir_stream = openDirStreamAt(AT_FDCWD, attr_path)) == NULL)
+            return 0;
+        while ((dir_entry = readdir(dir_stream)) != NULL) {
+            if (dir_entry->d_name[0] == '.')
+                continue;
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/dev",
+                    dir_entry->d_name);
+            if ((readAttributeAt(dirfd(dir_stream), attr_path,
+                    attr_val) == 0) && (sscanf(attr_val, "%u:%u",
+                    &dev_major, &dev_minor) == 2))
+                backing = makedev(dev_major, dev_minor);
+            break;
+        }
+        closedir(dir_stream);
+    }
+    if (backing == 0)
+        return 0;
+
+    /* The block layer has to know it (eg, not a btrfs anonymous device) */
+    snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%u:%u", SYSFS_DEV_BLOCK,
+            major(backing), minor(backing));
+    if ((link_size = readlink(attr_path, link_path,
+            (MAX_SYSFS_PATH_SIZE - 1))) == -1)
+        return 0;
+    link_path[link_size] = '\0';
+    snprintf(backing_name, MISC_STRING_LEN, "%s", (strrchr(link_path, '/') ?
+            (strrchr(link_path, '/') + 1) : link_path));
+    snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%u:%u/dm/name",
+            SYSFS_DEV_BLOCK, major(backing), minor(backing));
+    if ((readAttributeAt(AT_FDCWD, attr_path, attr_val) == 0) &&
+            (attr_val[0] != '\0'))
+        snprintf(backing_name, MISC_STRING_LEN, "%s", attr_val);
+    return backing;
+}
+
+
+/**
+ * @brief Walk the SCST handler directories and rebuild the cached device
+ * table, matching each device with its backing block device. The devices
+ * have their own string pool, so this is independent of the targets and
+ * sessions. Return FALSE if we couldn't allocate memory (and set the error
+ * message), otherwise TRUE; a handler that isn't loaded is simply skipped.
+ */
+boolean rebuildSCSTDevices(scst_topo_t *topo) {
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    scst_dev_tbl_t *devs = &topo->devs;
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0},
+            backing_name[MISC_STRING_LEN] = {0};
+    int i = 0, row = 0, handlers_fd = -1;
+
+    devs->cnt = 0;
+    topo->devs_stale = TRUE;
+    if (!resetStrPool(&topo->dev_strings)) {
+        snprintf(topo->error_msg, MISC_STRING_LEN, "%s", TOPO_MEM_ERR);
+        return FALSE;
+    }
+
+    /* SCST keeps every device in the "devices" directory (the handler
+     * directories only have links to them, which don't change nlink) */
+    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/devices", SYSFS_SCST_TGT);
+    topo->devices_sig.valid = FALSE;
+    dirSigChanged(dir_name, &topo->devices_sig);
+
+    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers", SYSFS_SCST_TGT);
+    if ((handlers_fd = openDirAt(AT_FDCWD, dir_name)) == -1)
+        return TRUE;
+    for (i = 0; i < (int) g_scst_handlers_size(); i++) {
+        if ((dir_stream = openDirStreamAt(handlers_fd,
+                g_scst_handlers[i])) == NULL)
+            continue;
+        while ((dir_entry = readdir(dir_stream)) != NULL) {
+            /* The devices are links */
+            if (dir_entry->d_type != DT_LNK)
+                continue;
+            if (!growDevTable(devs, (devs->cnt + 1))) {
+                closedir(dir_stream);
+                close(handlers_fd);
+                snprintf(topo->error_msg, MISC_STRING_LEN, "%s",
+                        TOPO_MEM_ERR);
+                return FALSE;
+            }
+            row = devs->cnt;
+            devs->backing_dev[row] = findBackingDev(dirfd(dir_stream),
+                    g_scst_handlers[i], dir_entry->d_name, backing_name);
+            devs->handler[row] = internStr(&topo->dev_strings,
+                    g_scst_handlers[i]);
+            devs->name[row] = internStr(&topo->dev_strings,
+                    dir_entry->d_name);
+            devs->backing[row] = internStr(&topo->dev_strings, backing_name);
+            if ((devs->handler[row] == -1) || (devs->name[row] == -1) ||
+                    (devs->backing[row] == -1)) {
+                closedir(dir_stream);
+                close(handlers_fd);
+                snprintf(topo->error_msg, MISC_STRING_LEN, "%s",
+                        TOPO_MEM_ERR);
+                return FALSE;
+            }
+            devs->have_stat[row] = FALSE;
+            devs->have_rate[row] = FALSE;
+            devs->read_iops[row] = 0;
+            devs->write_iops[row] = 0;
+            devs->read_mbps[row] = 0;
+            devs->write_mbps[row] = 0;
+            devs->svc_msec[row] = 0;
+            devs->in_flight[row] = 0;
+            devs->cnt++;
+        }
+        closedir(dir_stream);
+    }
+    close(handlers_fd);
+
+    /* Done */
+    topo->devs_stale = FALSE;
+    return TRUE;
+}
+
+
+/**
+ * @brief Read the block device statistics for each SCST device and compute
+ * the rates since the last sample: read/write IOPS and MB/s, the average
+ * service time (milliseconds the device was busy per completed I/O) and the
+ * I/Os in flight. If a backing device went away, the devices are re-walked
+ * on the next update.
+ */
+void readSCSTDevStats(scst_topo_t *topo) {
+    scst_dev_tbl_t *devs = &topo->devs;
+    struct timespec sample_time = {0};
+    blk_stat_t curr = {0}, *last = NULL;
+    char attr_path[MAX_SYSFS_PATH_SIZE] = {0},
+            attr_val[MAX_SYSFS_ATTR_SIZE] = {0};
+    double elapsed = 0, io_cnt = 0;
+    int i = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &sample_time);
+    for (i = 0; i < devs->cnt; i++) {
+        if (devs->backing_dev[i] == 0)
+            continue;
+        snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/%u:%u/stat",
+                SYSFS_DEV_BLOCK, major(devs->backing_dev[i]),
+                minor(devs->backing_dev[i]));
+        if ((readAttrCached(attr_path, attr_val) != 0) ||
+                (sscanf(attr_val, "%llu %*u %llu %llu %llu %*u %llu %llu "
+                "%llu %llu", &curr.read_ios, &curr.read_sectors,
+                &curr.read_ticks, &curr.write_ios, &curr.write_sectors,
+                &curr.write_ticks, &curr.in_flight, &curr.io_ticks) != 8)) {
+            devs->have_stat[i] = FALSE;
+            devs->have_rate[i] = FALSE;
+            topo->devs_stale = TRUE;
+            continue;
+        }
+        devs->in_flight[i] = curr.in_flight;
+
+        /* The counters only go down if the device was re-created */
+        last = &devs->last_stat[i];
+        elapsed = (sample_time.tv_sec - devs->stat_time[i].tv_sec) +
+                ((sample_time.tv_nsec - devs->stat_time[i].tv_nsec) / 1e9);
+        if (devs->have_stat[i] && (elapsed > 0) &&
+                (curr.read_ios >= last->read_ios) &&
+                (curr.write_ios >= last->write_ios)) {
+            io_cnt = (curr.read_ios - last->read_ios) +
+                    (curr.write_ios - last->write_ios);
+            devs->read_iops[i] = (curr.read_ios - last->read_ios) / elapsed;
+            devs->write_iops[i] = (curr.write_ios - last->write_ios) /
+                    elapsed;
+            devs->read_mbps[i] = ((curr.read_sectors - last->read_sectors) *
+                    512.0) / 1000000.0 / elapsed;
+            devs->write_mbps[i] = ((curr.write_sectors -
+                    last->write_sectors) * 512.0) / 1000000.0 / elapsed;
+            /* The read/write ticks include the time spent queued (that's
+             * await), so use the time the device was busy instead */
+            devs->svc_msec[i] = ((io_cnt > 0) &&
+                    (curr.io_ticks >= last->io_ticks)) ? ((curr.io_ticks -
+                    last->io_ticks) / io_cnt) : 0;
+            devs->have_rate[i] = TRUE;
+        } else {
+            devs->have_rate[i] = FALSE;
+        }
+        *last = curr;
+        devs->stat_time[i] = sample_time;
+        devs->have_stat[i] = TRUE;
+    }
+}
+
+
+/**
+ * @brief Bring the cached SCST topology up to date. The sysfs structure is
+ * only walked again if a directory signature changed (or a volatile attribute
+ * disappeared); otherwise only the volatile counters (and the block device
+ * statistics for the SCST devices) are read. Return FALSE if an error occurs
+ * (the error message is set in the topology), otherwise TRUE.
+ */
+boolean updateSCSTTopology(scst_topo_t *topo) {
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0};
+    boolean devs_ok = TRUE;
+
+    topo->error_msg[0] = '\0';
+
+    /* Nothing else to do if SCST isn't loaded */
+    if (!isSCSTLoaded()) {
+        topo->scst_loaded = FALSE;
+        topo->stale = TRUE;
+        topo->driver_cnt = 0;
+        topo->tgts.cnt = 0;
+        topo->sess.cnt = 0;
+        topo->adapter_cnt = 0;
+        topo->devs_stale = TRUE;
+        topo->devs.cnt = 0;
+        return TRUE;
+    }
+    topo->scst_loaded = TRUE;
+
+    /* The devices are kept separately (a device problem doesn't hide the
+     * targets and sessions); if they can't all be read, the table keeps
+     * the ones that were and is stale (so it's tried again next time) */
+    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/devices", SYSFS_SCST_TGT);
+    if (dirSigChanged(dir_name, &topo->devices_sig) || topo->devs_stale)
+        devs_ok = rebuildSCSTDevices(topo);
+    readSCSTDevStats(topo);
+
+    /* Re-walk the structure only if something changed */
+    if (topologyChanged(topo) || topo->stale) {
+        if (!rebuildSCSTTopology(topo))
+            return FALSE;
+    }
+
+    /* Read the counters; if something went away, rebuild and try again */
+    if (!readSCSTCounters(topo)) {
+        if (!rebuildSCSTTopology(topo))
+            return FALSE;
+        if (!readSCSTCounters(topo)) {
+            topo->stale = TRUE;
+            snprintf(topo->error_msg, MISC_STRING_LEN,
+                    "The SCST sysfs structure changed; retrying...");
+            return FALSE;
+        }
+    }
+
+    /* Done; a device table error is still reported */
+    return devs_ok;
+}
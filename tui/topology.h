@@ -0,0 +1,191 @@
+/**
+ * @file topology.h
+ * @brief Data structures for the cached SCST target/session topology.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _TOPOLOGY_H
+#define	_TOPOLOGY_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <time.h>
+#include <sys/types.h>
+
+#include "system.h"
+
+/* Link adapter types (used to match SCST targets to HBAs/HCAs) */
+typedef enum {
+    FC_ADAPTER, IB_ADAPTER
+} adapter_t;
+
+/* A cheap "did this directory change" signature; sysfs (kernfs) keeps the
+ * directory link count in sync with the number of sub-directories */
+typedef struct {
+    boolean valid;
+    ino_t ino;
+    nlink_t nlink;
+    struct timespec mtime;
+} dir_sig_t;
+
+/* A FC / FCoE adapter or IB HCA */
+typedef struct {
+    adapter_t type;
+    char host[MISC_STRING_LEN];
+    char port_name[MAX_SYSFS_ATTR_SIZE];
+    char speed[MAX_SYSFS_ATTR_SIZE];
+} scst_adapter_t;
+
+/* Interned strings (target, driver, session and initiator names); a string
+ * is referenced by its offset in the pool so the pool can grow (realloc)
+ * without invalidating anything, offset 0 is always the empty string */
+typedef struct {
+    char *data;
+    int used;
+    int size;
+    int *index;
+    int index_size;
+    int str_cnt;
+} str_pool_t;
+
+/* The SCST targets (struct-of-arrays, one column per value; the columns
+ * grow as needed and are reused across refreshes) */
+typedef struct {
+    int cnt;
+    int alloc;
+    int *driver;
+    int *name;
+    int *adapter;
+    dir_sig_t *sess_sig;
+    boolean *enabled;
+} scst_tgt_tbl_t;
+
+/* The SCST sessions (struct-of-arrays, same as the targets) */
+typedef struct {
+    int cnt;
+    int alloc;
+    int *target;
+    int *rate;
+    int *name;
+    int *initiator;
+    dir_sig_t *luns_sig;
+    boolean *has_cmd_cnts;
+    int *lun_cnt;
+    int *active_cmds;
+    unsigned long long *read_io_kb;
+    unsigned long long *write_io_kb;
+    unsigned long long *read_cmds;
+    unsigned long long *write_cmds;
+    boolean *have_rate;
+    double *read_kbps;
+    double *write_kbps;
+    double *iops;
+    double *peak_kbps;
+} scst_sess_tbl_t;
+
+/* Block device I/O statistics (the /sys/dev/block/<maj:min>/stat fields we
+ * use; the sectors are always 512 bytes and the ticks are in milliseconds) */
+typedef struct {
+    unsigned long long read_ios;
+    unsigned long long read_sectors;
+    unsigned long long read_ticks;
+    unsigned long long write_ios;
+    unsigned long long write_sectors;
+    unsigned long long write_ticks;
+    unsigned long long in_flight;
+    unsigned long long io_ticks;
+} blk_stat_t;
+
+/* The SCST devices (struct-of-arrays, same as the targets); each device is
+ * matched with the block device backing it, and the rates come from that
+ * block device's statistics (backing_dev is zero if there isn't one) */
+typedef struct {
+    int cnt;
+    int alloc;
+    int *handler;
+    int *name;
+    int *backing;
+    dev_t *backing_dev;
+    boolean *have_stat;
+    blk_stat_t *last_stat;
+    struct timespec *stat_time;
+    boolean *have_rate;
+    double *read_iops;
+    double *write_iops;
+    double *read_mbps;
+    double *write_mbps;
+    double *svc_msec;
+    unsigned long long *in_flight;
+} scst_dev_tbl_t;
+
+/* Session sort keys (main screen); these match g_sess_sort_keys[] */
+typedef enum {
+    SORT_READ_RATE, SORT_WRITE_RATE, SORT_ACTIVE_CMDS, SORT_LUN_CNT,
+    SORT_INITIATOR, MAX_SESS_SORT_KEYS
+} sess_sort_t;
+
+/* Batch (headless) mode output formats */
+typedef enum {
+    BATCH_JSON, BATCH_CSV
+} batch_fmt_t;
+
+/* Session rate (throughput/IOPS) state, kept in a table keyed by
+ * "driver/target/session" so it survives topology rebuilds */
+#define RATE_SLOT_EMPTY     -1
+#define RATE_SLOT_DELETED   -2
+typedef struct {
+    boolean used;
+    int next_free;
+    char *key;
+    unsigned long generation;
+    boolean have_sample;
+    struct timespec sample_time;
+    unsigned long long read_kb;
+    unsigned long long write_kb;
+    unsigned long long cmds;
+    double read_kbps;
+    double write_kbps;
+    double iops;
+    int hist_pos;
+    int hist_cnt;
+    double hist_kbps[SESS_RATE_HIST_LEN];
+} sess_rate_t;
+extern sess_rate_t *g_sess_rates;
+
+/* The whole (cached) topology; the structure is only re-walked when one
+ * of the directory signatures changes, the volatile counters are read on
+ * every update; the collector thread publishes copies (snapshots) of it. The
+ * SCST devices have their own string pool and directory signature, so they
+ * are only re-walked when a device is added or removed */
+typedef struct {
+    boolean collected;
+    struct timespec published;
+    boolean scst_loaded;
+    boolean stale;
+    unsigned long generation;
+    char error_msg[MISC_STRING_LEN];
+    dir_sig_t drivers_sig;
+    int driver_cnt;
+    char drivers[MAX_SCST_DRIVERS][MISC_STRING_LEN];
+    dir_sig_t driver_sig[MAX_SCST_DRIVERS];
+    dir_sig_t fc_sig;
+    dir_sig_t ib_sig;
+    int adapter_cnt;
+    scst_adapter_t adapters[MAX_FC_ADAPTERS + MAX_IB_ADAPTERS];
+    str_pool_t strings;
+    scst_tgt_tbl_t tgts;
+    scst_sess_tbl_t sess;
+    boolean devs_stale;
+    dir_sig_t devices_sig;
+    str_pool_t dev_strings;
+    scst_dev_tbl_t devs;
+} scst_topo_t;
+extern scst_topo_t g_scst_topo;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _TOPOLOGY_H */
@@ -16,9 +16,20 @@
 #include <blkid/blkid.h>
 #include <assert.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 
 #include "prototypes.h"
 #include "system.h"
+#include "strings.h"
+
+
+/* The libblkid cache is kept for the life of the program (so the devices
+ * aren't all probed again each time we look for a label or UUID) */
+blkid_cache g_blkid_cache = NULL;
+boolean g_blkid_cache_tried = FALSE;
 
 
 /**
@@ -42,31 +53,115 @@ char *strStrip(char *string) {
 
 
 /**
- * @brief Reads a sysfs attribute value. Open the specified file and read its
- * contents. If an error occurs, fill the character array with the error.
+ * @brief Reads a sysfs attribute value; only the first line is returned. This
+ * is for one-off reads (the descriptor isn't kept open), the collector reads
+ * its per-tick counters with readAttrCached() instead. If an error occurs,
+ * fill the character array with the error and return the errno value,
+ * otherwise we return 0 (zero).
  */
-void readAttribute(char sysfs_attr[], char attr_value[]) {
-     FILE *sysfs_file = NULL;
-     char *remove_me = NULL;
+int readAttribute(char sysfs_attr[], char attr_value[]) {
+    return readAttributeAt(AT_FDCWD, sysfs_attr, attr_value);
+}
 
-     /* Open the file and retrieve the value */
-     if ((sysfs_file = fopen(sysfs_attr, "r")) == NULL) {
-         snprintf(attr_value, MAX_SYSFS_ATTR_SIZE,
-                 "fopen(): %s", strerror(errno));
-         return;
-     } else {
-         fgets(attr_value, MAX_SYSFS_ATTR_SIZE, sysfs_file);
-         fclose(sysfs_file);
-     }
 
-     /* Get rid of the newline character */
-     remove_me = strrchr(attr_value, '\n');
-     if (remove_me) {
-         *remove_me = '\0';
-     }
+/**
+ * @brief Open a sysfs directory relative to an already open directory (or
+ * AT_FDCWD for a full path) so walking the tree doesn't make the kernel look
+ * up the whole path again for every level. Return the new descriptor, or -1
+ * (and errno is set) if an error occurs.
+ */
+int openDirAt(int dir_fd, const char *dir_name) {
+    return openat(dir_fd, dir_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
 
-     /* Done */
-     return;
+/**
+ * @brief Open a directory stream relative to an already open directory (or
+ * AT_FDCWD); use dirfd() on the stream to open/read its entries. Return NULL
+ * (and errno is set) if an error occurs.
+ */
+DIR *openDirStreamAt(int dir_fd, const char *dir_name) {
+    DIR *dir_stream = NULL;
+    int new_fd = 0, saved_errno = 0;
+
+    if ((new_fd = openDirAt(dir_fd, dir_name)) == -1)
+        return NULL;
+    if ((dir_stream = fdopendir(new_fd)) == NULL) {
+        saved_errno = errno;
+        close(new_fd);
+        errno = saved_errno;
+    }
+    return dir_stream;
+}
+
+
+/**
+ * @brief Read a sysfs attribute value relative to an already open directory;
+ * only the first line is returned. This is for one-off reads (the descriptor
+ * isn't kept open). If an error occurs, fill the character array with the
+ * error and return the errno value, otherwise we return 0 (zero).
+ */
+int readAttributeAt(int dir_fd, const char *attr_name, char attr_value[]) {
+    int attr_fd = 0, ret_val = 0;
+    ssize_t read_size = 0;
+    char *remove_me = NULL;
+
+    if ((attr_fd = openat(dir_fd, attr_name, O_RDONLY | O_CLOEXEC)) == -1) {
+        ret_val = errno;
+        snprintf(attr_value, MAX_SYSFS_ATTR_SIZE,
+                "openat(): %s", strerror(ret_val));
+        return ret_val;
+    }
+    if ((read_size = read(attr_fd, attr_value,
+            (MAX_SYSFS_ATTR_SIZE - 1))) == -1) {
+        ret_val = errno;
+        close(attr_fd);
+        snprintf(attr_value, MAX_SYSFS_ATTR_SIZE,
+                "read(): %s", strerror(ret_val));
+        return ret_val;
+    }
+    close(attr_fd);
+    attr_value[read_size] = '\0';
+
+    /* Only the first line (same as readAttribute) */
+    remove_me = strchr(attr_value, '\n');
+    if (remove_me) {
+        *remove_me = '\0';
+    }
+
+    /* Done */
+    return 0;
+}
+
+
+/**
+ * @brief Count the entries of the given type (DT_DIR, DT_REG, etc.) in a
+ * directory relative to an already open directory (or AT_FDCWD); '.' and
+ * '..' are never counted. If a name is given, only entries with that name
+ * are counted. Return -1 if an error occurs.
+ */
+int countDirEntriesAt(int dir_fd, const char *dir_name,
+        unsigned char entry_type, const char *entry_name) {
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    int entry_cnt = 0;
+
+    if ((dir_stream = openDirStreamAt(dir_fd, dir_name)) == NULL) {
+        DEBUG_LOG("openDirStreamAt(): %s", strerror(errno));
+        return -1;
+    }
+    while ((dir_entry = readdir(dir_stream)) != NULL) {
+        if ((dir_entry->d_type != entry_type) ||
+                (strcmp(dir_entry->d_name, ".") == 0) ||
+                (strcmp(dir_entry->d_name, "..") == 0))
+            continue;
+        if ((entry_name != NULL) && (strcmp(dir_entry->d_name,
+                entry_name) != 0))
+            continue;
+        entry_cnt++;
+    }
+    closedir(dir_stream);
+    return entry_cnt;
 }
 
 
@@ -92,6 +187,32 @@ int writeAttribute(char sysfs_attr[], char attr_value[]) {
 }
 
 
+/**
+ * @brief Move all of the sysfs/procfs paths under another root directory
+ * (eg, a synthetic tree for testing). This is done once, before any other
+ * thread is started; the old paths aren't freed. Return FALSE if we
+ * couldn't allocate the memory.
+ */
+boolean setSysRoot(const char *root_dir) {
+    char *new_path = NULL;
+    int i = 0, root_len = 0;
+
+    /* We don't want a doubled slash */
+    root_len = strlen(root_dir);
+    while ((root_len > 0) && (root_dir[root_len - 1] == '/'))
+        root_len--;
+    for (i = 0; i < SYS_PATH_CNT; i++) {
+        if (asprintf(&new_path, "%.*s%s", root_len, root_dir,
+                g_sys_paths[i]) == -1) {
+            DEBUG_LOG("asprintf(): %s", strerror(errno));
+            return FALSE;
+        }
+        g_sys_paths[i] = new_path;
+    }
+    return TRUE;
+}
+
+
 /**
  * @brief Test if SCST is loaded on the current machine. For now we have a very
  * simple test using the SCST sysfs directory; return TRUE (1) if the
@@ -113,53 +234,39 @@ boolean isSCSTLoaded() {
  */
 boolean isSCSTInitInGroup(char tgt_name[], char tgt_driver[],
         char group_name[], char init_name[]) {
-    DIR *dir_stream = NULL;
-    struct dirent *dir_entry = NULL;
     char dir_name[MAX_SYSFS_PATH_SIZE] = {0};
-    boolean found_init = FALSE;
 
-    /* Open the group initiator directory */
+    /* The initiators are files in the group initiator directory */
     snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
             "%s/targets/%s/%s/ini_groups/%s/initiators",
             SYSFS_SCST_TGT, tgt_driver, tgt_name, group_name);
-    if ((dir_stream = opendir(dir_name)) == NULL) {
-        DEBUG_LOG("opendir(): %s", strerror(errno));
+    if (countDirEntriesAt(AT_FDCWD, dir_name, DT_REG, init_name) > 0)
+        return TRUE;
+    else
         return FALSE;
-    }
-
-    /* Loop over each entry in the directory */
-    while ((dir_entry = readdir(dir_stream)) != NULL) {
-        /* The initiators are files */
-        if ((dir_entry->d_type == DT_REG) &&
-                (strcmp(dir_entry->d_name, init_name) == 0)) {
-            found_init = TRUE;
-            break;
-        }
-    }
-
-    /* Done */
-    closedir(dir_stream);
-    return found_init;
 }
 
 
 /**
  * @brief Walk the group directories in sysfs for the specified target and count
- * the number of times the initiator is used. Return -1 if an error occurs.
+ * the number of times the initiator is used; each group's initiators are
+ * read relative to the open "ini_groups" directory. Return -1 if an error
+ * occurs.
  */
 int countSCSTInitUses(char tgt_name[], char tgt_driver[], char init_name[]) {
-    DIR *grp_dir_stream = NULL, *init_dir_stream = NULL;
-    struct dirent *grp_dir_entry = NULL, *init_dir_entry = NULL;
+    DIR *grp_dir_stream = NULL;
+    struct dirent *grp_dir_entry = NULL;
     char groups_dir_name[MAX_SYSFS_PATH_SIZE] = {0},
             inits_dir_name[MAX_SYSFS_PATH_SIZE] = {0};
-    int use_count = 0;
+    int use_count = 0, grp_uses = 0;
 
     /* Open the target group's directory (to get a list) */
     snprintf(groups_dir_name, MAX_SYSFS_PATH_SIZE,
             "%s/targets/%s/%s/ini_groups",
             SYSFS_SCST_TGT, tgt_driver, tgt_name);
-    if ((grp_dir_stream = opendir(groups_dir_name)) == NULL) {
-        DEBUG_LOG("opendir(): %s", strerror(errno));
+    if ((grp_dir_stream = openDirStreamAt(AT_FDCWD,
+            groups_dir_name)) == NULL) {
+        DEBUG_LOG("openDirStreamAt(): %s", strerror(errno));
         return -1;
     }
 
@@ -170,25 +277,14 @@ int countSCSTInitUses(char tgt_name[], char tgt_driver[], char init_name[]) {
                 (strcmp(grp_dir_entry->d_name, ".") != 0) &&
                 (strcmp(grp_dir_entry->d_name, "..") != 0)) {
             /* Now for each group, read through their initiators */
-            snprintf(inits_dir_name, MAX_SYSFS_PATH_SIZE,
-                    "%s/targets/%s/%s/ini_groups/%s/initiators",
-                    SYSFS_SCST_TGT, tgt_driver, tgt_name,
+            snprintf(inits_dir_name, MAX_SYSFS_PATH_SIZE, "%s/initiators",
                     grp_dir_entry->d_name);
-            if ((init_dir_stream = opendir(inits_dir_name)) == NULL) {
-                DEBUG_LOG("opendir(): %s", strerror(errno));
+            if ((grp_uses = countDirEntriesAt(dirfd(grp_dir_stream),
+                    inits_dir_name, DT_REG, init_name)) == -1) {
                 closedir(grp_dir_stream);
                 return -1;
             }
-            /* Loop over each entry in the directory */
-            while ((init_dir_entry = readdir(init_dir_stream)) != NULL) {
-                /* The initiators are files */
-                if ((init_dir_entry->d_type == DT_REG) &&
-                        (strcmp(init_dir_entry->d_name, init_name) == 0)) {
-                    use_count++;
-                }
-            }
-            closedir(init_dir_stream);
-
+            use_count += grp_uses;
         }
     }
 
@@ -246,62 +342,99 @@ boolean listSCSTTgtDrivers(char tgt_drivers[][MISC_STRING_LEN],
  * and initiator combination. Return -1 if an error occurs.
  */
 int countSCSTSessLUNs(char tgt_name[], char tgt_driver[], char init_name[]) {
-    DIR *dir_stream = NULL;
-    struct dirent *dir_entry = NULL;
     char dir_name[MAX_SYSFS_PATH_SIZE] = {0};
-    int lun_count = 0;
 
-    /* Open the session's "luns" directory (to get a count) */
+    /* The LUNs are directories in the session's "luns" directory */
     snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
             "%s/targets/%s/%s/sessions/%s/luns",
             SYSFS_SCST_TGT, tgt_driver, tgt_name, init_name);
-    if ((dir_stream = opendir(dir_name)) == NULL) {
-        DEBUG_LOG("opendir(): %s", strerror(errno));
-        return -1;
-    }
+    return countDirEntriesAt(AT_FDCWD, dir_name, DT_DIR, NULL);
+}
 
-    /* Loop over each entry in the directory */
-    while ((dir_entry = readdir(dir_stream)) != NULL) {
-        /* The LUNs are directories; skip '.' and '..' */
-        if ((dir_entry->d_type == DT_DIR) &&
-                    (strcmp(dir_entry->d_name, ".") != 0) &&
-                    (strcmp(dir_entry->d_name, "..") != 0)) {
-            lun_count++;
+
+/**
+ * @brief Find the lowest LUN numbers that are free in every one of the given
+ * "luns" directories, so a device gets the same LUN in all of them. Fill the
+ * array with up to 'lun_cnt' (ascending) LUN numbers and return how many were
+ * found; return -1 if one of the directories couldn't be read.
+ */
+int findFreeLUNs(char luns_dirs[][MAX_SYSFS_PATH_SIZE], int dir_cnt,
+        int lun_cnt, int luns[]) {
+    boolean lun_used[MAX_SCST_LUN_VAL + 1] = {FALSE};
+    DIR *dir_stream = NULL;
+    struct dirent *dir_entry = NULL;
+    char *end_ptr = NULL;
+    long lun = 0;
+    int i = 0, found = 0;
+
+    /* The LUNs are directories (named by number) */
+    for (i = 0; i < dir_cnt; i++) {
+        if ((dir_stream = openDirStreamAt(AT_FDCWD, luns_dirs[i])) == NULL) {
+            DEBUG_LOG("opendir(): %s", strerror(errno));
+            return -1;
+        }
+        while ((dir_entry = readdir(dir_stream)) != NULL) {
+            if (dir_entry->d_type != DT_DIR)
+                continue;
+            lun = strtol(dir_entry->d_name, &end_ptr, 10);
+            if ((end_ptr == dir_entry->d_name) || (*end_ptr != '\0'))
+                continue;
+            if ((lun >= MIN_SCST_LUN_VAL) && (lun <= MAX_SCST_LUN_VAL))
+                lun_used[lun] = TRUE;
         }
+        closedir(dir_stream);
     }
 
-    /* Done */
-    closedir(dir_stream);
-    return lun_count;
+    /* Take the lowest free ones */
+    for (i = MIN_SCST_LUN_VAL; (i <= MAX_SCST_LUN_VAL) && (found < lun_cnt);
+            i++) {
+        if (!lun_used[i])
+            luns[found++] = i;
+    }
+    return found;
 }
 
 
 /**
  * @brief This function takes a number of bytes and formats/converts the value
  * for a "human-readable" representation of the number (eg, 2048 returns
- * "2 KiB").
- * Originally taken from here: http://stackoverflow.com/questions/3898840
+ * "2 KiB"). The result is allocated here; the caller needs to free it.
  */
 char *prettyFormatBytes(uint64_t size) {
+    char *result = (char *) malloc(sizeof (char) * 20);
+
+    if (result == NULL)
+        return NULL;
+    return prettyFormatBytesBuf(size, result, 20);
+}
+
+
+/**
+ * @brief Same as prettyFormatBytes(), but the result is written to the given
+ * buffer (which is returned); 20 characters is always enough.
+ * Originally taken from here: http://stackoverflow.com/questions/3898840
+ */
+char *prettyFormatBytesBuf(uint64_t size, char buffer[], size_t buffer_size) {
     static const char *sizes[] = {"EiB", "PiB", "TiB",
     "GiB", "MiB", "KiB", "B"};
     uint64_t multiplier = (1024ULL * 1024ULL * 1024ULL *
     1024ULL * 1024ULL * 1024ULL);
     int i = 0;
-    char *result = (char *) malloc(sizeof (char) * 20);
 
     for (i = 0; i < (int)(sizeof (sizes) / sizeof (*(sizes)));
             i++, multiplier /= 1024) {
         if (size < multiplier)
             continue;
         if ((size % multiplier) == 0)
-            sprintf(result, "%" PRIu64 " %s", size / multiplier, sizes[i]);
+            snprintf(buffer, buffer_size, "%" PRIu64 " %s",
+                    size / multiplier, sizes[i]);
         else
-            sprintf(result, "%.1f %s", (float) size / multiplier, sizes[i]);
-        return result;
+            snprintf(buffer, buffer_size, "%.1f %s",
+                    (float) size / multiplier, sizes[i]);
+        return buffer;
     }
-    strcpy(result, "0");
-    return result;
+    snprintf(buffer, buffer_size, "0");
+    return buffer;
 }
 
 
@@ -373,282 +506,634 @@ boolean checkInetAccess() {
  * argument and a string argument; if the length of the given string is less
  * than the maximum, return the string as is. If the string is longer, then
  * remove enough of the string from the center to accommodate the maximum size
- * and include several periods to show the string was abbreviated.
+ * and include several periods to show the string was abbreviated. The result
+ * is a static buffer (re-used by the next call); use prettyShrinkStrBuf() if
+ * more than one is needed at a time.
  */
 char *prettyShrinkStr(size_t max_len, char *string) {
-    size_t curr_size = 0, char_to_del = 0, left_len = 0, right_len = 0;
-    char *right_half = NULL, *curr_pos = NULL;
-    char str_buff[MISC_STRING_LEN] = {0};
     static char ret_buff[MAX_SYSFS_ATTR_SIZE] = {0};
-    int i = 0;
 
-    /* Since ret_buff is re-used between calls, we reset the first character */
-    ret_buff[0] = '\0';
+    return prettyShrinkStrBuf(max_len, string, ret_buff, MAX_SYSFS_ATTR_SIZE);
+}
+
+
+/**
+ * @brief Same as prettyShrinkStr(), but the result is written to the given
+ * buffer (which is returned), so it is safe to use more than once in the
+ * same expression (or from another thread).
+ */
+char *prettyShrinkStrBuf(size_t max_len, const char *string, char buffer[],
+        size_t buffer_size) {
+    size_t curr_size = 0, char_to_del = 0, left_len = 0;
 
     /* Maybe it is already an acceptable length */
     curr_size = strlen(string);
     if (curr_size <= max_len) {
-        strncpy(ret_buff, string, MAX_SYSFS_ATTR_SIZE);
-        return ret_buff;
+        snprintf(buffer, buffer_size, "%s", string);
+        return buffer;
+    } else if (max_len < 3) {
+        /* No room for the periods */
+        snprintf(buffer, buffer_size, "%.*s", (int) max_len, string);
+        return buffer;
+    }
+
+    /* Guess not, so lets shrink it; keep the left and right ends */
+    char_to_del = curr_size - max_len + 3;
+    left_len = (curr_size - char_to_del) / 2;
+    snprintf(buffer, buffer_size, "%.*s...%s", (int) left_len, string,
+            (string + left_len + char_to_del));
+    return buffer;
+}
+
+
+/**
+ * @brief Return the libblkid cache, reading it the first time we're called.
+ * If we couldn't get the cache NULL is returned, which the blkid functions
+ * accept (they'll just probe the devices every time).
+ */
+blkid_cache getBlkidCache() {
+    struct timespec prof_start = {0};
+
+    if (!g_blkid_cache_tried) {
+        g_blkid_cache_tried = TRUE;
+        startProfile(&prof_start);
+        if (blkid_get_cache(&g_blkid_cache, NULL) != 0) {
+            DEBUG_LOG("blkid_get_cache() failed");
+            g_blkid_cache = NULL;
+        }
+        endProfile("blkid cache load", &prof_start);
+    }
+    return g_blkid_cache;
+}
+
+
+/**
+ * @brief Resolve a sysfs block device link (eg, /sys/dev/block/8:1, or an
+ * entry in a "slaves" directory) to the name of its whole disk; for a
+ * partition (.../block/sda/sda1) that is the parent (sda). Return FALSE if
+ * the link couldn't be read or isn't a block device.
+ */
+boolean getBlockDiskName(int dir_fd, const char *link_name, char disk_name[]) {
+    char link_path[MAX_SYSFS_PATH_SIZE] = {0};
+    char *block_dir = NULL, *curr_pos = NULL;
+    ssize_t link_size = 0;
+
+    if ((link_size = readlinkat(dir_fd, link_name, link_path,
+            (MAX_SYSFS_PATH_SIZE - 1))) == -1)
+        return FALSE;
+    link_path[link_size] = '\0';
+
+    /* The disk is the component following the last "/block/" */
+    curr_pos = link_path;
+    while ((curr_pos = strstr(curr_pos, "/block/")) != NULL) {
+        block_dir = curr_pos;
+        curr_pos++;
+    }
+    if (block_dir == NULL)
+        return FALSE;
+    block_dir += strlen("/block/");
+    snprintf(disk_name, MISC_STRING_LEN, "%.*s",
+            (int) strcspn(block_dir, "/"), block_dir);
+    return (disk_name[0] != '\0');
+}
+
+
+/**
+ * @brief Add the disk holding the given block device number (itself, or the
+ * parent of a partition) to the in-use set. Return FALSE if the device isn't
+ * known to the block layer or we couldn't grow the set.
+ */
+boolean markBlockDevInUse(str_pool_t *in_use, dev_t dev_num) {
+    char dev_path[MAX_SYSFS_PATH_SIZE] = {0}, disk_name[MISC_STRING_LEN] = {0};
 
+    if (major(dev_num) == 0)
+        return FALSE;
+    snprintf(dev_path, MAX_SYSFS_PATH_SIZE, "%s/%u:%u", SYSFS_DEV_BLOCK,
+            major(dev_num), minor(dev_num));
+    if (!getBlockDiskName(AT_FDCWD, dev_path, disk_name))
+        return FALSE;
+    return (internStr(in_use, disk_name) != -1);
+}
+
+
+/**
+ * @brief Build the set of block devices (whole disk names, as found in
+ * /sys/block) that are in use, in one pass over what the kernel already
+ * tells us: mounted file systems and active swap, anything with a holder
+ * (md, dm, bcache, etc.) on the disk or one of its partitions, the members
+ * of md/dm devices, and the devices SCST has been configured with (a SCST
+ * device doesn't necessarily hold its block device open exclusively). No
+ * block device is opened. Return FALSE if we couldn't allocate the set;
+ * any other problem just leaves that source out.
+ */
+boolean findBlockDevsInUse(str_pool_t *in_use) {
+    FILE *proc_file = NULL;
+    DIR *block_stream = NULL, *dir_stream = NULL;
+    struct dirent *block_entry = NULL, *dir_entry = NULL;
+    struct stat file_stat = {0};
+    char *line = NULL;
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0}, attr_path[MAX_SYSFS_PATH_SIZE] = {0},
+            swap_path[MAX_SYSFS_PATH_SIZE] = {0},
+            backing_name[MISC_STRING_LEN] = {0},
+            disk_name[MISC_STRING_LEN] = {0};
+    size_t line_size = 0;
+    unsigned int dev_major = 0, dev_minor = 0;
+    int block_fd = -1, hndlr_fd = -1, disk_fd = -1, i = 0;
+    dev_t backing = 0;
+    boolean disk_in_use = FALSE;
+
+    if (!resetStrPool(in_use))
+        return FALSE;
+
+    /* Mounted file systems; we go by the device number, so it doesn't matter
+     * how the mount source was given */
+    if ((proc_file = fopen(PROC_MOUNTINFO, "r")) != NULL) {
+        while (getline(&line, &line_size, proc_file) != -1) {
+            if (sscanf(line, "%*d %*d %u:%u", &dev_major, &dev_minor) == 2)
+                markBlockDevInUse(in_use, makedev(dev_major, dev_minor));
+        }
+        fclose(proc_file);
     } else {
-        /* Guess not, so lets shrink it */
-        strncpy(ret_buff, string, MAX_SYSFS_ATTR_SIZE);
-        char_to_del = curr_size - max_len + 3;
-        left_len = right_len = (curr_size - char_to_del) / 2;
-        while ((left_len + char_to_del + right_len) < max_len)
-            ++right_len;
-        right_half = ret_buff + left_len + char_to_del;
-        strncpy(str_buff, right_half, MISC_STRING_LEN);
-        curr_pos = ret_buff + left_len;
-        *curr_pos = '.';
-        ++curr_pos;
-        *curr_pos = '.';
-        ++curr_pos;
-        *curr_pos = '.';
-        ++curr_pos;
-        for (i = 0; i < MISC_STRING_LEN; i++) {
-            if (str_buff[i] == '\0') {
-                break;
-            } else {
-                *curr_pos = str_buff[i];
-                ++curr_pos;
+        DEBUG_LOG("fopen(): %s", strerror(errno));
+    }
+
+    /* Active swap partitions */
+    if ((proc_file = fopen(PROC_SWAPS, "r")) != NULL) {
+        while (getline(&line, &line_size, proc_file) != -1) {
+            if ((sscanf(line, "%255s", swap_path) == 1) &&
+                    (stat(swap_path, &file_stat) == 0) &&
+                    S_ISBLK(file_stat.st_mode))
+                markBlockDevInUse(in_use, file_stat.st_rdev);
+        }
+        fclose(proc_file);
+    }
+    FREE_NULL(line);
+
+    /* Block devices configured as SCST devices */
+    if (isSCSTLoaded()) {
+        for (i = 0; i < (int) g_scst_handlers_size(); i++) {
+            snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s",
+                    SYSFS_SCST_TGT, g_scst_handlers[i]);
+            if ((dir_stream = opendir(dir_name)) == NULL)
+                continue;
+            hndlr_fd = dirfd(dir_stream);
+            while ((dir_entry = readdir(dir_stream)) != NULL) {
+                if (dir_entry->d_type != DT_LNK)
+                    continue;
+                if ((backing = findBackingDev(hndlr_fd, g_scst_handlers[i],
+                        dir_entry->d_name, backing_name)) != 0)
+                    markBlockDevInUse(in_use, backing);
             }
+            closedir(dir_stream);
         }
-        *curr_pos = '\0';
-        return ret_buff;
     }
+
+    /* Holders of each disk (and its partitions), and md/dm members */
+    if ((block_stream = opendir(SYSFS_BLOCK)) == NULL) {
+        DEBUG_LOG("opendir(): %s", strerror(errno));
+        return TRUE;
+    }
+    block_fd = dirfd(block_stream);
+    while ((block_entry = readdir(block_stream)) != NULL) {
+        if (block_entry->d_type != DT_LNK)
+            continue;
+        if ((disk_fd = openDirAt(block_fd, block_entry->d_name)) == -1)
+            continue;
+
+        disk_in_use = (countDirEntriesAt(disk_fd, "holders",
+                DT_LNK, NULL) > 0);
+        if ((dir_stream = openDirStreamAt(disk_fd, "slaves")) != NULL) {
+            while ((dir_entry = readdir(dir_stream)) != NULL) {
+                if ((dir_entry->d_type == DT_LNK) &&
+                        getBlockDiskName(dirfd(dir_stream), dir_entry->d_name,
+                        disk_name))
+                    internStr(in_use, disk_name);
+            }
+            closedir(dir_stream);
+        }
+        if (!disk_in_use &&
+                (dir_stream = openDirStreamAt(disk_fd, "")) != NULL) {
+            while ((dir_entry = readdir(dir_stream)) != NULL) {
+                if ((dir_entry->d_type != DT_DIR) ||
+                        (dir_entry->d_name[0] == '.'))
+                    continue;
+                snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/partition",
+                        dir_entry->d_name);
+                if (faccessat(disk_fd, attr_path, F_OK, 0) != 0)
+                    continue;
+                snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/holders",
+                        dir_entry->d_name);
+                if (countDirEntriesAt(disk_fd, attr_path, DT_LNK, NULL) > 0) {
+                    disk_in_use = TRUE;
+                    break;
+                }
+            }
+            closedir(dir_stream);
+        }
+        if (disk_in_use)
+            internStr(in_use, block_entry->d_name);
+        close(disk_fd);
+    }
+    closedir(block_stream);
+
+    /* Done */
+    return TRUE;
 }
 
 
 /**
- * @brief Get all of the "usable" (eg, not the ESOS boot device, and other
- * block devices that appear to be in use) on the system, and fill the arrays
- * (by reference) with that information. We return the number of block devices
- * found (even zero) or -1 if an error occurred. This function will display
- * any error information to the screen itself.
+ * @brief Check if the given file (or block device) is the "filename" of a
+ * configured SCST device; files are matched by their inode (so any path to
+ * them works) and block devices by their device number. Return TRUE and fill
+ * in the SCST device name if it is, otherwise FALSE.
  */
-int getUsableBlockDevs(CDKSCREEN *cdk_screen,
-        char blk_dev_name[MAX_BLOCK_DEVS][MISC_STRING_LEN],
-        char blk_dev_info[MAX_BLOCK_DEVS][MISC_STRING_LEN],
-        char blk_dev_size[MAX_BLOCK_DEVS][MISC_STRING_LEN]) {
-    int dev_cnt = 0, blk_dev_fd = 0;
-    char *error_msg = NULL, *boot_dev_node = NULL;
-    char dir_name[MAX_SYSFS_PATH_SIZE] = {0},
-            tmp_buff[MAX_SYSFS_ATTR_SIZE] = {0},
-            dev_node_test[MISC_STRING_LEN] = {0};
+boolean findSCSTFileDev(const char *path, char scst_dev[]) {
     DIR *dir_stream = NULL;
     struct dirent *dir_entry = NULL;
-    boolean finished = FALSE;
+    struct stat path_stat = {0}, file_stat = {0};
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0},
+            attr_path[MAX_SYSFS_PATH_SIZE] = {0},
+            attr_val[MAX_SYSFS_ATTR_SIZE] = {0};
+    boolean found = FALSE;
+    int i = 0;
 
-    while (1) {
-        /* Get the ESOS boot device node */
-        if ((boot_dev_node = blkid_get_devname(NULL, "LABEL",
-                ESOS_ROOT_PART)) == NULL) {
-            /* The function above returns NULL if the device isn't found */
-            SAFE_ASPRINTF(&boot_dev_node, " ");
-        } else {
-            /* Found the device so chop off the partition number */
-            *(boot_dev_node + strlen(boot_dev_node) - 1) = '\0';
+    scst_dev[0] = '\0';
+    if (!isSCSTLoaded() || (stat(path, &path_stat) == -1))
+        return FALSE;
+    for (i = 0; (i < (int) g_scst_handlers_size()) && !found; i++) {
+        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/handlers/%s",
+                SYSFS_SCST_TGT, g_scst_handlers[i]);
+        if ((dir_stream = opendir(dir_name)) == NULL)
+            continue;
+        while ((dir_entry = readdir(dir_stream)) != NULL) {
+            if (dir_entry->d_type != DT_LNK)
+                continue;
+            snprintf(attr_path, MAX_SYSFS_PATH_SIZE, "%s/filename",
+                    dir_entry->d_name);
+            if ((readAttributeAt(dirfd(dir_stream), attr_path,
+                    attr_val) != 0) || (attr_val[0] == '\0') ||
+                    (stat(attr_val, &file_stat) == -1))
+                continue;
+            if ((S_ISBLK(path_stat.st_mode) && S_ISBLK(file_stat.st_mode) &&
+                    (path_stat.st_rdev == file_stat.st_rdev)) ||
+                    (!S_ISBLK(path_stat.st_mode) &&
+                    (path_stat.st_dev == file_stat.st_dev) &&
+                    (path_stat.st_ino == file_stat.st_ino))) {
+                snprintf(scst_dev, MISC_STRING_LEN, "%s", dir_entry->d_name);
+                found = TRUE;
+                break;
+            }
         }
+        closedir(dir_stream);
+    }
+    return found;
+}
 
-        /* Open the directory to get block devices */
-        if ((dir_stream = opendir(SYSFS_BLOCK)) == NULL) {
-            SAFE_ASPRINTF(&error_msg, "opendir(): %s", strerror(errno));
-            errorDialog(cdk_screen, error_msg, NULL);
-            FREE_NULL(error_msg);
-            break;
+
+/**
+ * @brief Find the RAID stripe geometry under a block device (or partition)
+ * so a new file system can be aligned to it: the stripe unit (in bytes) and
+ * the stripe width (the number of data disks). An md array gives its chunk
+ * size and member count (less the parity/mirror copies), a striped LVM
+ * logical volume its stripe size and count, and anything else (eg, a
+ * hardware RAID volume, or LVM on top of md) the I/O hints its driver
+ * reports: minimum_io_size is one strip and optimal_io_size a full stripe.
+ * Where the values came from is described in 'source'. Return FALSE (and
+ * both are zero) if no striping was found.
+ */
+boolean findStripeGeometry(const char *blk_dev_node,
+        unsigned long *stripe_unit, int *stripe_width, char source[]) {
+    FILE *shell_cmd = NULL;
+    struct stat dev_stat = {0};
+    char dev_path[MAX_SYSFS_PATH_SIZE] = {0},
+            disk_name[MISC_STRING_LEN] = {0},
+            md_level[MAX_SYSFS_ATTR_SIZE] = {0},
+            attr_val[MAX_SYSFS_ATTR_SIZE] = {0},
+            command_str[MAX_SHELL_CMD_LEN] = {0},
+            output_line[MAX_CMD_LINE_LEN] = {0};
+    unsigned long chunk_size = 0, min_io = 0, opt_io = 0, phys_block = 0;
+    int disk_fd = -1, raid_disks = 0, data_disks = 0, layout = 0,
+            copies = 0, lv_stripes = 0;
+
+    *stripe_unit = 0;
+    *stripe_width = 0;
+    snprintf(source, MISC_STRING_LEN, "no striping found");
+    if ((stat(blk_dev_node, &dev_stat) == -1) ||
+            !S_ISBLK(dev_stat.st_mode))
+        return FALSE;
+    /* A partition is on the same stripes as its disk */
+    snprintf(dev_path, MAX_SYSFS_PATH_SIZE, "%s/%u:%u", SYSFS_DEV_BLOCK,
+            major(dev_stat.st_rdev), minor(dev_stat.st_rdev));
+    if (!getBlockDiskName(AT_FDCWD, dev_path, disk_name))
+        return FALSE;
+    snprintf(dev_path, MAX_SYSFS_PATH_SIZE, "%s/%s", SYSFS_BLOCK, disk_name);
+    if ((disk_fd = openDirAt(AT_FDCWD, dev_path)) == -1)
+        return FALSE;
+
+    /* An md array */
+    if ((readAttributeAt(disk_fd, "md/level", md_level) == 0) &&
+            (readAttributeAt(disk_fd, "md/raid_disks", attr_val) == 0) &&
+            ((raid_disks = atoi(attr_val)) > 0) &&
+            (readAttributeAt(disk_fd, "md/chunk_size", attr_val) == 0) &&
+            ((chunk_size = strtoul(attr_val, NULL, 10)) > 0)) {
+        if (strcmp(md_level, "raid0") == 0) {
+            data_disks = raid_disks;
+        } else if ((strcmp(md_level, "raid4") == 0) ||
+                (strcmp(md_level, "raid5") == 0)) {
+            data_disks = raid_disks - 1;
+        } else if (strcmp(md_level, "raid6") == 0) {
+            data_disks = raid_disks - 2;
+        } else if ((strcmp(md_level, "raid10") == 0) &&
+                (readAttributeAt(disk_fd, "md/layout", attr_val) == 0)) {
+            /* The near and far copies are packed in the layout */
+            layout = atoi(attr_val);
+            copies = (layout & 0xFF) * ((layout >> 8) & 0xFF);
+            if (copies > 0)
+                data_disks = raid_disks / copies;
+        }
+        if (data_disks > 0) {
+            *stripe_unit = chunk_size;
+            *stripe_width = data_disks;
+            snprintf(source, MISC_STRING_LEN, "md %s, %d disks "
+                    "(%d data), %lu KiB chunk", md_level, raid_disks,
+                    data_disks, (chunk_size / 1024));
+            close(disk_fd);
+            return TRUE;
         }
+    }
 
-        /* Loop over each entry in the directory (block devices) */
-        while ((dir_entry = readdir(dir_stream)) != NULL) {
-            if (dir_entry->d_type == DT_LNK) {
-                snprintf(dev_node_test, MISC_STRING_LEN,
-                        "/dev/%s", dir_entry->d_name);
-                /* Test to see if the block device is already open */
-                if ((blk_dev_fd = open(dev_node_test, O_EXCL)) == -1) {
-                    continue;
-                } else {
-                    if (close(blk_dev_fd) == -1) {
-                        SAFE_ASPRINTF(&error_msg, "close(): %s",
-                                strerror(errno));
-                        errorDialog(cdk_screen, error_msg, NULL);
-                        FREE_NULL(error_msg);
-                        finished = TRUE;
-                        break;
-                    }
-                }
+    /* A striped LVM logical volume */
+    if ((readAttributeAt(disk_fd, "dm/uuid", attr_val) == 0) &&
+            (strncmp(attr_val, "LVM-", 4) == 0) &&
+            (readAttributeAt(disk_fd, "dm/name", attr_val) == 0)) {
+        snprintf(command_str, MAX_SHELL_CMD_LEN, "%s --noheadings "
+                "--separator , --units b --nosuffix --options "
+                "stripes,stripe_size /dev/mapper/%s 2> /dev/null",
+                LVS_BIN, attr_val);
+        if ((shell_cmd = popen(command_str, "r")) != NULL) {
+            if ((fgets(output_line, sizeof (output_line),
+                    shell_cmd) != NULL) && (sscanf(output_line, " %d,%lu",
+                    &lv_stripes, &chunk_size) == 2) && (lv_stripes > 1) &&
+                    (chunk_size > 0)) {
+                *stripe_unit = chunk_size;
+                *stripe_width = lv_stripes;
+                snprintf(source, MISC_STRING_LEN, "LVM, %d stripes, "
+                        "%lu KiB stripe size", lv_stripes,
+                        (chunk_size / 1024));
+            }
+            pclose(shell_cmd);
+            if (*stripe_unit > 0) {
+                close(disk_fd);
+                return TRUE;
+            }
+        }
+    }
 
-                if (strcmp(boot_dev_node, dev_node_test) == 0) {
-                    /* We don't want to show the ESOS boot block
-                     * device (USB drive) */
-                    continue;
+    /* The I/O hints (what hardware RAID controllers report) */
+    if (readAttributeAt(disk_fd, "queue/minimum_io_size", attr_val) == 0)
+        min_io = strtoul(attr_val, NULL, 10);
+    if (readAttributeAt(disk_fd, "queue/optimal_io_size", attr_val) == 0)
+        opt_io = strtoul(attr_val, NULL, 10);
+    if (readAttributeAt(disk_fd, "queue/physical_block_size", attr_val) == 0)
+        phys_block = strtoul(attr_val, NULL, 10);
+    close(disk_fd);
+    /* Some devices report nonsense, so only whole file system blocks */
+    if ((opt_io == 0) || ((opt_io % FS_STRIPE_BLOCK_SIZE) != 0))
+        return FALSE;
+    if ((min_io > phys_block) && ((min_io % FS_STRIPE_BLOCK_SIZE) == 0) &&
+            ((opt_io % min_io) == 0)) {
+        *stripe_unit = min_io;
+        *stripe_width = (int) (opt_io / min_io);
+    } else {
+        *stripe_unit = opt_io;
+        *stripe_width = 1;
+    }
+    snprintf(source, MISC_STRING_LEN, "I/O hints, %lu KiB minimum, "
+            "%lu KiB optimal", (min_io / 1024), (opt_io / 1024));
+    return TRUE;
+}
 
-                } else if ((strstr(dev_node_test, "/dev/drbd")) != NULL) {
-                    /* For DRBD block devices (not sure if the /dev/drbdX
-                     * format is forced when using drbdadm, so this may
-                     * be a problem */
-                    if (dev_cnt < MAX_BLOCK_DEVS) {
-                        snprintf(blk_dev_name[dev_cnt], MISC_STRING_LEN, "%s",
-                                dir_entry->d_name);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%s",
-                                tmp_buff);
-                        /* Nothing extra for DRBD... yet */
-                        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN,
-                                "DRBD Device");
-                        dev_cnt++;
-                    }
 
-                } else if ((strstr(dev_node_test, "/dev/md")) != NULL) {
-                    /* For software RAID (md) devices; it appears the mdadm
-                     * tool forces the /dev/mdX device node name format */
-                    if (dev_cnt < MAX_BLOCK_DEVS) {
-                        snprintf(blk_dev_name[dev_cnt], MISC_STRING_LEN, "%s",
-                                dir_entry->d_name);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%s",
-                                tmp_buff);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                                "%s/%s/md/level", SYSFS_BLOCK,
-                                blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN,
-                                "Level: %s", tmp_buff);
-                        dev_cnt++;
-                    }
+/**
+ * @brief Get the name of the disk the ESOS boot partition is on (found by
+ * its label); the name is empty if it isn't found.
+ */
+void getBootDiskName(char disk_name[]) {
+    char *boot_dev_node = NULL;
+    char dev_path[MAX_SYSFS_PATH_SIZE] = {0};
+    struct stat boot_stat = {0};
+    struct timespec prof_start = {0};
+
+    disk_name[0] = '\0';
+    /* The function below returns NULL if the device isn't found */
+    startProfile(&prof_start);
+    boot_dev_node = blkid_get_devname(getBlkidCache(), "LABEL",
+            ESOS_ROOT_PART);
+    endProfile("blkid lookup", &prof_start);
+    if ((boot_dev_node != NULL) && (stat(boot_dev_node,
+            &boot_stat) == 0) && S_ISBLK(boot_stat.st_mode)) {
+        snprintf(dev_path, MAX_SYSFS_PATH_SIZE, "%s/%u:%u",
+                SYSFS_DEV_BLOCK, major(boot_stat.st_rdev),
+                minor(boot_stat.st_rdev));
+        if (!getBlockDiskName(AT_FDCWD, dev_path, disk_name))
+            disk_name[0] = '\0';
+    }
+    FREE_NULL(boot_dev_node);
+}
 
-                } else if ((strstr(dev_node_test, "/dev/sd")) != NULL) {
-                    /* For normal SCSI block devices */
-                    if (dev_cnt < MAX_BLOCK_DEVS) {
-                        snprintf(blk_dev_name[dev_cnt], MISC_STRING_LEN, "%s",
-                                dir_entry->d_name);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%s",
-                                tmp_buff);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                                "%s/%s/device/model",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN,
-                                "Model: %s", tmp_buff);
-                        dev_cnt++;
-                    }
 
-                } else if ((strstr(dev_node_test, "/dev/dm-")) != NULL) {
-                    /* For device mapper (eg, LVM2) block devices */
-                    if (dev_cnt < MAX_BLOCK_DEVS) {
-                        snprintf(blk_dev_name[dev_cnt], MISC_STRING_LEN, "%s",
-                                dir_entry->d_name);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%s",
-                                tmp_buff);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/dm/name",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN,
-                                "Name: %s", tmp_buff);
-                        dev_cnt++;
-                    }
+/**
+ * @brief Get all of the "usable" (eg, not the ESOS boot device, and other
+ * block devices that appear to be in use) on the system, and fill the arrays
+ * (by reference) with that information. The devices come from the live
+ * device table. We return the number of block devices found (even zero) or
+ * -1 if an error occurred. This function will display any error information
+ * to the screen itself.
+ */
+int getUsableBlockDevs(CDKSCREEN *cdk_screen,
+        char blk_dev_name[MAX_BLOCK_DEVS][MISC_STRING_LEN],
+        char blk_dev_info[MAX_BLOCK_DEVS][MISC_STRING_LEN],
+        char blk_dev_size[MAX_BLOCK_DEVS][MISC_STRING_LEN]) {
+    int dev_cnt = 0, i = 0;
+    char boot_disk[MISC_STRING_LEN] = {0};
+    blk_dev_ent_t *entry = NULL;
+
+    /* Make sure the table is there, and the in-use status is current */
+    readyDevTable();
+    if (!refreshDevTableInUse()) {
+        errorDialog(cdk_screen, "Couldn't allocate memory for the "
+                "in-use block device list.", NULL);
+        return -1;
+    }
+    getBootDiskName(boot_disk);
+
+    pthread_mutex_lock(&g_dev_table_mutex);
+    for (i = 0; (i < g_dev_table.blk_cnt) && (dev_cnt < MAX_BLOCK_DEVS);
+            i++) {
+        entry = &g_dev_table.blk_devs[i];
+        /* We don't want to show the ESOS boot block device (USB drive),
+         * anything that is in use, or device types we don't know */
+        if (!entry->listable || entry->in_use ||
+                (strcmp(entry->name, boot_disk) == 0))
+            continue;
+        snprintf(blk_dev_name[dev_cnt], MISC_STRING_LEN, "%s", entry->name);
+        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%llu", entry->size);
+        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN, "%s", entry->info);
+        dev_cnt++;
+    }
+    pthread_mutex_unlock(&g_dev_table_mutex);
 
-                } else if ((strstr(dev_node_test, "/dev/cciss")) != NULL) {
-                    /* For Compaq SMART array controllers */
-                    if (dev_cnt < MAX_BLOCK_DEVS) {
-                        snprintf(blk_dev_name[dev_cnt], MISC_STRING_LEN, "%s",
-                                dir_entry->d_name);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%s",
-                                tmp_buff);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                                "%s/%s/device/raid_level",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN,
-                                "RAID Level: %s", tmp_buff);
-                        dev_cnt++;
-                    }
+    /* Done */
+    return dev_cnt;
+}
 
-                } else if ((strstr(dev_node_test, "/dev/zd")) != NULL) {
-                    /* For ZFS block devices */
-                    if (dev_cnt < MAX_BLOCK_DEVS) {
-                        snprintf(blk_dev_name[dev_cnt], MISC_STRING_LEN, "%s",
-                                dir_entry->d_name);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%s",
-                                tmp_buff);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                                "%s/%s/queue/logical_block_size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN,
-                                "Block Size: %s", tmp_buff);
-                        dev_cnt++;
-                    }
 
-                } else if ((strstr(dev_node_test, "/dev/rbd")) != NULL) {
-                    /* For RBD (Ceph) block devices */
-                    if (dev_cnt < MAX_BLOCK_DEVS) {
-                        snprintf(blk_dev_name[dev_cnt], "%s", MISC_STRING_LEN,
-                                dir_entry->d_name);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%s",
-                                tmp_buff);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                                "%s/%s/queue/logical_block_size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN,
-                                "Block Size: %s", tmp_buff);
-                        dev_cnt++;
-                    }
+/**
+ * @brief Walk the SCST targets, their security groups, initiators and LUNs
+ * (for the "LUN/Group Layout" dialog) and add the lines to display to the
+ * (empty) row arena; lines that don't fit are dropped. Everything below the
+ * "targets" directory is opened relative to its (open) parent directory.
+ * Return the number of lines, or -1 if the target drivers couldn't be listed.
+ */
+int readLUNLayout(row_arena_t *layout) {
+    int i = 0, dev_path_size = 0, driver_cnt = 0,
+            targets_fd = -1, group_fd = -1;
+    char dir_name[MAX_SYSFS_PATH_SIZE] = {0},
+            link_path[MAX_SYSFS_PATH_SIZE] = {0},
+            dev_path[MAX_SYSFS_PATH_SIZE] = {0};
+    char tgt_drivers[MAX_SCST_DRIVERS][MISC_STRING_LEN] = {{0}, {0}};
+    DIR *tgt_dir_stream = NULL, *group_dir_stream = NULL,
+            *init_dir_stream = NULL, *lun_dir_stream = NULL;
+    struct dirent *tgt_dir_entry = NULL, *group_dir_entry = NULL,
+            *init_dir_entry = NULL, *lun_dir_entry = NULL;
+
+    /* Fill the array with current SCST target drivers */
+    if (!listSCSTTgtDrivers(tgt_drivers, &driver_cnt))
+        return -1;
 
-                } else if ((strstr(dev_node_test, "/dev/nvme")) != NULL) {
-                    /* For NVMe block devices */
-                    if (dev_cnt < MAX_BLOCK_DEVS) {
-                        snprintf(blk_dev_name[dev_cnt], MISC_STRING_LEN, "%s",
-                                dir_entry->d_name);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/%s/size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_size[dev_cnt], MISC_STRING_LEN, "%s",
-                                tmp_buff);
-                        snprintf(dir_name, MAX_SYSFS_PATH_SIZE,
-                                "%s/%s/queue/logical_block_size",
-                                SYSFS_BLOCK, blk_dev_name[dev_cnt]);
-                        readAttribute(dir_name, tmp_buff);
-                        snprintf(blk_dev_info[dev_cnt], MISC_STRING_LEN,
-                                "Block Size: %s", tmp_buff);
-                        dev_cnt++;
+    /* Loop over each target driver type */
+    snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/targets", SYSFS_SCST_TGT);
+    if ((targets_fd = openDirAt(AT_FDCWD, dir_name)) == -1) {
+        addArenaRow(layout, "openat(): %s", strerror(errno));
+        driver_cnt = 0;
+    }
+    for (i = 0; i < driver_cnt; i++) {
+        /* Loop over each target for current driver type */
+        if ((tgt_dir_stream = openDirStreamAt(targets_fd,
+                tgt_drivers[i])) == NULL) {
+            addArenaRow(layout, "opendir(): %s", strerror(errno));
+            break;
+        }
+        while ((tgt_dir_entry = readdir(tgt_dir_stream)) != NULL) {
+            /* The target names are directories; skip '.' and '..' */
+            if ((tgt_dir_entry->d_type == DT_DIR) &&
+                    (strcmp(tgt_dir_entry->d_name, ".") != 0) &&
+                    (strcmp(tgt_dir_entry->d_name, "..") != 0)) {
+                addArenaRow(layout, "</B>Target:<!B> %s (%s)",
+                        tgt_dir_entry->d_name, tgt_drivers[i]);
+                /* Loop over each security group for the current target */
+                snprintf(dir_name, MAX_SYSFS_PATH_SIZE, "%s/ini_groups",
+                        tgt_dir_entry->d_name);
+                if ((group_dir_stream = openDirStreamAt(
+                        dirfd(tgt_dir_stream), dir_name)) == NULL) {
+                    addArenaRow(layout, "opendir(): %s", strerror(errno));
+                    continue;
+                }
+                while ((group_dir_entry = readdir(group_dir_stream)) != NULL) {
+                    /* The group names are directories; skip '.' and '..' */
+                    if ((group_dir_entry->d_type == DT_DIR) &&
+                            (strcmp(group_dir_entry->d_name, ".") != 0) &&
+                            (strcmp(group_dir_entry->d_name, "..") != 0)) {
+                        addArenaRow(layout, "\t</B>Group:<!B> %s",
+                                group_dir_entry->d_name);
+                        if ((group_fd = openDirAt(dirfd(group_dir_stream),
+                                group_dir_entry->d_name)) == -1) {
+                            addArenaRow(layout, "openat(): %s",
+                                    strerror(errno));
+                            continue;
+                        }
+
+                        /* Loop over each initiator for the current group */
+                        if ((init_dir_stream = openDirStreamAt(group_fd,
+                                "initiators")) == NULL) {
+                            addArenaRow(layout, "opendir(): %s",
+                                    strerror(errno));
+                        } else {
+                            while ((init_dir_entry =
+                                    readdir(init_dir_stream)) != NULL) {
+                                /* The initiators are files; skip 'mgmt' */
+                                if ((init_dir_entry->d_type == DT_REG) &&
+                                        (strcmp(init_dir_entry->d_name,
+                                        "mgmt") != 0)) {
+                                    addArenaRow(layout,
+                                            "\t\t</B>Initiator:<!B> %s",
+                                            init_dir_entry->d_name);
+                                }
+                            }
+                            closedir(init_dir_stream);
+                        }
+
+                        /* Loop over each LUN for the current group */
+                        if ((lun_dir_stream = openDirStreamAt(group_fd,
+                                "luns")) == NULL) {
+                            addArenaRow(layout, "opendir(): %s",
+                                    strerror(errno));
+                        } else {
+                            while ((lun_dir_entry =
+                                    readdir(lun_dir_stream)) != NULL) {
+                                /* The LUNs are directories; skip '.'
+                                 * and '..' */
+                                if ((lun_dir_entry->d_type != DT_DIR) ||
+                                        (strcmp(lun_dir_entry->d_name,
+                                        ".") == 0) ||
+                                        (strcmp(lun_dir_entry->d_name,
+                                        "..") == 0))
+                                    continue;
+                                /* We need to get the device name (link) */
+                                snprintf(link_path, MAX_SYSFS_PATH_SIZE,
+                                        "%s/device", lun_dir_entry->d_name);
+                                /* Read the link to get device name
+                                 * (doesn't append null byte) */
+                                dev_path_size = readlinkat(
+                                        dirfd(lun_dir_stream), link_path,
+                                        dev_path, (MAX_SYSFS_PATH_SIZE - 1));
+                                if (dev_path_size == -1)
+                                    dev_path_size = 0;
+                                *(dev_path + dev_path_size) = '\0';
+                                addArenaRow(layout, "\t\t</B>LUN:<!B> %s (%s)",
+                                        lun_dir_entry->d_name,
+                                        (strrchr(dev_path, '/') ?
+                                        (strrchr(dev_path, '/') + 1) :
+                                        dev_path));
+                            }
+                            closedir(lun_dir_stream);
+                        }
+                        close(group_fd);
                     }
                 }
-                // TODO: Still more controller block devices (ida, rd)
-                // need to be added but we need hardware so we can
-                // confirm sysfs attributes.
+                closedir(group_dir_stream);
+                /* Print a blank line to separate targets */
+                addArenaRow(layout, " ");
             }
         }
-        if (finished)
-            break;
-
-        /* Close the directory stream, we're done */
-        closedir(dir_stream);
-        break;
+        closedir(tgt_dir_stream);
     }
+    if (targets_fd != -1)
+        close(targets_fd);
 
     /* Done */
-    FREE_NULL(boot_dev_node);
-    return dev_cnt;
+    return layout->used;
+}
+
+
+/**
+ * @brief Block all signals in the calling thread; signal handling (SIGWINCH,
+ * SIGINT, etc.) is left to the UI thread. Threads created afterwards inherit
+ * the mask. If 'old_set' isn't NULL, the previous mask is saved in it.
+ */
+void blockThreadSignals(sigset_t *old_set) {
+    sigset_t signal_set;
+
+    sigfillset(&signal_set);
+    pthread_sigmask(SIG_BLOCK, &signal_set, old_set);
 }
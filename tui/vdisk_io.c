@@ -0,0 +1,861 @@
+/**
+ * @file vdisk_io.c
+ * @brief Functions for creating (provisioning), cloning and reclaiming the
+ * zeroed space in virtual disk files; these don't touch the screen, so they
+ * can be used from any thread.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <syslog.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <libaio.h>
+#include <cdk.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "prototypes.h"
+#include "system.h"
+#include "vdisk_io.h"
+
+
+/**
+ * @brief Write zeros over the whole file (which is open for writing) with
+ * large aligned writes, keeping up to 'queue_depth' of them in flight using
+ * Linux AIO. With O_DIRECT this runs at device speed and doesn't go through
+ * the page cache; without it (the file system doesn't support O_DIRECT) the
+ * written ranges are flushed and dropped from the cache as we go. On
+ * failure, the error message is filled and FALSE is returned.
+ */
+boolean eagerZeroFile(int fd, long long size, int queue_depth,
+        vdisk_progress_fn progress, void *progress_arg, char error_msg[]) {
+    io_context_t aio_ctx = 0;
+    struct iocb *iocbs = NULL, **free_cbs = NULL, *curr_cb = NULL;
+    struct io_event *events = NULL;
+    void *zero_buff = NULL;
+    long long next_off = 0, done = 0, direct_end = 0, last_report = 0;
+    long result = 0;
+    int free_cnt = 0, in_flight = 0, got = 0, ret_val = 0, i = 0,
+            fd_flags = 0, write_errno = 0;
+    boolean direct_io = FALSE, success = FALSE;
+
+    if ((fd_flags = fcntl(fd, F_GETFL)) == -1) {
+        snprintf(error_msg, MISC_STRING_LEN, "fcntl(): %s", strerror(errno));
+        return FALSE;
+    }
+    direct_io = ((fd_flags & O_DIRECT) != 0);
+    if (queue_depth < 1)
+        queue_depth = 1;
+    if (queue_depth > MAX_VDISK_QUEUE_DEPTH)
+        queue_depth = MAX_VDISK_QUEUE_DEPTH;
+
+    /* Every write is zeros, so they all share one (aligned) buffer */
+    if ((ret_val = posix_memalign(&zero_buff, VDISK_DIRECT_ALIGN,
+            VDISK_DIRECT_SIZE)) != 0) {
+        snprintf(error_msg, MISC_STRING_LEN, "posix_memalign(): %s",
+                strerror(ret_val));
+        return FALSE;
+    }
+    memset(zero_buff, 0, VDISK_DIRECT_SIZE);
+    if (((iocbs = calloc(queue_depth, sizeof (struct iocb))) == NULL) ||
+            ((free_cbs = calloc(queue_depth,
+            sizeof (struct iocb *))) == NULL) ||
+            ((events = calloc(queue_depth,
+            sizeof (struct io_event))) == NULL)) {
+        snprintf(error_msg, MISC_STRING_LEN, "calloc(): %s", strerror(errno));
+        goto out;
+    }
+    for (i = 0; i < queue_depth; i++)
+        free_cbs[free_cnt++] = &iocbs[i];
+    if ((ret_val = io_setup(queue_depth, &aio_ctx)) != 0) {
+        snprintf(error_msg, MISC_STRING_LEN, "io_setup(): %s",
+                strerror(-ret_val));
+        aio_ctx = 0;
+        goto out;
+    }
+
+    /* The direct writes cover the aligned part of the file */
+    direct_end = size - (size % VDISK_DIRECT_ALIGN);
+    while ((done < direct_end) || (in_flight > 0)) {
+        /* Keep the queue full (unless something failed) */
+        while ((write_errno == 0) && (free_cnt > 0) &&
+                (next_off < direct_end)) {
+            curr_cb = free_cbs[--free_cnt];
+            io_prep_pwrite(curr_cb, fd, zero_buff,
+                    MIN((direct_end - next_off), VDISK_DIRECT_SIZE),
+                    next_off);
+            if ((ret_val = io_submit(aio_ctx, 1, &curr_cb)) != 1) {
+                write_errno = ((ret_val < 0) ? -ret_val : EAGAIN);
+                free_cbs[free_cnt++] = curr_cb;
+                break;
+            }
+            next_off += curr_cb->u.c.nbytes;
+            in_flight++;
+        }
+        if (in_flight == 0)
+            break;
+
+        /* Reap whatever has finished */
+        if ((got = io_getevents(aio_ctx, 1, in_flight, events, NULL)) < 0) {
+            if (got == -EINTR)
+                continue;
+            if (write_errno == 0)
+                write_errno = -got;
+            break;
+        }
+        for (i = 0; i < got; i++) {
+            curr_cb = events[i].obj;
+            result = (long) events[i].res;
+            if (result < 0) {
+                if (write_errno == 0)
+                    write_errno = -result;
+            } else if ((unsigned long) result != curr_cb->u.c.nbytes) {
+                /* A short write means we ran out of space */
+                if (write_errno == 0)
+                    write_errno = ENOSPC;
+            } else {
+                done += result;
+            }
+            free_cbs[free_cnt++] = curr_cb;
+            in_flight--;
+        }
+        if (write_errno != 0)
+            continue;
+
+        if ((done - last_report) >= VDISK_PROGRESS_BYTES) {
+            if (!direct_io) {
+                /* Write back and drop what we wrote from the page cache */
+                sync_file_range(fd, last_report, (done - last_report),
+                        (SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                        SYNC_FILE_RANGE_WAIT_AFTER));
+                posix_fadvise(fd, last_report, (done - last_report),
+                        POSIX_FADV_DONTNEED);
+            }
+            last_report = done;
+            /* Stop queuing writes; the ones in flight are reaped first */
+            if ((progress != NULL) && !progress(progress_arg, done, size))
+                write_errno = ECANCELED;
+        }
+    }
+    if (write_errno == ECANCELED) {
+        snprintf(error_msg, MISC_STRING_LEN, "Cancelled.");
+        goto out;
+    } else if (write_errno != 0) {
+        snprintf(error_msg, MISC_STRING_LEN, "io_submit(): %s",
+                strerror(write_errno));
+        goto out;
+    }
+
+    /* Anything left over (less than the alignment) is written normally */
+    if (done < size) {
+        if (direct_io && (fcntl(fd, F_SETFL, (fd_flags & ~O_DIRECT)) == -1)) {
+            snprintf(error_msg, MISC_STRING_LEN, "fcntl(): %s",
+                    strerror(errno));
+            goto out;
+        }
+        if (pwrite(fd, zero_buff, (size - done), done) != (size - done)) {
+            snprintf(error_msg, MISC_STRING_LEN, "pwrite(): %s",
+                    strerror(errno));
+            goto out;
+        }
+    }
+    if (fsync(fd) == -1) {
+        snprintf(error_msg, MISC_STRING_LEN, "fsync(): %s", strerror(errno));
+        goto out;
+    }
+    if (!direct_io)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    if (progress != NULL)
+        progress(progress_arg, size, size);
+    success = TRUE;
+
+out:
+    if (aio_ctx != 0)
+        io_destroy(aio_ctx);
+    FREE_NULL(events);
+    FREE_NULL(free_cbs);
+    FREE_NULL(iocbs);
+    free(zero_buff);
+    return success;
+}
+
+
+/**
+ * @brief Create a new virtual disk file of the given size (in bytes) using
+ * the given provisioning mode: thin is a sparse file (only the size is set),
+ * lazy thick allocates all of the space with one fallocate() call (the file
+ * system marks it unwritten, so it reads as zeros), and eager-zero thick
+ * allocates and writes zeros over all of it. The file must not exist; if
+ * this fails, the error message is filled, the (partial) file is removed and
+ * FALSE is returned.
+ */
+boolean createVDiskFile(const char *path, long long size, vdisk_prov_t mode,
+        int queue_depth, vdisk_progress_fn progress, void *progress_arg,
+        char error_msg[]) {
+    int fd = -1;
+    boolean success = FALSE;
+
+    while (1) {
+        if ((fd = open(path, (O_WRONLY | O_CREAT | O_EXCL), 0666)) == -1) {
+            snprintf(error_msg, MISC_STRING_LEN, "open(): %s",
+                    strerror(errno));
+            return FALSE;
+        }
+        /* Eager-zero writes bypass the page cache if the file system
+         * supports it (setting the flag fails if not) */
+        if ((mode == VDISK_EAGER_ZERO) && (fcntl(fd, F_SETFL,
+                (fcntl(fd, F_GETFL) | O_DIRECT)) == -1))
+            DEBUG_LOG("No O_DIRECT support for %s; using buffered writes.",
+                    path);
+
+        if (mode == VDISK_THIN) {
+            if (ftruncate(fd, size) == -1) {
+                snprintf(error_msg, MISC_STRING_LEN, "ftruncate(): %s",
+                        strerror(errno));
+                break;
+            }
+        } else if (mode == VDISK_LAZY_THICK) {
+            if (fallocate(fd, 0, 0, size) == -1) {
+                snprintf(error_msg, MISC_STRING_LEN, "fallocate(): %s%s",
+                        strerror(errno), ((errno == EOPNOTSUPP) ?
+                        " (use eager-zero)" : ""));
+                break;
+            }
+        } else {
+            /* Reserving the space first keeps the file contiguous; not
+             * every file system can, which is fine */
+            if ((fallocate(fd, 0, 0, size) == -1) && (errno == ENOSPC)) {
+                snprintf(error_msg, MISC_STRING_LEN, "fallocate(): %s",
+                        strerror(errno));
+                break;
+            }
+            if (!eagerZeroFile(fd, size, queue_depth, progress,
+                    progress_arg, error_msg))
+                break;
+        }
+
+        if (fsync(fd) == -1) {
+            snprintf(error_msg, MISC_STRING_LEN, "fsync(): %s",
+                    strerror(errno));
+            break;
+        }
+        success = TRUE;
+        break;
+    }
+
+    if ((close(fd) == -1) && success) {
+        snprintf(error_msg, MISC_STRING_LEN, "close(): %s", strerror(errno));
+        success = FALSE;
+    }
+    if (!success)
+        unlink(path);
+    return success;
+}
+
+
+/**
+ * @brief Find the next chunk of data to copy (skipping any holes) and claim
+ * it; the lock must be held. Return FALSE once the whole file is done (or
+ * finding the data failed, which sets the error).
+ */
+boolean nextCloneChunk(vdisk_clone_t *clone, long long *offset,
+        long long *length) {
+    off_t data_start = 0, hole_start = 0;
+
+    if (clone->error != 0)
+        return FALSE;
+    if (clone->next_off >= clone->extent_end) {
+        if (clone->next_off >= clone->size)
+            return FALSE;
+        /* The next data extent (ENXIO means the rest is a hole) */
+        if ((data_start = lseek(clone->src_fd, clone->next_off,
+                SEEK_DATA)) == -1) {
+            if (errno != ENXIO) {
+                clone->error = errno;
+                snprintf(clone->error_func, MISC_STRING_LEN, "lseek()");
+            }
+            clone->next_off = clone->size;
+            return FALSE;
+        }
+        if ((hole_start = lseek(clone->src_fd, data_start,
+                SEEK_HOLE)) == -1) {
+            clone->error = errno;
+            snprintf(clone->error_func, MISC_STRING_LEN, "lseek()");
+            return FALSE;
+        }
+        clone->next_off = data_start;
+        clone->extent_end = MIN(hole_start, clone->size);
+        if (clone->next_off >= clone->extent_end)
+            return FALSE;
+    }
+
+    *offset = clone->next_off;
+    *length = MIN((clone->extent_end - clone->next_off), VDISK_CLONE_CHUNK);
+    clone->next_off += *length;
+    return TRUE;
+}
+
+
+/**
+ * @brief Copy part of the file without copy_file_range() (eg, an older
+ * kernel, or it's not supported between these files); plain reads and
+ * writes through the given buffer. Return 0, or the errno value.
+ */
+int copyCloneRange(vdisk_clone_t *clone, char *buffer, long long offset,
+        long long length) {
+    ssize_t bytes_read = 0;
+
+    while (length > 0) {
+        if ((bytes_read = pread(clone->src_fd, buffer,
+                MIN(length, VDISK_CLONE_BUFF_SIZE), offset)) == -1) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        /* The source got shorter; the rest stays a hole */
+        if (bytes_read == 0)
+            break;
+        if (pwrite(clone->dst_fd, buffer, bytes_read, offset) != bytes_read)
+            return ((errno != 0) ? errno : ENOSPC);
+        offset += bytes_read;
+        length -= bytes_read;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief A copy thread for cloning a file; keep taking chunks of data and
+ * copying them in the kernel (copy_file_range) until everything is done or
+ * something fails.
+ */
+void *cloneThread(void *arg) {
+    vdisk_clone_t *clone = (vdisk_clone_t *) arg;
+    char *buffer = NULL;
+    long long offset = 0, length = 0, chunk_len = 0;
+    loff_t off_in = 0, off_out = 0;
+    ssize_t copied = 0;
+    int copy_errno = 0;
+    boolean use_kernel = TRUE;
+
+    for (;;) {
+        pthread_mutex_lock(&clone->mutex);
+        if (!nextCloneChunk(clone, &offset, &length)) {
+            pthread_mutex_unlock(&clone->mutex);
+            break;
+        }
+        pthread_mutex_unlock(&clone->mutex);
+
+        off_in = off_out = offset;
+        chunk_len = length;
+        copy_errno = 0;
+        while (use_kernel && (length > 0)) {
+            if ((copied = copy_file_range(clone->src_fd, &off_in,
+                    clone->dst_fd, &off_out, length, 0)) == -1) {
+                if (errno == EINTR)
+                    continue;
+                if ((errno == ENOSYS) || (errno == EXDEV) ||
+                        (errno == EOPNOTSUPP) || (errno == EINVAL)) {
+                    /* Do the rest of the job the slow way */
+                    use_kernel = FALSE;
+                    break;
+                }
+                copy_errno = errno;
+                break;
+            }
+            if (copied == 0)
+                break;
+            length -= copied;
+        }
+        if (!use_kernel && (copy_errno == 0) && (length > 0)) {
+            if ((buffer == NULL) &&
+                    ((buffer = malloc(VDISK_CLONE_BUFF_SIZE)) == NULL))
+                copy_errno = ENOMEM;
+            else if ((copy_errno = copyCloneRange(clone, buffer, off_in,
+                    length)) == 0)
+                length = 0;
+        }
+
+        pthread_mutex_lock(&clone->mutex);
+        if (copy_errno != 0) {
+            if (clone->error == 0) {
+                clone->error = copy_errno;
+                snprintf(clone->error_func, MISC_STRING_LEN, "%s",
+                        (use_kernel ? "copy_file_range()" : "pwrite()"));
+            }
+            pthread_mutex_unlock(&clone->mutex);
+            break;
+        }
+        clone->done += (chunk_len - length);
+        if ((clone->progress != NULL) &&
+                ((clone->done - clone->last_report) >= VDISK_PROGRESS_BYTES)) {
+            clone->last_report = clone->done;
+            /* The other threads stop when they go for their next chunk */
+            if (!clone->progress(clone->progress_arg, clone->done,
+                    clone->total) && (clone->error == 0))
+                clone->error = ECANCELED;
+        }
+        pthread_mutex_unlock(&clone->mutex);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+
+/**
+ * @brief Return the number of bytes of data (not holes) in the open file.
+ */
+long long fileDataBytes(int fd, long long size) {
+    off_t data_start = 0, hole_start = 0;
+    long long data_bytes = 0;
+
+    while (data_start < size) {
+        if ((data_start = lseek(fd, data_start, SEEK_DATA)) == -1)
+            break;
+        if ((hole_start = lseek(fd, data_start, SEEK_HOLE)) == -1)
+            hole_start = size;
+        data_bytes += (MIN(hole_start, size) - data_start);
+        data_start = hole_start;
+    }
+    return data_bytes;
+}
+
+
+/**
+ * @brief Clone a virtual disk file (the new file must not exist). The file
+ * system is asked to share the extents first (FICLONE; a reflink on XFS or
+ * btrfs, which is instant); if it can't, the data extents are copied by a
+ * number of threads with copy_file_range() so the data stays in the kernel
+ * and holes stay holes. A copy of a file that's being written isn't
+ * consistent, so with 'reflink_only' set it fails instead. On failure, the
+ * error message is filled, the new (partial) file is removed and FALSE is
+ * returned.
+ */
+boolean cloneVDiskFile(const char *src_path, const char *dst_path,
+        int threads, boolean reflink_only, vdisk_progress_fn progress,
+        void *progress_arg, char error_msg[]) {
+    vdisk_clone_t clone;
+    pthread_t clone_threads[MAX_VDISK_CLONE_THREADS];
+    struct stat src_stat = {0};
+    int src_fd = -1, dst_fd = -1, started = 0, ret_val = 0, i = 0;
+    boolean success = FALSE;
+
+    if ((src_fd = open(src_path, O_RDONLY)) == -1) {
+        snprintf(error_msg, MISC_STRING_LEN, "open(): %s", strerror(errno));
+        return FALSE;
+    }
+    if (fstat(src_fd, &src_stat) == -1) {
+        snprintf(error_msg, MISC_STRING_LEN, "fstat(): %s", strerror(errno));
+        close(src_fd);
+        return FALSE;
+    }
+    if ((dst_fd = open(dst_path, (O_WRONLY | O_CREAT | O_EXCL),
+            (src_stat.st_mode & 0777))) == -1) {
+        snprintf(error_msg, MISC_STRING_LEN, "open(): %s", strerror(errno));
+        close(src_fd);
+        return FALSE;
+    }
+
+    while (1) {
+        /* Try sharing the extents; if the file system can't (or they're
+         * on different ones), copy the data */
+        if (ioctl(dst_fd, FICLONE, src_fd) == 0) {
+            DEBUG_LOG("Cloned %s to %s with a reflink.", src_path, dst_path);
+            if (progress != NULL)
+                progress(progress_arg, src_stat.st_size, src_stat.st_size);
+        } else {
+            if ((errno != EOPNOTSUPP) && (errno != ENOTTY) &&
+                    (errno != EXDEV) && (errno != EINVAL)) {
+                snprintf(error_msg, MISC_STRING_LEN, "ioctl(FICLONE): %s",
+                        strerror(errno));
+                break;
+            }
+            if (reflink_only) {
+                snprintf(error_msg, MISC_STRING_LEN, "The file system can't "
+                        "reflink this file, and a copy isn't consistent.");
+                break;
+            }
+            /* The whole size is set first so anything not copied is a
+             * hole, like it is in the original */
+            if (ftruncate(dst_fd, src_stat.st_size) == -1) {
+                snprintf(error_msg, MISC_STRING_LEN, "ftruncate(): %s",
+                        strerror(errno));
+                break;
+            }
+            memset(&clone, 0, sizeof (vdisk_clone_t));
+            clone.src_fd = src_fd;
+            clone.dst_fd = dst_fd;
+            clone.size = src_stat.st_size;
+            clone.total = fileDataBytes(src_fd, src_stat.st_size);
+            clone.progress = progress;
+            clone.progress_arg = progress_arg;
+            pthread_mutex_init(&clone.mutex, NULL);
+            if (progress != NULL)
+                progress(progress_arg, 0, clone.total);
+
+            if (threads < 1)
+                threads = 1;
+            if (threads > MAX_VDISK_CLONE_THREADS)
+                threads = MAX_VDISK_CLONE_THREADS;
+            for (started = 0; started < threads; started++) {
+                if ((ret_val = pthread_create(&clone_threads[started], NULL,
+                        cloneThread, &clone)) != 0)
+                    break;
+            }
+            /* Fewer threads is fine, as long as there is one */
+            if (started == 0) {
+                snprintf(error_msg, MISC_STRING_LEN, "pthread_create(): %s",
+                        strerror(ret_val));
+                pthread_mutex_destroy(&clone.mutex);
+                break;
+            }
+            for (i = 0; i < started; i++)
+                pthread_join(clone_threads[i], NULL);
+            pthread_mutex_destroy(&clone.mutex);
+            if (clone.error == ECANCELED) {
+                snprintf(error_msg, MISC_STRING_LEN, "Cancelled.");
+                break;
+            } else if (clone.error != 0) {
+                snprintf(error_msg, MISC_STRING_LEN, "%s: %s",
+                        clone.error_func, strerror(clone.error));
+                break;
+            }
+            if (progress != NULL)
+                progress(progress_arg, clone.total, clone.total);
+        }
+
+        /* Make sure it's all on disk before it's used as a vdisk */
+        if (fsync(dst_fd) == -1) {
+            snprintf(error_msg, MISC_STRING_LEN, "fsync(): %s",
+                    strerror(errno));
+            break;
+        }
+        success = TRUE;
+        break;
+    }
+
+    close(src_fd);
+    if ((close(dst_fd) == -1) && success) {
+        snprintf(error_msg, MISC_STRING_LEN, "close(): %s", strerror(errno));
+        success = FALSE;
+    }
+    if (!success)
+        unlink(dst_path);
+    return success;
+}
+
+
+/**
+ * @brief Test if the block is all zeros, a 64-bit word at a time; this works
+ * on any CPU.
+ */
+boolean zeroBlockGeneric(const unsigned char *block, size_t len) {
+    const uint64_t *words = (const uint64_t *) block;
+    size_t i = 0;
+
+    for (i = 0; i < (len / sizeof (uint64_t)); i += 8) {
+        if ((words[i] | words[i + 1] | words[i + 2] | words[i + 3] |
+                words[i + 4] | words[i + 5] | words[i + 6] |
+                words[i + 7]) != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+
+#if defined(__x86_64__)
+/**
+ * @brief Test if the block is all zeros using SSE2 (every x86-64 CPU has
+ * it); 64 bytes are OR'ed together and tested at a time.
+ */
+boolean zeroBlockSSE2(const unsigned char *block, size_t len) {
+    __m128i accum;
+    size_t i = 0;
+
+    for (i = 0; i < len; i += 64) {
+        accum = _mm_or_si128(
+                _mm_or_si128(_mm_load_si128((const __m128i *) (block + i)),
+                _mm_load_si128((const __m128i *) (block + i + 16))),
+                _mm_or_si128(_mm_load_si128((const __m128i *) (block + i + 32)),
+                _mm_load_si128((const __m128i *) (block + i + 48))));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(accum,
+                _mm_setzero_si128())) != 0xFFFF)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+
+/**
+ * @brief Test if the block is all zeros using AVX2 (only called if the CPU
+ * has it); 128 bytes are OR'ed together and tested at a time.
+ */
+__attribute__((target("avx2")))
+boolean zeroBlockAVX2(const unsigned char *block, size_t len) {
+    __m256i accum;
+    size_t i = 0;
+
+    for (i = 0; (i + 128) <= len; i += 128) {
+        accum = _mm256_or_si256(
+                _mm256_or_si256(
+                _mm256_load_si256((const __m256i *) (block + i)),
+                _mm256_load_si256((const __m256i *) (block + i + 32))),
+                _mm256_or_si256(
+                _mm256_load_si256((const __m256i *) (block + i + 64)),
+                _mm256_load_si256((const __m256i *) (block + i + 96))));
+        if (!_mm256_testz_si256(accum, accum))
+            return FALSE;
+    }
+    /* Blocks are a multiple of 64 bytes, so there may be half left */
+    if (i < len)
+        return zeroBlockSSE2((block + i), (len - i));
+    return TRUE;
+}
+#endif
+
+
+/**
+ * @brief Return the fastest zero block test this CPU can run.
+ */
+zero_check_fn getZeroCheck() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return zeroBlockAVX2;
+    return zeroBlockSSE2;
+#else
+    return zeroBlockGeneric;
+#endif
+}
+
+
+/**
+ * @brief Sleep as long as it takes to bring the read rate (since the start
+ * time) down to the limit, in MiB/s; zero means no limit.
+ */
+void throttleReads(struct timespec *start, long long bytes_read,
+        int rate_limit) {
+    struct timespec now = {0}, pause = {0};
+    double wanted = 0, elapsed = 0;
+
+    if (rate_limit <= 0)
+        return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - start->tv_sec) +
+            ((now.tv_nsec - start->tv_nsec) / 1000000000.0);
+    wanted = bytes_read / ((double) rate_limit * MEBIBYTE_SIZE);
+    if (wanted <= elapsed)
+        return;
+    pause.tv_sec = (time_t) (wanted - elapsed);
+    pause.tv_nsec = (long) (((wanted - elapsed) - pause.tv_sec) * 1000000000.0);
+    while ((nanosleep(&pause, &pause) == -1) && (errno == EINTR))
+        ;
+}
+
+
+/**
+ * @brief Punch out a run of zero blocks (the file size stays the same).
+ * Return 0, or the errno value.
+ */
+int punchZeroRun(int fd, long long offset, long long length,
+        long long *punched) {
+    if (length <= 0)
+        return 0;
+    if (fallocate(fd, (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE),
+            offset, length) == -1)
+        return errno;
+    *punched += length;
+    return 0;
+}
+
+
+/**
+ * @brief Reclaim the space used by zeroed blocks in a virtual disk file:
+ * the data extents (holes are skipped) are read in large sequential chunks
+ * (O_DIRECT if the file system supports it), each file system block is
+ * tested with a vectorized zero check, and runs of zero blocks are punched
+ * out (FALLOC_FL_PUNCH_HOLE) so they read back the same. The reads are
+ * limited to 'rate_limit' MiB/s. The file must not be in use; a block
+ * written between our read and the punch would be lost. The bytes freed are
+ * set, and on failure the error message is filled and FALSE is returned.
+ */
+boolean reclaimVDiskFile(const char *path, int rate_limit,
+        vdisk_progress_fn progress, void *progress_arg,
+        long long *reclaimed, char error_msg[]) {
+    struct stat file_stat = {0};
+    struct timespec start = {0};
+    zero_check_fn zero_check = getZeroCheck();
+    unsigned char *buffer = NULL;
+    off_t data_start = 0, hole_start = 0;
+    long long offset = 0, extent_end = 0, run_start = -1, block_size = 0,
+            blocks_before = 0, done = 0, total = 0, last_report = 0,
+            punched = 0, pos = 0;
+    ssize_t bytes_read = 0;
+    int fd = -1, ret_val = 0, punch_errno = 0, read_errno = 0, fd_flags = 0;
+    boolean success = FALSE, cancelled = FALSE;
+
+    *reclaimed = 0;
+    if ((fd = open(path, (O_RDWR | O_DIRECT))) == -1) {
+        if ((errno != EINVAL) || ((fd = open(path, O_RDWR)) == -1)) {
+            snprintf(error_msg, MISC_STRING_LEN, "open(): %s",
+                    strerror(errno));
+            return FALSE;
+        }
+        DEBUG_LOG("No O_DIRECT support for %s; using buffered reads.", path);
+    }
+    if (fstat(fd, &file_stat) == -1) {
+        snprintf(error_msg, MISC_STRING_LEN, "fstat(): %s", strerror(errno));
+        close(fd);
+        return FALSE;
+    }
+    blocks_before = file_stat.st_blocks;
+
+    /* Holes can only be punched in whole file system blocks */
+    block_size = file_stat.st_blksize;
+    if ((block_size < 512) || (block_size > VDISK_RECLAIM_READ_SIZE) ||
+            ((VDISK_RECLAIM_READ_SIZE % block_size) != 0))
+        block_size = VDISK_DIRECT_ALIGN;
+    if ((ret_val = posix_memalign((void **) &buffer, VDISK_DIRECT_ALIGN,
+            VDISK_RECLAIM_READ_SIZE)) != 0) {
+        snprintf(error_msg, MISC_STRING_LEN, "posix_memalign(): %s",
+                strerror(ret_val));
+        close(fd);
+        return FALSE;
+    }
+
+    total = fileDataBytes(fd, file_stat.st_size);
+    if (progress != NULL)
+        progress(progress_arg, 0, total);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (1) {
+        /* The next data extent (ENXIO means the rest is a hole) */
+        if ((data_start = lseek(fd, offset, SEEK_DATA)) == -1) {
+            if (errno == ENXIO) {
+                success = TRUE;
+            } else {
+                snprintf(error_msg, MISC_STRING_LEN, "lseek(): %s",
+                        strerror(errno));
+            }
+            break;
+        }
+        if ((hole_start = lseek(fd, data_start, SEEK_HOLE)) == -1) {
+            snprintf(error_msg, MISC_STRING_LEN, "lseek(): %s",
+                    strerror(errno));
+            break;
+        }
+        /* Only whole blocks can be tested (and punched) */
+        offset = data_start - (data_start % block_size);
+        extent_end = MIN(hole_start, file_stat.st_size);
+        if (offset >= extent_end) {
+            success = TRUE;
+            break;
+        }
+
+        while (offset < extent_end) {
+            if ((bytes_read = pread(fd, buffer, MIN(VDISK_RECLAIM_READ_SIZE,
+                    (((extent_end - offset) + (block_size - 1)) /
+                    block_size) * block_size), offset)) == -1) {
+                if ((read_errno = errno) == EINTR)
+                    continue;
+                /* Some file systems only take O_DIRECT at open(); retry
+                 * buffered, but only once (if it was still set) */
+                if ((read_errno == EINVAL) && ((fd_flags = fcntl(fd,
+                        F_GETFL)) != -1) && (fd_flags & O_DIRECT) &&
+                        (fcntl(fd, F_SETFL, (fd_flags & ~O_DIRECT)) == 0))
+                    continue;
+                break;
+            }
+            if (bytes_read == 0)
+                break;
+
+            for (pos = 0; pos < bytes_read; pos += block_size) {
+                /* A partial block at the end of the file is left alone */
+                if (((pos + block_size) <= bytes_read) &&
+                        zero_check((buffer + pos), block_size)) {
+                    if (run_start == -1)
+                        run_start = offset + pos;
+                } else if (run_start != -1) {
+                    if ((punch_errno = punchZeroRun(fd, run_start,
+                            ((offset + pos) - run_start), &punched)) != 0)
+                        break;
+                    run_start = -1;
+                }
+            }
+            if (punch_errno != 0)
+                break;
+            if ((fcntl(fd, F_GETFL) & O_DIRECT) == 0)
+                posix_fadvise(fd, offset, bytes_read, POSIX_FADV_DONTNEED);
+            done += MIN(bytes_read, (extent_end - offset));
+            offset += bytes_read;
+            if ((progress != NULL) &&
+                    ((done - last_report) >= VDISK_PROGRESS_BYTES)) {
+                last_report = done;
+                /* What was punched so far stays punched (it was zeros) */
+                if (!progress(progress_arg, done, total)) {
+                    cancelled = TRUE;
+                    break;
+                }
+            }
+            throttleReads(&start, done, rate_limit);
+        }
+        if ((bytes_read == -1) || (punch_errno != 0) || cancelled)
+            break;
+
+        /* A run can't carry on past the end of the extent */
+        if ((run_start != -1) && ((punch_errno = punchZeroRun(fd, run_start,
+                (offset - run_start), &punched)) != 0))
+            break;
+        run_start = -1;
+        if (offset < extent_end) {
+            /* The file got shorter while we read it */
+            success = TRUE;
+            break;
+        }
+    }
+    if (cancelled) {
+        snprintf(error_msg, MISC_STRING_LEN, "Cancelled.");
+        success = FALSE;
+    } else if (bytes_read == -1) {
+        snprintf(error_msg, MISC_STRING_LEN, "pread(): %s",
+                strerror(read_errno));
+        success = FALSE;
+    } else if (punch_errno != 0) {
+        snprintf(error_msg, MISC_STRING_LEN, "fallocate(PUNCH_HOLE): %s%s",
+                strerror(punch_errno), ((punch_errno == EOPNOTSUPP) ?
+                " (not supported by this file system)" : ""));
+        success = FALSE;
+    }
+
+    if (success && (fsync(fd) == -1)) {
+        snprintf(error_msg, MISC_STRING_LEN, "fsync(): %s", strerror(errno));
+        success = FALSE;
+    }
+    if (success && (progress != NULL))
+        progress(progress_arg, total, total);
+
+    /* What was actually freed (punching a block that was never written
+     * frees nothing) */
+    if (fstat(fd, &file_stat) == 0)
+        *reclaimed = MAX(0, (blocks_before - file_stat.st_blocks) * 512LL);
+    DEBUG_LOG("Punched %lld bytes (%lld bytes freed) in %s.", punched,
+            *reclaimed, path);
+    close(fd);
+    free(buffer);
+    return success;
+}
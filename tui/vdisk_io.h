@@ -0,0 +1,78 @@
+/**
+ * @file vdisk_io.h
+ * @brief Data structures and settings for creating virtual disk files.
+ * @author Copyright (c) 2012-2017 Marc A. Smith
+ */
+
+#ifndef _VDISK_IO_H
+#define	_VDISK_IO_H
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <pthread.h>
+
+#include "system.h"
+
+/* The eager-zero writes; large aligned O_DIRECT writes (of the same zero
+ * buffer) with a number of them in flight at once */
+#define VDISK_DIRECT_SIZE       4194304
+#define VDISK_DIRECT_ALIGN      4096
+#define VDISK_DEF_QUEUE_DEPTH   8
+#define MAX_VDISK_QUEUE_DEPTH   64
+/* How often (bytes written) the progress is reported */
+#define VDISK_PROGRESS_BYTES    268435456LL
+
+/* Cloning (when the file system can't share the extents); each thread
+ * copies one chunk of a data extent at a time, holes are skipped */
+#define VDISK_CLONE_CHUNK       67108864LL
+#define VDISK_CLONE_BUFF_SIZE   1048576
+#define VDISK_DEF_CLONE_THREADS 4
+#define MAX_VDISK_CLONE_THREADS 16
+
+/* Reclaiming zeroed space; the data is read in large sequential chunks and
+ * any all-zero file system blocks are punched out, with the reads limited
+ * to a rate (MiB/s, zero is no limit) so live I/O isn't starved */
+#define VDISK_RECLAIM_READ_SIZE 8388608
+#define VDISK_DEF_RECLAIM_RATE  200
+#define MAX_VDISK_RECLAIM_RATE  100000
+
+/* How the space for a new virtual disk file is provisioned; the order
+ * matches the radio widget options */
+typedef enum {
+    VDISK_THIN, VDISK_LAZY_THICK, VDISK_EAGER_ZERO
+} vdisk_prov_t;
+
+/* Called with the bytes done so far (and the total) while a file is
+ * written; it's called from whichever thread is doing the writing. If it
+ * returns FALSE, the work is cancelled (and fails) */
+typedef boolean (*vdisk_progress_fn)(void *arg, long long done,
+        long long total);
+
+/* Tests if a block (a multiple of 64 bytes long) is all zeros */
+typedef boolean (*zero_check_fn)(const unsigned char *block, size_t len);
+
+/* Shared by the copy threads while cloning a file; the next chunk to copy
+ * is found (and the progress is reported) with the lock held */
+typedef struct {
+    int src_fd;
+    int dst_fd;
+    long long size;
+    long long next_off;
+    long long extent_end;
+    long long done;
+    long long total;
+    long long last_report;
+    vdisk_progress_fn progress;
+    void *progress_arg;
+    int error;
+    char error_func[MISC_STRING_LEN];
+    pthread_mutex_t mutex;
+} vdisk_clone_t;
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* _VDISK_IO_H */